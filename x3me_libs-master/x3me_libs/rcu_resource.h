@@ -1,16 +1,75 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 #include "thread_common.h"
 #include "spin_lock.h"
+#include "x3me_assert.h"
 
 namespace x3me
 {
 namespace thread
 {
+namespace detail
+{
+
+// Gives small unique indexes to the threads which read rcu_resources.
+// The indexes are reused when the threads exit, so that the number of the
+// reader slots in the rcu_resource can stay small and fixed.
+class rcu_reader_ids
+{
+    std::mutex mutex_;
+    std::vector<uint32_t> free_ids_;
+    uint32_t next_id_ = 0;
+
+public:
+    static rcu_reader_ids& instance() noexcept
+    {
+        static rcu_reader_ids inst;
+        return inst;
+    }
+
+    uint32_t acquire() noexcept
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        if (free_ids_.empty())
+            return next_id_++;
+        const auto ret = free_ids_.back();
+        free_ids_.pop_back();
+        return ret;
+    }
+
+    void release(uint32_t id) noexcept
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        free_ids_.push_back(id);
+    }
+};
+
+struct rcu_reader_id
+{
+    // The registry must be created before and destroyed after
+    // the thread local ids.
+    rcu_reader_ids& ids_ = rcu_reader_ids::instance();
+    const uint32_t id_   = ids_.acquire();
+
+    ~rcu_reader_id() noexcept { ids_.release(id_); }
+};
+
+inline uint32_t rcu_this_reader_id() noexcept
+{
+    thread_local rcu_reader_id id;
+    return id.id_;
+}
+
+} // namespace detail
+////////////////////////////////////////////////////////////////////////////////
 
 // The class implements the ideas of the Read-Copy-Update (RCU) technique,
 // which is widely used in the Linux kernel in a slightly different manner.
@@ -23,6 +82,15 @@ namespace thread
 // This makes them more inefficient than the upcoming atomic_shared_ptr which
 // embeds the needed spin lock inside the given instance.
 // The same thing is done in this functionality.
+//
+// The read_copy operation still takes the spin lock and increments the
+// shared reference count. Both touch a cache line shared by all readers.
+// The read operation is lock free and doesn't write to shared memory.
+// Every reader thread publishes the pointer it reads in its own reader
+// slot (a hazard pointer). The update and release operations wait until
+// the replaced resource is no longer published by any reader, before
+// dropping their reference to it. Thus the updates get more expensive,
+// but they are supposed to be rare.
 template <typename T>
 class rcu_resource
 {
@@ -30,11 +98,66 @@ public:
     using type          = typename std::add_const<T>::type;
     using resource_type = std::shared_ptr<type>;
 
+    // The threads with bigger reader indexes fall back to read_copy.
+    static constexpr uint32_t max_readers = 64;
+
 private:
     using lock_guard_t = std::lock_guard<spin_lock>;
 
+    struct alignas(64) reader_slot
+    {
+        std::atomic<type*> ptr_{nullptr};
+    };
+
     resource_type resource_;
+    // Points to the same object as the resource_.
+    // It's read by the lock free readers.
+    std::atomic<type*> ptr_{resource_.get()};
     mutable spin_lock lock_;
+    mutable std::array<reader_slot, max_readers> slots_;
+
+public:
+    // Keeps the resource alive while the reader works with it.
+    // Must be destroyed on the thread which created it and before the
+    // rcu_resource. Must not outlive the current reader operation,
+    // because it delays the updates of the rcu_resource.
+    class read_ptr
+    {
+        type* ptr_ = nullptr;
+        // Null if the object doesn't own the reader slot.
+        std::atomic<type*>* slot_ = nullptr;
+        // Used when the thread doesn't have a reader slot.
+        resource_type res_;
+
+    public:
+        read_ptr(type* p, std::atomic<type*>* slot, resource_type&& r) noexcept
+            : ptr_(p),
+              slot_(slot),
+              res_(std::move(r))
+        {
+        }
+        ~read_ptr() noexcept
+        {
+            if (slot_)
+                slot_->store(nullptr, std::memory_order_release);
+        }
+
+        read_ptr(read_ptr&& rhs) noexcept : ptr_(rhs.ptr_),
+                                            slot_(rhs.slot_),
+                                            res_(std::move(rhs.res_))
+        {
+            rhs.ptr_  = nullptr;
+            rhs.slot_ = nullptr;
+        }
+        read_ptr& operator=(read_ptr&&) = delete;
+        read_ptr(const read_ptr&) = delete;
+        read_ptr& operator=(const read_ptr&) = delete;
+
+        type* get() const noexcept { return ptr_; }
+        type* operator->() const noexcept { return ptr_; }
+        type& operator*() const noexcept { return *ptr_; }
+        explicit operator bool() const noexcept { return !!ptr_; }
+    };
 
 public:
     rcu_resource() noexcept {}
@@ -74,12 +197,48 @@ public:
         return resource_;
     }
 
+    // Lock free. Nested reads of the same resource on the same thread
+    // return the resource seen by the outermost read.
+    // The thread must not update or release the resource while it holds
+    // a read_ptr to it.
+    read_ptr read() const noexcept
+    {
+        const auto id = detail::rcu_this_reader_id();
+        if (id >= max_readers)
+        {
+            auto r = read_copy();
+            auto p = r.get();
+            return read_ptr(p, nullptr, std::move(r));
+        }
+        auto& slot = slots_[id].ptr_;
+        // Only this thread writes to its slot.
+        if (auto p = slot.load(std::memory_order_relaxed))
+            return read_ptr(p, nullptr, resource_type{});
+
+        auto p = ptr_.load(std::memory_order_acquire);
+        for (;;)
+        {
+            // The publishing must be visible before the second load,
+            // and the updater must see it before scanning the slots.
+            slot.store(p, std::memory_order_seq_cst);
+            auto p2 = ptr_.load(std::memory_order_seq_cst);
+            if (p2 == p)
+                break;
+            p = p2;
+        }
+        return read_ptr(p, &slot, resource_type{});
+    }
+
+    // The update and release wait for the readers of the replaced resource.
+    // Calling them while holding a read_ptr to it aborts the process.
     void update(resource_type r) noexcept
     {
         {
             lock_guard_t _(lock_);
             resource_.swap(r);
+            ptr_.store(resource_.get(), std::memory_order_seq_cst);
         }
+        wait_readers(r.get());
         // Do the potential destruction of 'r' outside the critical section
     }
 
@@ -95,10 +254,33 @@ public:
         {
             lock_guard_t _(lock_);
             resource_.swap(ret);
+            ptr_.store(nullptr, std::memory_order_seq_cst);
         }
+        wait_readers(ret.get());
         return ret;
     }
+
+private:
+    void wait_readers(type* p) const noexcept
+    {
+        if (!p)
+            return;
+        // Waiting for our own reader slot would never end
+        const auto id = detail::rcu_this_reader_id();
+        X3ME_ENFORCE((id >= max_readers) ||
+                         (slots_[id].ptr_.load(std::memory_order_relaxed) != p),
+                     "The resource can't be updated while it's being read "
+                     "by the same thread");
+        for (const auto& s : slots_)
+        {
+            while (s.ptr_.load(std::memory_order_seq_cst) == p)
+                std::this_thread::yield();
+        }
+    }
 };
 
+template <typename T>
+constexpr uint32_t rcu_resource<T>::max_readers;
+
 } // namespace thread
 } // namespace x3me
@@ -1,3 +1,4 @@
+#include <thread>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -12,7 +13,18 @@ using rcu_arr_t = rcu_resource<int_arr_t>;
 ////////////////////////////////////////////////////////////////////////////////
 // The actual thread safety of the rcu_resource functionality is not tested
 // in these unit tests. I couldn't figure out a way to reliably test it with
-// unit tests.
+// unit tests. The concurrent tests below only check that the readers never
+// see partially updated or destroyed resource.
+
+namespace
+{
+
+uint32_t cnt_reader_threads() noexcept
+{
+    return std::min(std::max(std::thread::hardware_concurrency(), 2U), 8U);
+}
+
+} // namespace
 
 BOOST_AUTO_TEST_SUITE(tests_rcu_resource)
 
@@ -117,4 +129,67 @@ BOOST_AUTO_TEST_CASE(test_update)
     BOOST_CHECK_EQUAL(r->at(2), 6);
 }
 
+BOOST_AUTO_TEST_CASE(test_read)
+{
+    auto t  = {1, 2, 3};
+    auto t2 = {4, 5, 6};
+    rcu_arr_t arr;
+    BOOST_CHECK(!arr.read());
+    arr.update(x3me::thread::in_place, t);
+    {
+        auto r = arr.read();
+        BOOST_REQUIRE(r);
+        BOOST_CHECK_EQUAL(r->at(0), 1);
+        // Nested reads see the same resource
+        auto r2 = arr.read();
+        BOOST_CHECK_EQUAL(r2.get(), r.get());
+    }
+    arr.update(x3me::thread::in_place, t2);
+    auto r = arr.read();
+    BOOST_CHECK_EQUAL(r->at(0), 4);
+    BOOST_CHECK_EQUAL((*r)[2], 6);
+}
+
+BOOST_AUTO_TEST_CASE(test_read_released)
+{
+    auto t = {1, 2, 3};
+    rcu_arr_t arr(x3me::thread::in_place, t);
+    auto r = arr.release();
+    BOOST_CHECK(!arr.read());
+    BOOST_CHECK_EQUAL(r->at(0), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_concurrent_read_update)
+{
+    constexpr int arr_size = 64;
+    rcu_arr_t arr(x3me::thread::in_place, arr_size, 0);
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint32_t> cnt_errors{0};
+    std::vector<std::thread> readers;
+    for (uint32_t i = 0; i < cnt_reader_threads(); ++i)
+    {
+        readers.emplace_back([&]
+                             {
+                                 while (!stop.load(std::memory_order_relaxed))
+                                 {
+                                     auto r = arr.read();
+                                     const auto v = r->front();
+                                     for (auto e : *r)
+                                     {
+                                         if (e != v)
+                                             ++cnt_errors;
+                                     }
+                                 }
+                             });
+    }
+    for (int i = 1; i <= 10000; ++i)
+        arr.update(x3me::thread::in_place, arr_size, i);
+    stop = true;
+    for (auto& t : readers)
+        t.join();
+    BOOST_CHECK_EQUAL(cnt_errors.load(), 0);
+    BOOST_CHECK_EQUAL(arr.read()->back(), 10000);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
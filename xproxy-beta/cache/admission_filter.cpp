@@ -0,0 +1,120 @@
+#include "precompiled.h"
+#include "admission_filter.h"
+#include "cache_stats.h"
+
+namespace cache
+{
+namespace detail
+{
+
+constexpr uint32_t admission_filter::cnt_rows;
+constexpr uint8_t admission_filter::max_count;
+constexpr uint32_t admission_filter::reset_mult;
+constexpr uint32_t admission_filter::min_row_size;
+constexpr uint32_t admission_filter::max_row_size;
+constexpr uint16_t admission_filter::max_min_requests;
+
+admission_filter::admission_filter() noexcept
+{
+}
+
+admission_filter::~admission_filter() noexcept
+{
+}
+
+void admission_filter::init(const admission_cfg& cfg) noexcept
+{
+    X3ME_ENFORCE(cfg.min_requests_ <= max_min_requests,
+                 "The min requests can't be counted");
+    cfg_ = cfg;
+    if (!enabled())
+        return;
+
+    uint32_t row_size = min_row_size;
+    while ((row_size < cfg.sketch_entries_) && (row_size < max_row_size))
+        row_size <<= 1;
+    row_mask_   = row_size - 1;
+    reset_size_ = uint64_t(row_size) * reset_mult;
+    counters_.reset(new std::atomic<uint8_t>[cnt_rows * row_size]);
+    for (uint32_t i = 0; i < cnt_rows * row_size; ++i)
+        counters_[i].store(0, std::memory_order_relaxed);
+}
+
+bool admission_filter::admit(const fs_node_key_t& key,
+                             bytes64_t obj_size) noexcept
+{
+    if (!enabled())
+        return true;
+
+    // Count the request even if the object gets admitted due to its size.
+    const auto cnt = inc_count(key);
+    const bool res =
+        (cnt >= cfg_.min_requests_) ||
+        ((cfg_.bypass_size_ > 0) && (obj_size >= cfg_.bypass_size_));
+    if (res)
+        cnt_admitted_.fetch_add(1, std::memory_order_relaxed);
+    else
+        cnt_rejected_.fetch_add(1, std::memory_order_relaxed);
+    return res;
+}
+
+void admission_filter::get_stats(stats_internal& sts) const noexcept
+{
+    sts.cnt_admit_ok_       = cnt_admitted_.load(std::memory_order_relaxed);
+    sts.cnt_admit_rejected_ = cnt_rejected_.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint8_t admission_filter::inc_count(const fs_node_key_t& key) noexcept
+{
+    // The key is a MD5 hash and thus it's already well distributed.
+    // We use its two halves to derive the indexes in the separate rows.
+    static_assert(sizeof(fs_node_key_t) >= 2 * sizeof(uint64_t),
+                  "The key must contain at least two uint64_t values");
+    uint64_t h1, h2;
+    ::memcpy(&h1, key.data(), sizeof(h1));
+    ::memcpy(&h2, key.data() + sizeof(h1), sizeof(h2));
+
+    std::array<std::atomic<uint8_t>*, cnt_rows> cnts;
+    uint8_t min_cnt = max_count;
+    for (uint32_t i = 0; i < cnt_rows; ++i)
+    {
+        const auto idx = (h1 + i * h2) & row_mask_;
+        cnts[i]        = &counters_[(i * (row_mask_ + 1)) + idx];
+        min_cnt = std::min(min_cnt, cnts[i]->load(std::memory_order_relaxed));
+    }
+    if (min_cnt < max_count)
+    {
+        // Conservative update. Increment only the smallest counters.
+        // A failed exchange means concurrent update of the counter.
+        // We don't care about it, the count is approximate anyway.
+        for (auto c : cnts)
+        {
+            auto v = min_cnt;
+            c->compare_exchange_weak(v, min_cnt + 1, std::memory_order_relaxed);
+        }
+        ++min_cnt;
+    }
+
+    if (((cnt_incs_.fetch_add(1, std::memory_order_relaxed) + 1) %
+         reset_size_) == 0)
+        reset_counters();
+
+    return min_cnt;
+}
+
+void admission_filter::reset_counters() noexcept
+{
+    // It's possible to lose some increments happening concurrently
+    // with the reset, but this doesn't matter for us.
+    for (uint32_t i = 0; i < cnt_rows * (row_mask_ + 1); ++i)
+    {
+        auto& c = counters_[i];
+        c.store(c.load(std::memory_order_relaxed) >> 1,
+                std::memory_order_relaxed);
+    }
+}
+
+} // namespace detail
+} // namespace cache
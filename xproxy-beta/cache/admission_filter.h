@@ -0,0 +1,81 @@
+#pragma once
+
+#include "fs_node_key.h"
+
+namespace cache
+{
+struct stats_internal;
+namespace detail
+{
+
+struct admission_cfg
+{
+    // An object is admitted for writing on its N-th request.
+    // Zero or one means that all objects are admitted.
+    uint16_t min_requests_ = 0;
+    // Objects with this size or bigger are admitted on their first request.
+    // Zero disables the size check.
+    bytes64_t bypass_size_ = 0;
+    // The approximate number of objects whose requests are counted.
+    uint32_t sketch_entries_ = 0;
+};
+
+// Admission filter for the cache write path, like the TinyLFU one.
+// The requests for every object are counted in a count-min sketch with
+// small saturating counters. The counters are halved periodically, so that
+// the filter forgets the old popularity. This way the objects requested
+// only once don't get written and don't evict the useful content from the
+// cyclic cache log.
+// The counting is approximate and lock free. Concurrent updates may get
+// lost once in a while, but this doesn't matter for the filter purposes.
+class admission_filter
+{
+    static constexpr uint32_t cnt_rows  = 4;
+    static constexpr uint8_t max_count  = 15;
+    // The counters are halved after so many requests per sketch entry.
+    static constexpr uint32_t reset_mult   = 10;
+    static constexpr uint32_t min_row_size = 1024;
+    static constexpr uint32_t max_row_size = 1U << 28;
+
+    std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+    uint32_t row_mask_   = 0;
+    uint64_t reset_size_ = 0;
+    std::atomic<uint64_t> cnt_incs_{0};
+
+    admission_cfg cfg_;
+
+    std::atomic<uint64_t> cnt_admitted_{0};
+    std::atomic<uint64_t> cnt_rejected_{0};
+
+public:
+    static constexpr uint16_t max_min_requests = max_count;
+
+    admission_filter() noexcept;
+    ~admission_filter() noexcept;
+
+    admission_filter(const admission_filter&) = delete;
+    admission_filter& operator=(const admission_filter&) = delete;
+    admission_filter(admission_filter&&) = delete;
+    admission_filter& operator=(admission_filter&&) = delete;
+
+    // Not thread safe. Must be called before the filter gets used.
+    void init(const admission_cfg& cfg) noexcept;
+
+    // The functions below are thread safe.
+
+    // Counts the request for the given object and returns true if the
+    // object should be written to the cache.
+    bool admit(const fs_node_key_t& key, bytes64_t obj_size) noexcept;
+
+    void get_stats(stats_internal& sts) const noexcept;
+
+    bool enabled() const noexcept { return cfg_.min_requests_ > 1; }
+
+private:
+    // Returns the estimated count of requests including the current one.
+    uint8_t inc_count(const fs_node_key_t& key) noexcept;
+    void reset_counters() noexcept;
+};
+
+} // namespace detail
+} // namespace cache
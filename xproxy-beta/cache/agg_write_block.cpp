@@ -15,7 +15,7 @@ static_assert((agg_write_meta_size % volume_blocks64_t::block_size) == 0, "");
 static_assert((agg_write_block_size % volume_blocks64_t::block_size) == 0, "");
 
 agg_write_block::agg_write_block() noexcept
-    : block_meta_(agg_write_meta_size),
+    : block_meta_(agg_write_meta_size, true /*with journal*/),
       block_data_(alloc_page_aligned(agg_write_block_size)),
       buff_pos_(volume_blocks64_t::create_from_bytes(agg_write_meta_size))
 {
@@ -95,11 +95,28 @@ bool agg_write_block::try_read_fragment(const fs_node_key_t& key,
     return false;
 }
 
+void agg_write_block::jrnl_rem_key(const fs_node_key_t& key) noexcept
+{
+    if (pending_disk_write_)
+    {
+        // The metadata has already been serialized. The removal will be
+        // recorded in the next block, which is correct because the entries
+        // for this key in the current block were added before the removal.
+        pend_rem_keys_.push_back(key);
+        return;
+    }
+    block_meta_.rem_entries(key);
+    if (!block_meta_.add_rem_key(key))
+        jrnl_broken_ = true;
+}
+
 agg_write_block::agg_ro_buff_t
-agg_write_block::begin_disk_write(stats_fs_wr& sts) noexcept
+agg_write_block::begin_disk_write(uint64_t write_lap,
+                                  stats_fs_wr& sts) noexcept
 {
     pending_disk_write_ = true;
     // Save the metadata at the beginning of the memory block
+    block_meta_.set_jrnl_info(jrnl_fs_uuid_, write_lap);
     memory_writer w(block_data_.get(), agg_write_meta_size);
     block_meta_.save(w);
     // We write to disk in store block size.
@@ -121,7 +138,17 @@ std::vector<agg_meta_entry> agg_write_block::end_disk_write() noexcept
     buff_pos_ = volume_blocks64_t::create_from_bytes(agg_write_meta_size);
 
     // Return the entries and reset the meta with one call
-    return block_meta_.release_entries();
+    auto ret = block_meta_.release_entries();
+
+    block_meta_.clear_jrnl();
+    for (const auto& key : pend_rem_keys_)
+    {
+        if (!block_meta_.add_rem_key(key))
+            jrnl_broken_ = true;
+    }
+    pend_rem_keys_.clear();
+
+    return ret;
 }
 
 agg_write_block::agg_wr_buff_t agg_write_block::metadata_buff() noexcept
@@ -129,6 +156,11 @@ agg_write_block::agg_wr_buff_t agg_write_block::metadata_buff() noexcept
     return agg_wr_buff_t(block_data_.get(), agg_write_meta_size);
 }
 
+agg_write_block::agg_wr_buff_t agg_write_block::block_buff() const noexcept
+{
+    return agg_wr_buff_t(block_data_.get(), agg_write_block_size);
+}
+
 bytes32_t agg_write_block::bytes_avail() const noexcept
 {
     return buff_pos_.to_bytes() - agg_write_meta_size;
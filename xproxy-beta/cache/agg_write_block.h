@@ -25,9 +25,21 @@ class agg_write_block
     agg_write_meta block_meta_;
     aligned_data_ptr_t block_data_;
     volume_blocks64_t buff_pos_;
+    // The disk offset where the block content goes. The agg_writer sets it
+    // when it starts to fill the block for the given disk position.
+    volume_blocks64_t write_offs_ = volume_blocks64_t::zero();
+    // The keys removed while the block is written to the disk.
+    // They go to the journal of the next block.
+    agg_write_meta::rem_keys_t pend_rem_keys_;
+    // Written in the journal section of every block. Identifies the
+    // blocks written by the current FS.
+    uuid_t jrnl_fs_uuid_ = boost::uuids::nil_uuid();
     // The flag is needed only to ensure the correct usage of the class.
     // Will probably be removed in the future.
     bool pending_disk_write_ = false;
+    // Set if some removal couldn't be recorded in the journal. The journal
+    // can't be replayed past such block and thus full metadata save is needed.
+    bool jrnl_broken_ = false;
 
 public:
     agg_write_block() noexcept;
@@ -56,9 +68,24 @@ public:
                            volume_blocks64_t curr_write_offs,
                            frag_wr_buff_t buff) const noexcept;
 
+    // Records the removal of all entries for the given key in the journal.
+    // The entries for this key are removed from the block, if it's not
+    // currently written to the disk.
+    void jrnl_rem_key(const fs_node_key_t& key) noexcept;
+    void set_jrnl_fs_uuid(const uuid_t& fs_uuid) noexcept
+    {
+        jrnl_fs_uuid_ = fs_uuid;
+    }
+    // Returns the flag and resets it
+    bool reset_jrnl_broken() noexcept
+    {
+        return std::exchange(jrnl_broken_, false);
+    }
+
     // Returns read-only (RO) buffer
     using agg_ro_buff_t = x3me::mem_utils::array_view<const uint8_t>;
-    agg_ro_buff_t begin_disk_write(stats_fs_wr& sts) noexcept;
+    agg_ro_buff_t begin_disk_write(uint64_t write_lap,
+                                   stats_fs_wr& sts) noexcept;
     std::vector<agg_meta_entry> end_disk_write() noexcept;
 
     using agg_wr_buff_t = x3me::mem_utils::array_view<uint8_t>;
@@ -66,10 +93,18 @@ public:
     // It's unsafe the buffer to be used when there is a pending disk write
     // i.e. between the calls of begin_disk_write/end_disk_write.
     agg_wr_buff_t metadata_buff() noexcept;
+    // Unsafe method. Provides the whole memory block only for the purpose
+    // of its registration with the IO engine. The memory block doesn't
+    // change during the lifetime of the agg_write_block.
+    agg_wr_buff_t block_buff() const noexcept;
 
     bytes32_t bytes_avail() const noexcept;
     bytes32_t free_space() const noexcept;
 
+    void set_write_offs(volume_blocks64_t offs) noexcept { write_offs_ = offs; }
+    volume_blocks64_t write_offs() const noexcept { return write_offs_; }
+    bool pending_disk_write() const noexcept { return pending_disk_write_; }
+
     static constexpr volume_blocks64_t max_size() noexcept
     {
         return volume_blocks64_t::create_from_bytes(agg_write_block_size);
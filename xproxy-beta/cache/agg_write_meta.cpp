@@ -8,8 +8,14 @@ namespace cache
 namespace detail
 {
 
-agg_write_meta::agg_write_meta(bytes32_t meta_buff_size) noexcept
-    : max_cnt_entries_((meta_buff_size / sizeof(agg_meta_entry)) - 1)
+constexpr uint64_t agg_write_meta::hdr_ftr_magic;
+constexpr uint64_t agg_write_meta::jrnl_magic;
+
+agg_write_meta::agg_write_meta(bytes32_t meta_buff_size,
+                               bool with_jrnl) noexcept
+    : max_cnt_entries_((meta_buff_size / sizeof(agg_meta_entry)) - 1),
+      meta_buff_size_(meta_buff_size),
+      with_jrnl_(with_jrnl)
 {
     static_assert(
         sizeof(agg_meta_entry) >=
@@ -52,6 +58,31 @@ bool agg_write_meta::load(memory_reader& reader) noexcept
 
     entries_.swap(entries);
 
+    // The journal section is optional. The metadata is valid without it.
+    rem_keys_.clear();
+    has_jrnl_      = false;
+    jrnl_complete_ = true;
+    if (reader.remaining() >= jrnl_fixed_size())
+    {
+        reader.read(&magic, sizeof(magic));
+        if (magic == jrnl_magic)
+        {
+            count_t cnt_keys = 0;
+            count_t complete = 0;
+            reader.read(&jrnl_fs_uuid_, sizeof(jrnl_fs_uuid_));
+            reader.read(&jrnl_wr_lap_, sizeof(jrnl_wr_lap_));
+            reader.read(&cnt_keys, sizeof(cnt_keys));
+            reader.read(&complete, sizeof(complete));
+            if (reader.remaining() >= (cnt_keys * sizeof(fs_node_key_t)))
+            {
+                rem_keys_.resize(cnt_keys);
+                reader.read(rem_keys_.data(), cnt_keys * sizeof(fs_node_key_t));
+                has_jrnl_      = true;
+                jrnl_complete_ = (complete != 0);
+            }
+        }
+    }
+
     return true;
 }
 
@@ -70,14 +101,28 @@ void agg_write_meta::save(memory_writer& writer) noexcept
 
     // Footer magic
     writer.write(&magic, sizeof(magic));
+
+    if (has_jrnl_)
+    {
+        X3ME_ASSERT(with_jrnl_, "No space has been reserved for the journal");
+        const count_t cnt_keys = rem_keys_.size();
+        const count_t complete = jrnl_complete_;
+        writer.write(&jrnl_magic, sizeof(jrnl_magic));
+        writer.write(&jrnl_fs_uuid_, sizeof(jrnl_fs_uuid_));
+        writer.write(&jrnl_wr_lap_, sizeof(jrnl_wr_lap_));
+        writer.write(&cnt_keys, sizeof(cnt_keys));
+        writer.write(&complete, sizeof(complete));
+        writer.write(rem_keys_.data(), cnt_keys * sizeof(fs_node_key_t));
+    }
 }
 
 agg_write_meta::add_res
 agg_write_meta::add_entry(const fs_node_key_t& key,
                           const range_elem& rng) noexcept
 {
-    add_res ret =
-        (entries_.size() < max_cnt_entries_) ? add_res::ok : add_res::no_space;
+    add_res ret = fits(entries_.size() + 1, rem_keys_.size())
+                      ? add_res::ok
+                      : add_res::no_space;
     if (ret == add_res::ok)
     {
         auto overlap = [](const auto& lhs, const auto& rhs)
@@ -134,6 +179,20 @@ bool agg_write_meta::has_entry(const fs_node_key_t& key,
     return (it != entries_.end()) && (*it == e);
 }
 
+void agg_write_meta::rem_entries(const fs_node_key_t& key) noexcept
+{
+    auto beg = std::lower_bound(entries_.begin(), entries_.end(), key,
+                                [](const agg_meta_entry& e, const auto& k)
+                                {
+                                    return e.key() < k;
+                                });
+    auto end = std::find_if(beg, entries_.end(), [&key](const auto& e)
+                            {
+                                return !(e.key() == key);
+                            });
+    entries_.erase(beg, end);
+}
+
 void agg_write_meta::set_entries(entries_t&& entries) noexcept
 {
     std::sort(entries.begin(), entries.end());
@@ -147,5 +206,45 @@ agg_write_meta::entries_t agg_write_meta::release_entries() noexcept
     return ret;
 }
 
+bool agg_write_meta::add_rem_key(const fs_node_key_t& key) noexcept
+{
+    X3ME_ASSERT(with_jrnl_, "No space has been reserved for the journal");
+    if (!fits(entries_.size(), rem_keys_.size() + 1))
+    {
+        jrnl_complete_ = false;
+        return false;
+    }
+    rem_keys_.push_back(key);
+    return true;
+}
+
+void agg_write_meta::set_jrnl_info(const uuid_t& fs_uuid,
+                                   uint64_t write_lap) noexcept
+{
+    X3ME_ASSERT(with_jrnl_, "No space has been reserved for the journal");
+    jrnl_fs_uuid_ = fs_uuid;
+    jrnl_wr_lap_  = write_lap;
+    has_jrnl_     = true;
+}
+
+void agg_write_meta::clear_jrnl() noexcept
+{
+    rem_keys_.clear();
+    has_jrnl_      = false;
+    jrnl_complete_ = true;
+}
+
+bool agg_write_meta::fits(size_type cnt_entries, size_type cnt_rem_keys) const
+    noexcept
+{
+    if (!with_jrnl_)
+        return (cnt_entries <= max_cnt_entries_) && (cnt_rem_keys == 0);
+    const bytes64_t size = sizeof(hdr_ftr_magic) + sizeof(count_t) +
+                           (cnt_entries * sizeof(agg_meta_entry)) +
+                           sizeof(hdr_ftr_magic) + jrnl_fixed_size() +
+                           (cnt_rem_keys * sizeof(fs_node_key_t));
+    return size <= meta_buff_size_;
+}
+
 } // namespace detail
 } // namespace cache
@@ -11,28 +11,50 @@ class memory_reader;
 class memory_writer;
 class range;
 
+// The metadata of every aggregate block serves also as a journal of the
+// changes in the fs_table since the last full metadata save (checkpoint).
+// The added entries are the entries of the block itself. The removed, due to
+// truncation, keys are kept in a journal section written after the footer.
+// The section contains also the FS uuid and the write lap of the block,
+// so that on load we can find out which blocks are written after the
+// checkpoint. Blocks written by older versions don't have this section
+// and their metadata is still loadable.
 class agg_write_meta
 {
 public:
-    using entries_t = std::vector<agg_meta_entry>;
+    using entries_t  = std::vector<agg_meta_entry>;
+    using rem_keys_t = std::vector<fs_node_key_t>;
 
 private:
     using count_t = uint32_t;
 
     static constexpr uint64_t hdr_ftr_magic = 0xDEADBED01DEBDAED;
+    static constexpr uint64_t jrnl_magic    = 0x10A1BEEFCAFE10A1;
 
     // We use sorted vector here (like boost::container::flat_set).
     // We don't use the boost one, because with the vector we can
     // do faster serialization/deserialization, just memcpy.
     entries_t entries_;
     count_t max_cnt_entries_;
+    const bytes32_t meta_buff_size_;
+
+    // The journal section
+    rem_keys_t rem_keys_;
+    uuid_t jrnl_fs_uuid_    = boost::uuids::nil_uuid();
+    uint64_t jrnl_wr_lap_   = 0;
+    const bool with_jrnl_;
+    bool has_jrnl_          = false;
+    bool jrnl_complete_     = true;
 
 public:
     using const_iterator = entries_t::const_iterator;
     using size_type      = entries_t::size_type;
 
 public:
-    explicit agg_write_meta(bytes32_t meta_buff_size) noexcept;
+    // The space for the journal section is reserved only if the metadata
+    // is going to be written with journal.
+    explicit agg_write_meta(bytes32_t meta_buff_size,
+                            bool with_jrnl = false) noexcept;
     ~agg_write_meta() noexcept;
 
     bool load(memory_reader& reader) noexcept;
@@ -53,9 +75,26 @@ public:
     bool has_entry(const fs_node_key_t& key, const range_elem& rng) const
         noexcept;
 
+    // Removes all entries for the given key
+    void rem_entries(const fs_node_key_t& key) noexcept;
+
     void set_entries(entries_t&& entries) noexcept;
     entries_t release_entries() noexcept;
 
+    // Returns false if there is no space for the key. The journal gets
+    // marked as incomplete in this case.
+    bool add_rem_key(const fs_node_key_t& key) noexcept;
+    // Sets the journal information which is going to be written on save.
+    void set_jrnl_info(const uuid_t& fs_uuid, uint64_t write_lap) noexcept;
+    void clear_jrnl() noexcept;
+
+    // These are valid only if the journal section has been loaded.
+    bool has_jrnl() const noexcept { return has_jrnl_; }
+    bool jrnl_complete() const noexcept { return jrnl_complete_; }
+    const uuid_t& jrnl_fs_uuid() const noexcept { return jrnl_fs_uuid_; }
+    uint64_t jrnl_write_lap() const noexcept { return jrnl_wr_lap_; }
+    const rem_keys_t& rem_keys() const noexcept { return rem_keys_; }
+
     void clear() noexcept { return entries_.clear(); }
 
     const_iterator begin() const noexcept { return entries_.begin(); }
@@ -66,6 +105,14 @@ public:
     size_type cnt_entries() const noexcept { return entries_.size(); }
 
     size_type max_cnt_entries() const noexcept { return max_cnt_entries_; }
+
+private:
+    bool fits(size_type cnt_entries, size_type cnt_rem_keys) const noexcept;
+    static constexpr bytes32_t jrnl_fixed_size() noexcept
+    {
+        return sizeof(jrnl_magic) + sizeof(uuid_t) + sizeof(uint64_t) +
+               sizeof(count_t) + sizeof(count_t);
+    }
 };
 
 } // namespace detail
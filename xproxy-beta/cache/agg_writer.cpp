@@ -24,6 +24,11 @@ static Stat read_stat(const std::atomic<Stat>& cnt) noexcept
     return cnt.load(std::memory_order_acquire);
 }
 
+// The max gap between two fragments for evacuation which are read together
+// with a single disk read. Reading few hundred KB more is usually cheaper
+// than an additional disk seek.
+constexpr bytes64_t evac_max_read_gap = 256_KB;
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace awsm
 {
@@ -35,16 +40,33 @@ struct state_data
         write_transaction trans_;
     };
 
-    agg_write_meta evac_meta_{agg_write_meta_size};
+    // The entries for evacuation sorted by their disk offset. Neighbour
+    // fragments are read together with a single disk read and the first
+    // cnt_evac_batch_ entries are the ones currently read.
+    std::vector<agg_meta_entry> evac_entries_;
+    size_t cnt_evac_batch_ = 0;
     // TODO A possible optimization here is to use directly the
     // agg_write_block buffer and avoid additional allocation of the
-    // evacuation fragment.
-    aligned_data_ptr_t evac_frag_;
+    // evacuation buffer.
+    aligned_data_ptr_t evac_buff_;
+    std_clock_t::time_point evac_read_start_;
 
-    pending_data pend_data_;
+    // The final writes which didn't fit in the current block. They are
+    // written first, once the next block becomes ready.
+    std::vector<pending_data> pend_data_;
 
+    // The write position of the block which is currently filled.
     volume_blocks64_t write_pos_ = volume_blocks64_t::zero();
-    bool is_first_lap_           = false;
+    uint64_t write_lap_          = 0;
+
+    // The write position and the serialized content of the block which
+    // waits to be flushed to the disk.
+    volume_blocks64_t flush_pos_ = volume_blocks64_t::zero();
+    agg_write_block::agg_ro_buff_t flush_buff_;
+    // Set from the swap of the blocks until the flushed block gets committed.
+    bool flush_pending_ = false;
+    // Set if the current block gets full while the other one is flushed.
+    bool swap_needed_ = false;
 
     bytes64_t wr_pos() const noexcept { return write_pos_.to_bytes(); }
 };
@@ -79,28 +101,39 @@ struct sm_impl
         // clang-format off
         auto is_first_lap = [](agg_writer* w)
         { 
-            return w->sdata_->is_first_lap_;
+            return w->sdata_->write_lap_ == 0;
         };
         auto evac_needed = [](agg_writer* w)
         { 
-            return !w->sdata_->evac_meta_.empty();
+            return !w->sdata_->evac_entries_.empty();
+        };
+        auto flush_pending = [](agg_writer* w)
+        { 
+            return w->sdata_->flush_pending_;
         };
 
         auto enqueue_read_aio_op = [](agg_writer* w)
         { 
             w->enqueue_read_aio_op();
         };
-        auto enqueue_write_aio_op = [](agg_writer* w)
-        { 
-            w->enqueue_write_aio_op();
-        };
         auto begin_md_read = [](agg_writer* w){ w->begin_md_read(); };
         auto on_md_read = [](agg_writer* w, auto ev){ w->on_md_read(ev); };
         auto begin_evac = [](agg_writer* w){ w->begin_evac(); };
         auto on_evac_done = [](agg_writer* w, auto ev){ w->on_evac_done(ev); };
         auto write_pend_data = [](agg_writer* w){ w->write_pend_data(); };
+        auto write_pend_and_flush = [](agg_writer* w)
+        { 
+            w->write_pend_data(); 
+            w->enqueue_write_aio_op();
+        };
         auto do_write = [](agg_writer* w, auto ev){ w->do_write(ev); };
         auto do_fin_write = [](agg_writer* w, auto ev){ w->do_fin_write(ev); };
+        auto skip_write = [](agg_writer* w, auto ev){ w->skip_write(ev); };
+        auto pend_fin_write = [](agg_writer* w, auto ev)
+        { 
+            w->pend_fin_write(ev); 
+        };
+        auto swap_blocks = [](agg_writer* w){ w->swap_blocks(); };
         auto begin_flush = [](agg_writer* w){ w->begin_flush(); };
         auto on_flush_done = [](agg_writer* w, auto ev){ w->on_flush_done(ev); };
         auto do_last_flush = [](agg_writer* w){ w->do_last_flush(); };
@@ -117,31 +150,57 @@ struct sm_impl
         const auto wait_next_s      = "wait_next"_s;
         return make_transition_table(
             // First handle the aggregate fragment metadata reading
-            *begin_s + event<ev_do_next>[is_first_lap] / write_pend_data = 
-                                                                wait_write_s,
+            *begin_s + event<ev_do_next>[is_first_lap && !flush_pending] / 
+                                            write_pend_data = wait_write_s,
+            begin_s + event<ev_do_next>[is_first_lap && flush_pending] / 
+                                            write_pend_and_flush = async_flush1_s,
             begin_s + event<ev_do_next>[!is_first_lap] / enqueue_read_aio_op = 
                                                             async_md_read1_s,
             async_md_read1_s + event<ev_io_begin> / begin_md_read =
                                                             async_md_read2_s,
             async_md_read2_s + event<ev_io_done> / on_md_read = wait_next_s,
-            // Next handle evacuation one fragment at time.
+            // Next handle evacuation of batches of neighbour fragments.
             // "Loop" until all needed fragments are evacuated.
             wait_next_s + event<ev_do_next>[evac_needed] / enqueue_read_aio_op = 
                                                                 async_evac1_s,
             async_evac1_s + event<ev_io_begin> / begin_evac = async_evac2_s,
             async_evac2_s + event<ev_io_done> / on_evac_done = wait_next_s,
-            // Try to write pending, current and final. If we get out of space
-            // the given operation will enqueue a deferred flush event and
-            // we start async flush operation. We start from the beginning
-            // once the flush is done.
-            wait_next_s + event<ev_do_next>[!evac_needed] / write_pend_data = 
-                                                                wait_write_s,
+            // The current block can't take writes until its disk area gets
+            // evacuated. The final writes are kept for later.
+            async_md_read1_s + event<ev_do_write> / skip_write = 
+                                                            async_md_read1_s,
+            async_md_read2_s + event<ev_do_write> / skip_write = 
+                                                            async_md_read2_s,
+            async_evac1_s + event<ev_do_write> / skip_write = async_evac1_s,
+            async_evac2_s + event<ev_do_write> / skip_write = async_evac2_s,
+            async_md_read1_s + event<ev_do_fin_write> / pend_fin_write = 
+                                                            async_md_read1_s,
+            async_md_read2_s + event<ev_do_fin_write> / pend_fin_write = 
+                                                            async_md_read2_s,
+            async_evac1_s + event<ev_do_fin_write> / pend_fin_write = 
+                                                                async_evac1_s,
+            async_evac2_s + event<ev_do_fin_write> / pend_fin_write = 
+                                                                async_evac2_s,
+            // Try to write pending, current and final. The previous block,
+            // if any, gets flushed to the disk while we write to the current
+            // one. If we get out of space the current block is swapped with
+            // the flushed one. If the flush is still not done the swap waits
+            // for it. We start from the beginning after the swap.
+            wait_next_s + event<ev_do_next>[!evac_needed && !flush_pending] / 
+                                            write_pend_data = wait_write_s,
+            wait_next_s + event<ev_do_next>[!evac_needed && flush_pending] / 
+                                            write_pend_and_flush = async_flush1_s,
             wait_write_s + event<ev_do_write> / do_write = wait_write_s,
             wait_write_s + event<ev_do_fin_write> / do_fin_write = wait_write_s,
-            wait_write_s + event<ev_do_async_flush> / enqueue_write_aio_op =
+            wait_write_s + event<ev_do_async_flush> / swap_blocks = begin_s,
+            async_flush1_s + event<ev_do_write> / do_write = async_flush1_s,
+            async_flush1_s + event<ev_do_fin_write> / do_fin_write = 
                                                                 async_flush1_s,
             async_flush1_s + event<ev_io_begin> / begin_flush = async_flush2_s,
-            async_flush2_s + event<ev_io_done> / on_flush_done = begin_s,
+            async_flush2_s + event<ev_do_write> / do_write = async_flush2_s,
+            async_flush2_s + event<ev_do_fin_write> / do_fin_write = 
+                                                                async_flush2_s,
+            async_flush2_s + event<ev_io_done> / on_flush_done = wait_write_s,
             // Do final flush unconditionally, to simplify things
             *"wait_last_flush"_s + event<ev_last_flush> / do_last_flush = X
             );
@@ -157,8 +216,9 @@ auto event_type() // Gives the event type string
 
 class sm : private boost::sml::sm<sm_impl>
 {
-    using base_t           = boost::sml::sm<sm_impl>;
-    using deferred_event_t = boost::variant<boost::blank, ev_do_async_flush>;
+    using base_t = boost::sml::sm<sm_impl>;
+    using deferred_event_t =
+        boost::variant<boost::blank, ev_do_next, ev_do_async_flush>;
 
     static constexpr auto idx_no_event = 0;
     struct process_defr_ev : boost::static_visitor<>
@@ -205,13 +265,14 @@ public:
         defr_ev_ = ev;
     }
 
+    // The processing of a deferred event may enqueue another one.
     void process_defr_event() noexcept
     {
-        if (defr_ev_.which() != idx_no_event)
+        while (defr_ev_.which() != idx_no_event)
         {
+            auto ev = std::exchange(defr_ev_, deferred_event_t{});
             process_defr_ev proc{this};
-            boost::apply_visitor(proc, defr_ev_);
-            defr_ev_ = boost::blank{};
+            boost::apply_visitor(proc, ev);
         }
     }
 };
@@ -222,8 +283,9 @@ public:
 agg_writer::agg_writer(volume_blocks64_t write_pos, uint64_t write_lap) noexcept
     : sm_(this)
 {
-    sdata_->write_pos_    = write_pos;
-    sdata_->is_first_lap_ = (write_lap == 0);
+    sdata_->write_pos_ = write_pos;
+    sdata_->write_lap_ = write_lap;
+    curr_block()->set_write_offs(write_pos);
 }
 
 agg_writer::~agg_writer() noexcept
@@ -235,11 +297,12 @@ void agg_writer::start(non_owner_ptr_t<cache_fs_ops> fso) noexcept
 {
     XLOG_DEBUG(
         disk_tag,
-        "Create agg_writer {}. FS '{}'. Wr_pos {} bytes. Is_first_lap {}",
+        "Create agg_writer {}. FS '{}'. Wr_pos {} bytes. Wr_lap {}",
         log_ptr(this), fso->vol_path(), sdata_->wr_pos(),
-        sdata_->is_first_lap_);
+        sdata_->write_lap_);
     fs_ops_ = fso;
     sm_->process_event(awsm::ev_do_next{});
+    sm_->process_defr_event();
 }
 
 void agg_writer::stop_flush() noexcept
@@ -275,6 +338,37 @@ void agg_writer::get_stats(stats_fs_wr& swr) noexcept
     swr.cnt_evac_entries_todo_    = read_stat(stats_.cnt_evac_entries_todo_);
     swr.cnt_evac_entries_ok_      = read_stat(stats_.cnt_evac_entries_ok_);
     swr.cnt_evac_entries_err_     = read_stat(stats_.cnt_evac_entries_err_);
+    swr.cnt_evac_reads_           = read_stat(stats_.cnt_evac_reads_);
+    swr.evac_read_size_           = read_stat(stats_.evac_read_size_);
+    swr.evac_read_time_us_        = read_stat(stats_.evac_read_time_us_);
+}
+
+void agg_writer::set_jrnl_fs_uuid(const uuid_t& fs_uuid) noexcept
+{
+    for (auto& wblock : write_blocks_)
+        wblock->set_jrnl_fs_uuid(fs_uuid);
+}
+
+void agg_writer::jrnl_rem_key(const fs_node_key_t& key) noexcept
+{
+    // Both blocks are locked because the writer may swap them concurrently.
+    // The removal goes to the currently filled block. It's written to the
+    // disk after the flushed one and thus the removal is replayed after
+    // the entries for the key in the flushed block.
+    x3me::thread::with_synchronized(
+        write_blocks_[0], write_blocks_[1],
+        [this, &key](agg_write_block& b0, agg_write_block& b1)
+        {
+            ((curr_block_ == 0) ? b0 : b1).jrnl_rem_key(key);
+        });
+}
+
+bool agg_writer::reset_jrnl_broken() noexcept
+{
+    // Both flags need to be reset
+    const bool r0 = write_blocks_[0]->reset_jrnl_broken();
+    const bool r1 = write_blocks_[1]->reset_jrnl_broken();
+    return r0 || r1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -300,26 +394,31 @@ non_owner_ptr_t<const aio_data> agg_writer::on_begin_io_op() noexcept
 
 void agg_writer::on_end_io_op(const err_code_t& err) noexcept
 {
+    X3ME_ASSERT(io_pending_, "Wrong state logic");
+    io_pending_ = false;
     sm_->process_event(awsm::ev_io_done{&err});
     sm_->process_defr_event();
-    sm_->process_event(awsm::ev_do_next{});
-    sm_->process_defr_event();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // It's important that all aio tasks here are pushed at the beginning of
-// the aio_service queue. This way we make the other writes wait while we
-// evacuate or write the aggregation buffer to the disk.
+// the aio_service queue. This way the evacuation and the flush of the
+// aggregation buffers don't wait behind the other writes. The scheduling
+// classes of the agg_writer have zero deadline for the same reason.
 
 void agg_writer::enqueue_read_aio_op() noexcept
 {
-    aio_op_ = aio_op::read;
+    X3ME_ASSERT(!io_pending_, "Only one disk operation at a time");
+    io_pending_ = true;
+    aio_op_     = aio_op::read;
     fs_ops_->aios_push_front_write_queue(this);
 }
 
 void agg_writer::enqueue_write_aio_op() noexcept
 {
-    aio_op_ = aio_op::write;
+    X3ME_ASSERT(!io_pending_, "Only one disk operation at a time");
+    io_pending_ = true;
+    aio_op_     = aio_op::write;
     fs_ops_->aios_push_front_write_queue(this);
 }
 
@@ -330,7 +429,7 @@ void agg_writer::begin_md_read() noexcept
     // Use the metadata buffer of the aggregate block to read the
     // current write block metadata from the disk.
     const auto wpos = sdata_->wr_pos();
-    auto buf        = write_block_->metadata_buff();
+    auto buf        = curr_block()->metadata_buff();
     aio_data_.buf_  = buf.data();
     aio_data_.size_ = buf.size();
     aio_data_.offs_ = wpos;
@@ -341,7 +440,7 @@ void agg_writer::begin_md_read() noexcept
 
 void agg_writer::on_md_read(const awsm::ev_io_done& ev) noexcept
 {
-    X3ME_ASSERT(sdata_->evac_meta_.empty(), "Wrong state logic");
+    X3ME_ASSERT(sdata_->evac_entries_.empty(), "Wrong state logic");
     X3ME_ASSERT((aio_data_.size_ == agg_write_meta_size), "Wrong state logic");
     X3ME_ASSERT((aio_data_.offs_ == sdata_->wr_pos()), "Wrong state logic");
 
@@ -384,7 +483,13 @@ void agg_writer::on_md_read(const awsm::ev_io_done& ev) noexcept
             {
 
                 inc_stat(stats_.cnt_evac_entries_todo_, frags_meta.size());
-                sdata_->evac_meta_.set_entries(std::move(frags_meta));
+                std::sort(frags_meta.begin(), frags_meta.end(),
+                          [](const auto& lhs, const auto& rhs)
+                          {
+                              return lhs.rng().disk_offset() <
+                                     rhs.rng().disk_offset();
+                          });
+                sdata_->evac_entries_ = std::move(frags_meta);
             }
         }
         else
@@ -393,7 +498,7 @@ void agg_writer::on_md_read(const awsm::ev_io_done& ev) noexcept
             XLOG_ERROR(disk_tag, "On_MD_read agg_writer {}. FS '{}'. Corrupted "
                                  "aggregate block metadata. Wr_pos {}",
                        log_ptr(this), fs_ops_->vol_path(), aio_data_.offs_);
-            X3ME_ASSERT(sdata_->evac_meta_.empty(), "Wrong state logic");
+            X3ME_ASSERT(sdata_->evac_entries_.empty(), "Wrong state logic");
             // Currently we pretend that nothing wrong happened here and
             // proceed with the aggregate and write logic.
             // However, this behavior could lead to corrupted reads, once in a
@@ -405,53 +510,82 @@ void agg_writer::on_md_read(const awsm::ev_io_done& ev) noexcept
             // complicating the logic.
         }
     }
+    sm_->enqueue_defr_event(awsm::ev_do_next{});
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void agg_writer::begin_evac() noexcept
 {
-    X3ME_ASSERT(!sdata_->evac_meta_.empty(), "Wrong state logic");
+    auto& entries = sdata_->evac_entries_;
+    X3ME_ASSERT(!entries.empty() && (sdata_->cnt_evac_batch_ == 0),
+                "Wrong state logic");
     constexpr auto max_sz = object_frag_size(object_frag_max_data_size);
-    const auto entry      = sdata_->evac_meta_.begin();
-    const auto sz         = object_frag_size(entry->rng().rng_size());
-    const auto offs       = entry->rng().disk_offset().to_bytes();
     const auto rpos       = sdata_->wr_pos() + agg_write_meta_size;
 
-    // The call to cache_fs_ops for removing non evacuate fragments meta
-    // must have filtered out invalid range elements.
-    X3ME_ENFORCE(sz <= max_sz, "Invalid range size");
-    X3ME_ENFORCE(
-        x3me::math::in_range(offs, offs + sz, rpos, rpos + agg_write_data_size),
-        "Invalid range element");
+    // Read all neighbour fragments with a single disk read. Reading the
+    // unneeded data between them is cheaper than an additional disk read
+    // if the gap is not too big.
+    const auto beg = entries.front().rng().disk_offset().to_bytes();
+    auto end       = beg;
+    size_t cnt     = 0;
+    for (const auto& e : entries)
+    {
+        const auto sz   = object_frag_size(e.rng().rng_size());
+        const auto offs = e.rng().disk_offset().to_bytes();
+        // The call to cache_fs_ops for removing non evacuate fragments meta
+        // must have filtered out invalid range elements.
+        X3ME_ENFORCE(sz <= max_sz, "Invalid range size");
+        X3ME_ENFORCE(x3me::math::in_range(offs, offs + sz, rpos,
+                                          rpos + agg_write_data_size),
+                     "Invalid range element");
+        if (offs > (end + evac_max_read_gap))
+            break;
+        end = std::max(end, offs + sz);
+        ++cnt;
+    }
+
+    auto& buff = sdata_->evac_buff_;
+    if (!buff) // Lazy allocation, only if needed
+        buff = alloc_page_aligned(agg_write_data_size);
 
-    auto& frag_buff = sdata_->evac_frag_;
-    if (!frag_buff) // Lazy allocation, only if needed
-        frag_buff = alloc_page_aligned(max_sz);
+    aio_data_.buf_  = buff.get();
+    aio_data_.size_ = end - beg;
+    aio_data_.offs_ = beg;
 
-    aio_data_.buf_  = frag_buff.get();
-    aio_data_.size_ = sz;
-    aio_data_.offs_ = offs;
+    sdata_->cnt_evac_batch_  = cnt;
+    sdata_->evac_read_start_ = std_clock_t::now();
 
-    XLOG_DEBUG(disk_tag, "Begin_evac agg_writer {}. Wr_pos {} bytes. Entry {}",
-               log_ptr(this), rpos - agg_write_meta_size, *entry);
+    XLOG_DEBUG(disk_tag, "Begin_evac agg_writer {}. Wr_pos {} bytes. Read "
+                         "offs {} bytes. Read size {} bytes. Entries {}/{}",
+               log_ptr(this), rpos - agg_write_meta_size, aio_data_.offs_,
+               aio_data_.size_, cnt, entries.size());
 }
 
 void agg_writer::on_evac_done(const awsm::ev_io_done& ev) noexcept
 {
-    X3ME_ASSERT(!sdata_->evac_meta_.empty(), "Wrong state logic");
-    auto e = sdata_->evac_meta_.begin();
-    X3ME_ASSERT((aio_data_.offs_ == e->rng().disk_offset().to_bytes()),
-                "Wrong state logic");
-    X3ME_ASSERT((aio_data_.size_ == object_frag_size(e->rng().rng_size())),
+    auto& entries  = sdata_->evac_entries_;
+    const auto cnt = sdata_->cnt_evac_batch_;
+    X3ME_ASSERT((cnt > 0) && (cnt <= entries.size()), "Wrong state logic");
+    const auto beg = entries.begin();
+    const auto end = beg + cnt;
+    X3ME_ASSERT((aio_data_.offs_ == beg->rng().disk_offset().to_bytes()),
                 "Wrong state logic");
 
+    const auto dur = std::chrono::duration_cast<std::chrono::microseconds>(
+        std_clock_t::now() - sdata_->evac_read_start_);
+    inc_stat(stats_.cnt_evac_reads_, 1);
+    inc_stat(stats_.evac_read_size_, aio_data_.size_);
+    inc_stat(stats_.evac_read_time_us_, dur.count());
+
     if (*ev.err_)
     {
-        inc_stat(stats_.cnt_evac_entries_err_, 1);
+        inc_stat(stats_.cnt_evac_entries_err_, cnt);
         XLOG_FATAL(disk_tag, "On_evac_done agg_writer {}. FS '{}'. Disk error "
-                             "while reading object fragment. Entry {}. {}",
-                   log_ptr(this), fs_ops_->vol_path(), *e, ev.err_->message());
+                             "while reading object fragments. Read offs {}. "
+                             "Read size {}. Entries {}. {}",
+                   log_ptr(this), fs_ops_->vol_path(), aio_data_.offs_,
+                   aio_data_.size_, cnt, ev.err_->message());
         fs_ops_->report_disk_error();
         // TODO Continue to work in the current write block as if nothing
         // has happened. This could lead to corruption of the data read by
@@ -459,68 +593,76 @@ void agg_writer::on_evac_done(const awsm::ev_io_done& ev) noexcept
     }
     else
     {
-        object_frag_hdr hdr;
-        const auto exp_hdr  = object_frag_hdr::create(e->key(), e->rng());
-        const auto hdr_size = sizeof(object_frag_hdr);
-        ::memcpy(&hdr, aio_data_.buf_, hdr_size);
-        if (hdr == exp_hdr)
+        for (auto it = beg; it != end; ++it)
         {
-            inc_stat(stats_.cnt_evac_entries_ok_, 1);
-            const range rng{e->rng().rng_offset(), e->rng().rng_size(),
-                            frag_rng};
-            const agg_write_block::frag_ro_buff_t frag{
-                aio_data_.buf_ + hdr_size, rng.len()};
-            const auto res = fs_ops_->fsmd_add_evac_fragment(
-                e->key(), rng, frag, sdata_->write_pos_, write_block_);
-            XLOG_DEBUG(disk_tag, "On_evac_done agg_writer {}. Added evacuated "
-                                 "frag. Key {}. Rng {}. Wr_pos {}. Res {}",
-                       log_ptr(this), e->key(), rng, sdata_->wr_pos(), res);
-        }
-        else
-        {
-            inc_stat(stats_.cnt_evac_entries_err_, 1);
-            XLOG_ERROR(disk_tag,
-                       "On_evac_done agg_writer {}. FS '{}'. Corrupted "
-                       "object fragment. Check sum doesn't match. Wr_pos {}. "
-                       "Hdr {}. Exp_hdr {}. Entry {}",
-                       log_ptr(this), fs_ops_->vol_path(), aio_data_.offs_, hdr,
-                       exp_hdr, *e);
-            // Can't do anything more here. Some reader will most likely
-            // read corrupted data and will probably detect it by the header.
-            // TODO We can forcefully remove the corrupted entry here!!!
+            const auto offs = it->rng().disk_offset().to_bytes();
+            evac_frag(*it, aio_data_.buf_ + (offs - aio_data_.offs_));
         }
     }
 
-    sdata_->evac_meta_.rem_entry(e); // Remove the processed entry
+    // Remove the processed entries
+    entries.erase(beg, end);
+    sdata_->cnt_evac_batch_ = 0;
 
     // Assuming that evacuations would be a rare event. Let's not
     // keep memory allocated without a need.
-    if (sdata_->evac_meta_.empty())
-        sdata_->evac_frag_.reset();
+    if (entries.empty())
+        sdata_->evac_buff_.reset();
+
+    sm_->enqueue_defr_event(awsm::ev_do_next{});
+}
+
+void agg_writer::evac_frag(const agg_meta_entry& e, const uint8_t* buf) noexcept
+{
+    object_frag_hdr hdr;
+    const auto exp_hdr  = object_frag_hdr::create(e.key(), e.rng());
+    const auto hdr_size = sizeof(object_frag_hdr);
+    ::memcpy(&hdr, buf, hdr_size);
+    if (hdr == exp_hdr)
+    {
+        inc_stat(stats_.cnt_evac_entries_ok_, 1);
+        const range rng{e.rng().rng_offset(), e.rng().rng_size(), frag_rng};
+        const agg_write_block::frag_ro_buff_t frag{buf + hdr_size, rng.len()};
+        const auto res = fs_ops_->fsmd_add_evac_fragment(
+            e.key(), rng, frag, sdata_->write_pos_, curr_block());
+        XLOG_DEBUG(disk_tag, "On_evac_done agg_writer {}. Added evacuated "
+                             "frag. Key {}. Rng {}. Wr_pos {}. Res {}",
+                   log_ptr(this), e.key(), rng, sdata_->wr_pos(), res);
+    }
+    else
+    {
+        inc_stat(stats_.cnt_evac_entries_err_, 1);
+        XLOG_ERROR(disk_tag, "On_evac_done agg_writer {}. FS '{}'. Corrupted "
+                             "object fragment. Check sum doesn't match. Wr_pos "
+                             "{}. Hdr {}. Exp_hdr {}. Entry {}",
+                   log_ptr(this), fs_ops_->vol_path(), sdata_->wr_pos(), hdr,
+                   exp_hdr, e);
+        // Can't do anything more here. Some reader will most likely
+        // read corrupted data and will probably detect it by the header.
+        // TODO We can forcefully remove the corrupted entry here!!!
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void agg_writer::write_pend_data() noexcept
 {
-    auto& pd = sdata_->pend_data_;
-    if (!pd.buff_.empty())
+    auto& pds = sdata_->pend_data_;
+    auto it   = pds.begin();
+    for (; it != pds.end(); ++it)
     {
-        X3ME_ASSERT(pd.trans_.valid(), "If we have non empty buffer, we must "
-                                       "have a valid transaction too");
+        X3ME_ASSERT(it->trans_.valid(), "If we have non empty buffer, we must "
+                                        "have a valid transaction too");
         XLOG_DEBUG(disk_tag, "Write_pend_data agg_writer {}. Trans {}",
-                   log_ptr(this), pd.trans_);
-        if (do_write_impl(pd.trans_, pd.buff_, true /*fin write*/))
-        {
-            finished_trans_.push_back(std::move(pd.trans_));
-            pd.buff_ = frag_write_buff{};
-        }
-        else
-        {
-            // Flush the data to the disk to free meta/data space
-            sm_->enqueue_defr_event(awsm::ev_do_async_flush{});
-        }
+                   log_ptr(this), it->trans_);
+        if (!do_write_impl(it->trans_, it->buff_, true /*fin write*/))
+            break;
+        finished_trans_.push_back(std::move(it->trans_));
     }
+    pds.erase(pds.begin(), it);
+
+    if (!pds.empty()) // Flush the data to the disk to free meta/data space
+        request_flush();
 }
 
 void agg_writer::do_write(const awsm::ev_do_write& ev) noexcept
@@ -528,7 +670,7 @@ void agg_writer::do_write(const awsm::ev_do_write& ev) noexcept
     bool r = do_write_impl(*ev.wtrans_, *ev.wbuf_, false /*No fin write*/);
 
     if (!r) // Flush the data to the disk to free meta/data space
-        sm_->enqueue_defr_event(awsm::ev_do_async_flush{});
+        request_flush();
 
     *ev.res_ = r;
 }
@@ -551,14 +693,36 @@ void agg_writer::do_fin_write(awsm::ev_do_fin_write& ev) noexcept
     else
     {
         // Set the pending data to be written first after the flush
-        auto& pd = sdata_->pend_data_;
-        X3ME_ASSERT(pd.buff_.empty() && !pd.trans_.valid(),
-                    "Invalid pending data state");
-        pd.buff_  = std::move(*ev.wbuf_);
-        pd.trans_ = std::move(*ev.wtrans_);
+        sdata_->pend_data_.push_back(
+            awsm::state_data::pending_data{std::move(*ev.wbuf_),
+                                           std::move(*ev.wtrans_)});
 
         // Flush the data to the disk to free meta/data space
-        sm_->enqueue_defr_event(awsm::ev_do_async_flush{});
+        request_flush();
+    }
+}
+
+void agg_writer::skip_write(const awsm::ev_do_write& ev) noexcept
+{
+    // The current block can't take writes while its disk area is evacuated.
+    // The caller will retry the write later.
+    *ev.res_ = false;
+}
+
+void agg_writer::pend_fin_write(awsm::ev_do_fin_write& ev) noexcept
+{
+    // The same as the do_fin_write, but the final write can't go to the
+    // current block while its disk area is evacuated.
+    if (ev.wbuf_->size() < range_elem::min_rng_size())
+    {
+        finished_trans_.push_back(std::move(*ev.wtrans_));
+        *ev.wbuf_ = frag_write_buff{};
+    }
+    else
+    {
+        sdata_->pend_data_.push_back(
+            awsm::state_data::pending_data{std::move(*ev.wbuf_),
+                                           std::move(*ev.wtrans_)});
     }
 }
 
@@ -574,7 +738,7 @@ bool agg_writer::do_write_impl(write_transaction& wtrans,
     const agg_write_block::frag_ro_buff_t frag{wbuf};
 
     const auto res = fs_ops_->fsmd_add_new_fragment(
-        key, rng, frag, sdata_->write_pos_, write_block_);
+        key, rng, frag, sdata_->write_pos_, curr_block());
     XLOG_DEBUG(disk_tag, "Do_write agg_writer {}. Written frag. Fin_write {}. "
                          "Trans {}. Rng {}. Wr_pos {}. Res {}",
                log_ptr(this), fin_write, key, rng, sdata_->wr_pos(), res);
@@ -586,22 +750,70 @@ bool agg_writer::do_write_impl(write_transaction& wtrans,
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void agg_writer::begin_flush() noexcept
+void agg_writer::request_flush() noexcept
+{
+    if (sdata_->flush_pending_)
+        sdata_->swap_needed_ = true; // Swap once the other block is flushed
+    else
+        sm_->enqueue_defr_event(awsm::ev_do_async_flush{});
+}
+
+void agg_writer::swap_blocks() noexcept
 {
+    X3ME_ASSERT(!sdata_->flush_pending_, "Wrong state logic");
+    const auto next = fs_ops_->fsmd_next_write_pos(
+        cache_fs_ops::wr_pos{sdata_->wr_pos(), sdata_->write_lap_});
+    const auto next_pos = volume_blocks64_t::create_from_bytes(next.write_pos_);
+
+    // The current block is serialized and the index changed under the
+    // locks of both blocks. This way every journal removal goes either
+    // to the flushed block, before its serialization, or to the next one.
     stats_fs_wr sts;
-    const auto block = write_block_->begin_disk_write(sts);
+    x3me::thread::with_synchronized(
+        write_blocks_[0], write_blocks_[1],
+        [this, &sts, next_pos](agg_write_block& b0, agg_write_block& b1)
+        {
+            auto& curr = (curr_block_ == 0) ? b0 : b1;
+            auto& next = (curr_block_ == 0) ? b1 : b0;
+            X3ME_ASSERT((next.bytes_avail() == 0) &&
+                            !next.pending_disk_write(),
+                        "The next block must have been committed");
+            sdata_->flush_buff_ =
+                curr.begin_disk_write(sdata_->write_lap_, sts);
+            next.set_write_offs(next_pos);
+            curr_block_ ^= 1;
+        });
 
     inc_stat(stats_.written_meta_size_, sts.written_meta_size_);
     inc_stat(stats_.wasted_meta_size_, sts.wasted_meta_size_);
     inc_stat(stats_.written_data_size_, sts.written_data_size_);
     inc_stat(stats_.wasted_data_size_, sts.wasted_data_size_);
 
+    XLOG_DEBUG(disk_tag, "Swap_blocks agg_writer {}. Flush_pos {} bytes. "
+                         "Next wr_pos {} bytes. Next wr_lap {}",
+               log_ptr(this), sdata_->wr_pos(), next.write_pos_,
+               next.write_lap_);
+
+    sdata_->flush_pos_     = sdata_->write_pos_;
+    sdata_->write_pos_     = next_pos;
+    sdata_->write_lap_     = next.write_lap_;
+    sdata_->flush_pending_ = true;
+    flush_trans_.swap(finished_trans_);
+
+    // Prepare the next block. The flush is started once it's ready.
+    sm_->enqueue_defr_event(awsm::ev_do_next{});
+}
+
+void agg_writer::begin_flush() noexcept
+{
+    X3ME_ASSERT(sdata_->flush_pending_, "Wrong state logic");
+    const auto& block = sdata_->flush_buff_;
     // Yeah, that cast is ugly. It's due to the lack of const correctness
     // in the aio_data structure. The operation is really read-only for the
     // fragment buffer. It's just that the aio_data behavior is not correct.
     aio_data_.buf_  = const_cast<uint8_t*>(block.data());
     aio_data_.size_ = block.size();
-    aio_data_.offs_ = sdata_->wr_pos();
+    aio_data_.offs_ = sdata_->flush_pos_.to_bytes();
 
     XLOG_DEBUG(disk_tag,
                "Begin_flush agg_writer {}. Pos {} bytes. Size {} bytes",
@@ -610,7 +822,8 @@ void agg_writer::begin_flush() noexcept
 
 void agg_writer::on_flush_done(const awsm::ev_io_done& ev) noexcept
 {
-    X3ME_ASSERT((aio_data_.offs_ == sdata_->wr_pos()), "Wrong state logic");
+    X3ME_ASSERT((aio_data_.offs_ == sdata_->flush_pos_.to_bytes()),
+                "Wrong state logic");
     if (*ev.err_)
     {
         XLOG_FATAL(disk_tag, "On_flush_done agg_writer {}. FS '{}'. Disk error "
@@ -633,10 +846,15 @@ void agg_writer::on_flush_done(const awsm::ev_io_done& ev) noexcept
     // commit non written entries which could lead to corrupted data being
     // read later.
     const auto wpos_info = fs_ops_->fsmd_commit_disk_write(
-        sdata_->write_pos_, finished_trans_, write_block_);
-    finished_trans_.clear();
-    sdata_->write_pos_.set_from_bytes(wpos_info.write_pos_);
-    sdata_->is_first_lap_ = (wpos_info.write_lap_ == 0);
+        sdata_->flush_pos_, flush_trans_, flush_block());
+    flush_trans_.clear();
+    X3ME_ASSERT((wpos_info.write_pos_ == sdata_->wr_pos()) &&
+                    (wpos_info.write_lap_ == sdata_->write_lap_),
+                "The current block must be at the next write position");
+    sdata_->flush_buff_    = agg_write_block::agg_ro_buff_t{};
+    sdata_->flush_pending_ = false;
+    if (std::exchange(sdata_->swap_needed_, false))
+        sm_->enqueue_defr_event(awsm::ev_do_async_flush{});
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -650,8 +868,16 @@ void agg_writer::do_last_flush() noexcept
     // even if they are not really needed.
     fs_ops_->vmtx_wait_disk_readers();
 
+    // The previous block must go to the disk before the current one, if its
+    // flush hasn't been done.
+    if (sdata_->flush_pending_)
+    {
+        fs_ops_->fsmd_fin_flush_commit(sdata_->flush_pos_, flush_trans_,
+                                       flush_block());
+        sdata_->flush_pending_ = false;
+    }
     fs_ops_->fsmd_fin_flush_commit(sdata_->write_pos_, finished_trans_,
-                                   write_block_);
+                                   curr_block());
 }
 
 } // namespace detail
@@ -10,6 +10,7 @@ namespace cache
 struct stats_fs_wr;
 namespace detail
 {
+class agg_meta_entry;
 class frag_write_buff;
 class write_transaction;
 namespace awsm
@@ -38,26 +39,46 @@ class agg_writer final : public aio_task
         std::atomic<uint64_t> cnt_evac_entries_todo_{0};
         std::atomic<uint64_t> cnt_evac_entries_ok_{0};
         std::atomic<uint64_t> cnt_evac_entries_err_{0};
+        std::atomic<uint64_t> cnt_evac_reads_{0};
+        std::atomic<bytes64_t> evac_read_size_{0};
+        std::atomic<uint64_t> evac_read_time_us_{0};
     };
 
     non_owner_ptr_t<cache_fs_ops> fs_ops_;
 
-    // The only part of the agg_writer which is accessed by multiple threads
-    // is the agg_write_block. Some readers may need content which is currently
-    // written to the agg_write_block buffer, but is still not flushed to the
-    // cache.
-    agg_wblock_sync_t write_block_;
+public:
+    using write_blocks_t = std::array<agg_wblock_sync_t, 2>;
 
-    x3me::utils::pimpl<awsm::sm, 32, 8> sm_;
-    x3me::utils::pimpl<awsm::state_data, 112, 8> sdata_;
+private:
+    // The only part of the agg_writer which is accessed by multiple threads
+    // are the agg_write_blocks. Some readers may need content which is
+    // currently written to the agg_write_block buffer, but is still not
+    // flushed to the cache.
+    // The writer fills one of the blocks while the other one is flushed
+    // to the disk. This way the writes don't wait for the disk write of
+    // the previous block.
+    write_blocks_t write_blocks_;
+    // The index of the block which is currently filled. It's changed only
+    // by the writer thread while both blocks are locked.
+    uint8_t curr_block_ = 0;
+
+    x3me::utils::pimpl<awsm::sm, 48, 8> sm_;
+    x3me::utils::pimpl<awsm::state_data, 120, 8> sdata_;
 
     // Transactions finished in the current aggregate write pass.
     std::vector<write_transaction> finished_trans_;
+    // Transactions finished in the block which is currently flushed.
+    std::vector<write_transaction> flush_trans_;
 
     stats stats_;
 
     aio_data aio_data_;
     aio_op aio_op_ = aio_op::exec;
+    // The writer never has more than one disk operation queued or in flight.
+    // The next one is enqueued only after the completion of the previous.
+    // This keeps the order of the writer disk operations, even if the
+    // aio_service completes the operations of different tasks out of order.
+    bool io_pending_ = false;
 
 public:
     agg_writer(volume_blocks64_t write_pos, uint64_t write_lap) noexcept;
@@ -82,16 +103,30 @@ public:
     // The method can be safely called from multiple threads
     void get_stats(stats_fs_wr& swr) noexcept;
 
-    const agg_wblock_sync_t& write_block() const noexcept
+    // The journal related methods can be safely called from multiple threads.
+    // They are forwarded to the agg_write_block under its lock.
+    void set_jrnl_fs_uuid(const uuid_t& fs_uuid) noexcept;
+    void jrnl_rem_key(const fs_node_key_t& key) noexcept;
+    bool reset_jrnl_broken() noexcept;
+
+    const write_blocks_t& write_blocks() const noexcept
     {
-        return write_block_;
+        return write_blocks_;
     }
 #ifdef X3ME_TEST
-    agg_wblock_sync_t& write_block() noexcept { return write_block_; }
+    // The block which is currently filled
+    agg_wblock_sync_t& write_block() noexcept { return curr_block(); }
 #endif
 
 private:
     aio_op operation() const noexcept final { return aio_op_; }
+    // The agg_writer reads only the metadata and the fragments of the
+    // block which is going to be overwritten.
+    aio_class io_class() const noexcept final
+    {
+        return (aio_op_ == aio_op::read) ? aio_class::evacuation
+                                         : aio_class::flush;
+    }
 
     void exec() noexcept final;
 
@@ -101,6 +136,16 @@ private:
     // We don't need to do anything here
     void service_stopped() noexcept final {}
 
+private:
+    agg_wblock_sync_t& curr_block() noexcept
+    {
+        return write_blocks_[curr_block_];
+    }
+    agg_wblock_sync_t& flush_block() noexcept
+    {
+        return write_blocks_[curr_block_ ^ 1];
+    }
+
 private: // Action handlers
     void enqueue_read_aio_op() noexcept;
     void enqueue_write_aio_op() noexcept;
@@ -108,12 +153,17 @@ private: // Action handlers
     void on_md_read(const awsm::ev_io_done& ev) noexcept;
     void begin_evac() noexcept;
     void on_evac_done(const awsm::ev_io_done& ev) noexcept;
+    void evac_frag(const agg_meta_entry& e, const uint8_t* buf) noexcept;
     void write_pend_data() noexcept;
     void do_write(const awsm::ev_do_write& ev) noexcept;
     void do_fin_write(awsm::ev_do_fin_write& ev) noexcept;
+    void skip_write(const awsm::ev_do_write& ev) noexcept;
+    void pend_fin_write(awsm::ev_do_fin_write& ev) noexcept;
     bool do_write_impl(write_transaction& wtrans,
                        const frag_write_buff& wbuf,
                        bool fin_write) noexcept;
+    void request_flush() noexcept;
+    void swap_blocks() noexcept;
     void begin_flush() noexcept;
     void on_flush_done(const awsm::ev_io_done& ev) noexcept;
     void do_last_flush() noexcept;
@@ -2,6 +2,8 @@
 #include "aio_service.h"
 #include "aio_task.h"
 #include "aio_data.h"
+#include "cache_error.h"
+#include "cache_stats.h"
 #include "volume_fd.h"
 
 namespace cache
@@ -9,6 +11,72 @@ namespace cache
 namespace detail
 {
 
+void aio_latencies::record(const aio_task& t,
+                           aio_op op,
+                           std_clock_t::time_point enq,
+                           std_clock_t::time_point beg,
+                           std_clock_t::time_point end) noexcept
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    auto& lats = (op == aio_op::read)
+                     ? read_
+                     : ((t.io_class() == aio_class::metadata) ? md_write_
+                                                              : agg_write_);
+    const auto wait = duration_cast<microseconds>(beg - enq);
+    const auto serv = duration_cast<microseconds>(end - beg);
+    lats.wait_.record(std::max<int64_t>(wait.count(), 0));
+    lats.service_.record(std::max<int64_t>(serv.count(), 0));
+}
+
+void aio_latencies::get_stats(stats_aio_latency& sts) const noexcept
+{
+    read_.wait_.get_stats(sts.read_wait_);
+    read_.service_.get_stats(sts.read_service_);
+    agg_write_.wait_.get_stats(sts.agg_write_wait_);
+    agg_write_.service_.get_stats(sts.agg_write_service_);
+    md_write_.wait_.get_stats(sts.md_write_wait_);
+    md_write_.service_.get_stats(sts.md_write_service_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void aio_read_gate::wait_reads() noexcept
+{
+    if ((max_delay_.count() == 0) || !reads_pending())
+        return;
+    // The reads complete in tens of microseconds up to few milliseconds.
+    // Short sleeps keep the reader threads free of any notification cost.
+    constexpr auto poll_period = std::chrono::microseconds(50);
+    const auto beg = std_clock_t::now();
+    const auto end = beg + max_delay_;
+    auto now       = beg;
+    do
+    {
+        std::this_thread::sleep_for(poll_period);
+        now = std_clock_t::now();
+    } while (reads_pending() && (now < end));
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    const uint64_t d = duration_cast<microseconds>(now - beg).count();
+    cnt_delayed_.fetch_add(1, std::memory_order_relaxed);
+    delay_time_us_.fetch_add(d, std::memory_order_relaxed);
+    if (d > max_delay_time_us_.load(std::memory_order_relaxed))
+        max_delay_time_us_.store(d, std::memory_order_relaxed);
+}
+
+void aio_read_gate::get_stats(stats_aio_class& sts) const noexcept
+{
+    sts.cnt_tasks_ += cnt_delayed_.load(std::memory_order_relaxed);
+    sts.wait_time_us_ += delay_time_us_.load(std::memory_order_relaxed);
+    sts.max_wait_time_us_ =
+        std::max(sts.max_wait_time_us_,
+                 max_delay_time_us_.load(std::memory_order_relaxed));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 aio_service::aio_service(volume_fd& vol_fd) noexcept : vol_fd_(vol_fd)
 {
 }
@@ -18,12 +86,19 @@ aio_service::~aio_service() noexcept
 }
 
 void aio_service::start(const boost::container::string& vol_path,
-                        uint16_t num_threads) noexcept
+                        const aio_service_cfg& cfg) noexcept
 {
+    const auto num_threads = cfg.num_threads_;
     X3ME_ASSERT(num_threads >= min_num_threads,
                 "Must have at least min_num_threads");
     X3ME_ASSERT(threads_.empty(), "Can't start aio_service more than once");
 
+    write_queue_.set_sched_cfg(cfg.sched_);
+    read_gate_.set_max_delay(cfg.bg_max_delay_);
+
+    const bool use_rings =
+        (cfg.engine_ == aio_engine::io_uring) && init_rings(vol_path, cfg);
+
     // The label is created from the last max 4 letters of the volume path.
     // The volume path is usually /dev/sda, /dev/sdb or /dev/sdaa in the
     // worst case.
@@ -43,20 +118,52 @@ void aio_service::start(const boost::container::string& vol_path,
     using x3me::sys_utils::set_this_thread_name;
     std::array<char, 16> name;
     ::snprintf(name.data(), name.size(), "xproxy_wr_%s", lbl.c_str());
-    threads_.emplace_back([this, name]
-                          {
-                              set_this_thread_name(name.data());
-                              process_queue(write_queue_, vol_fd_);
-                          });
-    for (uint16_t i = 1; i < num_threads; ++i)
+    if (use_rings)
     {
-        ::snprintf(name.data(), name.size(), "xproxy_rd_%s", lbl.c_str());
+        // The first ring is for the writer thread.
         threads_.emplace_back([this, name]
                               {
                                   set_this_thread_name(name.data());
-                                  process_queue(read_queue_, vol_fd_);
+                                  process_queue_uring(write_queue_, vol_fd_,
+                                                      latencies_, read_gate_,
+                                                      *rings_[0], fixed_buffs_);
                               });
     }
+    else
+    {
+        threads_.emplace_back([this, name]
+                              {
+                                  set_this_thread_name(name.data());
+                                  process_queue(write_queue_, vol_fd_,
+                                                latencies_, read_gate_);
+                              });
+    }
+    for (uint16_t i = 1; i < num_threads; ++i)
+    {
+        ::snprintf(name.data(), name.size(), "xproxy_rd_%s", lbl.c_str());
+        if (use_rings)
+        {
+            // The read threads don't use the fixed buffers.
+            threads_.emplace_back([this, name, i]
+                                  {
+                                      set_this_thread_name(name.data());
+                                      process_queue_uring(read_queue_, vol_fd_,
+                                                          latencies_,
+                                                          read_gate_,
+                                                          *rings_[i],
+                                                          aio_uring::buffers_t{});
+                                  });
+        }
+        else
+        {
+            threads_.emplace_back([this, name]
+                                  {
+                                      set_this_thread_name(name.data());
+                                      process_queue(read_queue_, vol_fd_,
+                                                    latencies_, read_gate_);
+                                  });
+        }
+    }
 }
 
 void aio_service::stop()
@@ -77,9 +184,72 @@ void aio_service::stop()
     clear_queue_on_stop(write_queue_);
 }
 
+void aio_service::register_fixed_buffer(uint8_t* buf, bytes32_t size) noexcept
+{
+    X3ME_ASSERT(threads_.empty(), "Must be called before the start");
+    fixed_buffs_.push_back(iovec{buf, size});
+}
+
+void aio_service::get_sched_stats(stats_aio_sched& sts) const noexcept
+{
+    read_queue_.get_stats(sts);
+    write_queue_.get_stats(sts);
+    read_gate_.get_stats(sts.bg_delay_);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
-void aio_service::process_queue(aio_task_queue& queue, volume_fd& fd) noexcept
+bool aio_service::init_rings(const boost::container::string& vol_path,
+                             const aio_service_cfg& cfg) noexcept
+{
+    const uint16_t batch_size =
+        std::min(std::max<uint16_t>(cfg.batch_size_, 1), max_batch_size);
+    rings_.reserve(cfg.num_threads_);
+    for (uint16_t i = 0; i < cfg.num_threads_; ++i)
+    {
+        // The write ring may complete the operations of different tasks
+        // out of order. This is fine, because no write task depends on the
+        // completion order of the other tasks. The agg_writer has at most
+        // one disk operation queued or in flight and enqueues the next one
+        // from the completion of the previous (asserted there). The same
+        // holds for the metadata sync, which is one at a time per volume
+        // and writes only the metadata area. The write handles, popped
+        // together with the agg_writer flush, fill its second block while
+        // the flush is in flight. The agg_writer rejects them while it
+        // evacuates.
+        const uint32_t entries = batch_size;
+        const auto& fbuffs = (i == 0) ? fixed_buffs_ : aio_uring::buffers_t{};
+        auto ring = std::make_unique<aio_uring>();
+        err_code_t err;
+        if (!ring->init(entries, vol_fd_.get(), fbuffs, err))
+        {
+            XLOG_WARN(disk_tag, "Unable to initialize io_uring for volume "
+                                "'{}'. Fall back to the threads AIO "
+                                "engine. The writes will wait for the "
+                                "aggregate block flushes. {}",
+                      vol_path, err.message());
+            rings_.clear();
+            return false;
+        }
+        rings_.push_back(std::move(ring));
+    }
+    XLOG_INFO(disk_tag, "Use io_uring AIO engine for volume '{}'. Batch size {}",
+              vol_path, batch_size);
+    return true;
+}
+
+namespace
+{
+bool is_interactive(const aio_task& t) noexcept
+{
+    return t.io_class() == aio_class::interactive;
+}
+} // namespace
+
+void aio_service::process_queue(aio_task_queue& queue,
+                                volume_fd& fd,
+                                aio_latencies& lats,
+                                aio_read_gate& gate) noexcept
 {
     // We have increased the task reference count when we pushed it to the
     // given queue. Now we have to decrease the task reference count
@@ -88,7 +258,8 @@ void aio_service::process_queue(aio_task_queue& queue, volume_fd& fd) noexcept
     // somebody holds the last reference from outside the task will continue
     // it's life.
     non_owner_ptr_t<aio_task> task;
-    while ((task = queue.pop()))
+    std_clock_t::time_point enq;
+    while ((task = queue.pop(enq)))
     {
         switch (task->operation())
         {
@@ -98,16 +269,30 @@ void aio_service::process_queue(aio_task_queue& queue, volume_fd& fd) noexcept
         case aio_op::read:
             if (auto d = task->on_begin_io_op())
             {
+                const bool interactive = is_interactive(*task);
+                if (interactive)
+                    gate.begin_read();
+                else
+                    gate.wait_reads();
                 err_code_t err;
+                const auto beg = std_clock_t::now();
                 fd.read(d->buf_, d->size_, d->offs_, err);
+                lats.record(*task, aio_op::read, enq, beg, std_clock_t::now());
+                if (interactive)
+                    gate.end_read();
                 task->on_end_io_op(err);
             }
             break;
         case aio_op::write:
             if (auto d = task->on_begin_io_op())
             {
+                if (!is_interactive(*task))
+                    gate.wait_reads();
                 err_code_t err;
+                const auto beg = std_clock_t::now();
                 fd.write(d->buf_, d->size_, d->offs_, err);
+                lats.record(*task, aio_op::write, enq, beg,
+                            std_clock_t::now());
                 task->on_end_io_op(err);
             }
             break;
@@ -119,6 +304,156 @@ void aio_service::process_queue(aio_task_queue& queue, volume_fd& fd) noexcept
     }
 }
 
+namespace
+{
+struct uring_slot
+{
+    non_owner_ptr_t<aio_task> task_ = nullptr;
+    // We need a copy of the task IO data because it gets modified in case
+    // of partial read or write. The task data must remain untouched.
+    aio_data data_;
+    aio_op op_ = aio_op::exec;
+    // The partial operations continue the initial one
+    std_clock_t::time_point enq_;
+    std_clock_t::time_point beg_;
+    // The interactive reads are tracked by the aio_read_gate
+    bool gated_read_ = false;
+};
+
+void prep_uring_slot(aio_uring& ring,
+                     volume_fd& fd,
+                     const aio_uring::buffers_t& fbuffs,
+                     const uring_slot& s,
+                     aio_uring::user_data_t ud) noexcept
+{
+    const auto& d  = s.data_;
+    const auto fb  = ring.find_fixed_buff(fbuffs, d.buf_, d.size_);
+    if (s.op_ == aio_op::read)
+        ring.prep_read(fd.get(), d.buf_, d.size_, d.offs_, fb, ud);
+    else
+        ring.prep_write(fd.get(), d.buf_, d.size_, d.offs_, fb, ud);
+}
+} // namespace
+
+void aio_service::process_queue_uring(aio_task_queue& queue,
+                                      volume_fd& fd,
+                                      aio_latencies& lats,
+                                      aio_read_gate& gate,
+                                      aio_uring& ring,
+                                      const aio_uring::buffers_t& fbuffs) noexcept
+{
+    // The reference counting of the tasks works in the same way as in the
+    // process_queue function. The only difference is that the reference gets
+    // released after the end of the IO operation, which may happen after
+    // other tasks have been popped from the queue.
+    const auto cnt_slots = ring.entries();
+    std::vector<uring_slot> slots(cnt_slots);
+    std::vector<uint32_t> free_slots(cnt_slots);
+    std::iota(free_slots.rbegin(), free_slots.rend(), 0U);
+    std::vector<non_owner_ptr_t<aio_task>> tasks(cnt_slots);
+    std::vector<std_clock_t::time_point> enq_times(cnt_slots);
+    uint32_t in_flight = 0;
+
+    auto on_complete = [&](aio_uring::user_data_t ud, int res)
+    {
+        auto& s = slots[ud];
+        err_code_t err;
+        if (res < 0)
+        {
+            err.assign(-res, bsys::get_system_category());
+        }
+        else if (res == 0)
+        {
+            err.assign((s.op_ == aio_op::read) ? cache::error::eof
+                                               : cache::error::null_write,
+                       get_cache_error_category());
+        }
+        else if (static_cast<bytes32_t>(res) < s.data_.size_)
+        {
+            // Partial read or write. Continue with the rest of the data.
+            s.data_.buf_ += res;
+            s.data_.offs_ += res;
+            s.data_.size_ -= res;
+            prep_uring_slot(ring, fd, fbuffs, s, ud);
+            return;
+        }
+        lats.record(*s.task_, s.op_, s.enq_, s.beg_, std_clock_t::now());
+        if (s.gated_read_)
+            gate.end_read();
+        s.task_->on_end_io_op(err);
+        intrusive_ptr_release(s.task_);
+        s.task_ = nullptr;
+        free_slots.push_back(ud);
+        --in_flight;
+    };
+
+    for (;;)
+    {
+        // Block on the queue only if there is nothing in flight.
+        // Otherwise take only the currently available tasks.
+        const auto cnt = queue.pop(tasks.data(), free_slots.size(),
+                                   (in_flight == 0), enq_times.data());
+        if ((cnt == 0) && (in_flight == 0))
+            break; // The queue has been stopped
+        for (uint32_t i = 0; i < cnt; ++i)
+        {
+            auto task = tasks[i];
+            const auto op = task->operation();
+            switch (op)
+            {
+            case aio_op::exec:
+                task->exec();
+                intrusive_ptr_release(task);
+                break;
+            case aio_op::read:
+            case aio_op::write:
+                if (auto d = task->on_begin_io_op())
+                {
+                    const bool interactive = is_interactive(*task);
+                    if (!interactive)
+                        gate.wait_reads();
+                    else if (op == aio_op::read)
+                        gate.begin_read();
+                    const auto ud = free_slots.back();
+                    free_slots.pop_back();
+                    auto& s       = slots[ud];
+                    s.task_       = task;
+                    s.data_       = *d;
+                    s.op_         = op;
+                    s.enq_        = enq_times[i];
+                    s.beg_        = std_clock_t::now();
+                    s.gated_read_ = interactive && (op == aio_op::read);
+                    prep_uring_slot(ring, fd, fbuffs, s, ud);
+                    ++in_flight;
+                }
+                else
+                {
+                    intrusive_ptr_release(task);
+                }
+                break;
+            default:
+                X3ME_ASSERT(false, "Missing switch case");
+                intrusive_ptr_release(task);
+                break;
+            }
+        }
+        if (in_flight > 0)
+        {
+            err_code_t err;
+            if (X3ME_UNLIKELY(!ring.submit_and_wait(1, err)))
+            {
+                // The submitted operations use buffers owned by the tasks.
+                // We can't complete the tasks while the kernel may still
+                // work with their buffers. It's a bug, if this happens.
+                XLOG_FATAL(disk_tag, "io_uring submit failed. {}",
+                           err.message());
+                X3ME_ENFORCE(false, "io_uring submit must not fail");
+            }
+            ring.reap_completions(on_complete);
+        }
+    }
+}
+
 void aio_service::push_front_task(owner_ptr_t<aio_task> t,
                                   aio_task_queue& queue) noexcept
 {
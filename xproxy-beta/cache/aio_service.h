@@ -1,26 +1,134 @@
 #pragma once
 
 #include "aio_task_queue.h"
+#include "aio_uring.h"
+#include "latency_histogram.h"
 
 namespace cache
 {
+struct stats_aio_latency;
+
 namespace detail
 {
 
 class aio_task;
 class volume_fd;
 
+enum struct aio_engine : uint8_t
+{
+    // Every AIO thread does blocking pread/pwrite calls, one at a time.
+    threads,
+    // Every AIO thread submits a batch of operations to its own io_uring
+    // and reaps their completions.
+    io_uring,
+};
+
+struct aio_service_cfg
+{
+    uint16_t num_threads_ = 0;
+    // The max number of IO operations which a single read thread keeps
+    // in flight. It's used only by the io_uring engine.
+    uint16_t batch_size_ = 1;
+    aio_engine engine_   = aio_engine::io_uring;
+    // The class weights and deadlines are applied to the write queue only.
+    // The read queue holds only interactive tasks. The reads are weighed
+    // against the background disk operations by the aio_read_gate.
+    aio_sched_cfg sched_;
+    // The max time for which a background disk operation waits for the
+    // pending interactive reads. Zero disables the waiting.
+    std::chrono::microseconds bg_max_delay_ = std::chrono::milliseconds(2);
+};
+
+// The reader threads and the writer thread of a volume submit their disk
+// operations to the device independently. The gate gives the interactive
+// reads priority over the background operations - evacuation, aggregate
+// flush and metadata sync. A thread delays a background operation while
+// the volume has interactive reads queued or in flight, but not longer
+// than the configured max delay per operation. The bound ensures that the
+// background work can't be starved by a constant stream of reads.
+class aio_read_gate
+{
+    const aio_task_queue& read_queue_;
+    std::chrono::microseconds max_delay_{0};
+    std::atomic_uint reads_in_flight_{0};
+    // Statistics. Written only by the thread doing the background operations.
+    std::atomic<uint64_t> cnt_delayed_{0};
+    std::atomic<uint64_t> delay_time_us_{0};
+    std::atomic<uint64_t> max_delay_time_us_{0};
+
+public:
+    explicit aio_read_gate(const aio_task_queue& read_queue) noexcept
+        : read_queue_(read_queue)
+    {
+    }
+
+    // Must be called before the gate gets used by more than one thread.
+    void set_max_delay(std::chrono::microseconds d) noexcept { max_delay_ = d; }
+
+    void begin_read() noexcept
+    {
+        reads_in_flight_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void end_read() noexcept
+    {
+        reads_in_flight_.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Called before every background disk operation.
+    void wait_reads() noexcept;
+
+    void get_stats(stats_aio_class& sts) const noexcept;
+
+private:
+    bool reads_pending() const noexcept
+    {
+        return (reads_in_flight_.load(std::memory_order_acquire) > 0) ||
+               (read_queue_.size() > 0);
+    }
+};
+
+// The latencies of the disk operations done by all AIO threads of a volume.
+class aio_latencies
+{
+    struct op_latencies
+    {
+        latency_recorder wait_;    // In the queue
+        latency_recorder service_; // By the device
+    };
+    op_latencies read_;
+    op_latencies agg_write_;
+    op_latencies md_write_;
+
+public:
+    // The queue wait is measured from the enqueue time of the task,
+    // as returned when the task has been popped, to the begin of the
+    // operation.
+    void record(const aio_task& t,
+                aio_op op,
+                std_clock_t::time_point enq,
+                std_clock_t::time_point beg,
+                std_clock_t::time_point end) noexcept;
+
+    void get_stats(stats_aio_latency& sts) const noexcept;
+};
+
 class aio_service
 {
     // Don't go to the heap for the most common case.
     // Waste some memory if the threads are more.
     // However, once we find the 'good' number we won't change it.
     using threads_t = boost::container::small_vector<std::thread, 8>;
+    using rings_t =
+        boost::container::small_vector<std::unique_ptr<aio_uring>, 8>;
 
     volume_fd& vol_fd_;
     threads_t threads_;
+    rings_t rings_;
+    aio_uring::buffers_t fixed_buffs_;
     aio_task_queue read_queue_;
     aio_task_queue write_queue_;
+    aio_read_gate read_gate_{read_queue_};
+    aio_latencies latencies_;
 
 public:
     // We need at least one thread for writing and one for reading.
@@ -28,6 +136,7 @@ public:
     // However it may happen that the both threads are occupied by reads
     // at a given moment.
     static constexpr uint16_t min_num_threads = 2;
+    static constexpr uint16_t max_batch_size  = 256;
 
 public:
     explicit aio_service(volume_fd& vol_fd) noexcept;
@@ -38,13 +147,27 @@ public:
     aio_service(aio_service&&) = delete;
     aio_service& operator=(aio_service&&) = delete;
 
+    // Falls back to the threads engine if the io_uring engine is requested
+    // but it can't be initialized.
     void start(const boost::container::string& vol_path,
-               uint16_t num_threads) noexcept;
+               const aio_service_cfg& cfg) noexcept;
     void stop();
 
+    // Registers a long living buffer with the IO engine, so that the IO
+    // operations on it are cheaper. Must be called before the start.
+    // The registered buffers are currently used only for the operations
+    // from the write queue, because only the agg_writer has such buffer.
+    void register_fixed_buffer(uint8_t* buf, bytes32_t size) noexcept;
+
     uint32_t read_queue_size() const noexcept { return read_queue_.size(); }
     uint32_t write_queue_size() const noexcept { return write_queue_.size(); }
 
+    void get_sched_stats(stats_aio_sched& sts) const noexcept;
+    void get_latency_stats(stats_aio_latency& sts) const noexcept
+    {
+        latencies_.get_stats(sts);
+    }
+
     // The aio_service starts to share the ownership of the task,
     // when the latter gets pushed to one of the queues.
     void push_front_read_queue(owner_ptr_t<aio_task> t) noexcept
@@ -87,7 +210,18 @@ public:
     }
 
 private:
-    static void process_queue(aio_task_queue& queue, volume_fd& fd) noexcept;
+    bool init_rings(const boost::container::string& vol_path,
+                    const aio_service_cfg& cfg) noexcept;
+    static void process_queue(aio_task_queue& queue,
+                              volume_fd& fd,
+                              aio_latencies& lats,
+                              aio_read_gate& gate) noexcept;
+    static void process_queue_uring(aio_task_queue& queue,
+                                    volume_fd& fd,
+                                    aio_latencies& lats,
+                                    aio_read_gate& gate,
+                                    aio_uring& ring,
+                                    const aio_uring::buffers_t& fbuffs) noexcept;
     static void push_front_task(owner_ptr_t<aio_task> t,
                                 aio_task_queue& queue) noexcept;
     static void push_task(owner_ptr_t<aio_task> t,
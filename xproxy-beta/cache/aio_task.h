@@ -13,6 +13,23 @@ enum struct aio_op : uint8_t
     write,
 };
 
+// The scheduling class of a task. The aio_task_queue keeps the tasks of
+// every class in a separate FIFO list and chooses between the classes
+// according to their weights and deadlines. The classes compete only
+// inside a single queue. The background classes go to the write queue,
+// where they compete with the interactive write handles. Their disk
+// operations also wait, for a bounded time, for the interactive reads
+// of the volume (see aio_read_gate).
+enum struct aio_class : uint8_t
+{
+    interactive, // Operations on which a client currently waits.
+    evacuation,
+    flush,
+    metadata, // Background metadata synchronization.
+};
+
+constexpr uint8_t aio_class_count = 4;
+
 using list_hook_t = boost::intrusive::list_base_hook<
     boost::intrusive::link_mode<boost::intrusive::safe_link>>;
 
@@ -25,6 +42,13 @@ private:
     friend void intrusive_ptr_release(aio_task*) noexcept;
     std::atomic_uint ref_cnt_{0};
 
+    // Maintained by the aio_task_queue under its lock. The class is
+    // remembered because the one returned by the task may change while
+    // the task waits in the queue.
+    friend class aio_task_queue;
+    std_clock_t::time_point enqueue_time_;
+    aio_class queued_class_ = aio_class::interactive;
+
 public:
     aio_task() noexcept {}
     // Note that the destructor of an aio_task can be called from any thread -
@@ -40,6 +64,12 @@ public:
 
     virtual aio_op operation() const noexcept = 0;
 
+    // Called when the task is put in an aio_task_queue.
+    virtual aio_class io_class() const noexcept
+    {
+        return aio_class::interactive;
+    }
+
     virtual void exec() noexcept = 0;
 
     // Why the IO is done in this way and outside of the task?
@@ -1,5 +1,6 @@
 #include "precompiled.h"
 #include "aio_task_queue.h"
+#include "cache_stats.h"
 
 namespace cache
 {
@@ -13,16 +14,28 @@ aio_task_queue::aio_task_queue() noexcept
 aio_task_queue::~aio_task_queue() noexcept
 {
     X3ME_ASSERT(
-        queue_.empty(),
+        empty(),
         "The tasks must have been released, otherwise we are leaking them");
 }
 
+void aio_task_queue::set_sched_cfg(const aio_sched_cfg& cfg) noexcept
+{
+    for (const auto& c : cfg.classes_)
+    {
+        X3ME_ENFORCE(c.weight_ > 0, "The class weight must be positive");
+        X3ME_ENFORCE(c.deadline_.count() >= 0,
+                     "The class deadline must not be negative");
+    }
+    lock_guard_t _(mutex_);
+    cfg_ = cfg;
+}
+
 bool aio_task_queue::push_front(owner_ptr_t<aio_task> t) noexcept
 {
     lock_guard_t _(mutex_);
     if (X3ME_LIKELY(working_))
     {
-        queue_.push_front(*t);
+        push(t, true /*front*/);
         // I believe 'synchronize with' semantic is not needed between all
         // of the store operations because they happen inside the mutex
         // critical section. Thus we don't need to use memory_order_acq_rel.
@@ -44,7 +57,7 @@ bool aio_task_queue::push_back(owner_ptr_t<aio_task> t) noexcept
     lock_guard_t _(mutex_);
     if (X3ME_LIKELY(working_))
     {
-        queue_.push_back(*t);
+        push(t, false /*front*/);
         size_.fetch_add(1, std::memory_order_release);
         cond_var_.notify_one();
         return true;
@@ -60,7 +73,7 @@ aio_task_queue::enqueue(owner_ptr_t<aio_task> t) noexcept
     {
         if (!t->is_linked())
         {
-            queue_.push_back(*t);
+            push(t, false /*front*/);
             size_.fetch_add(1, std::memory_order_release);
             cond_var_.notify_one();
             return enqueue_res::enqueued;
@@ -71,6 +84,13 @@ aio_task_queue::enqueue(owner_ptr_t<aio_task> t) noexcept
 }
 
 owner_ptr_t<aio_task> aio_task_queue::pop() noexcept
+{
+    std_clock_t::time_point enq;
+    return pop(enq);
+}
+
+owner_ptr_t<aio_task>
+aio_task_queue::pop(std_clock_t::time_point& enqueue_time) noexcept
 {
     // Returns null task if the queue is explicitly unblocked.
     owner_ptr_t<aio_task> t = nullptr;
@@ -78,25 +98,56 @@ owner_ptr_t<aio_task> aio_task_queue::pop() noexcept
     std::unique_lock<std::mutex> lk(mutex_);
     cond_var_.wait(lk, [this]
                    {
-                       return !queue_.empty() || !working_;
+                       return !empty() || !working_;
                    });
     if (working_)
     {
-        t = &queue_.front();
-        queue_.pop_front();
+        t = pop_next(std_clock_t::now(), enqueue_time);
         size_.fetch_sub(1, std::memory_order_release);
     }
 
     return t;
 }
 
+uint32_t aio_task_queue::pop(non_owner_ptr_t<aio_task>* tasks,
+                             uint32_t max_cnt,
+                             bool wait,
+                             std_clock_t::time_point* enqueue_times) noexcept
+{
+    uint32_t cnt = 0;
+
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (wait)
+    {
+        cond_var_.wait(lk, [this]
+                       {
+                           return !empty() || !working_;
+                       });
+    }
+    if (working_)
+    {
+        const auto now = std_clock_t::now();
+        std_clock_t::time_point enq;
+        for (; (cnt < max_cnt) && !empty(); ++cnt)
+        {
+            tasks[cnt] = pop_next(now, enq);
+            if (enqueue_times)
+                enqueue_times[cnt] = enq;
+        }
+        size_.fetch_sub(cnt, std::memory_order_release);
+    }
+
+    return cnt;
+}
+
 non_owner_ptr_t<aio_task>
 aio_task_queue::remove_task(non_owner_ptr_t<aio_task> t) noexcept
 {
     lock_guard_t _(mutex_);
     if (t->is_linked())
     {
-        queue_.erase(queue_t::s_iterator_to(*t));
+        auto& q = queues_[static_cast<uint8_t>(t->queued_class_)].tasks_;
+        q.erase(queue_t::s_iterator_to(*t));
         size_.fetch_sub(1, std::memory_order_release);
     }
     else
@@ -118,7 +169,10 @@ aio_task_queue::queue_t aio_task_queue::release_all() noexcept
 {
     lock_guard_t _(mutex_);
     size_.store(0, std::memory_order_release);
-    return std::move(queue_);
+    queue_t ret;
+    for (auto& q : queues_)
+        ret.splice(ret.end(), q.tasks_);
+    return ret;
 }
 
 uint32_t aio_task_queue::size() const noexcept
@@ -126,5 +180,110 @@ uint32_t aio_task_queue::size() const noexcept
     return size_.load(std::memory_order_acquire);
 }
 
+void aio_task_queue::get_stats(stats_aio_sched& sts) const noexcept
+{
+    // Indexed by aio_class
+    const std::array<stats_aio_class*, aio_class_count> out = {
+        {&sts.interactive_, &sts.evacuation_, &sts.flush_, &sts.metadata_}};
+    lock_guard_t _(mutex_);
+    for (uint8_t i = 0; i < aio_class_count; ++i)
+    {
+        const auto& q = queues_[i];
+        auto& s       = *out[i];
+        s.cnt_tasks_ += q.cnt_tasks_;
+        s.wait_time_us_ += q.wait_time_us_;
+        s.max_wait_time_us_ =
+            std::max(s.max_wait_time_us_, q.max_wait_time_us_);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void aio_task_queue::push(non_owner_ptr_t<aio_task> t, bool front) noexcept
+{
+    const auto cls = t->io_class();
+    X3ME_ASSERT(static_cast<uint8_t>(cls) < aio_class_count,
+                "Invalid aio class");
+    t->queued_class_ = cls;
+    t->enqueue_time_ = std_clock_t::now();
+    auto& q          = queues_[static_cast<uint8_t>(cls)].tasks_;
+    if (front)
+        q.push_front(*t);
+    else
+        q.push_back(*t);
+}
+
+non_owner_ptr_t<aio_task>
+aio_task_queue::pop_next(std_clock_t::time_point now,
+                         std_clock_t::time_point& enq) noexcept
+{
+    X3ME_ASSERT(!empty(), "Must be called only for non empty queue");
+    class_queue* sel = nullptr;
+    // The class with the most overdue task goes first, if there is such.
+    auto max_overdue = std_clock_t::duration::min();
+    for (uint8_t i = 0; i < aio_class_count; ++i)
+    {
+        auto& q = queues_[i];
+        if (q.tasks_.empty())
+            continue;
+        const auto overdue =
+            (now - q.tasks_.front().enqueue_time_) - cfg_.classes_[i].deadline_;
+        if ((overdue >= std_clock_t::duration::zero()) &&
+            (overdue > max_overdue))
+        {
+            max_overdue = overdue;
+            sel         = &q;
+        }
+    }
+    // Otherwise the smooth weighted round robin, as done by the nginx.
+    // Every class with tasks gets its weight as credit and the one with the
+    // most credit is chosen and pays the sum of the weights.
+    // This interleaves the classes instead of serving them in bursts.
+    if (!sel)
+    {
+        int32_t total = 0;
+        for (uint8_t i = 0; i < aio_class_count; ++i)
+        {
+            auto& q = queues_[i];
+            if (q.tasks_.empty())
+            {
+                // Don't keep credit or debt from the previous rounds.
+                q.credit_ = 0;
+                continue;
+            }
+            q.credit_ += cfg_.classes_[i].weight_;
+            total += cfg_.classes_[i].weight_;
+            if (!sel || (q.credit_ > sel->credit_))
+                sel = &q;
+        }
+        sel->credit_ -= total;
+    }
+
+    auto* t = &sel->tasks_.front();
+    sel->tasks_.pop_front();
+    enq = t->enqueue_time_;
+
+    const auto wait_us = std::max<int64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - t->enqueue_time_)
+            .count(),
+        0);
+    ++sel->cnt_tasks_;
+    sel->wait_time_us_ += wait_us;
+    sel->max_wait_time_us_ =
+        std::max<uint64_t>(sel->max_wait_time_us_, wait_us);
+
+    return t;
+}
+
+bool aio_task_queue::empty() const noexcept
+{
+    return std::all_of(queues_.begin(), queues_.end(),
+                       [](const class_queue& q)
+                       {
+                           return q.tasks_.empty();
+                       });
+}
+
 } // namespace detail
 } // namespace cache
@@ -4,9 +4,48 @@
 
 namespace cache
 {
+struct stats_aio_class;
+struct stats_aio_sched;
+
 namespace detail
 {
 
+struct aio_sched_cfg
+{
+    struct class_cfg
+    {
+        // The relative share of the pops which the class gets when all
+        // classes have queued tasks. Must be greater than zero.
+        uint16_t weight_;
+        // A task which has waited in the queue longer than this is popped
+        // before the tasks chosen by weight. Zero means that the tasks
+        // of the class never wait behind the tasks of the other classes.
+        std::chrono::microseconds deadline_;
+    };
+    // Indexed by aio_class.
+    // The interactive tasks in the write queue are the write handles.
+    // The agg_writer is the only one evacuation/flush task and it must not
+    // wait behind the other writes. The metadata sync can wait the most.
+    std::array<class_cfg, aio_class_count> classes_ = {{
+        {8, std::chrono::milliseconds(20)},  // interactive
+        {4, std::chrono::microseconds(0)},   // evacuation
+        {4, std::chrono::microseconds(0)},   // flush
+        {1, std::chrono::milliseconds(500)}, // metadata
+    }};
+};
+
+// The tasks of every aio_class are kept in a separate FIFO list.
+// The next task is taken from the class with the most overdue task, if any.
+// Otherwise the class is chosen by smooth weighted round robin among the
+// classes with queued tasks.
+// The classes compete only inside a queue. The aio_service puts all
+// background operations in its write queue, so the scheduling there is
+// between the write handles, the agg_writer and the metadata sync.
+// The reads are given priority over them by the aio_service instead.
+// A single task is present at most once in the queue and the read handles
+// enqueue themselves again after every fragment read. Thus the FIFO order
+// inside the interactive class gives round robin between the read handles,
+// so that a big object doesn't delay the reads of the small ones.
 class aio_task_queue
 {
 public:
@@ -17,9 +56,20 @@ public:
 private:
     using lock_guard_t = std::lock_guard<std::mutex>;
 
-    std::mutex mutex_;
+    struct class_queue
+    {
+        queue_t tasks_;
+        int32_t credit_ = 0; // Used by the weighted round robin
+        // Statistics
+        uint64_t cnt_tasks_        = 0;
+        uint64_t wait_time_us_     = 0;
+        uint64_t max_wait_time_us_ = 0;
+    };
+
+    mutable std::mutex mutex_;
     std::condition_variable cond_var_;
-    queue_t queue_;
+    std::array<class_queue, aio_class_count> queues_;
+    aio_sched_cfg cfg_;
     std::atomic_uint size_{0};
     bool working_ = true;
 
@@ -32,15 +82,19 @@ public:
     aio_task_queue(aio_task_queue&&) = delete;
     aio_task_queue& operator=(aio_task_queue&&) = delete;
 
+    // Must be called before the queue gets used by more than one thread.
+    void set_sched_cfg(const aio_sched_cfg& cfg) noexcept;
+
     // These two methods expect that the task is not already queued.
+    // The push_front puts the task before the other tasks of its class.
     // They return true if the task is put in the queue.
     // They return false if the queue is no longer working and the task is
     // not put in the queue.
     bool push_front(non_owner_ptr_t<aio_task> t) noexcept;
     bool push_back(non_owner_ptr_t<aio_task> t) noexcept;
-    // This method enqueues a task to the back if it's not already
-    // in the queue, otherwise it's no op and the task remains enqueued
-    // at its current position.
+    // This method enqueues a task to the back of its class list, if it's
+    // not already in the queue, otherwise it's no op and the task remains
+    // enqueued at its current position.
     // The method returns true if the task hasn't been in the queue
     // and is enqueued now, returns false otherwise.
     enum struct enqueue_res
@@ -52,6 +106,20 @@ public:
     enqueue_res enqueue(non_owner_ptr_t<aio_task> t) noexcept;
 
     non_owner_ptr_t<aio_task> pop() noexcept;
+    // Returns also the time when the popped task has been put in the queue.
+    // The task may be pushed again by another thread as soon as it's popped.
+    // Thus its enqueue time can't be read later without the queue lock.
+    non_owner_ptr_t<aio_task> pop(std_clock_t::time_point& enqueue_time) noexcept;
+    // Pops up to 'max_cnt' tasks at once and puts them in the 'tasks' array.
+    // Their enqueue times are put in the 'enqueue_times' array, if given.
+    // Waits for at least one task if 'wait' is true.
+    // Returns the number of popped tasks. Zero tasks are returned
+    // if the queue is explicitly unblocked or if it's empty and
+    // 'wait' is false.
+    uint32_t pop(non_owner_ptr_t<aio_task>* tasks,
+                 uint32_t max_cnt,
+                 bool wait,
+                 std_clock_t::time_point* enqueue_times = nullptr) noexcept;
     non_owner_ptr_t<aio_task> remove_task(non_owner_ptr_t<aio_task> t) noexcept;
 
     void stop() noexcept;
@@ -59,6 +127,15 @@ public:
     queue_t release_all() noexcept;
 
     uint32_t size() const noexcept;
+
+    // Adds the statistics of the queue to the given ones.
+    void get_stats(stats_aio_sched& sts) const noexcept;
+
+private:
+    void push(non_owner_ptr_t<aio_task> t, bool front) noexcept;
+    non_owner_ptr_t<aio_task> pop_next(std_clock_t::time_point now,
+                                       std_clock_t::time_point& enq) noexcept;
+    bool empty() const noexcept;
 };
 
 } // namespace detail
@@ -0,0 +1,288 @@
+#include "precompiled.h"
+#include "aio_uring.h"
+
+namespace cache
+{
+namespace detail
+{
+
+static int sys_io_uring_setup(uint32_t entries, io_uring_params* p) noexcept
+{
+    return ::syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd,
+                              uint32_t to_submit,
+                              uint32_t min_complete,
+                              uint32_t flags) noexcept
+{
+    return ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                     nullptr, 0);
+}
+
+static int sys_io_uring_register(int fd,
+                                 uint32_t opcode,
+                                 const void* arg,
+                                 uint32_t nr_args) noexcept
+{
+    return ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+template <typename T>
+static T* ring_ptr(uint8_t* ring, uint32_t offs) noexcept
+{
+    return reinterpret_cast<T*>(ring + offs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+aio_uring::~aio_uring() noexcept
+{
+    destroy();
+}
+
+bool aio_uring::init(uint32_t entries,
+                     int fd,
+                     const buffers_t& fixed_buffs,
+                     err_code_t& err) noexcept
+{
+    X3ME_ASSERT(ring_fd_ == invalid_fd, "Can't init the ring more than once");
+
+    io_uring_params p;
+    ::memset(&p, 0, sizeof(p));
+    const int rfd = sys_io_uring_setup(entries, &p);
+    if (rfd < 0)
+    {
+        err.assign(errno, bsys::get_system_category());
+        return false;
+    }
+    ring_fd_ = rfd;
+
+    auto map_ring = [this](size_t size, off_t offs) -> uint8_t*
+    {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring_fd_, offs);
+        return (p != MAP_FAILED) ? static_cast<uint8_t*>(p) : nullptr;
+    };
+
+    sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP);
+    if (single_mmap)
+    {
+        sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        cq_ring_size_ = 0; // Mapped together with the submission ring
+    }
+
+    sq_ring_ = map_ring(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (!sq_ring_)
+    {
+        err.assign(errno, bsys::get_system_category());
+        destroy();
+        return false;
+    }
+    if (single_mmap)
+    {
+        cq_ring_ = sq_ring_;
+    }
+    else if (!(cq_ring_ = map_ring(cq_ring_size_, IORING_OFF_CQ_RING)))
+    {
+        err.assign(errno, bsys::get_system_category());
+        destroy();
+        return false;
+    }
+    sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = reinterpret_cast<io_uring_sqe*>(
+        map_ring(sqes_size_, IORING_OFF_SQES));
+    if (!sqes_)
+    {
+        err.assign(errno, bsys::get_system_category());
+        destroy();
+        return false;
+    }
+
+    sq_head_  = ring_ptr<uint32_t>(sq_ring_, p.sq_off.head);
+    sq_tail_  = ring_ptr<uint32_t>(sq_ring_, p.sq_off.tail);
+    sq_mask_  = ring_ptr<uint32_t>(sq_ring_, p.sq_off.ring_mask);
+    sq_array_ = ring_ptr<uint32_t>(sq_ring_, p.sq_off.array);
+    cq_head_  = ring_ptr<uint32_t>(cq_ring_, p.cq_off.head);
+    cq_tail_  = ring_ptr<uint32_t>(cq_ring_, p.cq_off.tail);
+    cq_mask_  = ring_ptr<uint32_t>(cq_ring_, p.cq_off.ring_mask);
+    cqes_     = ring_ptr<io_uring_cqe>(cq_ring_, p.cq_off.cqes);
+
+    sq_entries_ = p.sq_entries;
+
+    // The registration of the file descriptor saves the atomic reference
+    // counting of the file for every operation. The registration of the
+    // buffers saves the pinning/unpinning of their pages for every
+    // operation. Both are only optimizations and we can work without them.
+    has_fixed_file_ =
+        (sys_io_uring_register(ring_fd_, IORING_REGISTER_FILES, &fd, 1) == 0);
+    if (!fixed_buffs.empty())
+    {
+        has_fixed_buffers_ =
+            (sys_io_uring_register(ring_fd_, IORING_REGISTER_BUFFERS,
+                                   fixed_buffs.data(), fixed_buffs.size()) == 0);
+        if (!has_fixed_buffers_)
+        {
+            const err_code_t e(errno, bsys::get_system_category());
+            XLOG_WARN(disk_tag, "Unable to register {} fixed IO buffers. {}",
+                      fixed_buffs.size(), e.message());
+        }
+    }
+
+    return true;
+}
+
+int aio_uring::find_fixed_buff(const buffers_t& fixed_buffs,
+                               const uint8_t* buf,
+                               bytes32_t len) const noexcept
+{
+    if (has_fixed_buffers_)
+    {
+        for (size_t i = 0; i < fixed_buffs.size(); ++i)
+        {
+            const auto beg = static_cast<const uint8_t*>(fixed_buffs[i].iov_base);
+            const auto end = beg + fixed_buffs[i].iov_len;
+            if ((buf >= beg) && ((buf + len) <= end))
+                return i;
+        }
+    }
+    return no_fixed_buff;
+}
+
+void aio_uring::prep_read(int fd,
+                          uint8_t* buf,
+                          bytes32_t len,
+                          bytes64_t off,
+                          int fixed_buff,
+                          user_data_t ud) noexcept
+{
+    const uint8_t op =
+        (fixed_buff != no_fixed_buff) ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    prep_rw(op, fd, buf, len, off, fixed_buff, ud);
+}
+
+void aio_uring::prep_write(int fd,
+                           const uint8_t* buf,
+                           bytes32_t len,
+                           bytes64_t off,
+                           int fixed_buff,
+                           user_data_t ud) noexcept
+{
+    const uint8_t op =
+        (fixed_buff != no_fixed_buff) ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    prep_rw(op, fd, buf, len, off, fixed_buff, ud);
+}
+
+bool aio_uring::submit_and_wait(uint32_t wait_nr, err_code_t& err) noexcept
+{
+    const uint32_t flags = (wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0;
+    for (;;)
+    {
+        const int r = sys_io_uring_enter(ring_fd_, to_submit_, wait_nr, flags);
+        if (r >= 0)
+        {
+            const auto submitted = std::min<uint32_t>(r, to_submit_);
+            to_submit_ -= submitted;
+            in_kernel_ += submitted;
+            if (to_submit_ == 0)
+                return true;
+            // Not all operations got submitted. Try with the rest.
+            if (submitted > 0)
+                continue;
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else if ((errno != EAGAIN) && (errno != EBUSY))
+        {
+            err.assign(errno, bsys::get_system_category());
+            return false;
+        }
+        // The kernel is out of resources or the completion queue is full.
+        // The completions of the operations in flight need to be reaped,
+        // before the rest get submitted. The caller reaps them and calls
+        // us again with the rest still prepared.
+        if (in_kernel_ == 0)
+        {
+            // Nothing in flight which could free the resources. Back off
+            // for a while and retry, instead of spinning.
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        return wait_completion(err);
+    }
+}
+
+bool aio_uring::wait_completion(err_code_t& err) noexcept
+{
+    const auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (tail != *cq_head_)
+        return true; // Already available
+    for (;;)
+    {
+        const int r =
+            sys_io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+        if (r >= 0)
+            return true;
+        if (errno == EINTR)
+            continue;
+        err.assign(errno, bsys::get_system_category());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void aio_uring::prep_rw(uint8_t opcode,
+                        int fd,
+                        const uint8_t* buf,
+                        bytes32_t len,
+                        bytes64_t off,
+                        int fixed_buff,
+                        user_data_t ud) noexcept
+{
+    const auto tail = *sq_tail_;
+    X3ME_ASSERT((tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE)) <
+                    sq_entries_,
+                "The submission queue must not be overflowed");
+    const auto idx = tail & *sq_mask_;
+
+    auto& sqe = sqes_[idx];
+    ::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode    = opcode;
+    sqe.fd        = has_fixed_file_ ? 0 : fd;
+    sqe.flags     = has_fixed_file_ ? IOSQE_FIXED_FILE : 0;
+    sqe.off       = off;
+    sqe.addr      = reinterpret_cast<uint64_t>(buf);
+    sqe.len       = len;
+    sqe.user_data = ud;
+    if (fixed_buff != no_fixed_buff)
+        sqe.buf_index = fixed_buff;
+
+    sq_array_[idx] = idx;
+    // The kernel must see the filled entry before the tail update
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++to_submit_;
+}
+
+void aio_uring::destroy() noexcept
+{
+    if (sqes_)
+        ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ && (cq_ring_ != sq_ring_))
+        ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_)
+        ::munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ != invalid_fd)
+        ::close(ring_fd_);
+    sqes_    = nullptr;
+    cq_ring_ = nullptr;
+    sq_ring_ = nullptr;
+    ring_fd_ = invalid_fd;
+}
+
+} // namespace detail
+} // namespace cache
@@ -0,0 +1,134 @@
+#pragma once
+
+namespace cache
+{
+namespace detail
+{
+
+// Thin wrapper over the raw Linux io_uring interface.
+// We don't use the liburing, because it's not available on all of our
+// target systems and we need only a small part of its functionality.
+// The class is not thread safe. Every AIO thread owns its own ring.
+class aio_uring
+{
+public:
+    using buffers_t = boost::container::small_vector<iovec, 4>;
+
+    // The user data passed with every IO operation is returned back
+    // together with the operation result upon its completion.
+    using user_data_t = uint64_t;
+
+    enum : int
+    {
+        no_fixed_buff = -1
+    };
+
+private:
+    enum : int
+    {
+        invalid_fd = -1
+    };
+    int ring_fd_ = invalid_fd;
+
+    // Submission queue ring
+    uint8_t* sq_ring_       = nullptr;
+    size_t sq_ring_size_    = 0;
+    uint32_t* sq_head_      = nullptr;
+    uint32_t* sq_tail_      = nullptr;
+    uint32_t* sq_mask_      = nullptr;
+    uint32_t* sq_array_     = nullptr;
+    io_uring_sqe* sqes_     = nullptr;
+    size_t sqes_size_       = 0;
+    // Completion queue ring. It could be mapped together with the
+    // submission ring if the kernel supports this.
+    uint8_t* cq_ring_       = nullptr;
+    size_t cq_ring_size_    = 0;
+    uint32_t* cq_head_      = nullptr;
+    uint32_t* cq_tail_      = nullptr;
+    uint32_t* cq_mask_      = nullptr;
+    io_uring_cqe* cqes_     = nullptr;
+
+    uint32_t sq_entries_    = 0;
+    uint32_t to_submit_     = 0;
+    // Submitted, but still not reaped operations
+    uint32_t in_kernel_     = 0;
+    bool has_fixed_file_    = false;
+    bool has_fixed_buffers_ = false;
+
+public:
+    aio_uring() noexcept = default;
+    ~aio_uring() noexcept;
+
+    aio_uring(const aio_uring&) = delete;
+    aio_uring& operator=(const aio_uring&) = delete;
+    aio_uring(aio_uring&&) = delete;
+    aio_uring& operator=(aio_uring&&) = delete;
+
+    // Creates the ring with the given number of entries and registers the
+    // given file descriptor and buffers with it. The registration of the
+    // file and the buffers is optional optimization and failure to register
+    // them is not reported as error. They are just not used in this case.
+    bool init(uint32_t entries, int fd, const buffers_t& fixed_buffs,
+              err_code_t& err) noexcept;
+
+    // Returns the index of the registered buffer which fully contains
+    // the given memory region or no_fixed_buff if there is no such buffer.
+    int find_fixed_buff(const buffers_t& fixed_buffs, const uint8_t* buf,
+                        bytes32_t len) const noexcept;
+
+    // The caller must ensure that there are no more than 'entries'
+    // operations in flight. Both functions only prepare the operations.
+    // The submission happens on the next call to submit_and_wait.
+    void prep_read(int fd, uint8_t* buf, bytes32_t len, bytes64_t off,
+                   int fixed_buff, user_data_t ud) noexcept;
+    void prep_write(int fd, const uint8_t* buf, bytes32_t len, bytes64_t off,
+                    int fixed_buff, user_data_t ud) noexcept;
+
+    // Submits all prepared operations and waits for at least 'wait_nr'
+    // completions. Returns false in case of error which is different
+    // from interrupted call. If the kernel can't take all operations,
+    // because of lack of resources, the function returns true once there
+    // is a completion available, leaving the rest of the operations
+    // prepared. The caller needs to reap the completions and call it again.
+    bool submit_and_wait(uint32_t wait_nr, err_code_t& err) noexcept;
+
+    // Calls the given function for every available completion.
+    // The function is called with the user data and the result of the
+    // operation - the transferred bytes or negative errno value.
+    // Returns the number of processed completions.
+    template <typename Fn>
+    uint32_t reap_completions(Fn&& fn) noexcept;
+
+    uint32_t entries() const noexcept { return sq_entries_; }
+
+private:
+    bool wait_completion(err_code_t& err) noexcept;
+    void prep_rw(uint8_t opcode, int fd, const uint8_t* buf, bytes32_t len,
+                 bytes64_t off, int fixed_buff, user_data_t ud) noexcept;
+    void destroy() noexcept;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename Fn>
+uint32_t aio_uring::reap_completions(Fn&& fn) noexcept
+{
+    uint32_t cnt = 0;
+    auto head    = *cq_head_;
+    // The kernel updates the tail. We need to see the completion entries
+    // written before the tail update.
+    const auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head, ++cnt)
+    {
+        const auto& cqe = cqes_[head & *cq_mask_];
+        fn(static_cast<user_data_t>(cqe.user_data), cqe.res);
+    }
+    // The completion entries are no longer needed and the kernel can
+    // reuse them.
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    in_kernel_ -= std::min(cnt, in_kernel_);
+    return cnt;
+}
+
+} // namespace detail
+} // namespace cache
@@ -21,5 +21,11 @@ aligned_data_ptr_t alloc_page_aligned(size_t size) noexcept
     return aligned_data_ptr_t(static_cast<uint8_t*>(ptr));
 }
 
+aligned_data_ref_t alloc_page_aligned_ref(size_t size) noexcept
+{
+    return aligned_data_ref_t(alloc_page_aligned(size).release(),
+                              free_delete{});
+}
+
 } // namespace detail
 } // namespace cache
@@ -15,5 +15,12 @@ using aligned_data_ptr_t = std::unique_ptr<uint8_t[], free_delete>;
 
 aligned_data_ptr_t alloc_page_aligned(size_t size) noexcept;
 
+// Shared ownership of an aligned buffer. Used for the object fragments read
+// from the disk, so that they can be passed to the RAM cache and later
+// served from there to many readers without copying them.
+using aligned_data_ref_t = std::shared_ptr<uint8_t>;
+
+aligned_data_ref_t alloc_page_aligned_ref(size_t size) noexcept;
+
 } // namespace detail
 } // namespace cache
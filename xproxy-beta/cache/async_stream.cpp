@@ -125,13 +125,14 @@ void async_stream::async_open_write_impl(const cache_key& key,
                                          bool truncate_object,
                                          open_whandler_t&& h) noexcept
 {
-    if (auto handle = obj_distributor_->async_open_write(key, truncate_object,
-                                                         std::move(h)))
-    {
-        handle_ = std::move(handle);
-    }
+    // The handler posts the result. Thus it's not called inline here, even
+    // if the operation can't be started.
+    auto res =
+        obj_distributor_->async_open_write(key, truncate_object, std::move(h));
+    if (res)
+        handle_ = std::move(*res);
     else
-        h(cache::tasks_limit_reached, detail::object_whandle_ptr_t{});
+        h(res.error(), detail::object_whandle_ptr_t{});
 }
 
 ////////////////////////////////////////////////////////////////////////////////
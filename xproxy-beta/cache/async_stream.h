@@ -68,6 +68,13 @@ public:
     template <typename MutableBuffers, typename Handler>
     void async_read(MutableBuffers&& bufs, Handler&& h) noexcept;
 
+    // Reads at most max_len bytes by referring to the cached data instead
+    // of copying it. The data is valid for as long as it's referred.
+    template <typename Handler>
+    void async_read_shared(shared_data_t& data,
+                           bytes32_t max_len,
+                           Handler&& h) noexcept;
+
     template <typename ConstBuffers, typename Handler>
     void async_write(ConstBuffers&& bufs, Handler&& h) noexcept;
 
@@ -214,6 +221,39 @@ void async_stream::async_read(MutableBuffers&& buff, Handler&& h) noexcept
             });
 }
 
+template <typename Handler>
+void async_stream::async_read_shared(shared_data_t& data,
+                                     bytes32_t max_len,
+                                     Handler&& h) noexcept
+{
+    static_assert(
+        std::is_same<decltype(h(*(const err_code_t*)nullptr, 0U)), void>::value,
+        "The read handler must be 'void (const err_code_t&, uint32_t)'");
+    auto* obj_handle = boost::get<detail::object_rhandle_ptr_t>(&handle_);
+    if (!obj_handle || !obj_handle->get())
+    {
+        handler_ios_->post([h = std::forward<Handler>(h)]
+                           {
+                               h(err_invalid_handle(), 0U);
+                           });
+        return;
+    }
+    X3ME_ASSERT(!op_in_progress(),
+                "Multiple async operations in progress are not allowed");
+    set_op_in_progress(true);
+    (*obj_handle)
+        ->async_read(
+            data, max_len, [ this, h = std::forward<Handler>(h) ](
+                               const err_code_t& err, uint32_t bytes) mutable
+            {
+                handler_ios_->post([ this, h = std::move(h), err, bytes ]
+                                   {
+                                       set_op_in_progress(false);
+                                       h(err, bytes);
+                                   });
+            });
+}
+
 template <typename ConstBuffers, typename Handler>
 void async_stream::async_write(ConstBuffers&& buff, Handler&& h) noexcept
 {
@@ -256,29 +296,37 @@ void async_stream::async_close(Handler&& h) noexcept
     static_assert(
         std::is_same<decltype(h(*(const err_code_t*)nullptr)), void>::value,
         "The close handler must be 'void (const err_code_t&)'");
-    auto* obj_handle = boost::get<detail::object_rhandle_ptr_t>(&handle_);
-    X3ME_ENFORCE(obj_handle,
-                 "The operation is currently supported only for read handles");
-    if (!obj_handle->get())
+    auto on_close = [ this, h = std::forward<Handler>(h) ](
+        const err_code_t& err) mutable
     {
-        handler_ios_->post([h = std::forward<Handler>(h)]
+        handler_ios_->post([ this, h = std::move(h), err ]
                            {
-                               h(err_invalid_handle());
+                               set_cl_in_progress(false);
+                               h(err);
                            });
+    };
+    auto* rhandle = boost::get<detail::object_rhandle_ptr_t>(&handle_);
+    auto* whandle = boost::get<detail::object_whandle_ptr_t>(&handle_);
+    X3ME_ENFORCE(rhandle || whandle, "The operation is currently supported "
+                                     "only for read and write handles");
+    const bool valid = rhandle ? !!rhandle->get() : !!whandle->get();
+    if (!valid)
+    {
+        set_cl_in_progress(true);
+        on_close(err_invalid_handle());
         return;
     }
     set_cl_in_progress(true);
-    (*obj_handle)
-        ->async_close([ this, h = std::forward<Handler>(h) ](
-            const err_code_t& err) mutable
-                      {
-                          handler_ios_->post([ this, h = std::move(h), err ]
-                                             {
-                                                 set_cl_in_progress(false);
-                                                 h(err);
-                                             });
-                      });
-    obj_handle->reset();
+    if (rhandle)
+    {
+        (*rhandle)->async_close(std::move(on_close));
+        rhandle->reset();
+    }
+    else
+    {
+        (*whandle)->async_close(std::move(on_close));
+        whandle->reset();
+    }
 }
 
 } // namespace cache
@@ -57,6 +57,12 @@ public:
 } // namespace detail
 ////////////////////////////////////////////////////////////////////////////////
 
+// Refers to a part of a cached object fragment instead of a copy of it.
+// The fragment data remains valid and unchanged while it's referred.
+using shared_data_t = std::shared_ptr<const uint8_t>;
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct const_buffer;
 
 struct mutable_buffer : public detail::buffers
@@ -20,7 +20,8 @@ namespace cache
     MACRO(internal_logic_error, "Internal logic error")                        \
     MACRO(service_stopped, "Service stopped")                                  \
     MACRO(unexpected_data, "More data than expected")                          \
-    MACRO(tasks_limit_reached, "Cache AIO tasks limit reached")
+    MACRO(tasks_limit_reached, "Cache AIO tasks limit reached")                \
+    MACRO(object_not_admitted, "Object not admitted to the cache")
 
 // Couldn't find appropriate already present system error for these errors.
 enum error
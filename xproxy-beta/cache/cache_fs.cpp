@@ -1,9 +1,12 @@
 #include "precompiled.h"
 #include "cache_fs.h"
 #include "agg_writer.h"
+#include "agg_write_block.h"
+#include "agg_write_meta.h"
 #include "aligned_data_ptr.h"
 #include "cache_stats.h"
 #include "disk_reader.h"
+#include "memory_reader.h"
 #include "memory_writer.h"
 #include "object_open_handle.h"
 #include "task_md_sync.h"
@@ -117,7 +120,12 @@ bool cache_fs::init_reset() noexcept
     return true;
 }
 
-bool cache_fs::init(uint16_t num_threads) noexcept
+bool cache_fs::init(const aio_service_cfg& aio_cfg,
+                    const admission_cfg& adm_cfg,
+                    bytes64_t md_jrnl_max_size,
+                    bytes64_t mem_cache_size,
+                    const read_ahead_cfg& rdah_cfg,
+                    const evac_cfg& ev_cfg) noexcept
 {
     XLOG_DEBUG(disk_tag, "Start initialization of the cache FS for volume '{}'",
                path_);
@@ -154,7 +162,8 @@ bool cache_fs::init(uint16_t num_threads) noexcept
         // different kinds of metadata saving and I couldn't generalize them,
         // so that I can put them in the metadata functionality.
         disk_reader rdr(path_, metadata_offset_[0], fs_ops_.data_offs());
-        if (!tmp.load(rdr) || !check_write_pos(fs_ops_, tmp))
+        const bool loaded = tmp.load(rdr) && check_write_pos(fs_ops_, tmp);
+        if (!loaded)
         {
             init_reset_impl(fd, tmp);
         }
@@ -162,6 +171,17 @@ bool cache_fs::init(uint16_t num_threads) noexcept
         if ((tmp.write_pos() + agg_write_block_size) > fs_ops_.end_data_offs())
             tmp.wrap_write_pos(fs_ops_.data_offs());
 
+        // The replay moves the write position past the replayed blocks.
+        // The new blocks will be written there and they may overwrite the
+        // journal which the on-disk checkpoint still needs. Thus the
+        // replayed metadata becomes the new checkpoint before any writes.
+        if (loaded && replay_md_jrnl(fd, tmp))
+            init_save_md_chkpt(fd, tmp);
+
+        md_chkpt_.set_write_pos(tmp.write_pos());
+        md_chkpt_.set_write_lap(tmp.write_lap());
+        md_jrnl_max_size_ = md_jrnl_max_size;
+
         XLOG_INFO(disk_tag, "Initialized cache FS for volume '{}'. MD A "
                             "offset: {} bytes. MD B offset: {} bytes. Data "
                             "offset: {} bytes. End data offset: {} bytes. "
@@ -175,8 +195,20 @@ bool cache_fs::init(uint16_t num_threads) noexcept
         agg_writer_ = make_aio_task<agg_writer>(wpos, tmp.write_lap());
         fs_meta_    = std::move(tmp);
 
+        agg_writer_->set_jrnl_fs_uuid(uuid_);
         fs_ops_.set_agg_writer(agg_writer_.get());
-        aios_.start(path_, num_threads);
+        fs_ops_.set_mem_cache_size(mem_cache_size);
+        fs_ops_.set_read_ahead_cfg(rdah_cfg);
+        fs_ops_.set_evac_cfg(ev_cfg);
+        adm_filter_.init(adm_cfg);
+        // The aggregate blocks memory is used for all disk writes and for
+        // some of the reads done by the agg_writer.
+        for (const auto& wb : agg_writer_->write_blocks())
+        {
+            const auto wblock = wb->block_buff();
+            aios_.register_fixed_buffer(wblock.data(), wblock.size());
+        }
+        aios_.start(path_, aio_cfg);
         agg_writer_->start(&fs_ops_);
     }
     catch (const std::exception& ex)
@@ -277,6 +309,12 @@ object_ohandle_ptr_t cache_fs::async_open_write(const object_key& obj_key,
     return ret;
 }
 
+bool cache_fs::admit_write(const object_key& obj_key,
+                           bytes64_t obj_size) noexcept
+{
+    return adm_filter_.admit(obj_key.fs_node_key(), obj_size);
+}
+
 stats_fs cache_fs::get_stats() const noexcept
 {
     stats_fs sts;
@@ -291,6 +329,8 @@ stats_fs cache_fs::get_stats() const noexcept
     sts.path_               = path_;
     sts.cnt_pending_reads_  = aios_.read_queue_size();
     sts.cnt_pending_writes_ = aios_.write_queue_size();
+    aios_.get_sched_stats(sts.aio_sched_);
+    aios_.get_latency_stats(sts.aio_latency_);
 
     err_mutex_.lock();
     sts.cnt_errors_ = cnt_disk_errors_;
@@ -303,6 +343,7 @@ stats_internal cache_fs::get_internal_stats() const noexcept
 {
     stats_internal sts;
     fs_ops_.get_internal_stats(sts);
+    adm_filter_.get_stats(sts);
     return sts;
 }
 
@@ -336,9 +377,38 @@ void cache_fs::init_reset_impl(volume_fd& fd, fs_metadata& out)
     }
 }
 
+void cache_fs::init_save_md_chkpt(volume_fd& fd, fs_metadata& md)
+{
+    md.set_non_dirty();
+    md.inc_sync_serial();
+    const uint32_t idx = md.sync_serial() & 1U;
+    const auto cp      = idx ? 'B' : 'A';
+
+    const auto buff_size = metadata_max_size();
+    auto p               = alloc_page_aligned(buff_size);
+
+    memory_writer wtr(p.get(), buff_size);
+    md.save(wtr);
+    const auto md_size = wtr.written();
+    err_code_t err;
+    if (!fd.write(p.get(), md_size, metadata_offset_[idx], err))
+    {
+        throw bsys::system_error(err, idx
+                                          ? "Write B metadata checkpoint failed"
+                                          : "Write A metadata checkpoint failed");
+    }
+    XLOG_INFO(disk_tag, "Saved {} metadata checkpoint after the journal "
+                        "replay for volume '{}'. Disk offset: {} bytes. "
+                        "Size: {} bytes",
+              cp, path_, metadata_offset_[idx], md_size);
+}
+
 void cache_fs::async_sync_metadata(const cb_on_sync_end_t& on_end) noexcept
 {
-    if (fs_meta_->is_dirty())
+    // The changes are journaled in the aggregate blocks. We save the whole
+    // metadata only when the journal becomes too long for a fast replay.
+    const bool is_dirty = fs_meta_->is_dirty();
+    if (is_dirty && md_chkpt_needed())
     {
         const auto prev = async_sync_in_progress_.exchange(true);
         X3ME_ASSERT(!prev, "There shouldn't be a previous metadata sync "
@@ -358,7 +428,12 @@ void cache_fs::async_sync_metadata(const cb_on_sync_end_t& on_end) noexcept
         auto p               = alloc_page_aligned(buff_size);
 
         memory_writer wtr(p.get(), buff_size);
-        fs_meta_.as_const()->save(wtr);
+        with_synchronized(fs_meta_.as_const(), [&](const fs_metadata& md)
+                          {
+                              md.save(wtr);
+                              md_chkpt_.set_write_pos(md.write_pos());
+                              md_chkpt_.set_write_lap(md.write_lap());
+                          });
 
         const auto md_size = wtr.written();
         XLOG_INFO(disk_tag, "Start {} metadata asynchronous sync for cache "
@@ -383,9 +458,9 @@ void cache_fs::async_sync_metadata(const cb_on_sync_end_t& on_end) noexcept
     }
     else
     {
-        XLOG_INFO(disk_tag, "Skip asynchronous sync of non-dirty metadata "
+        XLOG_INFO(disk_tag, "Skip asynchronous sync of {} metadata "
                             "for cache FS for volume '{}'",
-                  path_);
+                  is_dirty ? "journaled" : "non-dirty", path_);
         on_end(shared_from_this());
     }
 }
@@ -436,6 +511,166 @@ void cache_fs::sync_metadata() noexcept
     }
 }
 
+bool cache_fs::replay_md_jrnl(volume_fd& fd, fs_metadata& md) noexcept
+{
+    const auto data_offs     = fs_ops_.data_offs();
+    const auto end_data_offs = fs_ops_.end_data_offs();
+    const auto beg_pos       = md.write_pos();
+    const auto beg_lap       = md.write_lap();
+
+    auto buf = alloc_page_aligned(agg_write_meta_size);
+    // Reads the block metadata at the given position. Returns true if the
+    // block has been written by the current FS on the given lap.
+    auto read_meta = [&](bytes64_t pos, uint64_t lap, agg_write_meta& meta)
+    {
+        err_code_t err;
+        if (!fd.read(buf.get(), agg_write_meta_size, pos, err))
+        {
+            XLOG_ERROR(disk_tag, "Unable to read the journal block at {} "
+                                 "bytes for volume '{}'. {}",
+                       pos, path_, err.message());
+            return false;
+        }
+        memory_reader rdr(buf.get(), agg_write_meta_size);
+        return meta.load(rdr) && meta.has_jrnl() &&
+               (meta.jrnl_fs_uuid() == md.uuid()) &&
+               (meta.jrnl_write_lap() == lap);
+    };
+    auto next_pos = [data_offs, end_data_offs](bytes64_t& pos, uint64_t& lap)
+    {
+        if (pos + (2 * agg_write_block_size) <= end_data_offs)
+        {
+            pos += agg_write_block_size;
+        }
+        else
+        {
+            pos = data_offs;
+            lap += 1;
+        }
+    };
+
+    // The first pass finds how many blocks have been written after the
+    // checkpoint and how many of them have complete journal. The blocks
+    // after an incomplete one can't be applied, because some removals
+    // are missing and we could resurrect removed entries. However, they have
+    // been written and overwrote the data on the disk anyway.
+    uint64_t cnt_blocks   = 0;
+    uint64_t cnt_complete = 0;
+    bytes64_t end_pos     = beg_pos;
+    uint64_t end_lap      = beg_lap;
+    {
+        agg_write_meta meta(agg_write_meta_size);
+        // We never replay more than a whole lap
+        while (((end_lap == beg_lap) || (end_pos < beg_pos)) &&
+               read_meta(end_pos, end_lap, meta))
+        {
+            ++cnt_blocks;
+            if ((cnt_complete + 1 == cnt_blocks) && meta.jrnl_complete())
+                ++cnt_complete;
+            next_pos(end_pos, end_lap);
+        }
+    }
+    if (cnt_blocks == 0)
+        return false;
+
+    // The table entries pointing to the overwritten disk areas are no
+    // longer valid.
+    const bool wrapped = (end_lap != beg_lap);
+    const auto cnt_inv = md.rem_table_entries_if(
+        [beg_pos, end_pos, wrapped](const range_elem& rng)
+        {
+            const auto offs = rng.disk_offset().to_bytes();
+            return wrapped ? ((offs >= beg_pos) || (offs < end_pos))
+                           : ((offs >= beg_pos) && (offs < end_pos));
+        });
+
+    // The second pass applies the journal of the complete blocks and moves
+    // the write position after the last written block.
+    uint64_t cnt_rem = 0;
+    uint64_t cnt_add = 0;
+    uint64_t cnt_err = 0;
+    agg_write_meta meta(agg_write_meta_size);
+    for (uint64_t i = 0; i < cnt_blocks; ++i)
+    {
+        const auto pos = md.write_pos();
+        if ((i < cnt_complete) && read_meta(pos, md.write_lap(), meta))
+        {
+            for (const auto& key : meta.rem_keys())
+            {
+                md.rem_table_entries(
+                    key, [&cnt_rem](range_vector& rv)
+                    {
+                        const auto rem_size = std::accumulate(
+                            rv.begin(), rv.end(), bytes64_t{0},
+                            [](bytes64_t sum, const range_elem& r)
+                            {
+                                return sum + r.rng_size();
+                            });
+                        cnt_rem += rv.size();
+                        rv.rem_range(
+                            range_vector::iter_range{rv.begin(), rv.end()});
+                        return rem_size;
+                    });
+            }
+            for (const auto& e : meta)
+            {
+                auto rng = e.rng();
+                if (!valid_range_elem(rng, pos + agg_write_meta_size,
+                                      agg_write_data_size))
+                {
+                    ++cnt_err;
+                    continue;
+                }
+                rng.reset_meta();
+                // The journal entries are always newer than the table ones
+                const auto res = md.add_table_entry(
+                    e.key(), rng,
+                    [](range_vector::iter_range, const range_elem&)
+                    {
+                        return true;
+                    });
+                if ((res == fs_table::add_res::added) ||
+                    (res == fs_table::add_res::overwrote))
+                    ++cnt_add;
+            }
+        }
+        if (pos + (2 * agg_write_block_size) <= end_data_offs)
+            md.inc_write_pos(agg_write_block_size);
+        else
+            md.wrap_write_pos(data_offs);
+    }
+    X3ME_ASSERT((md.write_pos() == end_pos) && (md.write_lap() == end_lap),
+                "Wrong position logic");
+
+    XLOG_INFO(disk_tag, "Replayed metadata journal for volume '{}'. Blocks "
+                        "{}. Complete blocks {}. Invalidated entries {}. "
+                        "Removed entries {}. Added entries {}. Invalid "
+                        "entries {}. Write_pos {} bytes. Write_lap {}",
+              path_, cnt_blocks, cnt_complete, cnt_inv, cnt_rem, cnt_add,
+              cnt_err, end_pos, end_lap);
+    return true;
+}
+
+bool cache_fs::md_chkpt_needed() noexcept
+{
+    // A removal has been lost from the journal. The journal can't be
+    // replayed past it and thus we need a new checkpoint.
+    if (agg_writer_->reset_jrnl_broken())
+        return true;
+    if (md_jrnl_max_size_ == 0)
+        return true;
+    const auto data_size = fs_ops_.end_data_offs() - fs_ops_.data_offs();
+    const auto jrnl_size = x3me::thread::with_synchronized(
+        fs_meta_.as_const(), [this, data_size](const fs_metadata& md)
+        {
+            return ((md.write_lap() - md_chkpt_.write_lap()) * data_size) +
+                   md.write_pos() - md_chkpt_.write_pos();
+        });
+    // The journal must never get close to a whole lap, because the blocks
+    // from its beginning get overwritten.
+    return (jrnl_size >= md_jrnl_max_size_) || (jrnl_size >= (data_size / 2));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void cache_fs::on_disk_error() noexcept
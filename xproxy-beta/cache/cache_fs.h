@@ -1,5 +1,6 @@
 #pragma once
 
+#include "admission_filter.h"
 #include "aio_service.h"
 #include "async_handlers_fwds.h"
 #include "cache_fs_operations.h"
@@ -57,6 +58,10 @@ class cache_fs : public std::enable_shared_from_this<cache_fs>
 
     cache_fs_operations fs_ops_;
 
+    // Every object goes to a single volume. Thus the per volume filters
+    // work as a single one split in shards.
+    admission_filter adm_filter_;
+
     // We skip some bytes from the beginning of the given volume in order
     // to not mess with the OS stuff.
     // We have two copies of the metadata on the disk.
@@ -75,6 +80,14 @@ class cache_fs : public std::enable_shared_from_this<cache_fs>
 
     std::atomic_bool async_sync_in_progress_{false};
 
+    // The write position at the time of the last full metadata save
+    // (checkpoint). The aggregate blocks written after it form the metadata
+    // journal. Accessed only by the thread doing the metadata syncs.
+    fs_ops_data md_chkpt_;
+    // A full metadata save is done only when the journal grows above this
+    // size. Zero means that the full metadata is saved on every sync.
+    bytes64_t md_jrnl_max_size_ = 0;
+
     struct private_tag
     {
     };
@@ -100,7 +113,12 @@ public:
     // Can be used only before a call to init.
     bool init_reset() noexcept;
 
-    bool init(uint16_t num_threads) noexcept;
+    bool init(const aio_service_cfg& aio_cfg,
+              const admission_cfg& adm_cfg,
+              bytes64_t md_jrnl_max_size,
+              bytes64_t mem_cache_size,
+              const read_ahead_cfg& rdah_cfg,
+              const evac_cfg& ev_cfg) noexcept;
 
     // Stops an in-progress metdata sync (if any).
     // Syncs synchronously the metadata (if dirty).
@@ -114,6 +132,9 @@ public:
     object_ohandle_ptr_t async_open_write(const object_key& obj_key,
                                           bool truncate_object,
                                           open_whandler_t&& h) noexcept;
+    // Counts the write request for the given object and returns true if
+    // the object should be written to the cache. Thread safe.
+    bool admit_write(const object_key& obj_key, bytes64_t obj_size) noexcept;
 
     // These methods can be safely called from multiple threads
     stats_fs get_stats() const noexcept;
@@ -126,9 +147,20 @@ public:
 
     const boost::container::string& vol_path() const noexcept { return path_; }
     const uuid_t& uuid() const noexcept { return uuid_; }
+    bytes64_t data_size() const noexcept
+    {
+        return fs_ops_.end_data_offs() - fs_ops_.data_offs();
+    }
 
 private:
     void init_reset_impl(volume_fd& fd, fs_metadata& out);
+    // Writes synchronously a full checkpoint of the given metadata.
+    // Throws on write failure.
+    void init_save_md_chkpt(volume_fd& fd, fs_metadata& md);
+    // Applies to the loaded metadata the changes from the aggregate blocks
+    // written after it. Returns true if some blocks have been replayed.
+    bool replay_md_jrnl(volume_fd& fd, fs_metadata& md) noexcept;
+    bool md_chkpt_needed() noexcept;
     // Synchronous sync of the metadata
     void sync_metadata() noexcept;
 
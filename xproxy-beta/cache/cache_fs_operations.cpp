@@ -30,6 +30,15 @@ static Stat read_stat(const std::atomic<Stat>& cnt) noexcept
     return cnt.load(std::memory_order_acquire);
 }
 
+static cache_fs_ops::wr_pos next_wr_pos(const cache_fs_ops::wr_pos& curr,
+                                        bytes64_t data_offs,
+                                        bytes64_t end_data_offs) noexcept
+{
+    if (curr.write_pos_ + (2 * agg_write_block_size) <= end_data_offs)
+        return {curr.write_pos_ + agg_write_block_size, curr.write_lap_};
+    return {data_offs, curr.write_lap_ + 1};
+}
+
 static cache_fs_ops::wr_pos go_to_next_wr_pos(fs_metadata& md,
                                               bytes64_t data_offs,
                                               bytes64_t end_data_offs) noexcept
@@ -41,6 +50,20 @@ static cache_fs_ops::wr_pos go_to_next_wr_pos(fs_metadata& md,
     return {md.write_pos(), md.write_lap()};
 }
 
+// The agg_writer fills the block for the current write position or, while
+// the block for the current write position is flushed, the block for the
+// next write position.
+static bool valid_agg_write_pos(const fs_metadata& md,
+                                volume_blocks64_t disk_offset,
+                                bytes64_t data_offs,
+                                bytes64_t end_data_offs) noexcept
+{
+    const auto doffs = disk_offset.to_bytes();
+    const cache_fs_ops::wr_pos curr{md.write_pos(), md.write_lap()};
+    return (doffs == curr.write_pos_) ||
+           (doffs == next_wr_pos(curr, data_offs, end_data_offs).write_pos_);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 cache_fs_operations::cache_fs_operations(
@@ -75,6 +98,29 @@ void cache_fs_operations::set_agg_writer(
     agg_writer_ = agw;
 }
 
+void cache_fs_operations::set_mem_cache_size(bytes64_t size) noexcept
+{
+    mem_cache_.set_max_size(size);
+}
+
+void cache_fs_operations::set_read_ahead_cfg(const read_ahead_cfg& cfg) noexcept
+{
+    X3ME_ASSERT(cfg.max_frags_ <= read_ahead_cfg::frags_limit,
+                "The read-ahead fragments count must be checked by the caller");
+    X3ME_ASSERT(cfg.max_read_size_ <= agg_write_data_size,
+                "The coalesced read size must be checked by the caller");
+    rdah_cfg_ = cfg;
+}
+
+void cache_fs_operations::set_evac_cfg(const evac_cfg& cfg) noexcept
+{
+    X3ME_ASSERT(cfg.min_hits_ <= range_elem::max_hits(),
+                "The evacuation hits must be checked by the caller");
+    X3ME_ASSERT(cfg.max_hot_size_ <= agg_write_data_size,
+                "The evacuation size must be checked by the caller");
+    evac_cfg_ = cfg;
+}
+
 const boost::container::string& cache_fs_operations::vol_path() const noexcept
 {
     return *path_;
@@ -114,6 +160,15 @@ void cache_fs_operations::get_internal_stats(stats_internal& sts) const noexcept
     sts.cnt_failed_unmark_read_rng_ = read_stat(is.cnt_failed_unmark_read_rng_);
     sts.cnt_invalid_rng_elem_       = read_stat(is.cnt_invalid_rng_elem_);
     sts.cnt_evac_frag_no_mem_entry_ = read_stat(is.cnt_evac_frag_no_mem_entry_);
+    sts.rdah_issued_bytes_          = read_stat(is.rdah_issued_bytes_);
+    sts.rdah_used_bytes_            = read_stat(is.rdah_used_bytes_);
+    sts.rdah_wasted_bytes_          = read_stat(is.rdah_wasted_bytes_);
+    sts.cnt_rdah_no_budget_         = read_stat(is.cnt_rdah_no_budget_);
+    sts.rdah_size_                  = read_stat(rdah_size_);
+    sts.cnt_evac_hot_frags_         = read_stat(is.cnt_evac_hot_frags_);
+    sts.evac_hot_bytes_             = read_stat(is.evac_hot_bytes_);
+    sts.cnt_evac_hot_no_budget_     = read_stat(is.cnt_evac_hot_no_budget_);
+    mem_cache_.get_stats(sts);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -231,6 +286,7 @@ cache_fs_operations::fsmd_begin_read(const object_key& key) noexcept
             {
                 if (!rv_elem_atomic_inc_readers(it))
                     break; // A limit has been reached.
+                rv_elem_atomic_inc_hits(it);
             }
             if (it != r.end())
             { // Revert the marked once
@@ -296,12 +352,21 @@ expected_t<range_elem, err_code_t>
 cache_fs_operations::fsmd_find_next_range_elem(
     const read_transaction& rtrans) noexcept
 {
+    return fsmd_find_range_elem(rtrans, rtrans.curr_offset());
+}
+
+expected_t<range_elem, err_code_t>
+cache_fs_operations::fsmd_find_range_elem(const read_transaction& rtrans,
+                                          bytes64_t offs) noexcept
+{
+    X3ME_ASSERT(x3me::math::in_range(offs, rtrans.curr_offset(),
+                                     rtrans.end_offset()),
+                "The offset must be inside the not yet read transaction part");
     expected_t<range_elem, err_code_t> ret = boost::make_unexpected(
         err_code_t{cache::object_not_present, get_cache_error_category()});
 
     fs_meta_->as_const()->read_table_entries(
-        rtrans.fs_node_key(),
-        [ offs = rtrans.curr_offset(), &ret ](const range_vector& rv)
+        rtrans.fs_node_key(), [offs, &ret](const range_vector& rv)
         {
             // We have possible race condition here because the found
             // element can have it's readers concurrently manipulated by the
@@ -323,7 +388,9 @@ cache_fs_operations::fsmd_find_next_range_elem(
                    ret.value());
         // TODO We need first a safe mechanic for removing bad entries in
         // a presence of readers. Maybe we can mark them as bad and let the
-        // last reader remove them.
+        // last reader remove them. Such removal must also go to the
+        // metadata journal via agg_writer_->jrnl_rem_key. Otherwise the
+        // entry will be resurrected by the journal replay.
         //(*fs_meta_)->rem_table_entry(rtrans.fs_node_key(), ret.value());
         ret = boost::make_unexpected(err_code_t{cache::corrupted_object_meta,
                                                 get_cache_error_category()});
@@ -344,50 +411,64 @@ void cache_fs_operations::fsmd_rem_non_evac_frags(
     volume_blocks64_t area_size) noexcept
 {
     const auto orig_cnt = entries.size();
+    // The hot fragments which fit in the evacuation budget.
+    // Indexed in the same way as the entries.
+    std::vector<bool> hot(entries.size(), false);
+    if ((evac_cfg_.min_hits_ > 0) && (evac_cfg_.max_hot_size_ > 0))
+        mark_hot_evac_frags(entries, hot);
     // First filter out the entries against the in-memory metadata.
+    // These removals are not journaled, because the journal replay
+    // invalidates all entries pointing to the overwritten disk areas.
+    // Removals outside such areas must be journaled via jrnl_rem_key.
+    // The table entries are internally synchronized per table shard, so
+    // we need only a shared lock of the whole metadata here.
     x3me::thread::with_synchronized(
-        *fs_meta_,
-        [](fs_metadata& md, std::vector<agg_meta_entry>& entries)
+        fs_meta_->as_const(),
+        [&hot](const fs_metadata& md, std::vector<agg_meta_entry>& entries)
         {
-            // Remove fragments without readers from both entries and
-            // in-memory metadata.
-            for (auto it = entries.begin(); it != entries.end();)
+            // Remove fragments without readers, which are not hot, from both
+            // entries and in-memory metadata. The hits of the evacuated
+            // fragments get decayed, so that they need new hits in order
+            // to survive the next lap of the write position.
+            const auto cnt = entries.size();
+            size_t out     = 0;
+            for (size_t i = 0; i < cnt;)
             {
-                bool key_found = false;
+                const auto key = entries[i].key();
+                auto j         = i;
                 md.rem_table_entries(
-                    it->key(), [&](range_vector& rv)
+                    key, [&](range_vector& rv)
                     {
                         bytes64_t rem_size = 0;
-                        key_found          = true;
-                        const auto key     = it->key();
                         // There could be several successive entries with
                         // the same key.
-                        while ((it != entries.end()) && (it->key() == key))
+                        for (; (j < cnt) && (entries[j].key() == key); ++j)
                         {
-                            auto rit = rv.find_exact_range(it->rng());
+                            auto rit = rv.find_exact_range(entries[j].rng());
                             // It could happen that an entry read from the
                             // disk is not present in the memory in some rare
                             // cases due to the fact that an entry is first
                             // added to the writer block and later to
                             // the memory and the second operation may fail.
                             if (rit == rv.end())
-                                it = entries.erase(it);
-                            else if (!rit->has_readers())
+                                continue;
+                            if (rit->has_readers() || hot[j])
                             {
-                                rem_size += rit->rng_size();
-                                rv.rem_range(rit);
-                                it = entries.erase(it);
+                                rv_elem_atomic_decay_hits(rit);
+                                entries[out++] = entries[j];
                             }
                             else
                             {
-                                ++it;
+                                rem_size += rit->rng_size();
+                                rv.rem_range(rit);
                             }
                         }
                         return rem_size;
                     });
-                if (!key_found)
-                    it = entries.erase(it);
+                // Skip the entry if its key is not found
+                i = std::max(j, i + 1);
             }
+            entries.erase(entries.begin() + out, entries.end());
         },
         entries);
     // Second check the remaining entries that they are valid and
@@ -429,17 +510,20 @@ bool cache_fs_operations::fsmd_add_evac_fragment(
     // We need to ensure that we use the fs_metadata and the
     // agg_write_block in the same lock order in all places where both
     // of them are used.
-    // In addition, we can't use const fs_metadata i.e. read locking because
-    // the modifications on the found range element are not atomic/thread
-    // safe and they can't run concurrently with other readers.
+    // The modifications on the found range element are not atomic/thread
+    // safe and they can't run concurrently with other readers. However,
+    // the table locks exclusively the shard of the modified entries and
+    // thus the shared lock of the whole metadata is enough here.
     bool found_mem = false;
     x3me::thread::with_synchronized(
-        *fs_meta_, wblock, [&key, &rng, &frag, &found_mem,
-                            disk_offset](fs_metadata& fsm, agg_write_block& awb)
+        fs_meta_->as_const(), wblock,
+        [&key, &rng, &frag, &found_mem, disk_offset,
+         this](const fs_metadata& fsm, agg_write_block& awb)
         {
-            X3ME_ASSERT(disk_offset.to_bytes() == fsm.write_pos(),
+            X3ME_ASSERT(valid_agg_write_pos(fsm, disk_offset, data_offs(),
+                                            end_data_offs()),
                         "The fragments must be added at the current write "
-                        "position");
+                        "position or at the next one");
             const auto ret = awb.add_fragment(key, rng, disk_offset, frag);
             X3ME_ENFORCE(ret, "Adding a fragment evacuated from the disk block "
                               "to the memory block can't fail because of lack "
@@ -478,13 +562,18 @@ bool cache_fs_operations::fsmd_add_new_fragment(
 {
     optional_t<agg_write_block::fail_res> aggw_add_fail;
     fs_table::add_res fst_add_res = fs_table::add_res::skipped;
+    // The table entries are internally synchronized per table shard.
+    // The write position is changed only under exclusive lock of the whole
+    // metadata and thus the shared lock is enough here.
     x3me::thread::with_synchronized(
-        *fs_meta_, wblock, [&key, &rng, &frag, &aggw_add_fail, &fst_add_res,
-                            disk_offset](fs_metadata& fsm, agg_write_block& awb)
+        fs_meta_->as_const(), wblock,
+        [&key, &rng, &frag, &aggw_add_fail, &fst_add_res, disk_offset,
+         this](const fs_metadata& fsm, agg_write_block& awb)
         {
-            X3ME_ASSERT(disk_offset.to_bytes() == fsm.write_pos(),
+            X3ME_ASSERT(valid_agg_write_pos(fsm, disk_offset, data_offs(),
+                                            end_data_offs()),
                         "The fragments must be added at the current write "
-                        "position");
+                        "position or at the next one");
             auto ret = awb.add_fragment(key, rng, disk_offset, frag);
             if (!ret)
             {
@@ -576,6 +665,12 @@ std::ostream& operator<<(std::ostream& os, const std::vector<T>& rhs) noexcept
     return os;
 }
 
+cache_fs_ops::wr_pos
+cache_fs_operations::fsmd_next_write_pos(const wr_pos& curr) noexcept
+{
+    return next_wr_pos(curr, data_offs(), end_data_offs());
+}
+
 cache_fs_ops::wr_pos cache_fs_operations::fsmd_commit_disk_write(
     volume_blocks64_t disk_offset,
     const std::vector<write_transaction>& wtrans,
@@ -652,7 +747,8 @@ void cache_fs_operations::fsmd_fin_flush_commit(
             if (awb.bytes_avail() > 0)
             {
                 stats_fs_wr unused;
-                const auto buff = awb.begin_disk_write(unused);
+                const auto buff =
+                    awb.begin_disk_write(fsm.write_lap(), unused);
 
                 // We don't need to worry about writing past the end of the
                 // volume here. We should have checked this when start
@@ -694,22 +790,25 @@ bool cache_fs_operations::aggw_try_read_frag(const fs_node_key_t& key,
                                              const range_elem& rng,
                                              frag_buff_t buff) noexcept
 {
-    // We intentionally use the metadata inside the critical section because
-    // we don't want racy situations where the current write position is
-    // changed after we've asked the fs_metadata.
-    // The aggregate writer has the current write position but it's not
-    // currently thread safe to use it.
+    // The fragment could be in the block which is currently filled or in
+    // the block which is currently flushed. Every block knows its write
+    // position and thus we don't need to lock the fs_metadata here.
+    // The fragments don't move between the blocks, so it's fine to check
+    // them one after another.
     // In addition, this method should not be heavily hit because it should
     // be used only when a reader is interested in a fragment which currently
     // lays inside the agg_writer buffer, which should be pretty rare (IMO).
-    const bool res = x3me::thread::with_synchronized(
-        fs_meta_->as_const(), agg_writer_->write_block().as_const(),
-        [&](const fs_metadata& fsm, const agg_write_block& awb)
-        {
-            const auto wpos =
-                volume_blocks64_t::create_from_bytes(fsm.write_pos());
-            return awb.try_read_fragment(key, rng, wpos, buff);
-        });
+    bool res = false;
+    for (const auto& wblock : agg_writer_->write_blocks())
+    {
+        res = x3me::thread::with_synchronized(
+            wblock.as_const(), [&](const agg_write_block& awb)
+            {
+                return awb.try_read_fragment(key, rng, awb.write_offs(), buff);
+            });
+        if (res)
+            break;
+    }
     if (res)
         inc_stat(internal_stats_.cnt_read_frag_mem_hit_, 1);
     else
@@ -729,6 +828,62 @@ void cache_fs_operations::aggw_write_final_frag(
     agg_writer_->final_write(std::move(data), std::move(wtrans));
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Operations involving the RAM fragment cache
+aligned_data_ref_t
+cache_fs_operations::memc_try_read_frag(const fs_node_key_t& key,
+                                        const range_elem& rng,
+                                        bytes32_t size) noexcept
+{
+    return mem_cache_.try_read_frag(key, rng, size);
+}
+
+void cache_fs_operations::memc_add_frag(const fs_node_key_t& key,
+                                        const range_elem& rng,
+                                        const aligned_data_ref_t& frag,
+                                        bytes32_t size) noexcept
+{
+    mem_cache_.add_frag(key, rng, frag, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Operations involving the read-ahead memory budget
+uint32_t cache_fs_operations::rdah_max_frags() const noexcept
+{
+    return rdah_cfg_.max_frags_;
+}
+
+bytes32_t cache_fs_operations::rdah_max_read_size() const noexcept
+{
+    return rdah_cfg_.max_read_size_;
+}
+
+bool cache_fs_operations::rdah_reserve(bytes32_t size) noexcept
+{
+    auto curr = rdah_size_.load(std::memory_order_relaxed);
+    do
+    {
+        if ((curr + size) > rdah_cfg_.max_size_)
+        {
+            inc_stat(internal_stats_.cnt_rdah_no_budget_, 1);
+            return false;
+        }
+    } while (!rdah_size_.compare_exchange_weak(curr, curr + size,
+                                               std::memory_order_relaxed));
+    inc_stat(internal_stats_.rdah_issued_bytes_, size);
+    return true;
+}
+
+void cache_fs_operations::rdah_release(bytes32_t size, bool used) noexcept
+{
+    const auto prev = rdah_size_.fetch_sub(size, std::memory_order_relaxed);
+    X3ME_ASSERT(prev >= size, "Released more than reserved read-ahead memory");
+    if (used)
+        inc_stat(internal_stats_.rdah_used_bytes_, size);
+    else
+        inc_stat(internal_stats_.rdah_wasted_bytes_, size);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Temporary, for stats only
 void cache_fs_operations::count_mem_miss() noexcept
@@ -781,8 +936,8 @@ expected_t<write_transaction, err_code_t>
 cache_fs_operations::fsmd_begin_write_truncate(const object_key& key) noexcept
 {
     const auto found_removed = x3me::thread::with_synchronized(
-        *fs_meta_,
-        [](fs_metadata& md, const object_key& key)
+        fs_meta_->as_const(),
+        [](const fs_metadata& md, const object_key& key)
         {
             return md.rem_table_entries(
                 key.fs_node_key(), [](range_vector& rv)
@@ -823,9 +978,83 @@ cache_fs_operations::fsmd_begin_write_truncate(const object_key& key) noexcept
         return boost::make_unexpected(
             cache::make_error_code(cache::object_in_use));
     }
+    if (found_removed)
+    {
+        // The removal needs to go to the metadata journal. Otherwise the
+        // removed entries will be resurrected if the metadata is restored
+        // from the journal.
+        agg_writer_->jrnl_rem_key(key.fs_node_key());
+        // The old object content must not be served from the RAM anymore
+        mem_cache_.rem_frags(key.fs_node_key());
+    }
     inc_stat(internal_stats_.cnt_begin_write_trunc_ok_, 1);
     return write_transaction{key.fs_node_key(), key.get_range()};
 }
 
+void cache_fs_operations::mark_hot_evac_frags(
+    const std::vector<agg_meta_entry>& entries,
+    std::vector<bool>& hot) noexcept
+{
+    struct candidate
+    {
+        uint32_t idx_;
+        uint8_t hits_;
+    };
+    std::vector<candidate> cands;
+    // Only read the hits here. The entries are removed later, while
+    // holding the table locks exclusively.
+    x3me::thread::with_synchronized(
+        fs_meta_->as_const(),
+        [&cands, min_hits = evac_cfg_.min_hits_](
+            const fs_metadata& md, const std::vector<agg_meta_entry>& entries)
+        {
+            const uint32_t cnt = entries.size();
+            for (uint32_t i = 0; i < cnt;)
+            {
+                const auto& key = entries[i].key();
+                auto j          = i;
+                md.read_table_entries(
+                    key, [&](const range_vector& rv)
+                    {
+                        for (; (j < cnt) && (entries[j].key() == key); ++j)
+                        {
+                            auto rit = rv.find_exact_range(entries[j].rng());
+                            if ((rit != rv.end()) && !rit->has_readers() &&
+                                (rit->hits() >= min_hits))
+                                cands.push_back(candidate{j, rit->hits()});
+                        }
+                    });
+                i = std::max(j, i + 1);
+            }
+        },
+        entries);
+    // The hottest fragments go first. The equally hot ones keep their order.
+    std::stable_sort(cands.begin(), cands.end(),
+                     [](const candidate& lhs, const candidate& rhs)
+                     {
+                         return lhs.hits_ > rhs.hits_;
+                     });
+    bytes32_t size     = 0;
+    uint64_t cnt_hot   = 0;
+    uint64_t cnt_no_bg = 0;
+    for (const auto& c : cands)
+    {
+        const auto sz = object_frag_size(entries[c.idx_].rng().rng_size());
+        if ((size + sz) <= evac_cfg_.max_hot_size_)
+        {
+            hot[c.idx_] = true;
+            size += sz;
+            ++cnt_hot;
+        }
+        else
+        {
+            ++cnt_no_bg;
+        }
+    }
+    inc_stat(internal_stats_.cnt_evac_hot_frags_, cnt_hot);
+    inc_stat(internal_stats_.evac_hot_bytes_, size);
+    inc_stat(internal_stats_.cnt_evac_hot_no_budget_, cnt_no_bg);
+}
+
 } // namespace detail
 } // namespace cache
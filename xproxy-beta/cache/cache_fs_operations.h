@@ -2,6 +2,7 @@
 
 #include "cache_fs_ops.h"
 #include "cache_fs_ops_fwds.h"
+#include "frag_mem_cache.h"
 #include "unit_blocks.h"
 
 namespace cache
@@ -31,6 +32,8 @@ class cache_fs_operations final : public cache_fs_ops
 
     x3me::thread::shared_mutex vol_mutex_;
 
+    frag_mem_cache mem_cache_;
+
     struct internal_stats
     {
         std::atomic<uint64_t> cnt_lock_volume_mtx_{0};
@@ -49,8 +52,20 @@ class cache_fs_operations final : public cache_fs_ops
         std::atomic<uint32_t> cnt_failed_unmark_read_rng_{0};
         std::atomic<uint32_t> cnt_invalid_rng_elem_{0};
         std::atomic<uint32_t> cnt_evac_frag_no_mem_entry_{0};
+        std::atomic<uint64_t> rdah_issued_bytes_{0};
+        std::atomic<uint64_t> rdah_used_bytes_{0};
+        std::atomic<uint64_t> rdah_wasted_bytes_{0};
+        std::atomic<uint64_t> cnt_rdah_no_budget_{0};
+        std::atomic<uint64_t> cnt_evac_hot_frags_{0};
+        std::atomic<uint64_t> evac_hot_bytes_{0};
+        std::atomic<uint64_t> cnt_evac_hot_no_budget_{0};
     } internal_stats_;
 
+    // The memory currently held by the read-ahead fragments of the readers.
+    std::atomic<bytes64_t> rdah_size_{0};
+    read_ahead_cfg rdah_cfg_;
+    evac_cfg evac_cfg_;
+
     on_disk_error_cb_t on_disk_error_cb_;
 
     // The offset to the first data on the disk.
@@ -74,6 +89,12 @@ public:
 
     void set_on_disk_error_cb(const on_disk_error_cb_t& cb) noexcept;
     void set_agg_writer(non_owner_ptr_t<agg_writer> agw) noexcept;
+    // Must be called before the cache_fs_operations is used by the readers.
+    void set_mem_cache_size(bytes64_t size) noexcept;
+    // Must be called before the cache_fs_operations is used by the readers.
+    void set_read_ahead_cfg(const read_ahead_cfg& cfg) noexcept;
+    // Must be called before the agg_writer is started.
+    void set_evac_cfg(const evac_cfg& cfg) noexcept;
 
     const boost::container::string& vol_path() const noexcept final;
 
@@ -107,11 +128,16 @@ public:
     fsmd_begin_write(const object_key& key, bool truncate_obj) noexcept final;
     expected_t<range_elem, err_code_t>
     fsmd_find_next_range_elem(const read_transaction& rtrans) noexcept final;
+    expected_t<range_elem, err_code_t>
+    fsmd_find_range_elem(const read_transaction& rtrans,
+                         bytes64_t offs) noexcept final;
     // The function removes the metadata for fragments which are not currently
-    // read. These fragments don't need evacuation. It removes the metadata
-    // from both the passed collection of fragments and from its memory
-    // structures. This ensures that later arrived readers don't mess with the
-    // current aggregate write which is going to overwrite the fragments.
+    // read and are not hot enough. These fragments don't need evacuation.
+    // The hottest fragments are kept until the evacuation budget is reached.
+    // It removes the metadata from both the passed collection of fragments and
+    // from its memory structures. This ensures that later arrived readers
+    // don't mess with the current aggregate write which is going to overwrite
+    // the fragments.
     void fsmd_rem_non_evac_frags(std::vector<agg_meta_entry>&,
                                  volume_blocks64_t disk_offs,
                                  volume_blocks64_t area_size) noexcept final;
@@ -128,6 +154,7 @@ public:
                                frag_data_t frag,
                                volume_blocks64_t disk_offset,
                                agg_wblock_sync_t& wblock) noexcept final;
+    wr_pos fsmd_next_write_pos(const wr_pos& curr) noexcept final;
     wr_pos fsmd_commit_disk_write(volume_blocks64_t disk_offset,
                                   const std::vector<write_transaction>& wtrans,
                                   agg_wblock_sync_t& wblock) noexcept final;
@@ -147,6 +174,23 @@ public:
     void aggw_write_final_frag(frag_write_buff&& data,
                                write_transaction&& wtrans) noexcept final;
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Operations involving the RAM fragment cache
+    aligned_data_ref_t memc_try_read_frag(const fs_node_key_t& key,
+                                          const range_elem& rng,
+                                          bytes32_t size) noexcept final;
+    void memc_add_frag(const fs_node_key_t& key,
+                       const range_elem& rng,
+                       const aligned_data_ref_t& frag,
+                       bytes32_t size) noexcept final;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Operations involving the read-ahead memory budget
+    uint32_t rdah_max_frags() const noexcept final;
+    bytes32_t rdah_max_read_size() const noexcept final;
+    bool rdah_reserve(bytes32_t size) noexcept final;
+    void rdah_release(bytes32_t size, bool used) noexcept final;
+
     ////////////////////////////////////////////////////////////////////////////
     // Temporary, for stats only
     void count_mem_miss() noexcept final;
@@ -163,6 +207,9 @@ private:
     fsmd_begin_write(const object_key& key) noexcept;
     expected_t<write_transaction, err_code_t>
     fsmd_begin_write_truncate(const object_key& key) noexcept;
+
+    void mark_hot_evac_frags(const std::vector<agg_meta_entry>& entries,
+                             std::vector<bool>& hot) noexcept;
 };
 
 } // namespace detail
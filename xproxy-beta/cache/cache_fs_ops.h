@@ -2,6 +2,7 @@
 
 // TODO These includes could be removed if the corresponding typedefs
 // become classes.
+#include "aligned_data_ptr.h"
 #include "cache_fs_ops_fwds.h"
 #include "fs_node_key.h"
 #include "unit_blocks.h"
@@ -20,6 +21,31 @@ class range_elem;
 class read_transaction;
 class write_transaction;
 
+struct read_ahead_cfg
+{
+    static constexpr uint32_t frags_limit = 2;
+    // The count of the object fragments which a reader reads from the disk
+    // ahead of the currently consumed one. Zero disables the read-ahead.
+    uint32_t max_frags_ = 0;
+    // The max size of the memory held by the read-ahead fragments of all
+    // readers of the volume.
+    bytes64_t max_size_ = 0;
+    // The max size of a single disk read of fragments adjacent on the disk.
+    // The fragments after the first one use the read-ahead memory.
+    bytes32_t max_read_size_ = 0;
+};
+
+struct evac_cfg
+{
+    // The fragments read at least this many times, since the previous time
+    // the write position passed them, are evacuated even if they are not
+    // currently read. Zero disables the evacuation of such fragments.
+    uint8_t min_hits_ = 0;
+    // The max size of the hot fragments evacuated per aggregate write block.
+    // It limits the part of the write bandwidth used for rewriting old data.
+    bytes32_t max_hot_size_ = 0;
+};
+
 // This interface facilitates decoupling of various cache components from
 // the knowledge for cache_fs and the needed stuff which lives there.
 // It also facilitates the unit testing of the cache components.
@@ -51,8 +77,8 @@ struct cache_fs_ops
     virtual void aios_push_write_queue(owner_ptr_t<aio_task>) noexcept = 0;
     virtual void aios_enqueue_write_queue(owner_ptr_t<aio_task>) noexcept = 0;
     // It's important that only the aggregate_writer can push itself at the
-    // front of the queue, because this way it ensures that the other write
-    // tasks wait until it finishes a disk write operation.
+    // front of the queue, because this way it ensures that its disk
+    // operations don't wait behind the other write tasks.
     virtual void
         aios_push_front_write_queue(non_owner_ptr_t<agg_writer>) noexcept = 0;
 
@@ -64,6 +90,10 @@ struct cache_fs_ops
     fsmd_begin_write(const object_key&, bool truncate_obj) noexcept = 0;
     virtual expected_t<range_elem, err_code_t>
     fsmd_find_next_range_elem(const read_transaction&) noexcept = 0;
+    // Finds the range element starting at the given object offset which must
+    // be inside the read transaction. Used for the read-ahead of fragments.
+    virtual expected_t<range_elem, err_code_t>
+    fsmd_find_range_elem(const read_transaction&, bytes64_t) noexcept = 0;
     virtual void fsmd_rem_non_evac_frags(std::vector<agg_meta_entry>&,
                                          volume_blocks64_t,
                                          volume_blocks64_t) noexcept = 0;
@@ -86,6 +116,9 @@ struct cache_fs_ops
         bytes64_t write_pos_;
         uint64_t write_lap_;
     };
+    // Returns the write position following the given one. It doesn't change
+    // the current write position of the fs_metadata.
+    virtual wr_pos fsmd_next_write_pos(const wr_pos&) noexcept = 0;
     virtual wr_pos fsmd_commit_disk_write(volume_blocks64_t,
                                           const std::vector<write_transaction>&,
                                           agg_wblock_sync_t&) noexcept = 0;
@@ -104,6 +137,26 @@ struct cache_fs_ops
     virtual void aggw_write_final_frag(frag_write_buff&&,
                                        write_transaction&&) noexcept = 0;
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Operations involving the RAM fragment cache
+    // The fragment data are shared between the cache and the readers.
+    virtual aligned_data_ref_t memc_try_read_frag(const fs_node_key_t&,
+                                                  const range_elem&,
+                                                  bytes32_t) noexcept = 0;
+    virtual void memc_add_frag(const fs_node_key_t&,
+                               const range_elem&,
+                               const aligned_data_ref_t&,
+                               bytes32_t) noexcept = 0;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Operations involving the read-ahead memory budget
+    virtual uint32_t rdah_max_frags() const noexcept = 0;
+    virtual bytes32_t rdah_max_read_size() const noexcept = 0;
+    // Returns false if the budget doesn't allow the given size to be used.
+    virtual bool rdah_reserve(bytes32_t) noexcept = 0;
+    // The released read-ahead fragment has been either used or wasted.
+    virtual void rdah_release(bytes32_t, bool used) noexcept = 0;
+
     ////////////////////////////////////////////////////////////////////////////
     // Temporary, for stats only
     virtual void count_mem_miss() noexcept = 0;
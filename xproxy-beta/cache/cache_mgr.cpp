@@ -1,11 +1,14 @@
 #include "precompiled.h"
 #include "cache_mgr.h"
 #include "cache_common.h"
+#include "cache_error.h"
 #include "cache_fs.h"
 #include "cache_key.h"
 #include "cache_stats.h"
 #include "object_key.h"
 #include "object_open_handle.h"
+#include "object_write_handle.h"
+#include "range_elem.h"
 #include "settings.h"
 #include "volume_info.h"
 
@@ -14,15 +17,50 @@ namespace cache
 namespace
 {
 
-// TODO This naive function will cause the content from all disk to be lost
-// if one of them fails.
-uint32_t cache_key_to_fs_idx(const cache_key& ckey, uint32_t cnt_fss) noexcept
+// Mixes the bits of the given value. It's the finalizer of the splitmix64.
+uint64_t mix_bits(uint64_t v) noexcept
 {
-    // Change the hash function here, if the distribution across the volumes
-    // is not good.
-    // We want the ranges/stuff for the same url to go to the same disk,
-    // so that we can collect and merge them later if needed.
-    return boost::hash_range(ckey.url_.cbegin(), ckey.url_.cend()) % cnt_fss;
+    v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    v = (v ^ (v >> 27)) * 0x94D049BB133111EBULL;
+    return v ^ (v >> 31);
+}
+
+// Weighted rendezvous (highest random weight) hashing. Every volume gets
+// a pseudo random score for the given url, scaled by the volume size,
+// and the volume with the highest score wins. This way, when a volume gets
+// removed only the urls which have been mapped to it get remapped.
+// The modulo hashing used before remapped nearly all urls in this case,
+// and thus all of the cache content was effectively lost.
+// We want the ranges/stuff for the same url to go to the same disk,
+// so that we can collect and merge them later if needed.
+template <typename FsSet>
+const detail::cache_fs_ptr_t& cache_key_to_fs(const cache_key& ckey,
+                                              const FsSet& cfs) noexcept
+{
+    X3ME_ASSERT(!cfs.empty(), "There must be at least one alive FS");
+    const uint64_t url_hash =
+        boost::hash_range(ckey.url_.cbegin(), ckey.url_.cend());
+
+    auto ret       = cfs.begin();
+    auto max_score = -1.0;
+    for (auto it = cfs.begin(); it != cfs.end(); ++it)
+    {
+        const auto& fs = *it;
+        const auto h   = mix_bits(url_hash ^ mix_bits(hash_value(fs->uuid())));
+        // Convert the hash to a number in (0, 1] using its top 53 bits.
+        const double u = double((h >> 11) + 1) / double(1ULL << 53);
+        // The score is equal to -weight/ln(u). The weight is the volume size
+        // in GB so that bigger volumes get proportionally more urls.
+        const double w     = std::max(double(fs->data_size() >> 30), 1.0);
+        const double score = (u < 1.0) ? -w / std::log(u)
+                                       : std::numeric_limits<double>::max();
+        if (score > max_score)
+        {
+            max_score = score;
+            ret       = it;
+        }
+    }
+    return *ret;
 }
 
 } // namespace
@@ -150,9 +188,8 @@ cache_mgr::async_open_read(const cache_key& ckey,
                            bytes64_t skip_bytes,
                            detail::open_rhandler_t&& h) noexcept
 {
-    auto cfs          = cache_fs_.read_copy();
-    const auto fs_idx = cache_key_to_fs_idx(ckey, cfs->size());
-    const auto& fs = *(cfs->begin() + fs_idx);
+    auto cfs       = cache_fs_.read();
+    const auto& fs = cache_key_to_fs(ckey, *cfs);
     const detail::object_key obj_key(ckey, skip_bytes);
     XLOG_INFO(disk_tag, "Issue async_open_read to cache FS '{}'. "
                         "Cache_key {}. Skip bytes {}. Obj_key {}",
@@ -160,20 +197,33 @@ cache_mgr::async_open_read(const cache_key& ckey,
     return fs->async_open_read(obj_key, std::move(h));
 }
 
-detail::object_ohandle_ptr_t
+expected_t<detail::object_ohandle_ptr_t, err_code_t>
 cache_mgr::async_open_write(const cache_key& ckey,
                             bool truncate_object,
                             detail::open_whandler_t&& h) noexcept
 {
-    auto cfs             = cache_fs_.read_copy();
-    const auto fs_idx    = cache_key_to_fs_idx(ckey, cfs->size());
-    const auto& fs       = *(cfs->begin() + fs_idx);
+    auto cfs             = cache_fs_.read();
+    const auto& fs       = cache_key_to_fs(ckey, *cfs);
     const bytes64_t skip = 0; // We don't skip bytes on write
     const detail::object_key obj_key(ckey, skip);
+    // The truncate operation overwrites an object which is already in
+    // the cache. It has been already admitted.
+    if (!truncate_object && !fs->admit_write(obj_key, ckey.obj_full_len_))
+    {
+        XLOG_DEBUG(disk_tag, "Object not admitted to cache FS '{}'. Cache_key "
+                             "{}. Obj_key {}",
+                   fs->vol_path(), ckey, obj_key);
+        return boost::make_unexpected(err_code_t{cache::object_not_admitted,
+                                                 get_cache_error_category()});
+    }
     XLOG_INFO(disk_tag, "Issue async_open_write to cache FS '{}'. Cache_key "
                         "{}. Truncate {}. Obj_key {}",
               fs->vol_path(), ckey, truncate_object, obj_key);
-    return fs->async_open_write(obj_key, truncate_object, std::move(h));
+    auto ret = fs->async_open_write(obj_key, truncate_object, std::move(h));
+    if (!ret)
+        return boost::make_unexpected(err_code_t{cache::tasks_limit_reached,
+                                                 get_cache_error_category()});
+    return ret;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -187,6 +237,40 @@ bool cache_mgr::init_reset(const settings& sts, bool reset_vols) noexcept
         XLOG_FATAL(disk_tag, "Cache volume_threads must be at least {}", t);
         return false;
     }
+    detail::aio_service_cfg aio_cfg;
+    aio_cfg.num_threads_ = numt;
+    aio_cfg.batch_size_  = sts.cache_aio_batch_size();
+    if (!x3me::math::in_range(aio_cfg.batch_size_, uint16_t(1),
+                              uint16_t(detail::aio_service::max_batch_size + 1)))
+    {
+        XLOG_FATAL(disk_tag, "Invalid number for the setting cache "
+                             "aio_batch_size. Must be in [1 - {}]",
+                   detail::aio_service::max_batch_size);
+        return false;
+    }
+    if (sts.cache_aio_engine() == "threads")
+        aio_cfg.engine_ = detail::aio_engine::threads;
+    else if (sts.cache_aio_engine() == "io_uring")
+        aio_cfg.engine_ = detail::aio_engine::io_uring;
+    else
+    {
+        XLOG_FATAL(disk_tag, "Invalid value '{}' for the setting cache "
+                             "aio_engine. Must be 'threads' or 'io_uring'",
+                   sts.cache_aio_engine());
+        return false;
+    }
+    detail::admission_cfg adm_cfg;
+    adm_cfg.min_requests_   = sts.cache_admission_min_requests();
+    adm_cfg.sketch_entries_ = sts.cache_admission_sketch_entries();
+    adm_cfg.bypass_size_ =
+        bytes64_t(sts.cache_admission_bypass_size_KB()) * 1024U;
+    if (adm_cfg.min_requests_ > detail::admission_filter::max_min_requests)
+    {
+        XLOG_FATAL(disk_tag, "Invalid number for the setting cache "
+                             "admission_min_requests. Must be in [0 - {}]",
+                   detail::admission_filter::max_min_requests);
+        return false;
+    }
     const bytes64_t obj_size = sts.cache_min_avg_object_size_KB() * 1024U;
     if (!x3me::math::in_range(obj_size,
                               static_cast<bytes64_t>(detail::min_obj_size),
@@ -216,7 +300,55 @@ bool cache_mgr::init_reset(const settings& sts, bool reset_vols) noexcept
     if (volume_paths.empty())
         return false;
 
-    return init_volumes_fs(volume_paths, obj_size, numt, reset_vols);
+    const bytes64_t md_jrnl_size =
+        bytes64_t(sts.cache_metadata_journal_MB()) * 1024U * 1024U;
+    // The RAM cache is split equally between the volumes
+    const bytes64_t mem_cache_size =
+        (bytes64_t(sts.cache_mem_cache_MB()) * 1024U * 1024U) /
+        volume_paths.size();
+    // The read-ahead memory limit is split the same way
+    detail::read_ahead_cfg rdah_cfg;
+    rdah_cfg.max_frags_ = sts.cache_read_ahead_frags();
+    rdah_cfg.max_size_ =
+        (bytes64_t(sts.cache_read_ahead_MB()) * 1024U * 1024U) /
+        volume_paths.size();
+    if (rdah_cfg.max_frags_ > detail::read_ahead_cfg::frags_limit)
+    {
+        XLOG_FATAL(disk_tag, "Invalid number for the setting cache "
+                             "read_ahead_frags. Must be in [0 - {}]",
+                   detail::read_ahead_cfg::frags_limit);
+        return false;
+    }
+    if (sts.cache_read_coalesce_KB() > (detail::agg_write_data_size / 1024U))
+    {
+        XLOG_FATAL(disk_tag, "Invalid number for the setting cache "
+                             "read_coalesce_KB. Must be in [0 - {}]",
+                   detail::agg_write_data_size / 1024U);
+        return false;
+    }
+    rdah_cfg.max_read_size_ = sts.cache_read_coalesce_KB() * 1024U;
+
+    detail::evac_cfg ev_cfg;
+    if (sts.cache_evac_min_hits() > detail::range_elem::max_hits())
+    {
+        XLOG_FATAL(disk_tag, "Invalid number for the setting cache "
+                             "evac_min_hits. Must be in [0 - {}]",
+                   detail::range_elem::max_hits());
+        return false;
+    }
+    ev_cfg.min_hits_ = sts.cache_evac_min_hits();
+    if (sts.cache_evac_hot_KB() > (detail::agg_write_data_size / 1024U))
+    {
+        XLOG_FATAL(disk_tag, "Invalid number for the setting cache "
+                             "evac_hot_KB. Must be in [0 - {}]",
+                   detail::agg_write_data_size / 1024U);
+        return false;
+    }
+    ev_cfg.max_hot_size_ = sts.cache_evac_hot_KB() * 1024U;
+
+    return init_volumes_fs(volume_paths, obj_size, aio_cfg, adm_cfg,
+                           md_jrnl_size, mem_cache_size, rdah_cfg, ev_cfg,
+                           reset_vols);
 }
 
 cache_mgr::volume_paths_t
@@ -252,7 +384,12 @@ cache_mgr::load_storage_cfg(const std::string& fpath) noexcept
 
 bool cache_mgr::init_volumes_fs(const volume_paths_t& vpaths,
                                 uint32_t min_avg_obj_size,
-                                uint16_t num_aio_threads,
+                                const detail::aio_service_cfg& aio_cfg,
+                                const detail::admission_cfg& adm_cfg,
+                                bytes64_t md_jrnl_size,
+                                bytes64_t mem_cache_size,
+                                const detail::read_ahead_cfg& rdah_cfg,
+                                const detail::evac_cfg& ev_cfg,
                                 bool reset_vols) noexcept
 {
     // Parallelize the initialization of the cache filesystems which do
@@ -267,7 +404,8 @@ bool cache_mgr::init_volumes_fs(const volume_paths_t& vpaths,
         auto& fs          = fss[i];
 
         thrs.emplace_back(
-            [this, &vpath, &fs, min_avg_obj_size, num_aio_threads, reset_vols]
+            [this, &vpath, &fs, min_avg_obj_size, &aio_cfg, &adm_cfg,
+             md_jrnl_size, mem_cache_size, &rdah_cfg, &ev_cfg, reset_vols]
             {
                 x3me::sys_utils::set_this_thread_name("xproxy_dinit");
                 try
@@ -282,7 +420,8 @@ bool cache_mgr::init_volumes_fs(const volume_paths_t& vpaths,
                                                            on_fs_bad);
                     if (!reset_vols)
                     {
-                        if (new_fs->init(num_aio_threads))
+                        if (new_fs->init(aio_cfg, adm_cfg, md_jrnl_size,
+                                         mem_cache_size, rdah_cfg, ev_cfg))
                             fs = std::move(new_fs);
                     }
                     else
@@ -13,6 +13,10 @@ namespace detail
 {
 class cache_fs;
 class cache_fs_compare;
+struct admission_cfg;
+struct aio_service_cfg;
+struct evac_cfg;
+struct read_ahead_cfg;
 using cache_fs_ptr_t = std::shared_ptr<cache_fs>;
 } // namespace detail
 ////////////////////////////////////////////////////////////////////////////////
@@ -33,8 +37,9 @@ class cache_mgr final : public object_distributor
     // In addition we need the alive FS to be sorted because this allows
     // use to continue from the next FS when doing async metadata sync,
     // if one or few FS get removed in the meantime.
-    // TODO Use the more efficient atomic_shared_ptr when available
-    // or from Antony Williams.
+    // The hot paths (open for read/write) use its lock free read operation,
+    // so that the network threads don't contend on the shared reference
+    // count. The rest use read_copy.
     x3me::thread::rcu_resource<cache_fs_set_t> cache_fs_;
 
     // It's kind of unfortunate that we need to start a separate thread here
@@ -78,7 +83,7 @@ private:
                     bytes64_t skip_bytes,
                     detail::open_rhandler_t&& h) noexcept final;
 
-    detail::object_ohandle_ptr_t
+    expected_t<detail::object_ohandle_ptr_t, err_code_t>
     async_open_write(const cache_key& ckey,
                      bool truncate_object,
                      detail::open_whandler_t&& h) noexcept final;
@@ -91,7 +96,12 @@ private:
 
     bool init_volumes_fs(const volume_paths_t& vpaths,
                          uint32_t min_avg_obj_size,
-                         uint16_t num_aio_threads,
+                         const detail::aio_service_cfg& aio_cfg,
+                         const detail::admission_cfg& adm_cfg,
+                         bytes64_t md_jrnl_size,
+                         bytes64_t mem_cache_size,
+                         const detail::read_ahead_cfg& rdah_cfg,
+                         const detail::evac_cfg& ev_cfg,
                          bool reset_vols) noexcept;
 
     void on_fs_bad(const detail::cache_fs_ptr_t& fs) noexcept;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "latency_histogram.h"
+
 namespace cache
 {
 
@@ -26,6 +28,9 @@ struct stats_fs_wr
     uint64_t cnt_evac_entries_todo_    = 0;
     uint64_t cnt_evac_entries_ok_      = 0;
     uint64_t cnt_evac_entries_err_     = 0;
+    uint64_t cnt_evac_reads_           = 0;
+    bytes64_t evac_read_size_          = 0;
+    uint64_t evac_read_time_us_        = 0;
 };
 
 struct stats_fs_ops
@@ -36,10 +41,45 @@ struct stats_fs_ops
     uint64_t write_lap_   = 0;
 };
 
+// The time which the tasks of given scheduling class wait in the AIO
+// queues of a volume before being executed.
+struct stats_aio_class
+{
+    uint64_t cnt_tasks_        = 0;
+    uint64_t wait_time_us_     = 0;
+    uint64_t max_wait_time_us_ = 0;
+};
+
+struct stats_aio_sched
+{
+    stats_aio_class interactive_;
+    stats_aio_class evacuation_;
+    stats_aio_class flush_;
+    stats_aio_class metadata_;
+    // The background disk operations delayed by the pending reads.
+    // The wait time is the time of the delay.
+    stats_aio_class bg_delay_;
+};
+
+// The queue wait and the device service time of the disk operations.
+// The evacuation reads are counted as reads.
+struct stats_aio_latency
+{
+    latency_hist read_wait_;
+    latency_hist read_service_;
+    latency_hist agg_write_wait_;
+    latency_hist agg_write_service_;
+    latency_hist md_write_wait_;
+    latency_hist md_write_service_;
+};
+
 struct stats_fs : stats_fs_ops, stats_fs_md, stats_fs_wr
 {
     boost::container::string path_;
 
+    stats_aio_sched aio_sched_;
+    stats_aio_latency aio_latency_;
+
     uint32_t cnt_pending_reads_  = 0;
     uint32_t cnt_pending_writes_ = 0;
 
@@ -61,6 +101,30 @@ struct stats_internal
     uint64_t cnt_read_frag_mem_hit_  = 0;
     uint64_t cnt_read_frag_mem_miss_ = 0;
 
+    // The RAM fragment cache
+    uint64_t cnt_mem_cache_hit_   = 0;
+    uint64_t cnt_mem_cache_miss_  = 0;
+    uint64_t cnt_mem_cache_add_   = 0;
+    uint64_t cnt_mem_cache_evict_ = 0;
+    bytes64_t mem_cache_size_     = 0;
+
+    // The read-ahead of object fragments by the readers
+    uint64_t rdah_issued_bytes_  = 0;
+    uint64_t rdah_used_bytes_    = 0;
+    uint64_t rdah_wasted_bytes_  = 0;
+    uint64_t cnt_rdah_no_budget_ = 0;
+    bytes64_t rdah_size_         = 0;
+
+    // The fragments evacuated because of their hits and not because
+    // they were currently read
+    uint64_t cnt_evac_hot_frags_     = 0;
+    bytes64_t evac_hot_bytes_        = 0;
+    uint64_t cnt_evac_hot_no_budget_ = 0;
+
+    // The admission filter for the cache writes
+    uint64_t cnt_admit_ok_       = 0;
+    uint64_t cnt_admit_rejected_ = 0;
+
     uint64_t cnt_frag_meta_add_ok_      = 0;
     uint64_t cnt_frag_meta_add_skipped_ = 0;
     // These two errors should happen often, and hopefully won't happen at all
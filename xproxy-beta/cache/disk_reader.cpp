@@ -1,5 +1,7 @@
 #include "precompiled.h"
 #include "disk_reader.h"
+#include "cache_common.h"
+#include "cache_error.h"
 
 namespace cache
 {
@@ -9,64 +11,186 @@ namespace detail
 disk_reader::disk_reader(const boost::container::string& vol_path,
                          bytes64_t beg_offs,
                          bytes64_t end_offs)
-    : buff_(alloc_page_aligned(buff_capacity))
+    : pos_(beg_offs)
     , beg_disk_offs_(beg_offs)
     , end_disk_offs_(end_offs)
     , vol_path_(vol_path)
 {
-    fd_.reset(::fopen(vol_path.c_str(), "r"));
-    if (!fd_)
+    curr_.data_ = alloc_page_aligned(buff_capacity);
+    free_buffs_.resize(read_ahead_buffs);
+    for (auto& b : free_buffs_)
+        b.data_ = alloc_page_aligned(buff_capacity);
+    fd_ = ::open(vol_path.c_str(), O_RDONLY | O_DIRECT);
+    // Some file systems (e.g. tmpfs) don't support direct IO.
+    // The reading still works without it, just the page cache gets polluted.
+    if ((fd_ < 0) && (errno == EINVAL))
+        fd_ = ::open(vol_path.c_str(), O_RDONLY);
+    if (fd_ < 0)
     {
         throw bsys::system_error(
             errno, bsys::get_system_category(),
             ("Disk_reader failed to open volume: " + vol_path).c_str());
     }
-    // We want the reader to use bigger buffer, our buffer :)
-    auto buff = reinterpret_cast<char*>(buff_.get());
-    if (::setvbuf(fd_.get(), buff, _IOFBF, buff_capacity) != 0)
-    {
-        throw bsys::system_error(errno, bsys::get_system_category(),
-                                 "Disk_reader unable to set buffer");
-    }
     set_next_offset(0);
+    ra_thread_ = std::thread([this]
+                             {
+                                 read_ahead_loop();
+                             });
 }
 
 disk_reader::~disk_reader() noexcept
 {
+    // The read-ahead thread uses the file descriptor and the buffers
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    ra_thread_.join();
+    ::close(fd_);
 }
 
 void disk_reader::set_next_offset(bytes64_t offs)
 {
     X3ME_ENFORCE(offs <= read_area_size(), "Invalid offset provided");
-    const auto disk_offs = beg_disk_offs_ + offs;
-    if (::fseek(fd_.get(), disk_offs, SEEK_SET) != 0)
+    // The buffers are kept. The data is read from the disk only if the
+    // new offset is not inside them.
+    pos_ = beg_disk_offs_ + offs;
+}
+
+void disk_reader::read(void* buf, size_t len)
+{
+    if ((pos_ + len) > end_disk_offs_)
     {
         x3me::utilities::string_builder_256 inf;
-        inf << "Disk_reader. Unable to set next offset to " << disk_offs
-            << ". Begin disk offset " << beg_disk_offs_ << '\0';
-        throw bsys::system_error(errno, bsys::get_system_category(),
+        inf << "Disk_reader read beyond the end offset " << end_disk_offs_
+            << ". Current offset: " << pos_ << ". Wanted bytes: " << len;
+        throw bsys::system_error(EINVAL, bsys::get_system_category(),
                                  inf.data());
     }
+    auto* out = static_cast<uint8_t*>(buf);
+    while (len > 0)
+    {
+        if (!x3me::math::in_range(pos_, curr_.offs_,
+                                  curr_.offs_ + curr_.size_))
+            fill_curr_buffer();
+        const auto boffs = pos_ - curr_.offs_;
+        const auto cnt   = std::min<size_t>(len, curr_.size_ - boffs);
+        ::memcpy(out, curr_.data_.get() + boffs, cnt);
+        out += cnt;
+        len -= cnt;
+        pos_ += cnt;
+    }
 }
 
-void disk_reader::read(void* buf, size_t len)
+////////////////////////////////////////////////////////////////////////////////
+
+void disk_reader::fill_curr_buffer()
 {
-    const auto res = ::fread(buf, 1, len, fd_.get());
-    if (res != len)
+    const bytes64_t offs = pos_ & ~bytes64_t(store_block_size - 1);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (curr_.data_)
+        free_buffs_.push_back(std::move(curr_));
+    for (;;)
+    {
+        if (!ready_buffs_.empty() && (ready_buffs_.front().offs_ == offs))
+        {
+            // The usual case for the sequential reading
+            curr_ = std::move(ready_buffs_.front());
+            ready_buffs_.pop_front();
+            break;
+        }
+        if (!ready_buffs_.empty() || !ra_active_ || (ra_offs_ != offs))
+        {
+            // The read ahead data doesn't contain the needed chunk.
+            // Restart the read-ahead from the needed chunk.
+            for (auto& b : ready_buffs_)
+                free_buffs_.push_back(std::move(b));
+            ready_buffs_.clear();
+            ++ra_gen_;
+            ra_offs_   = offs;
+            ra_active_ = true;
+            cond_.notify_all();
+        }
+        cond_.wait(lock);
+    }
+    lock.unlock();
+    cond_.notify_all(); // The read-ahead may wait for a free buffer
+
+    auto err = curr_.err_;
+    if (err || (pos_ >= (curr_.offs_ + curr_.size_)))
     {
         x3me::utilities::string_builder_256 inf;
-        inf << "Disk_reader read error. Read bytes: " << res
-            << ". Wanted bytes: " << len;
-        throw bsys::system_error(errno, bsys::get_system_category(),
-                                 inf.data());
+        inf << "Disk_reader read error. Disk offset: " << curr_.offs_
+            << ". Read bytes: " << curr_.size_
+            << ". Wanted offset: " << pos_;
+        if (!err)
+            err.assign(cache::error::eof, get_cache_error_category());
+        throw bsys::system_error(err, inf.data());
+    }
+}
+
+void disk_reader::read_ahead_loop() noexcept
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        cond_.wait(lock, [this]
+                   {
+                       return stop_ || (ra_active_ && !free_buffs_.empty());
+                   });
+        if (stop_)
+            return;
+        auto b = std::move(free_buffs_.back());
+        free_buffs_.pop_back();
+        b.offs_        = ra_offs_;
+        const auto gen = ra_gen_;
+
+        lock.unlock();
+        b.err_ = read_chunk(b);
+        lock.lock();
+
+        if (gen != ra_gen_)
+        {
+            // The reader doesn't need this chunk anymore
+            free_buffs_.push_back(std::move(b));
+            continue;
+        }
+        ra_offs_ = b.offs_ + b.size_;
+        // Don't read after an error, after the end of the area or after
+        // the end of the file.
+        if (b.err_ || (ra_offs_ >= end_disk_offs_) ||
+            (b.size_ < buff_capacity))
+            ra_active_ = false;
+        ready_buffs_.push_back(std::move(b));
+        cond_.notify_all();
     }
 }
 
-bytes64_t disk_reader::curr_disk_offset() noexcept
+err_code_t disk_reader::read_chunk(buffer& b) noexcept
 {
-    const auto ret = ::ftell(fd_.get());
-    X3ME_ENFORCE(ret >= 0, "The file handle must be valid");
-    return ret;
+    X3ME_ASSERT((b.offs_ % store_block_size) == 0,
+                "The direct IO needs aligned offset");
+    const bytes64_t want = std::min<bytes64_t>(
+        buff_capacity,
+        round_to_store_block_size(end_disk_offs_ - b.offs_));
+    bytes64_t done = 0;
+    while (done < want)
+    {
+        const auto r =
+            ::pread(fd_, b.data_.get() + done, want - done, b.offs_ + done);
+        if (r > 0)
+            done += r;
+        else if (r == 0)
+            break; // The end of the file
+        else if (errno != EINTR)
+        {
+            b.size_ = 0;
+            return err_code_t{errno, bsys::get_system_category()};
+        }
+    }
+    b.size_ = std::min(done, end_disk_offs_ - b.offs_);
+    return err_code_t{};
 }
 
 } // namespace detail
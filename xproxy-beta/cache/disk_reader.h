@@ -7,24 +7,51 @@ namespace cache
 namespace detail
 {
 
-// Provides functionality for buffered reading from provided disk area
+// Provides functionality for buffered reading from provided disk area.
+// The disk is read with direct IO in big chunks, aligned to the
+// store_block_size. The next chunks are read ahead by a dedicated thread
+// while the current one is consumed, so that the sequential reading of
+// the metadata on startup is limited by the disk speed and not by the
+// speed of the disk requests issued one after another. The read-ahead
+// stops when all of its buffers are filled and continues when the reader
+// consumes one of them.
 // Do not use buffered reading along with unbuffered reading/writing.
 class disk_reader
 {
-    static constexpr bytes32_t buff_capacity = 1_MB;
+    static constexpr bytes32_t buff_capacity    = 4_MB;
+    static constexpr uint32_t read_ahead_buffs = 2;
 
-    struct fcloser
+    struct buffer
     {
-        void operator()(FILE* f) noexcept { ::fclose(f); }
+        aligned_data_ptr_t data_;
+        bytes64_t offs_ = 0; // The disk offset of the first buffer byte
+        bytes32_t size_ = 0; // The count of the valid bytes in the buffer
+        err_code_t err_;
     };
-    using file_t = std::unique_ptr<FILE, fcloser>;
 
-    file_t fd_;
-    aligned_data_ptr_t buff_;
+    int fd_ = -1;
+    buffer curr_;
+    bytes64_t pos_; // The current disk offset
     const bytes64_t beg_disk_offs_;
     const bytes64_t end_disk_offs_; // The max allowed offset on the disk
     const boost::container::string vol_path_;
 
+    // The read-ahead state is protected by the mutex.
+    // The buffers not used by the reader and by the read-ahead thread
+    // are in the free list. The read chunks are queued in disk order.
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::vector<buffer> free_buffs_;
+    std::deque<buffer> ready_buffs_;
+    bytes64_t ra_offs_ = 0; // The disk offset of the next chunk to be queued
+    // Incremented when the reader jumps to an offset which is not
+    // read ahead. The chunks started before that are dropped.
+    uint32_t ra_gen_ = 0;
+    bool ra_active_  = false;
+    bool stop_       = false;
+    // Must be last, because it uses all of the above
+    std::thread ra_thread_;
+
 public:
     disk_reader(const boost::container::string& vol_path,
                 bytes64_t beg_offs,
@@ -41,12 +68,17 @@ public:
 
     void read(void* buf, size_t len);
 
-    bytes64_t curr_disk_offset() noexcept;
+    bytes64_t curr_disk_offset() noexcept { return pos_; }
     bytes64_t beg_disk_offset() const noexcept { return beg_disk_offs_; }
     bytes64_t end_disk_offset() const noexcept { return end_disk_offs_; }
     const boost::container::string& path() const noexcept { return vol_path_; }
 
 private:
+    void fill_curr_buffer();
+    void read_ahead_loop() noexcept;
+
+    err_code_t read_chunk(buffer& b) noexcept;
+
     auto read_area_size() const noexcept
     {
         return end_disk_offs_ - beg_disk_offs_;
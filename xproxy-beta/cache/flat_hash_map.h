@@ -0,0 +1,579 @@
+#pragma once
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace cache
+{
+namespace detail
+{
+
+// Hash map with the lookup of the Swiss tables and the memory per entry
+// of the sparse_hash_map.
+// The table is split in groups of up to 64 entries. The group of a key is
+// chosen by its hash. Every group is a single allocation with the exact
+// needed size: a small header, one tag byte per entry followed by the
+// entries themselves. The tag of a full slot contains 7 bits from the key
+// hash. A lookup compares the tags of the whole group at once (with SSE2
+// when available) and compares the keys only for the matching slots.
+// Thus the keys are compared rarely and there is no pointer chasing
+// except the one to the group itself.
+// A full group puts the new entries in the following groups and remembers
+// that it has overflowed. A lookup continues to the next group only after
+// an overflowed one. The table grows by 1.5 when the groups get 48 entries
+// on average and then less than 1% of the groups overflow.
+// The number of groups doesn't need to be power of 2. This allows exact
+// reservation and smaller growth steps. The empty slots don't take memory,
+// so the memory per entry stays close to the size of the entry itself
+// regardless of the load of the table.
+// The insert operation invalidates the iterators.
+// The erase operation leaves a deleted tag in place of the erased element.
+// It doesn't move the other elements and doesn't invalidate the iterators
+// to them. Thus it's possible to erase elements while iterating.
+// The deleted slots are reused by the following inserts in their group.
+// The Hash must return well distributed 64 bit values.
+template <typename Key, typename Value, typename Hash>
+class flat_hash_map
+{
+public:
+    using key_type    = Key;
+    using mapped_type = Value;
+    using value_type  = std::pair<const Key, Value>;
+    using size_type   = size_t;
+
+private:
+    static constexpr size_type group_size = 64;
+    // The average count of entries per group above which the table grows.
+    static constexpr size_type max_group_load = 48;
+
+    static constexpr int8_t tag_deleted = -2;
+
+    // Placed at the beginning of every group allocation.
+    // The tags follow it. The first slot begins at the first properly
+    // aligned position after the tags.
+    struct group_hdr
+    {
+        uint8_t size_; // The used slots, including the deleted ones
+        uint8_t capacity_;
+        uint8_t cnt_deleted_;
+        // Some entries which belong to this group are put in the next ones.
+        // It's never cleared before a rehash.
+        bool overflowed_;
+    };
+    static_assert(group_size <= std::numeric_limits<uint8_t>::max(),
+                  "The group header can't keep the group size");
+    static_assert(alignof(value_type) <= alignof(std::max_align_t),
+                  "The group allocation doesn't align the slots properly");
+
+    std::unique_ptr<group_hdr*[]> groups_;
+    size_type cnt_groups_ = 0;
+    size_type size_       = 0;
+    // The memory allocated by the groups
+    size_type groups_mem_ = 0;
+    Hash hash_;
+
+    template <bool Const>
+    class iter
+    {
+        friend class flat_hash_map;
+        friend class iter<!Const>;
+        using map_t =
+            std::conditional_t<Const, const flat_hash_map, flat_hash_map>;
+
+        map_t* map_    = nullptr;
+        size_type pos_ = 0;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = flat_hash_map::value_type;
+        using difference_type   = ptrdiff_t;
+        using reference =
+            std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer =
+            std::conditional_t<Const, const value_type*, value_type*>;
+
+        iter() noexcept {}
+        iter(map_t* m, size_type pos) noexcept : map_(m), pos_(pos) {}
+        // Allows conversion from iterator to const_iterator
+        template <bool C, typename = std::enable_if_t<Const && !C>>
+        iter(const iter<C>& rhs) noexcept : map_(rhs.map_), pos_(rhs.pos_)
+        {
+        }
+
+        reference operator*() const noexcept { return map_->slot(pos_); }
+        pointer operator->() const noexcept { return &map_->slot(pos_); }
+
+        iter& operator++() noexcept
+        {
+            pos_ = map_->next_full(pos_ + 1);
+            return *this;
+        }
+        iter operator++(int) noexcept
+        {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        friend bool operator==(const iter& lhs, const iter& rhs) noexcept
+        {
+            return lhs.pos_ == rhs.pos_;
+        }
+        friend bool operator!=(const iter& lhs, const iter& rhs) noexcept
+        {
+            return lhs.pos_ != rhs.pos_;
+        }
+    };
+
+public:
+    using iterator       = iter<false>;
+    using const_iterator = iter<true>;
+
+public:
+    flat_hash_map() noexcept {}
+    ~flat_hash_map() noexcept { destroy_all(); }
+
+    flat_hash_map(const flat_hash_map& rhs) noexcept { copy_from(rhs); }
+    flat_hash_map& operator=(const flat_hash_map& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            flat_hash_map tmp(rhs);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    flat_hash_map(flat_hash_map&& rhs) noexcept { swap(rhs); }
+    flat_hash_map& operator=(flat_hash_map&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            flat_hash_map tmp(std::move(rhs));
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    void swap(flat_hash_map& rhs) noexcept
+    {
+        using std::swap;
+        swap(groups_, rhs.groups_);
+        swap(cnt_groups_, rhs.cnt_groups_);
+        swap(size_, rhs.size_);
+        swap(groups_mem_, rhs.groups_mem_);
+        swap(hash_, rhs.hash_);
+    }
+
+    // Ensures that the given count of elements can be inserted without
+    // rehashing. The groups still grow one slot at a time.
+    void reserve(size_type cnt) noexcept
+    {
+        const auto cnt_groups = groups_for(cnt);
+        if (cnt_groups > cnt_groups_)
+            rehash(cnt_groups);
+    }
+
+    iterator find(const Key& key) noexcept
+    {
+        return iterator(this, find_pos(key));
+    }
+    const_iterator find(const Key& key) const noexcept
+    {
+        return const_iterator(this, find_pos(key));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) noexcept
+    {
+        return emplace_impl(v);
+    }
+    std::pair<iterator, bool> insert(value_type&& v) noexcept
+    {
+        return emplace_impl(std::move(v));
+    }
+
+    // Invalidates only the iterators to the erased element.
+    void erase(const_iterator it) noexcept
+    {
+        auto& g        = groups_[it.pos_ / group_size];
+        const auto idx = it.pos_ % group_size;
+        X3ME_ASSERT(g && (idx < g->size_) && is_full(tags(g)[idx]),
+                    "Erasing invalid iterator");
+        values(g)[idx].~value_type();
+        tags(g)[idx] = tag_deleted;
+        ++g->cnt_deleted_;
+        --size_;
+        // The searches for the entries put after an overflowed group pass
+        // through it. Thus it must be kept even if it's empty.
+        if ((g->cnt_deleted_ == g->size_) && !g->overflowed_)
+        {
+            free_group(g);
+            g = nullptr;
+        }
+    }
+
+    iterator begin() noexcept { return iterator(this, next_full(0)); }
+    iterator end() noexcept { return iterator(this, capacity()); }
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(this, next_full(0));
+    }
+    const_iterator end() const noexcept
+    {
+        return const_iterator(this, capacity());
+    }
+
+    size_type size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    size_type capacity() const noexcept { return cnt_groups_ * group_size; }
+    // The bytes allocated by the map, not including the memory allocated
+    // by the elements themselves.
+    size_type memory_usage() const noexcept
+    {
+        return groups_mem_ + (cnt_groups_ * sizeof(group_hdr*));
+    }
+
+private:
+    template <typename V>
+    std::pair<iterator, bool> emplace_impl(V&& v) noexcept
+    {
+        const auto h = hash_(v.first);
+        auto pos     = find_pos(v.first, h);
+        if (pos != capacity())
+            return {iterator(this, pos), false};
+        if (size_ >= (cnt_groups_ * max_group_load))
+            grow();
+        pos = make_slot(h);
+        new (&slot(pos)) value_type(std::forward<V>(v));
+        ++size_;
+        return {iterator(this, pos), true};
+    }
+
+    size_type find_pos(const Key& key) const noexcept
+    {
+        return find_pos(key, hash_(key));
+    }
+
+    size_type find_pos(const Key& key, uint64_t h) const noexcept
+    {
+        if (cnt_groups_ == 0)
+            return capacity();
+        const auto tag = h2(h);
+        auto gi        = home_group(h);
+        for (size_type i = 0; i < cnt_groups_; ++i)
+        {
+            const auto* g = groups_[gi];
+            if (!g)
+                break;
+            for (auto m = match(g, tag); m != 0; m &= (m - 1))
+            {
+                const auto idx = __builtin_ctzll(m);
+                if (X3ME_LIKELY(values(g)[idx].first == key))
+                    return (gi * group_size) + idx;
+            }
+            if (!g->overflowed_)
+                break;
+            if (++gi == cnt_groups_)
+                gi = 0;
+        }
+        return capacity();
+    }
+
+    // Returns the position of a free slot for an element with the given
+    // hash. The tag of the slot is set, but the element is not constructed.
+    // There must be at least one group which is not full.
+    size_type make_slot(uint64_t h) noexcept
+    {
+        auto gi = home_group(h);
+        for (;;)
+        {
+            auto& g = groups_[gi];
+            size_type idx;
+            if (!g)
+            {
+                g   = alloc_group(1);
+                idx = g->size_++;
+            }
+            else if (g->cnt_deleted_ > 0)
+            {
+                idx = __builtin_ctzll(match(g, tag_deleted));
+                --g->cnt_deleted_;
+            }
+            else if (g->size_ < g->capacity_)
+            {
+                idx = g->size_++;
+            }
+            else if (g->size_ < group_size)
+            {
+                g   = realloc_group(g, g->size_ + 1);
+                idx = g->size_++;
+            }
+            else
+            {
+                g->overflowed_ = true;
+                if (++gi == cnt_groups_)
+                    gi = 0;
+                continue;
+            }
+            tags(g)[idx] = h2(h);
+            return (gi * group_size) + idx;
+        }
+    }
+
+    void grow() noexcept
+    {
+        rehash(groups_for(std::max<size_type>(size_ + (size_ / 2), 1)));
+    }
+
+    void rehash(size_type cnt_groups) noexcept
+    {
+        flat_hash_map tmp;
+        tmp.hash_ = hash_;
+        tmp.groups_.reset(new group_hdr*[cnt_groups]());
+        tmp.cnt_groups_ = cnt_groups;
+        X3ME_ASSERT(cnt_groups * max_group_load >= size_, "Wrong rehash size");
+        // The new groups are allocated with their exact final size, so that
+        // only the overflowing elements cause reallocations.
+        {
+            std::unique_ptr<uint8_t[]> cnts(new uint8_t[cnt_groups]());
+            for (size_type pos = next_full(0); pos < capacity();
+                 pos = next_full(pos + 1))
+            {
+                auto& c = cnts[tmp.home_group(hash_(slot(pos).first))];
+                if (c < group_size)
+                    ++c;
+            }
+            for (size_type gi = 0; gi < cnt_groups; ++gi)
+            {
+                if (cnts[gi] > 0)
+                    tmp.groups_[gi] = tmp.alloc_group(cnts[gi]);
+            }
+        }
+        // Every old group is released as soon as it's moved, so that the
+        // both tables don't need their full memory at the same time.
+        for (size_type gi = 0; gi < cnt_groups_; ++gi)
+        {
+            auto& g = groups_[gi];
+            if (!g)
+                continue;
+            for (size_type idx = 0; idx < g->size_; ++idx)
+            {
+                if (!is_full(tags(g)[idx]))
+                    continue;
+                auto& v        = values(g)[idx];
+                const auto dst = tmp.make_slot(hash_(v.first));
+                new (&tmp.slot(dst)) value_type(std::move(v));
+                v.~value_type();
+            }
+            free_group(g);
+            g = nullptr;
+        }
+        tmp.size_ = size_;
+        size_     = 0;
+        swap(tmp);
+    }
+
+    group_hdr* alloc_group(size_type cap) noexcept
+    {
+        const auto bytes = group_alloc_size(cap);
+        auto* g          = static_cast<group_hdr*>(::operator new(bytes));
+        g->size_         = 0;
+        g->capacity_     = cap;
+        g->cnt_deleted_  = 0;
+        g->overflowed_   = false;
+        groups_mem_ += bytes;
+        return g;
+    }
+
+    // Moves the slots of the group to a new allocation with the given
+    // capacity. The deleted slots stay at their positions.
+    group_hdr* realloc_group(group_hdr* g, size_type cap) noexcept
+    {
+        X3ME_ASSERT(cap >= g->size_, "The group can't shrink");
+        auto* ng         = alloc_group(cap);
+        ng->size_        = g->size_;
+        ng->cnt_deleted_ = g->cnt_deleted_;
+        ng->overflowed_  = g->overflowed_;
+        ::memcpy(tags(ng), tags(g), g->size_);
+        for (size_type idx = 0; idx < g->size_; ++idx)
+        {
+            if (!is_full(tags(g)[idx]))
+                continue;
+            auto& v = values(g)[idx];
+            new (&values(ng)[idx]) value_type(std::move(v));
+            v.~value_type();
+        }
+        free_group(g);
+        return ng;
+    }
+
+    void free_group(group_hdr* g) noexcept
+    {
+        groups_mem_ -= group_alloc_size(g->capacity_);
+        ::operator delete(g);
+    }
+
+    void copy_from(const flat_hash_map& rhs) noexcept
+    {
+        if (rhs.cnt_groups_ == 0)
+            return;
+        groups_.reset(new group_hdr*[rhs.cnt_groups_]());
+        cnt_groups_ = rhs.cnt_groups_;
+        for (size_type gi = 0; gi < cnt_groups_; ++gi)
+        {
+            const auto* rg = rhs.groups_[gi];
+            if (!rg)
+                continue;
+            auto* g         = alloc_group(rg->capacity_);
+            g->size_        = rg->size_;
+            g->cnt_deleted_ = rg->cnt_deleted_;
+            g->overflowed_  = rg->overflowed_;
+            ::memcpy(tags(g), tags(rg), rg->size_);
+            for (size_type idx = 0; idx < rg->size_; ++idx)
+            {
+                if (is_full(tags(rg)[idx]))
+                    new (&values(g)[idx]) value_type(values(rg)[idx]);
+            }
+            groups_[gi] = g;
+        }
+        size_ = rhs.size_;
+        hash_ = rhs.hash_;
+    }
+
+    void destroy_all() noexcept
+    {
+        for (size_type gi = 0; gi < cnt_groups_; ++gi)
+        {
+            auto& g = groups_[gi];
+            if (!g)
+                continue;
+            for (size_type idx = 0; idx < g->size_; ++idx)
+            {
+                if (is_full(tags(g)[idx]))
+                    values(g)[idx].~value_type();
+            }
+            free_group(g);
+            g = nullptr;
+        }
+    }
+
+    size_type next_full(size_type pos) const noexcept
+    {
+        const auto cap = capacity();
+        while (pos < cap)
+        {
+            const auto gi = pos / group_size;
+            if (const auto* g = groups_[gi])
+            {
+                for (size_type idx = pos % group_size; idx < g->size_; ++idx)
+                {
+                    if (is_full(tags(g)[idx]))
+                        return (gi * group_size) + idx;
+                }
+            }
+            pos = (gi + 1) * group_size;
+        }
+        return cap;
+    }
+
+    size_type home_group(uint64_t h) const noexcept
+    {
+        // Maps the hash to [0, cnt_groups_) without division
+        return static_cast<size_type>(
+            (static_cast<unsigned __int128>(h) * cnt_groups_) >> 64);
+    }
+
+    value_type& slot(size_type pos) noexcept
+    {
+        return values(groups_[pos / group_size])[pos % group_size];
+    }
+    const value_type& slot(size_type pos) const noexcept
+    {
+        return values(groups_[pos / group_size])[pos % group_size];
+    }
+
+    static size_type slots_offset(size_type cap) noexcept
+    {
+        return x3me::math::round_up(sizeof(group_hdr) + cap,
+                                    alignof(value_type));
+    }
+    static size_type group_alloc_size(size_type cap) noexcept
+    {
+        return slots_offset(cap) + (cap * sizeof(value_type));
+    }
+
+    static int8_t* tags(group_hdr* g) noexcept
+    {
+        return reinterpret_cast<int8_t*>(g + 1);
+    }
+    static const int8_t* tags(const group_hdr* g) noexcept
+    {
+        return reinterpret_cast<const int8_t*>(g + 1);
+    }
+    static value_type* values(group_hdr* g) noexcept
+    {
+        return reinterpret_cast<value_type*>(reinterpret_cast<uint8_t*>(g) +
+                                             slots_offset(g->capacity_));
+    }
+    static const value_type* values(const group_hdr* g) noexcept
+    {
+        return reinterpret_cast<const value_type*>(
+            reinterpret_cast<const uint8_t*>(g) + slots_offset(g->capacity_));
+    }
+
+    static int8_t h2(uint64_t h) noexcept { return h & 0x7F; }
+
+    static bool is_full(int8_t c) noexcept { return c >= 0; }
+
+    static size_type groups_for(size_type cnt) noexcept
+    {
+        return x3me::math::divide_round_up(cnt, max_group_load);
+    }
+
+    // Returns a mask with the bits of the used slots whose tag is 't'.
+#ifdef __SSE2__
+    static uint64_t match(const group_hdr* g, int8_t t) noexcept
+    {
+        // The 16 byte loads may read past the tags, but always inside the
+        // group allocation, because every slot is much bigger than 16 bytes.
+        // The bytes past the used tags are masked.
+        static_assert(sizeof(value_type) >= 16, "Reading past the group");
+        const auto* p  = tags(g);
+        const auto sz  = g->size_;
+        const auto tt  = _mm_set1_epi8(t);
+        uint64_t ret   = 0;
+        for (size_type i = 0; i < sz; i += 16)
+        {
+            const auto c =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const uint32_t m = _mm_movemask_epi8(_mm_cmpeq_epi8(tt, c));
+            ret |= uint64_t(m) << i;
+        }
+        if (sz < group_size)
+            ret &= (uint64_t(1) << sz) - 1;
+        return ret;
+    }
+#else
+    static uint64_t match(const group_hdr* g, int8_t t) noexcept
+    {
+        const auto* p = tags(g);
+        uint64_t ret  = 0;
+        for (size_type i = 0; i < g->size_; ++i)
+            ret |= uint64_t(p[i] == t) << i;
+        return ret;
+    }
+#endif
+};
+
+template <typename K, typename V, typename H>
+constexpr typename flat_hash_map<K, V, H>::size_type
+    flat_hash_map<K, V, H>::group_size;
+template <typename K, typename V, typename H>
+constexpr typename flat_hash_map<K, V, H>::size_type
+    flat_hash_map<K, V, H>::max_group_load;
+template <typename K, typename V, typename H>
+constexpr int8_t flat_hash_map<K, V, H>::tag_deleted;
+
+} // namespace detail
+} // namespace cache
@@ -0,0 +1,258 @@
+#include "precompiled.h"
+#include "frag_mem_cache.h"
+#include "cache_stats.h"
+#include "range_elem.h"
+
+namespace cache
+{
+namespace detail
+{
+
+constexpr uint32_t frag_mem_cache::cnt_shards;
+constexpr uint32_t frag_mem_cache::small_queue_pct;
+constexpr uint8_t frag_mem_cache::max_freq;
+
+frag_mem_cache::shard::shard() noexcept
+{
+}
+
+frag_mem_cache::shard::~shard() noexcept
+{
+    // The entries must be unlinked before their destruction
+    small_q_.clear();
+    main_q_.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+frag_mem_cache::frag_mem_cache() noexcept
+{
+}
+
+frag_mem_cache::~frag_mem_cache() noexcept
+{
+}
+
+void frag_mem_cache::set_max_size(bytes64_t max_size) noexcept
+{
+    max_shard_size_ = max_size / cnt_shards;
+}
+
+frag_mem_cache::frag_ref_t
+frag_mem_cache::try_read_frag(const fs_node_key_t& key,
+                              const range_elem& rng,
+                              bytes32_t size) noexcept
+{
+    if (!enabled())
+        return nullptr;
+
+    const auto id = make_frag_id(key, rng);
+
+    frag_ref_t ret;
+    {
+        auto& sh = get_shard(key);
+        std::lock_guard<std::mutex> _(sh.mutex_);
+        auto it = sh.entries_.find(id);
+        if ((it != sh.entries_.end()) && (it->second.size_ == size))
+        {
+            auto& e = it->second;
+            ret     = e.data_;
+            if (e.freq_ < max_freq)
+                ++e.freq_;
+        }
+    }
+
+    if (ret)
+        stats_.cnt_hit_.fetch_add(1, std::memory_order_relaxed);
+    else
+        stats_.cnt_miss_.fetch_add(1, std::memory_order_relaxed);
+    return ret;
+}
+
+void frag_mem_cache::add_frag(const fs_node_key_t& key,
+                              const range_elem& rng,
+                              const frag_ref_t& data,
+                              bytes32_t size) noexcept
+{
+    // The fragment must fit in the small queue
+    if (!enabled() || (size > max_small_size()))
+        return;
+
+    const auto id = make_frag_id(key, rng);
+    const auto h  = hash(id);
+
+    auto& sh = get_shard(key);
+    std::lock_guard<std::mutex> _(sh.mutex_);
+
+    auto res = sh.entries_.emplace(std::piecewise_construct,
+                                   std::forward_as_tuple(id),
+                                   std::forward_as_tuple());
+    if (!res.second)
+        return; // Already present
+
+    auto& e = res.first->second;
+    e.data_ = data;
+    e.id_   = &res.first->first;
+    e.size_ = size;
+    // The fragment has been evicted recently from the small queue.
+    // Now it's read again and thus it's considered hot.
+    if (sh.ghost_set_.erase(h) > 0)
+    {
+        e.queue_ = queue_id::main;
+        sh.main_q_.push_back(e);
+        sh.main_size_ += e.size_;
+    }
+    else
+    {
+        e.queue_ = queue_id::small;
+        sh.small_q_.push_back(e);
+        sh.small_size_ += e.size_;
+    }
+    stats_.cnt_add_.fetch_add(1, std::memory_order_relaxed);
+    stats_.size_.fetch_add(e.size_, std::memory_order_relaxed);
+
+    evict(sh);
+}
+
+void frag_mem_cache::rem_frags(const fs_node_key_t& key) noexcept
+{
+    if (!enabled())
+        return;
+
+    frag_id id;
+    id.key_         = key;
+    id.rng_offset_  = 0;
+    id.disk_offset_ = 0;
+    id.rng_size_    = 0;
+
+    auto& sh = get_shard(key);
+    std::lock_guard<std::mutex> _(sh.mutex_);
+    for (auto it = sh.entries_.lower_bound(id);
+         (it != sh.entries_.end()) && (it->first.key_ == key);)
+    {
+        auto curr = it++;
+        rem_entry(sh, curr);
+    }
+}
+
+void frag_mem_cache::get_stats(stats_internal& sts) const noexcept
+{
+    sts.cnt_mem_cache_hit_   = stats_.cnt_hit_.load(std::memory_order_relaxed);
+    sts.cnt_mem_cache_miss_  = stats_.cnt_miss_.load(std::memory_order_relaxed);
+    sts.cnt_mem_cache_add_   = stats_.cnt_add_.load(std::memory_order_relaxed);
+    sts.cnt_mem_cache_evict_ = stats_.cnt_evict_.load(std::memory_order_relaxed);
+    sts.mem_cache_size_      = stats_.size_.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void frag_mem_cache::evict(shard& sh) noexcept
+{
+    while ((sh.small_size_ + sh.main_size_) > max_shard_size_)
+    {
+        if ((sh.small_size_ > max_small_size()) || sh.main_q_.empty())
+            evict_small(sh);
+        else
+            evict_main(sh);
+    }
+}
+
+void frag_mem_cache::evict_small(shard& sh) noexcept
+{
+    X3ME_ASSERT(!sh.small_q_.empty(), "Wrong eviction logic");
+    auto& e = sh.small_q_.front();
+    sh.small_q_.pop_front();
+    sh.small_size_ -= e.size_;
+    if (e.freq_ > 0)
+    {
+        // Read again while in the small queue. Promote it.
+        e.freq_  = 0;
+        e.queue_ = queue_id::main;
+        sh.main_q_.push_back(e);
+        sh.main_size_ += e.size_;
+        return;
+    }
+    add_ghost(sh, hash(*e.id_));
+    // The entry is already unlinked from its queue
+    stats_.size_.fetch_sub(e.size_, std::memory_order_relaxed);
+    stats_.cnt_evict_.fetch_add(1, std::memory_order_relaxed);
+    sh.entries_.erase(*e.id_);
+}
+
+void frag_mem_cache::evict_main(shard& sh) noexcept
+{
+    // Every entry gets as many more rounds in the main queue as
+    // its frequency counter. Thus the loop is bounded.
+    for (;;)
+    {
+        auto& e = sh.main_q_.front();
+        sh.main_q_.pop_front();
+        if (e.freq_ > 0)
+        {
+            --e.freq_;
+            sh.main_q_.push_back(e);
+            continue;
+        }
+        sh.main_size_ -= e.size_;
+        stats_.size_.fetch_sub(e.size_, std::memory_order_relaxed);
+        stats_.cnt_evict_.fetch_add(1, std::memory_order_relaxed);
+        sh.entries_.erase(*e.id_);
+        break;
+    }
+}
+
+void frag_mem_cache::rem_entry(shard& sh, entries_t::iterator it) noexcept
+{
+    auto& e = it->second;
+    if (e.queue_ == queue_id::small)
+    {
+        sh.small_q_.erase(sh.small_q_.iterator_to(e));
+        sh.small_size_ -= e.size_;
+    }
+    else
+    {
+        sh.main_q_.erase(sh.main_q_.iterator_to(e));
+        sh.main_size_ -= e.size_;
+    }
+    stats_.size_.fetch_sub(e.size_, std::memory_order_relaxed);
+    sh.entries_.erase(it);
+}
+
+void frag_mem_cache::add_ghost(shard& sh, size_t hash) noexcept
+{
+    // The ghost queue remembers about as many fragments as the cache holds.
+    const auto max_cnt = std::max<size_t>(sh.entries_.size(), 64);
+    if (sh.ghost_set_.insert(hash).second)
+        sh.ghost_q_.push_back(hash);
+    while (sh.ghost_q_.size() > max_cnt)
+    {
+        // The hash may have already been removed from the set, if the
+        // fragment got added again. It doesn't matter.
+        sh.ghost_set_.erase(sh.ghost_q_.front());
+        sh.ghost_q_.pop_front();
+    }
+}
+
+frag_mem_cache::frag_id
+frag_mem_cache::make_frag_id(const fs_node_key_t& key,
+                             const range_elem& rng) noexcept
+{
+    frag_id ret;
+    ret.key_         = key;
+    ret.rng_offset_  = rng.rng_offset();
+    ret.disk_offset_ = rng.disk_offset().to_bytes();
+    ret.rng_size_    = rng.rng_size();
+    return ret;
+}
+
+size_t frag_mem_cache::hash(const frag_id& id) noexcept
+{
+    auto ret = boost::hash_range(id.key_.begin(), id.key_.end());
+    boost::hash_combine(ret, id.rng_offset_);
+    boost::hash_combine(ret, id.disk_offset_);
+    boost::hash_combine(ret, id.rng_size_);
+    return ret;
+}
+
+} // namespace detail
+} // namespace cache
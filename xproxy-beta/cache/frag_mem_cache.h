@@ -0,0 +1,168 @@
+#pragma once
+
+#include "aligned_data_ptr.h"
+#include "fs_node_key.h"
+
+namespace cache
+{
+struct stats_internal;
+namespace detail
+{
+class range_elem;
+
+// RAM cache for object fragments already read from the disk.
+// It uses the S3-FIFO eviction policy. A new fragment goes to a small FIFO
+// queue and gets promoted to the main FIFO queue only if it's read again
+// while it's there. This way a scan through many objects, read only once,
+// can't wipe out the really hot fragments from the main queue.
+// The fragments evicted from the small queue are remembered in a ghost
+// queue (only their hashes) and go directly to the main queue if they
+// are read again soon.
+// The cache is split into shards with separate locks by the fragment key.
+// The fragment buffers are shared with the readers instead of copied. A read
+// handle passes the buffer, just read from the disk, to the cache and later
+// readers of the fragment get a reference to the same buffer.
+class frag_mem_cache
+{
+    using list_hook_t = boost::intrusive::list_base_hook<
+        boost::intrusive::link_mode<boost::intrusive::safe_link>>;
+
+    // A fragment is identified by its disk position along with its key and
+    // range. A fragment with the same key and range on the same disk
+    // position can appear only if the object is rewritten and it's
+    // taken care for this case by removing all fragments for the given key.
+    struct frag_id
+    {
+        fs_node_key_t key_;
+        bytes64_t rng_offset_;
+        bytes64_t disk_offset_;
+        bytes32_t rng_size_;
+
+        friend bool operator<(const frag_id& lhs, const frag_id& rhs) noexcept
+        {
+            return std::tie(lhs.key_, lhs.rng_offset_, lhs.disk_offset_,
+                            lhs.rng_size_) < std::tie(rhs.key_, rhs.rng_offset_,
+                                                      rhs.disk_offset_,
+                                                      rhs.rng_size_);
+        }
+    };
+
+    enum struct queue_id : uint8_t
+    {
+        small,
+        main,
+    };
+
+    struct entry : public list_hook_t
+    {
+        aligned_data_ref_t data_;
+        // Points to the key of the map node where the entry lives
+        const frag_id* id_ = nullptr;
+        bytes32_t size_    = 0;
+        // The S3-FIFO uses 2 bit frequency counter
+        uint8_t freq_      = 0;
+        queue_id queue_    = queue_id::small;
+    };
+    using entries_t = std::map<frag_id, entry>;
+    using queue_t   = boost::intrusive::list<entry>;
+
+    struct alignas(64) shard
+    {
+        std::mutex mutex_;
+        entries_t entries_;
+        queue_t small_q_;
+        queue_t main_q_;
+        bytes64_t small_size_ = 0;
+        bytes64_t main_size_  = 0;
+        // The ghost queue keeps only the hashes of the evicted fragments
+        std::deque<size_t> ghost_q_;
+        std::unordered_set<size_t> ghost_set_;
+
+        shard() noexcept;
+        ~shard() noexcept;
+
+        shard(const shard&) = delete;
+        shard& operator=(const shard&) = delete;
+        shard(shard&&) = delete;
+        shard& operator=(shard&&) = delete;
+    };
+
+    static constexpr uint32_t cnt_shards = 16;
+    static_assert((cnt_shards & (cnt_shards - 1)) == 0,
+                  "Must be power of 2. We use it as a mask");
+    // The share of the small queue from the whole shard size, in percents.
+    static constexpr uint32_t small_queue_pct = 10;
+    static constexpr uint8_t max_freq         = 3;
+
+    std::array<shard, cnt_shards> shards_;
+
+    // Zero means that the cache is disabled
+    bytes64_t max_shard_size_ = 0;
+
+    struct stats
+    {
+        std::atomic<uint64_t> cnt_hit_{0};
+        std::atomic<uint64_t> cnt_miss_{0};
+        std::atomic<uint64_t> cnt_add_{0};
+        std::atomic<uint64_t> cnt_evict_{0};
+        std::atomic<bytes64_t> size_{0};
+    } stats_;
+
+public:
+    using frag_ref_t = aligned_data_ref_t;
+
+    frag_mem_cache() noexcept;
+    ~frag_mem_cache() noexcept;
+
+    frag_mem_cache(const frag_mem_cache&) = delete;
+    frag_mem_cache& operator=(const frag_mem_cache&) = delete;
+    frag_mem_cache(frag_mem_cache&&) = delete;
+    frag_mem_cache& operator=(frag_mem_cache&&) = delete;
+
+    // Not thread safe. Must be called before the cache gets used.
+    void set_max_size(bytes64_t max_size) noexcept;
+
+    // All functions below are thread safe.
+
+    // Returns the fragment data if the fragment is found and it's with the
+    // given size, otherwise returns null. The data must not be modified.
+    frag_ref_t try_read_frag(const fs_node_key_t& key,
+                             const range_elem& rng,
+                             bytes32_t size) noexcept;
+    // Adds the fragment, if it's not already present. The data is shared
+    // with the caller and must not be modified after that.
+    void add_frag(const fs_node_key_t& key,
+                  const range_elem& rng,
+                  const frag_ref_t& data,
+                  bytes32_t size) noexcept;
+    // Removes all fragments for the given key.
+    void rem_frags(const fs_node_key_t& key) noexcept;
+
+    void get_stats(stats_internal& sts) const noexcept;
+
+    bool enabled() const noexcept { return max_shard_size_ > 0; }
+
+private:
+    shard& get_shard(const fs_node_key_t& key) noexcept
+    {
+        return shards_[key.data()[0] & (cnt_shards - 1)];
+    }
+
+    void evict(shard& sh) noexcept;
+    void evict_small(shard& sh) noexcept;
+    void evict_main(shard& sh) noexcept;
+    void rem_entry(shard& sh, entries_t::iterator it) noexcept;
+    void add_ghost(shard& sh, size_t hash) noexcept;
+
+    bytes64_t max_small_size() const noexcept
+    {
+        return (max_shard_size_ * small_queue_pct) / 100;
+    }
+
+    static frag_id make_frag_id(const fs_node_key_t& key,
+                                const range_elem& rng) noexcept;
+    static size_t hash(const frag_id& id) noexcept;
+};
+
+} // namespace detail
+} // namespace cache
@@ -63,7 +63,7 @@ fs_metadata::fs_metadata(const fs_metadata& rhs) noexcept
       ops_(rhs.ops_),
       table_(rhs.table_),
       ftr_(rhs.ftr_),
-      is_dirty_(rhs.is_dirty_)
+      is_dirty_(rhs.is_dirty_.load())
 {
 }
 
@@ -72,7 +72,7 @@ fs_metadata::fs_metadata(fs_metadata&& rhs) noexcept
       ops_(std::move(rhs.ops_)),
       table_(std::move(rhs.table_)),
       ftr_(std::move(rhs.ftr_)),
-      is_dirty_(std::exchange(rhs.is_dirty_, false))
+      is_dirty_(rhs.is_dirty_.exchange(false))
 {
 }
 
@@ -84,7 +84,7 @@ fs_metadata& fs_metadata::operator=(fs_metadata&& rhs) noexcept
         ops_      = std::move(rhs.ops_);
         table_    = std::move(rhs.table_);
         ftr_      = std::move(rhs.ftr_);
-        is_dirty_ = std::exchange(rhs.is_dirty_, false);
+        is_dirty_ = rhs.is_dirty_.exchange(false);
     }
     return *this;
 }
@@ -146,7 +146,7 @@ bytes64_t fs_metadata::max_size_on_disk() const noexcept
 ////////////////////////////////////////////////////////////////////////////////
 
 bool fs_metadata::rem_table_entry(const fs_node_key_t& key,
-                                  const range_elem& rng) noexcept
+                                  const range_elem& rng) const noexcept
 {
     auto ret = rem_table_entries(key, [&](range_vector& rvec)
                                  {
@@ -320,6 +320,9 @@ bool fs_metadata::load_full_metadata(disk_reader& reader, uint32_t metadata_idx)
     fs_table tbl(table_); // The copy here is cheap because the table is empty
     fs_metadata_ftr ftr;
 
+    using namespace std::chrono;
+    const auto load_beg = steady_clock::now();
+
     reader.set_next_offset(md_offs);
     reader.read(&hdr, sizeof(hdr));
     reader.read(&ops, sizeof(ops));
@@ -331,6 +334,12 @@ bool fs_metadata::load_full_metadata(disk_reader& reader, uint32_t metadata_idx)
                    string_view_t(err_info.data(), err_info.size()));
         return false;
     }
+    const auto load_ms =
+        duration_cast<milliseconds>(steady_clock::now() - load_beg).count();
+    XLOG_INFO(disk_tag, "Loaded cache FS {} table for volume '{}' in {} ms. "
+                        "FS nodes {}. Ranges {}. Table size {} bytes",
+              lbl[metadata_idx], reader.path(), load_ms, tbl.cnt_fs_nodes(),
+              tbl.cnt_ranges(), tbl.size_on_disk());
     // The footer is always written at offset multiple of the store_block_size
     const auto ftr_offs =
         round_to_store_block_size(hdr.size() + ops.size() + tbl.size_on_disk());
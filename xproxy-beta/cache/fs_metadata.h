@@ -24,10 +24,14 @@ class fs_metadata
 {
     fs_metadata_hdr hdr_;
     fs_ops_data ops_;
-    fs_table table_;
+    // The table is internally synchronized. Thus the operations on its
+    // entries can be done through a const fs_metadata i.e. under a shared
+    // lock of the whole metadata. Only the operations on the header and the
+    // ops data need exclusive lock.
+    mutable fs_table table_;
     fs_metadata_ftr ftr_;
 
-    bool is_dirty_ = false;
+    mutable std::atomic_bool is_dirty_{false};
 
 public:
     fs_metadata(const volume_info& vi, bytes32_t min_avg_obj_size) noexcept;
@@ -55,19 +59,26 @@ public:
     template <typename OverwriteCond>
     fs_table::add_res add_table_entry(const fs_node_key_t& key,
                                       const range_elem& rng,
-                                      OverwriteCond&& overwrite) noexcept;
+                                      OverwriteCond&& overwrite) const
+        noexcept;
+    // The removals done by these functions are not journaled. The callers
+    // must journal them unless the removed entries point to disk areas
+    // which are about to be overwritten.
     // Returns the count of the removed ranges, if the key is found
     template <typename Remover>
     optional_t<uint32_t> rem_table_entries(const fs_node_key_t& key,
-                                           Remover&& rem) noexcept;
+                                           Remover&& rem) const noexcept;
     bool rem_table_entry(const fs_node_key_t& key,
-                         const range_elem& rng) noexcept;
+                         const range_elem& rng) const noexcept;
+    // Returns the count of the removed ranges
+    template <typename Pred>
+    uint64_t rem_table_entries_if(Pred&& pred) const noexcept;
     template <typename Reader>
     bool read_table_entries(const fs_node_key_t& key, Reader&& rdr) const
         noexcept;
     template <typename Modifier>
     bool modify_table_entries(const fs_node_key_t& key,
-                              Modifier&& mod) noexcept;
+                              Modifier&& mod) const noexcept;
 
     void inc_sync_serial() noexcept;
     void dec_sync_serial() noexcept;
@@ -111,7 +122,7 @@ template <typename OverwriteCond>
 fs_table::add_res
 fs_metadata::add_table_entry(const fs_node_key_t& key,
                              const range_elem& rng,
-                             OverwriteCond&& overwrite) noexcept
+                             OverwriteCond&& overwrite) const noexcept
 {
     is_dirty_ = true; // Add entry may fail/be skipped, but ...
     return table_.add_entry(key, rng, std::forward<OverwriteCond>(overwrite));
@@ -119,12 +130,22 @@ fs_metadata::add_table_entry(const fs_node_key_t& key,
 
 template <typename Remover>
 optional_t<uint32_t> fs_metadata::rem_table_entries(const fs_node_key_t& key,
-                                                    Remover&& rem) noexcept
+                                                    Remover&& rem) const
+    noexcept
 {
     is_dirty_ = true; // Remove entries may actually don't remove any, but ...
     return table_.rem_entries(key, std::forward<Remover>(rem));
 }
 
+template <typename Pred>
+uint64_t fs_metadata::rem_table_entries_if(Pred&& pred) const noexcept
+{
+    const auto ret = table_.rem_entries_if(std::forward<Pred>(pred));
+    if (ret > 0)
+        is_dirty_ = true;
+    return ret;
+}
+
 template <typename Reader>
 bool fs_metadata::read_table_entries(const fs_node_key_t& key,
                                      Reader&& rdr) const noexcept
@@ -134,7 +155,7 @@ bool fs_metadata::read_table_entries(const fs_node_key_t& key,
 
 template <typename Modifier>
 bool fs_metadata::modify_table_entries(const fs_node_key_t& key,
-                                       Modifier&& mod) noexcept
+                                       Modifier&& mod) const noexcept
 {
     // When we modify entries we modify their metadata and we don't want this
     // to provoke flush on the disk. Thus, we don't set the dirty flag here.
@@ -8,20 +8,94 @@ namespace cache
 namespace detail
 {
 
-size_t fs_table::fs_node_hash::operator()(const fs_node_key_t& v) const noexcept
+uint64_t fs_table::fs_node_hash::operator()(const fs_node_key_t& v) const
+    noexcept
 {
-    return boost::hash_range(v.begin(), v.end());
+    // The key is a MD5 hash and thus it's already well distributed.
+    // The first byte selects the shard, so we use the second half of the
+    // key for the hash. Otherwise the keys in a shard would have the same
+    // low bits of their hashes.
+    static_assert(sizeof(fs_node_key_t) >= 2 * sizeof(uint64_t),
+                  "The key must contain at least two uint64_t values");
+    uint64_t ret;
+    ::memcpy(&ret, v.data() + sizeof(ret), sizeof(ret));
+    return ret;
 }
 
 constexpr uint64_t fs_table::disk_hdr::magic;
 
+// The count of the fs_nodes decoded before they are given to the workers.
+constexpr uint64_t load_batch_size = 64 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////
+
+fs_table::shard::shard() noexcept
+{
+}
+
+fs_table::shard::~shard() noexcept
+{
+}
+
+void fs_table::shard::copy_from(const shard& rhs) noexcept
+{
+    cnt_ranges_        = rhs.cnt_ranges_;
+    cnt_entries_       = rhs.cnt_entries_;
+    entries_data_size_ = rhs.entries_data_size_;
+    fs_nodes_          = rhs.fs_nodes_;
+}
+
+void fs_table::shard::move_from(shard& rhs) noexcept
+{
+    cnt_ranges_        = std::exchange(rhs.cnt_ranges_, 0);
+    cnt_entries_       = std::exchange(rhs.cnt_entries_, 0);
+    entries_data_size_ = std::exchange(rhs.entries_data_size_, 0);
+
+    fs_nodes_t tmp;
+    tmp.swap(rhs.fs_nodes_);
+    fs_nodes_.swap(tmp);
+}
+
+void fs_table::shard::clear() noexcept
+{
+    cnt_ranges_        = 0;
+    cnt_entries_       = 0;
+    entries_data_size_ = 0;
+
+    fs_nodes_t tmp;
+    fs_nodes_.swap(tmp);
+}
+
+void fs_table::shard::on_inc_entries(const range_elem& rng) noexcept
+{
+    cnt_entries_ += 1;
+    entries_data_size_ += rng.rng_size();
+}
+
+void fs_table::shard::on_dec_entries(uint64_t cnt_removed,
+                                     bytes64_t rem_size) noexcept
+{
+    cnt_entries_ -= cnt_removed;
+    entries_data_size_ -= rem_size;
+}
+
+void fs_table::shard::on_dec_entries(
+    const range_vector::iter_range& rngs) noexcept
+{
+    const auto size = std::accumulate(rngs.begin(), rngs.end(), bytes64_t{0},
+                                      [](bytes64_t sum, const range_elem& rng)
+                                      {
+                                          return sum + rng.rng_size();
+                                      });
+    on_dec_entries(rngs.size(), size);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 fs_table::fs_table(bytes64_t avail_disk_space,
                    bytes32_t min_avg_obj_size) noexcept
     : max_allowed_data_size_(max_data_size(avail_disk_space, min_avg_obj_size))
 {
-    fs_nodes_.set_deleted_key(fs_node_key_t::zero());
 }
 
 fs_table::~fs_table() noexcept
@@ -30,23 +104,18 @@ fs_table::~fs_table() noexcept
 
 fs_table::fs_table(const fs_table& rhs) noexcept
     : max_allowed_data_size_(rhs.max_allowed_data_size_),
-      cnt_ranges_(rhs.cnt_ranges_),
-      cnt_entries_(rhs.cnt_entries_),
-      entries_data_size_(rhs.entries_data_size_),
-      fs_nodes_(rhs.fs_nodes_)
+      data_size_(rhs.data_size_.load(std::memory_order_relaxed))
 {
+    for (uint32_t i = 0; i < cnt_shards; ++i)
+        shards_[i].copy_from(rhs.shards_[i]);
 }
 
 fs_table::fs_table(fs_table&& rhs) noexcept
     : max_allowed_data_size_(rhs.max_allowed_data_size_),
-      cnt_ranges_(std::exchange(rhs.cnt_ranges_, 0)),
-      cnt_entries_(std::exchange(rhs.cnt_entries_, 0)),
-      entries_data_size_(std::exchange(rhs.entries_data_size_, 0))
+      data_size_(rhs.data_size_.exchange(0, std::memory_order_relaxed))
 {
-    fs_nodes_t tmp;
-    tmp.set_deleted_key(fs_node_key_t::zero());
-    tmp.swap(rhs.fs_nodes_);
-    fs_nodes_.swap(tmp);
+    for (uint32_t i = 0; i < cnt_shards; ++i)
+        shards_[i].move_from(rhs.shards_[i]);
 }
 
 fs_table& fs_table::operator=(fs_table&& rhs) noexcept
@@ -55,25 +124,19 @@ fs_table& fs_table::operator=(fs_table&& rhs) noexcept
     {
         const_cast<bytes64_t&>(max_allowed_data_size_) =
             rhs.max_allowed_data_size_;
-        cnt_ranges_        = std::exchange(rhs.cnt_ranges_, 0);
-        cnt_entries_       = std::exchange(rhs.cnt_entries_, 0);
-        entries_data_size_ = std::exchange(rhs.entries_data_size_, 0);
-
-        fs_nodes_t tmp;
-        tmp.set_deleted_key(fs_node_key_t::zero());
-        tmp.swap(rhs.fs_nodes_);
-        fs_nodes_.swap(tmp);
+        data_size_.store(rhs.data_size_.exchange(0, std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+        for (uint32_t i = 0; i < cnt_shards; ++i)
+            shards_[i].move_from(rhs.shards_[i]);
     }
     return *this;
 }
 
 void fs_table::clean_init() noexcept
 {
-    cnt_ranges_ = 0;
-
-    fs_nodes_t tmp;
-    tmp.set_deleted_key(fs_node_key_t::zero());
-    fs_nodes_.swap(tmp);
+    data_size_.store(0, std::memory_order_relaxed);
+    for (auto& sh : shards_)
+        sh.clear();
 }
 
 bool fs_table::load(disk_reader& reader, err_info_t& out_err)
@@ -91,55 +154,98 @@ bool fs_table::load(disk_reader& reader, err_info_t& out_err)
         return false;
     }
 
-    decltype(cnt_ranges_) num_ranges = 0;
-    fs_nodes_t tmp(hdr.cnt_nodes_);
-    tmp.set_deleted_key(fs_node_key_t::zero());
-    for (decltype(hdr.cnt_nodes_) i = 0; i < hdr.cnt_nodes_; ++i)
+    // The nodes are loaded into temporary shards first, because we don't
+    // want to touch the current table content if the loaded data is invalid.
+    // The keys are evenly distributed and thus the shards are pre-sized
+    // with some slack for the deviation from the average.
+    auto tmp                = std::make_unique<shards_t>();
+    const auto cnt_per_shrd = hdr.cnt_nodes_ / cnt_shards;
+    for (auto& sh : *tmp)
+        sh.fs_nodes_.reserve(cnt_per_shrd + (cnt_per_shrd / 16));
+
+    // The current batch is decoded while the previous one is inserted by
+    // the workers. The workers must be declared after all the data they
+    // use. The destructors of the futures wait for the workers to finish,
+    // if we return earlier or throw because of IO error.
+    const auto cnt_workers = cnt_load_workers(hdr.cnt_nodes_);
+    std::vector<load_batch_t> decode_batch(cnt_workers);
+    std::vector<load_batch_t> insert_batch(cnt_workers);
+    std::vector<uint64_t> num_ranges(cnt_workers, 0);
+    std::vector<err_info_t> errors(cnt_workers);
+    std::vector<std::future<bool>> workers;
+    workers.reserve(cnt_workers);
+
+    bool workers_ok  = true;
+    auto run_workers = [&]
     {
-        fs_node_t fs_node;
-        // Ugly, but needed, and safe. The entry is still not in the map
-        auto& hash = const_cast<fs_node_key_t&>(fs_node.first);
-        reader.read(hash.buff_unsafe(), hash.size());
-        auto res = tmp.insert(fs_node);
-        if (!res.second)
+        for (auto& w : workers)
+            workers_ok = w.get() && workers_ok;
+        workers.clear();
+        if (!workers_ok)
+            return;
+        std::swap(decode_batch, insert_batch);
+        if (cnt_workers == 1)
         {
-            out_err << "Found two times entry with tag " << fs_node.first;
-            return false;
+            // Not worth starting a thread for small tables
+            workers_ok = load_nodes(*tmp, insert_batch[0], num_ranges[0],
+                                    errors[0]);
+            return;
+        }
+        for (uint32_t i = 0; i < cnt_workers; ++i)
+        {
+            workers.push_back(std::async(std::launch::async, [&, i]
+                                         {
+                                             return load_nodes(
+                                                 *tmp, insert_batch[i],
+                                                 num_ranges[i], errors[i]);
+                                         }));
         }
-        auto& rvec = res.first->second;
+    };
+
+    uint64_t cnt_decoded = 0;
+    for (decltype(hdr.cnt_nodes_) i = 0; i < hdr.cnt_nodes_; ++i)
+    {
+        fs_node_key_t key;
+        reader.read(key.buff_unsafe(), key.size());
+        range_vector rvec;
         if (!rvec.load(reader))
         {
-            out_err << "Invalid range_vector for entry with tag "
-                    << fs_node.first;
+            out_err << "Invalid range_vector for entry with tag " << key;
             return false;
         }
-        const auto cnt_before = rvec.size();
-        if (cnt_before > 1)
-            num_ranges += cnt_before; // Don't count in-place range_elements
-        // Unfortunately we need to reset the meta here, because we
-        // could have saved the metadata with some temporary bits/bytes set.
-        // We trade some startup time for smaller memory consumption on runtime
-        // using some bytes from the range_elem metadata for temporary data.
-        for (auto it = rvec.begin(); it != rvec.end();)
+        decode_batch[load_worker_idx(key, cnt_workers)].emplace_back(
+            key, std::move(rvec));
+        if (++cnt_decoded == load_batch_size)
         {
-            if (!it->in_memory())
+            run_workers();
+            if (!workers_ok)
+                break;
+            cnt_decoded = 0;
+        }
+    }
+    if (workers_ok)
+        run_workers(); // Process the last, not full, batch
+    for (auto& w : workers)
+        workers_ok = w.get() && workers_ok;
+    if (!workers_ok)
+    {
+        for (const auto& err : errors)
+        {
+            if (err.size() > 0)
             {
-                rv_elem_reset_meta(it);
-                ++it;
+                out_err << string_view_t(err.data(), err.size());
+                break;
             }
-            else // This entry hasn't been committed to the disk. Remove it
-                it = rvec.rem_range(it);
         }
-        const auto cnt_now = rvec.size();
-        // Correct the num_ranges with the removed ranges count
-        num_ranges -= calc_dec_cnt_ranges(cnt_before, cnt_before - cnt_now);
-        if (cnt_now == 0)
-            tmp.erase(res.first); // We don't keep empty entries
+        return false;
     }
-    if (hdr.cnt_ranges_ != num_ranges)
+
+    const uint64_t sum_ranges =
+        std::accumulate(num_ranges.begin(), num_ranges.end(), uint64_t{0});
+    if (hdr.cnt_ranges_ != sum_ranges)
     {
         out_err << "Invalid value for the ranges count: " << hdr.cnt_ranges_
-                << ". Loaded ranges: " << num_ranges;
+                << ". Loaded ranges: " << sum_ranges;
         return false;
     }
     // Read the footer magic
@@ -153,31 +259,50 @@ bool fs_table::load(disk_reader& reader, err_info_t& out_err)
     }
 
     // Everything seems correct. We can populate the member values.
-    cnt_ranges_        = hdr.cnt_ranges_;
-    cnt_entries_       = hdr.cnt_entries_;
-    entries_data_size_ = hdr.entries_data_size_;
-    tmp.swap(fs_nodes_);
+    // The entries counters are recalculated per shard during the load.
+    // They can differ from the saved ones only if we have skipped some
+    // not committed entries above.
+    uint64_t num_nodes = 0;
+    for (uint32_t i = 0; i < cnt_shards; ++i)
+    {
+        num_nodes += (*tmp)[i].fs_nodes_.size();
+        shards_[i].move_from((*tmp)[i]);
+    }
+    data_size_.store(data_size(num_nodes, sum_ranges),
+                     std::memory_order_relaxed);
 
     return true;
 }
 
 void fs_table::save(memory_writer& writer) const noexcept
 {
-    disk_hdr hdr           = {};
-    hdr.magic_             = disk_hdr::magic;
-    hdr.cnt_nodes_         = fs_nodes_.size();
-    hdr.cnt_ranges_        = cnt_ranges_;
-    hdr.cnt_entries_       = cnt_entries_;
-    hdr.table_data_size_   = data_size(hdr.cnt_nodes_, hdr.cnt_ranges_);
-    hdr.entries_data_size_ = entries_data_size_;
+    // Lock all shards, always in the same order, to get consistent snapshot
+    // of the whole table. The format on the disk doesn't depend on the
+    // shards. The nodes are just written one after another.
+    for (const auto& sh : shards_)
+        sh.mutex_.lock_shared();
+
+    disk_hdr hdr = {};
+    hdr.magic_   = disk_hdr::magic;
+    for (const auto& sh : shards_)
+    {
+        hdr.cnt_nodes_ += sh.fs_nodes_.size();
+        hdr.cnt_ranges_ += sh.cnt_ranges_;
+        hdr.cnt_entries_ += sh.cnt_entries_;
+        hdr.entries_data_size_ += sh.entries_data_size_;
+    }
+    hdr.table_data_size_ = data_size(hdr.cnt_nodes_, hdr.cnt_ranges_);
 
     writer.write(&hdr, sizeof(hdr));
 
     const auto pos1 = writer.written();
-    for (const auto& i : fs_nodes_)
+    for (const auto& sh : shards_)
     {
-        writer.write(i.first.data(), i.first.size());
-        i.second.save(writer);
+        for (const auto& i : sh.fs_nodes_)
+        {
+            writer.write(i.first.data(), i.first.size());
+            i.second.save(writer);
+        }
     }
     const auto pos2 = writer.written();
     X3ME_ENFORCE((pos2 - pos1) == hdr.table_data_size_,
@@ -185,13 +310,16 @@ void fs_table::save(memory_writer& writer) const noexcept
 
     // Write the footer magic
     writer.write(&hdr.magic_, sizeof(hdr.magic_));
+
+    for (const auto& sh : shards_)
+        sh.mutex_.unlock_shared();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bytes64_t fs_table::size_on_disk() const noexcept
 {
-    return full_size(data_size(fs_nodes_.size(), cnt_ranges_));
+    return full_size(data_size_.load(std::memory_order_relaxed));
 }
 
 bytes64_t fs_table::max_size_on_disk() const noexcept
@@ -199,9 +327,50 @@ bytes64_t fs_table::max_size_on_disk() const noexcept
     return full_size(max_allowed_data_size_);
 }
 
+bytes64_t fs_table::entries_data_size() const noexcept
+{
+    bytes64_t ret = 0;
+    for_each_shard([&ret](const shard& sh)
+                   {
+                       ret += sh.entries_data_size_;
+                   });
+    return ret;
+}
+
+uint64_t fs_table::cnt_entries() const noexcept
+{
+    uint64_t ret = 0;
+    for_each_shard([&ret](const shard& sh)
+                   {
+                       ret += sh.cnt_entries_;
+                   });
+    return ret;
+}
+
+uint64_t fs_table::cnt_fs_nodes() const noexcept
+{
+    uint64_t ret = 0;
+    for_each_shard([&ret](const shard& sh)
+                   {
+                       ret += sh.fs_nodes_.size();
+                   });
+    return ret;
+}
+
+uint64_t fs_table::cnt_ranges() const noexcept
+{
+    uint64_t ret = 0;
+    for_each_shard([&ret](const shard& sh)
+                   {
+                       ret += sh.cnt_ranges_;
+                   });
+    return ret;
+}
+
 bool fs_table::limit_reached() const noexcept
 {
-    return !(data_size(fs_nodes_.size(), cnt_ranges_) < max_allowed_data_size_);
+    return !(data_size_.load(std::memory_order_relaxed) <
+             max_allowed_data_size_);
 }
 
 bool fs_table::load(disk_reader& reader, disk_hdr& hdr, err_info_t& out_err)
@@ -248,31 +417,97 @@ bytes64_t fs_table::max_full_size(bytes64_t disk_space,
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void fs_table::on_inc_entries(const range_elem& rng) noexcept
+uint32_t fs_table::cnt_load_workers(uint64_t cnt_nodes) noexcept
 {
-    cnt_entries_ += 1;
-    entries_data_size_ += rng.rng_size();
+    if (cnt_nodes < load_batch_size)
+        return 1;
+    // The workers are mostly limited by the memory accesses on insert.
+    // More than few of them doesn't speed up the load.
+    constexpr uint32_t max_workers = 8;
+    const uint32_t hw_threads      = std::thread::hardware_concurrency();
+    return std::min(std::max(hw_threads, 1U), max_workers);
 }
 
-void fs_table::on_dec_entries(uint64_t cnt_removed, bytes64_t rem_size) noexcept
+uint32_t fs_table::load_worker_idx(const fs_node_key_t& key,
+                                   uint32_t cnt_workers) noexcept
 {
-    cnt_entries_ -= cnt_removed;
-    entries_data_size_ -= rem_size;
+    return (key.data()[0] & (cnt_shards - 1)) % cnt_workers;
 }
 
-void fs_table::on_dec_entries(const range_elem& rng) noexcept
+bool fs_table::load_nodes(shards_t& shards,
+                          load_batch_t& nodes,
+                          uint64_t& num_ranges,
+                          err_info_t& out_err) noexcept
 {
-    on_dec_entries(1, rng.rng_size());
+    for (auto& node : nodes)
+    {
+        auto& sh = shards[node.first.data()[0] & (cnt_shards - 1)];
+        auto res = sh.fs_nodes_.insert(std::move(node));
+        if (!res.second)
+        {
+            out_err << "Found two times entry with tag " << node.first;
+            return false;
+        }
+        auto& rvec            = res.first->second;
+        const auto cnt_before = rvec.size();
+        if (cnt_before > 1)
+            num_ranges += cnt_before; // Don't count in-place range_elements
+        uint64_t sh_cnt_ranges = (cnt_before > 1) ? cnt_before : 0;
+        // Unfortunately we need to reset the meta here, because we
+        // could have saved the metadata with some temporary bits/bytes set.
+        // We trade some startup time for smaller memory consumption on runtime
+        // using some bytes from the range_elem metadata for temporary data.
+        for (auto it = rvec.begin(); it != rvec.end();)
+        {
+            if (!it->in_memory())
+            {
+                rv_elem_reset_meta(it);
+                ++it;
+            }
+            else // This entry hasn't been committed to the disk. Remove it
+                it = rvec.rem_range(it);
+        }
+        const auto cnt_now = rvec.size();
+        // Correct the num_ranges with the removed ranges count
+        const auto dec = calc_dec_cnt_ranges(cnt_before, cnt_before - cnt_now);
+        num_ranges -= dec;
+        sh_cnt_ranges -= dec;
+        if (cnt_now == 0)
+        {
+            sh.fs_nodes_.erase(res.first); // We don't keep empty entries
+            continue;
+        }
+        sh.cnt_ranges_ += sh_cnt_ranges;
+        sh.cnt_entries_ += cnt_now;
+        sh.entries_data_size_ +=
+            std::accumulate(rvec.begin(), rvec.end(), bytes64_t{0},
+                            [](bytes64_t sum, const range_elem& rng)
+                            {
+                                return sum + rng.rng_size();
+                            });
+    }
+    nodes.clear();
+    return true;
 }
 
-void fs_table::on_dec_entries(const range_vector::iter_range& rngs) noexcept
+////////////////////////////////////////////////////////////////////////////////
+
+bool fs_table::try_reserve_data(bytes64_t size) noexcept
 {
-    const auto size = std::accumulate(rngs.begin(), rngs.end(), bytes64_t{0},
-                                      [](bytes64_t sum, const range_elem& rng)
-                                      {
-                                          return sum + rng.rng_size();
-                                      });
-    on_dec_entries(rngs.size(), size);
+    auto curr = data_size_.load(std::memory_order_relaxed);
+    do
+    {
+        if ((curr + size) > max_allowed_data_size_)
+            return false;
+    } while (!data_size_.compare_exchange_weak(curr, curr + size,
+                                               std::memory_order_relaxed));
+    return true;
+}
+
+void fs_table::release_data(bytes64_t size) noexcept
+{
+    const auto prev = data_size_.fetch_sub(size, std::memory_order_relaxed);
+    X3ME_ENFORCE(prev >= size, "Wrong logic for the data size reservations");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -330,8 +565,8 @@ uint32_t fs_table::calc_dec_cnt_ranges(uint32_t rv_size, uint32_t dec) noexcept
 
 std::ostream& operator<<(std::ostream& os, const fs_table& rhs) noexcept
 {
-    const auto size_fnos = rhs.fs_nodes_.size() * sizeof(fs_table::fs_node_t);
-    const auto size_rngs = rhs.cnt_ranges_ * sizeof(range_elem);
+    const auto size_fnos = rhs.cnt_fs_nodes() * sizeof(fs_table::fs_node_t);
+    const auto size_rngs = rhs.cnt_ranges() * sizeof(range_elem);
     // clang-format off
     return os << "{max_allowed_bytes: " << rhs.max_allowed_data_size_
               << ", bytes_fs_nodes: " << size_fnos
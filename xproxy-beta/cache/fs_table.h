@@ -1,7 +1,8 @@
 #pragma once
 
-#include "range_vector.h"
+#include "flat_hash_map.h"
 #include "fs_node_key.h"
+#include "range_vector.h"
 
 namespace cache
 {
@@ -26,37 +27,81 @@ public:
         bytes64_t entries_data_size_; // The size of all entries data
     };
 
+    // The table is split into shards by the first byte of the fs_node_key.
+    // Every shard has its own lock and thus operations on different keys
+    // mostly don't contend with each other. The key is an MD5 hash, so its
+    // bytes are evenly distributed and the shards get equally loaded.
+    static constexpr uint32_t cnt_shards = 64;
+    static_assert((cnt_shards & (cnt_shards - 1)) == 0,
+                  "Must be power of 2. We use it as a mask");
+
 private:
     struct fs_node_hash
     {
-        size_t operator()(const fs_node_key_t& v) const noexcept;
+        uint64_t operator()(const fs_node_key_t& v) const noexcept;
     };
     using fs_nodes_t =
-        google::sparse_hash_map<fs_node_key_t, range_vector, fs_node_hash>;
+        flat_hash_map<fs_node_key_t, range_vector, fs_node_hash>;
     using fs_node_t = fs_nodes_t::value_type;
     static_assert(sizeof(fs_node_t) ==
                       (sizeof(fs_node_key_t) + sizeof(range_vector)),
                   "");
 
-    const bytes64_t max_allowed_data_size_;
-
     static_assert(range_vector::has_sbo(),
                   "Currently we don't count the "
                   "in-place ranges in the below "
                   "counter. We rely on the SBO here.");
-    // Doesn't include ranges from single element range vectors
-    uint64_t cnt_ranges_ = 0;
-    // An entry is a unique pair of fs_node + range_elem.
-    uint64_t cnt_entries_ = 0;
-    // The sum size of all entries data
-    bytes64_t entries_data_size_ = 0;
+    // Aligned to a cache line to avoid false sharing between the locks
+    // of the neighbour shards.
+    struct alignas(64) shard
+    {
+        mutable x3me::thread::shared_mutex mutex_;
+        // Doesn't include ranges from single element range vectors
+        uint64_t cnt_ranges_ = 0;
+        // An entry is a unique pair of fs_node + range_elem.
+        uint64_t cnt_entries_ = 0;
+        // The sum size of all entries data
+        bytes64_t entries_data_size_ = 0;
+
+        fs_nodes_t fs_nodes_;
+
+        shard() noexcept;
+        ~shard() noexcept;
+
+        shard(const shard&) = delete;
+        shard& operator=(const shard&) = delete;
+        shard(shard&&) = delete;
+        shard& operator=(shard&&) = delete;
+
+        // The lock is neither copied nor moved. The functions are used only
+        // on initialization when there is no concurrent access to the shards.
+        void copy_from(const shard& rhs) noexcept;
+        void move_from(shard& rhs) noexcept;
+        void clear() noexcept;
+
+        void on_inc_entries(const range_elem& rng) noexcept;
+        void on_dec_entries(uint64_t cnt_removed, bytes64_t rem_size) noexcept;
+        void on_dec_entries(const range_vector::iter_range& rngs) noexcept;
+    };
+    using shards_t = std::array<shard, cnt_shards>;
+
+    const bytes64_t max_allowed_data_size_;
 
-    fs_nodes_t fs_nodes_;
+    // The table data size, as returned by the data_size function, for all
+    // shards. The needed data size is reserved here before an entry gets
+    // added to a given shard. This way we keep the global memory limit
+    // without locking all shards.
+    std::atomic<bytes64_t> data_size_{0};
+
+    shards_t shards_;
 
 public:
     fs_table(bytes64_t avail_disk_space, bytes32_t min_avg_obj_size) noexcept;
     ~fs_table() noexcept;
 
+    // The copy, the move, the clean_init and the load functionality is not
+    // thread safe. They are supposed to be used only on initialization.
+    // All other functions are thread safe.
     fs_table(const fs_table& rhs) noexcept;
 
     fs_table(fs_table&& rhs) noexcept;
@@ -93,6 +138,12 @@ public:
     optional_t<uint32_t> rem_entries(const fs_node_key_t& key,
                                      Remover&& rem) noexcept;
 
+    // Removes all range elements, for all keys, for which the given
+    // predicate returns true. It's slow because it walks the whole table.
+    // Returns the count of the removed range elements.
+    template <typename Pred>
+    uint64_t rem_entries_if(Pred&& pred) noexcept;
+
     template <typename Reader>
     bool read_entries(const fs_node_key_t& key, Reader&& rdr) const noexcept;
 
@@ -109,10 +160,12 @@ public:
     {
         return max_allowed_data_size_;
     }
-    auto entries_data_size() const noexcept { return entries_data_size_; }
-    auto cnt_entries() const noexcept { return cnt_entries_; }
-    auto cnt_fs_nodes() const noexcept { return fs_nodes_.size(); }
-    auto cnt_ranges() const noexcept { return cnt_ranges_; }
+    // The stats are summed over all shards and thus they are not an atomic
+    // snapshot of the table, if there are concurrent modifications.
+    bytes64_t entries_data_size() const noexcept;
+    uint64_t cnt_entries() const noexcept;
+    uint64_t cnt_fs_nodes() const noexcept;
+    uint64_t cnt_ranges() const noexcept;
 
     bool limit_reached() const noexcept;
 
@@ -125,14 +178,39 @@ public:
                                    bytes32_t min_object_size) noexcept;
 
 private:
-    void on_inc_entries(const range_elem& rng) noexcept;
-    void on_dec_entries(uint64_t cnt_removed, bytes64_t rem_size) noexcept;
-    void on_dec_entries(const range_elem& rng) noexcept;
-    void on_dec_entries(const range_vector::iter_range& rngs) noexcept;
+    shard& get_shard(const fs_node_key_t& key) noexcept
+    {
+        return shards_[key.data()[0] & (cnt_shards - 1)];
+    }
+    const shard& get_shard(const fs_node_key_t& key) const noexcept
+    {
+        return shards_[key.data()[0] & (cnt_shards - 1)];
+    }
+
+    template <typename Fn>
+    void for_each_shard(Fn&& fn) const noexcept;
+
+    // Returns false if the reservation would exceed the allowed data size.
+    bool try_reserve_data(bytes64_t size) noexcept;
+    void release_data(bytes64_t size) noexcept;
 
     static bytes64_t max_data_size(bytes64_t disk_space,
                                    bytes32_t min_object_size) noexcept;
 
+    // The fs_nodes are read and decoded one after another, because their
+    // size on the disk varies, but they are inserted in the table by several
+    // workers in parallel. Every worker owns a fixed subset of the shards
+    // and thus the workers don't need locking.
+    using load_batch_t = std::vector<fs_node_t>;
+    static uint32_t cnt_load_workers(uint64_t cnt_nodes) noexcept;
+    static uint32_t load_worker_idx(const fs_node_key_t& key,
+                                    uint32_t cnt_workers) noexcept;
+    // Returns false if the nodes are invalid.
+    static bool load_nodes(shards_t& shards,
+                           load_batch_t& nodes,
+                           uint64_t& num_ranges,
+                           err_info_t& out_err) noexcept;
+
     // The entries are always added one by one, but several entries could be
     // removed at once.
     static uint32_t calc_inc_cnt_ranges(uint32_t rv_size) noexcept;
@@ -154,18 +232,20 @@ fs_table::add_res fs_table::add_entry(const fs_node_key_t& key,
                                       const range_elem& rng,
                                       OverwriteCond&& overwrite) noexcept
 {
-    auto key_it = fs_nodes_.find(key);
+    auto& sh = get_shard(key);
+    std::lock_guard<x3me::thread::shared_mutex> _(sh.mutex_);
 
-    if (key_it == fs_nodes_.end())
-    {
-        if (data_size(fs_nodes_.size() + 1, cnt_ranges_) >
-            max_allowed_data_size_)
-            return add_res::limit_reached;
+    auto key_it = sh.fs_nodes_.find(key);
 
+    if (key_it == sh.fs_nodes_.end())
+    {
         // We don't count the inplace range_elements.
         // Thus we don't increase the cnt_ranges_ here.
-        fs_nodes_.insert(fs_node_t(key, range_vector(rng)));
-        on_inc_entries(rng);
+        if (!try_reserve_data(data_size(1, 0)))
+            return add_res::limit_reached;
+
+        sh.fs_nodes_.insert(fs_node_t(key, range_vector(rng)));
+        sh.on_inc_entries(rng);
         return add_res::added;
     }
 
@@ -176,29 +256,29 @@ fs_table::add_res fs_table::add_entry(const fs_node_key_t& key,
     if (rngs.empty())
     {
         const auto inc = calc_inc_cnt_ranges(rvec.size());
-        if (data_size(fs_nodes_.size(), cnt_ranges_ + inc) >
-            max_allowed_data_size_)
+        if (!try_reserve_data(data_size(0, inc)))
             return add_res::limit_reached;
 
         // If this fail the limit of the vector has been reached.
         // We'll count it as skipped.
         if (rvec.add_range(rng).second)
         {
-            cnt_ranges_ += inc;
-            on_inc_entries(rng);
+            sh.cnt_ranges_ += inc;
+            sh.on_inc_entries(rng);
             return add_res::added;
         }
+        release_data(data_size(0, inc));
     }
     else if (overwrite(rngs, rng))
     {
         const auto cnt_before = rvec.size();
-        on_dec_entries(rngs);
+        sh.on_dec_entries(rngs);
         rvec.rem_range(rngs);
         const auto cnt_now = rvec.size();
 
         const auto dec = calc_dec_cnt_ranges(cnt_before, cnt_before - cnt_now);
-        X3ME_ENFORCE(cnt_ranges_ >= dec, "Wrong logic for ranges counting");
-        cnt_ranges_ -= dec;
+        X3ME_ENFORCE(sh.cnt_ranges_ >= dec, "Wrong logic for ranges counting");
+        sh.cnt_ranges_ -= dec;
 
         const auto inc = calc_inc_cnt_ranges(cnt_now);
         X3ME_ENFORCE(dec >= inc, "Wrong logic for inc/dec calculations");
@@ -206,8 +286,9 @@ fs_table::add_res fs_table::add_entry(const fs_node_key_t& key,
         const auto r = rvec.add_range(rng).second;
         X3ME_ASSERT(r,
                     "Insert must succeed. Overlapped ranges has been removed");
-        cnt_ranges_ += inc;
-        on_inc_entries(rng);
+        sh.cnt_ranges_ += inc;
+        sh.on_inc_entries(rng);
+        release_data(data_size(0, dec - inc));
         return add_res::overwrote;
     }
     return add_res::skipped;
@@ -219,8 +300,11 @@ optional_t<uint32_t> fs_table::rem_entries(const fs_node_key_t& key,
 {
     optional_t<uint32_t> ret;
 
-    auto it = fs_nodes_.find(key);
-    if (it == fs_nodes_.end())
+    auto& sh = get_shard(key);
+    std::lock_guard<x3me::thread::shared_mutex> _(sh.mutex_);
+
+    auto it = sh.fs_nodes_.find(key);
+    if (it == sh.fs_nodes_.end())
         return ret;
 
     auto& rvec            = it->second;
@@ -230,24 +314,82 @@ optional_t<uint32_t> fs_table::rem_entries(const fs_node_key_t& key,
 
     const auto cnt_removed = cnt_before - rvec.size();
     const auto dec = calc_dec_cnt_ranges(cnt_before, cnt_removed);
-    X3ME_ENFORCE(cnt_ranges_ >= dec, "Wrong logic for ranges counting");
-    cnt_ranges_ -= dec;
+    X3ME_ENFORCE(sh.cnt_ranges_ >= dec, "Wrong logic for ranges counting");
+    sh.cnt_ranges_ -= dec;
 
-    on_dec_entries(cnt_removed, rem_size);
+    sh.on_dec_entries(cnt_removed, rem_size);
 
+    uint64_t cnt_rem_nodes = 0;
     if (cnt_removed == cnt_before)
-        fs_nodes_.erase(it); // All elements has been removed
+    {
+        sh.fs_nodes_.erase(it); // All elements has been removed
+        cnt_rem_nodes = 1;
+    }
+    release_data(data_size(cnt_rem_nodes, dec));
 
     ret = cnt_removed;
     return ret;
 }
 
+template <typename Pred>
+uint64_t fs_table::rem_entries_if(Pred&& pred) noexcept
+{
+    uint64_t ret = 0;
+    for (auto& sh : shards_)
+    {
+        std::lock_guard<x3me::thread::shared_mutex> _(sh.mutex_);
+        // The erase operation of the flat_hash_map doesn't invalidate
+        // the iterators and thus we can erase while iterating.
+        for (auto it = sh.fs_nodes_.begin(); it != sh.fs_nodes_.end(); ++it)
+        {
+            auto& rvec            = it->second;
+            const auto cnt_before = rvec.size();
+
+            bytes64_t rem_size = 0;
+            for (auto rit = rvec.cbegin(); rit != rvec.cend();)
+            {
+                if (pred(*rit))
+                {
+                    rem_size += rit->rng_size();
+                    rit = rvec.rem_range(rit);
+                }
+                else
+                    ++rit;
+            }
+
+            const auto cnt_removed = cnt_before - rvec.size();
+            if (cnt_removed == 0)
+                continue;
+            const auto dec = calc_dec_cnt_ranges(cnt_before, cnt_removed);
+            X3ME_ENFORCE(sh.cnt_ranges_ >= dec,
+                         "Wrong logic for ranges counting");
+            sh.cnt_ranges_ -= dec;
+
+            sh.on_dec_entries(cnt_removed, rem_size);
+
+            uint64_t cnt_rem_nodes = 0;
+            if (cnt_removed == cnt_before)
+            {
+                sh.fs_nodes_.erase(it); // All elements has been removed
+                cnt_rem_nodes = 1;
+            }
+            release_data(data_size(cnt_rem_nodes, dec));
+
+            ret += cnt_removed;
+        }
+    }
+    return ret;
+}
+
 template <typename Reader>
 bool fs_table::read_entries(const fs_node_key_t& key, Reader&& rdr) const
     noexcept
 {
-    auto it = fs_nodes_.find(key);
-    if (it == fs_nodes_.end())
+    const auto& sh = get_shard(key);
+    x3me::thread::shared_lock _(sh.mutex_);
+
+    auto it = sh.fs_nodes_.find(key);
+    if (it == sh.fs_nodes_.end())
         return false;
 
     const auto& rvec = it->second;
@@ -260,8 +402,13 @@ bool fs_table::read_entries(const fs_node_key_t& key, Reader&& rdr) const
 template <typename Modifier>
 bool fs_table::modify_entries(const fs_node_key_t& key, Modifier&& mod) noexcept
 {
-    auto it = fs_nodes_.find(key);
-    if (it == fs_nodes_.end())
+    // The modifications of the range elements metadata are not atomic and
+    // thus they can't run concurrently with the readers of the same shard.
+    auto& sh = get_shard(key);
+    std::lock_guard<x3me::thread::shared_mutex> _(sh.mutex_);
+
+    auto it = sh.fs_nodes_.find(key);
+    if (it == sh.fs_nodes_.end())
         return false;
 
     const auto& rvec = it->second;
@@ -271,5 +418,15 @@ bool fs_table::modify_entries(const fs_node_key_t& key, Modifier&& mod) noexcept
     return true;
 }
 
+template <typename Fn>
+void fs_table::for_each_shard(Fn&& fn) const noexcept
+{
+    for (const auto& sh : shards_)
+    {
+        x3me::thread::shared_lock _(sh.mutex_);
+        fn(sh);
+    }
+}
+
 } // namespace detail
 } // namespace cache
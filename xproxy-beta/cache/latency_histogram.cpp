@@ -0,0 +1,90 @@
+#include "precompiled.h"
+#include "latency_histogram.h"
+
+namespace cache
+{
+
+uint32_t latency_hist::bucket_idx(uint64_t us) noexcept
+{
+    if (us < cnt_sub)
+        return us;
+    us = std::min(us, max_us);
+    const uint32_t msb   = 63 - __builtin_clzll(us);
+    const uint32_t shift = msb - sub_bits;
+    return ((shift + 1) * cnt_sub) + ((us >> shift) & (cnt_sub - 1));
+}
+
+uint64_t latency_hist::bucket_upper(uint32_t idx) noexcept
+{
+    X3ME_ASSERT(idx < cnt_buckets, "Invalid bucket index");
+    if (idx < cnt_sub)
+        return idx;
+    const uint32_t shift = (idx / cnt_sub) - 1;
+    const uint64_t lower = uint64_t(cnt_sub + (idx % cnt_sub)) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+void latency_hist::merge(const latency_hist& rhs) noexcept
+{
+    for (uint32_t i = 0; i < cnt_buckets; ++i)
+        buckets_[i] += rhs.buckets_[i];
+    cnt_ += rhs.cnt_;
+    sum_us_ += rhs.sum_us_;
+    max_us_ = std::max(max_us_, rhs.max_us_);
+}
+
+uint64_t latency_hist::percentile(double pr) const noexcept
+{
+    X3ME_ASSERT((pr > 0.0) && (pr <= 100.0), "Invalid percentile");
+    if (cnt_ == 0)
+        return 0;
+    const auto target =
+        std::max<uint64_t>(std::ceil(cnt_ * (pr / 100.0)), 1);
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < cnt_buckets; ++i)
+    {
+        sum += buckets_[i];
+        if (sum >= target)
+            return std::min(bucket_upper(i), max_us_);
+    }
+    return max_us_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+namespace detail
+{
+
+latency_recorder::latency_recorder() noexcept
+{
+    for (auto& b : buckets_)
+        b.store(0, std::memory_order_relaxed);
+}
+
+void latency_recorder::record(uint64_t us) noexcept
+{
+    buckets_[latency_hist::bucket_idx(us)].fetch_add(
+        1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+    auto curr = max_us_.load(std::memory_order_relaxed);
+    while ((curr < us) && !max_us_.compare_exchange_weak(
+                              curr, us, std::memory_order_relaxed))
+    {
+    }
+}
+
+void latency_recorder::get_stats(latency_hist& h) const noexcept
+{
+    // The count is taken from the buckets, so that the percentiles
+    // are calculated over consistent data.
+    for (uint32_t i = 0; i < latency_hist::cnt_buckets; ++i)
+    {
+        const auto v = buckets_[i].load(std::memory_order_relaxed);
+        h.buckets_[i] += v;
+        h.cnt_ += v;
+    }
+    h.sum_us_ += sum_us_.load(std::memory_order_relaxed);
+    h.max_us_ = std::max(h.max_us_, max_us_.load(std::memory_order_relaxed));
+}
+
+} // namespace detail
+} // namespace cache
@@ -0,0 +1,65 @@
+#pragma once
+
+namespace cache
+{
+
+// Log-linear histogram of latencies in microseconds. Every power of two
+// is split into 8 linear sub-buckets, so that the relative error of the
+// reported percentiles is at most 12.5% and the histogram stays small.
+// Values bigger than the max tracked one go to the last bucket.
+// The snapshots of different histograms can be merged by adding them.
+struct latency_hist
+{
+    static constexpr uint32_t sub_bits = 3;
+    static constexpr uint32_t cnt_sub  = 1U << sub_bits;
+    // About 134 seconds
+    static constexpr uint32_t max_bits = 27;
+    static constexpr uint64_t max_us   = (1ULL << max_bits) - 1;
+    static constexpr uint32_t cnt_buckets =
+        (max_bits - sub_bits + 1) * cnt_sub;
+
+    std::array<uint64_t, cnt_buckets> buckets_{};
+    uint64_t cnt_    = 0;
+    uint64_t sum_us_ = 0;
+    uint64_t max_us_ = 0;
+
+    static uint32_t bucket_idx(uint64_t us) noexcept;
+    // The max value which falls in the given bucket
+    static uint64_t bucket_upper(uint32_t idx) noexcept;
+
+    void merge(const latency_hist& rhs) noexcept;
+
+    // The percentile must be in (0, 100]. Returns the upper bound
+    // of the bucket containing the given percentile, limited to the max
+    // recorded value. Returns 0 for an empty histogram.
+    uint64_t percentile(double pr) const noexcept;
+};
+
+namespace detail
+{
+
+// Records latencies from many threads without locking.
+// Every bucket is a separate relaxed atomic counter. Thus a snapshot taken
+// while recording is in progress may not be exact, which is fine for stats.
+class latency_recorder
+{
+    std::array<std::atomic<uint64_t>, latency_hist::cnt_buckets> buckets_;
+    std::atomic<uint64_t> sum_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+
+public:
+    latency_recorder() noexcept;
+
+    latency_recorder(const latency_recorder&) = delete;
+    latency_recorder& operator=(const latency_recorder&) = delete;
+    latency_recorder(latency_recorder&&) = delete;
+    latency_recorder& operator=(latency_recorder&&) = delete;
+
+    void record(uint64_t us) noexcept;
+
+    // Adds the recorded values to the given histogram.
+    void get_stats(latency_hist& h) const noexcept;
+};
+
+} // namespace detail
+} // namespace cache
@@ -42,6 +42,8 @@ public:
         ::memcpy(buf, buf_ + buf_offs_, len);
         buf_offs_ += len;
     }
+
+    bytes64_t remaining() const noexcept { return buf_size_ - buf_offs_; }
 };
 
 } // namespace detail
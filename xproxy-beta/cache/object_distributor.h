@@ -13,7 +13,9 @@ struct object_distributor
     virtual detail::object_ohandle_ptr_t async_open_read(
         const cache_key&, bytes64_t, detail::open_rhandler_t&&) noexcept = 0;
 
-    virtual detail::object_ohandle_ptr_t
+    // Returns the error if the operation can't be started. The handler is
+    // not called and is left untouched in this case.
+    virtual expected_t<detail::object_ohandle_ptr_t, err_code_t>
     async_open_write(const cache_key&,
                      bool truncate_object,
                      detail::open_whandler_t&&) noexcept = 0;
@@ -9,31 +9,39 @@ namespace cache
 namespace detail
 {
 
-static object_frag_hdr frag_hdr(const aligned_data_ptr_t& buf) noexcept
+static object_frag_hdr frag_hdr(const uint8_t* buf) noexcept
 {
     static_assert(std::is_trivial<object_frag_hdr>::value,
                   "Needs to be trivial for the memcpy");
     object_frag_hdr hdr;
-    ::memcpy(&hdr, buf.get(), sizeof(hdr));
+    ::memcpy(&hdr, buf, sizeof(hdr));
     return hdr;
 }
 
-static const uint8_t* frag_data(const aligned_data_ptr_t& buf) noexcept
+static const uint8_t* frag_data(const uint8_t* buf) noexcept
 {
-    return buf.get() + sizeof(object_frag_hdr);
+    return buf + sizeof(object_frag_hdr);
 }
 
-static void expand_frag_buff_if_needed(aligned_data_ptr_t& buff,
-                                       bytes32_t& cur_size,
-                                       bytes32_t new_size) noexcept
+static void prepare_frag_buff(aligned_data_ref_t& buff,
+                              bytes32_t& cur_size,
+                              bytes32_t new_size) noexcept
 {
     // Once allocated the buffer for the biggest object fragment it won't be
-    // freed if only smaller fragments follow after it.
-    if (new_size > cur_size)
+    // freed if only smaller fragments follow after it. However, we can't
+    // write to the buffer while it's shared with the RAM cache or with
+    // other readers which got it from there.
+    if ((new_size > cur_size) || (buff.use_count() > 1))
     {
-        buff     = alloc_page_aligned(new_size);
+        buff     = alloc_page_aligned_ref(new_size);
         cur_size = new_size;
     }
+    else
+    {
+        // Synchronizes with the release of the buffer by the other owners.
+        // Their reads of the buffer happen before our writes to it.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -44,11 +52,24 @@ void object_read_handle::user_data::set_uh_buffers(read_handler_t&& h,
     uh_buffers_.set(std::move(h), std::move(wb));
 }
 
+void object_read_handle::user_data::set_uh_shared(read_handler_t&& h,
+                                                  shared_data_t& data,
+                                                  bytes32_t max_len) noexcept
+{
+    uh_buffers_.handler_ = std::move(h);
+    uh_buffers_.buffers_.set_shared(data, max_len);
+}
+
 void object_read_handle::user_data::swap_uh_buffers(uh_buffers_t& rhs) noexcept
 {
     uh_buffers_.swap(rhs);
 }
 
+bool object_read_handle::user_data::has_uh_buffers() const noexcept
+{
+    return !uh_buffers_.empty();
+}
+
 void object_read_handle::user_data::set_close_handler(
     close_handler_ptr_t&& h) noexcept
 {
@@ -77,6 +98,8 @@ object_read_handle::~object_read_handle()
 {
     XLOG_DEBUG(disk_tag, "Object_read_handle {} destroyed. RTrans {}",
                log_ptr(this), rtrans_);
+    // The read-ahead fragments may remain if the service has been stopped
+    drop_read_ahead();
     X3ME_ASSERT(!rtrans_.valid() || (state_.load(std::memory_order_acquire) ==
                                      state::service_stopped),
                 "The read transaction must have been finalized unless the "
@@ -88,7 +111,35 @@ void object_read_handle::async_read(buffers&& bufs, read_handler_t&& h) noexcept
     XLOG_DEBUG(disk_tag, "Object_read_handle {}. Async_read. Obj_key {}",
                log_ptr(this), rtrans_.obj_key());
     user_data_->set_uh_buffers(std::move(h), std::move(bufs));
-    fs_ops_->aios_push_read_queue(this);
+    enqueue_user_read();
+}
+
+void object_read_handle::async_read(shared_data_t& data,
+                                    bytes32_t max_len,
+                                    read_handler_t&& h) noexcept
+{
+    XLOG_DEBUG(disk_tag,
+               "Object_read_handle {}. Async_read shared. Obj_key {}. "
+               "Max_len {}",
+               log_ptr(this), rtrans_.obj_key(), max_len);
+    X3ME_ASSERT(max_len > 0, "Can't refer to zero bytes");
+    user_data_->set_uh_shared(std::move(h), data, max_len);
+    enqueue_user_read();
+}
+
+void object_read_handle::enqueue_user_read() noexcept
+{
+    // The task may be in the queue already, if it's been enqueued for
+    // read-ahead, or it'll be enqueued when the current read-ahead finishes.
+    if (fs_ops_->rdah_max_frags() == 0)
+        fs_ops_->aios_push_read_queue(this);
+    else
+    {
+        // Pairs with the fences in on_begin_io_op.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!rdah_reading_.load(std::memory_order_relaxed))
+            fs_ops_->aios_enqueue_read_queue(this);
+    }
 }
 
 void object_read_handle::async_close(close_handler_t&& h) noexcept
@@ -180,6 +231,21 @@ non_owner_ptr_t<const aio_data> object_read_handle::on_begin_io_op() noexcept
     {
     case state::running:
     {
+        if (fs_ops_->rdah_max_frags() > 0)
+        {
+            // The next fragments are read ahead only while the user doesn't
+            // wait for us. The fences pair with the one in the async_read.
+            // Either the user sees the flag set and doesn't enqueue the task,
+            // or we see the user buffers here.
+            rdah_reading_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!user_data_->has_uh_buffers() && (ret = begin_read_ahead()))
+                break;
+            rdah_reading_.store(false, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!user_data_->has_uh_buffers())
+                break;
+        }
         while (try_read_all_from_mem_buff() == read_res::end_of_buf)
         {
             const auto r = begin_io_op();
@@ -216,6 +282,13 @@ object_read_handle::begin_io_op_res object_read_handle::begin_io_op() noexcept
 {
     begin_io_op_res ret{nullptr /*skip IO*/, false /*Not in memory*/};
 
+    // Release the previous fragment, so that its buffer can be reused
+    // if it's not shared anymore.
+    curr_frag_.reset();
+
+    if (try_use_read_ahead())
+        return end_mem_read();
+
     // This call returns a valid range or no range at all.
     const auto new_rng = fs_ops_->fsmd_find_next_range_elem(rtrans_);
     if (!new_rng)
@@ -233,7 +306,6 @@ object_read_handle::begin_io_op_res object_read_handle::begin_io_op() noexcept
 
     const auto aligned_size = object_frag_size(new_rng->rng_size());
 
-    expand_frag_buff_if_needed(frag_read_buff_, read_buff_size_, aligned_size);
     curr_rng_ = new_rng.value();
 
     // Even if the entry says it's in_memory the situation is racy and we may
@@ -241,55 +313,135 @@ object_read_handle::begin_io_op_res object_read_handle::begin_io_op() noexcept
     // It could be committed to the disk between the first check here and the
     // second call.
     const bool in_mem = new_rng->in_memory();
-    if (in_mem &&
-        fs_ops_->aggw_try_read_frag(
-            rtrans_.fs_node_key(), new_rng.value(),
-            cache_fs_ops::frag_buff_t{frag_read_buff_.get(), aligned_size}))
+    bool read_mem     = false;
+    if (in_mem)
     {
-        if (!check_read_data())
-        {
-            XLOG_ERROR(disk_tag, "Wrong fragment data after memory read. "
-                                 "Object_read_handle {}. FS '{}'. RTrans {}",
-                       log_ptr(this), fs_ops_->vol_path(), rtrans_);
-            read_handle_done();
-            try_fire_error(cache::corrupted_object_data);
-            try_fire_closed(cache::success);
-            return ret;
-        }
-        // Set this to 0 to catch potential mistakes easily.
-        aio_data_.buf_    = nullptr;
-        aio_data_.offs_   = 0;
-        aio_data_.size_   = 0;
-        ret.try_read_mem_ = true;
-        return ret;
+        prepare_frag_buff(frag_read_buff_, read_buff_size_, aligned_size);
+        const cache_fs_ops::frag_buff_t buff{frag_read_buff_.get(),
+                                             aligned_size};
+        read_mem = fs_ops_->aggw_try_read_frag(rtrans_.fs_node_key(),
+                                               new_rng.value(), buff);
+        if (read_mem)
+            curr_frag_ = frag_read_buff_;
     }
-    else if (!in_mem)
+    else
     {
         fs_ops_->count_mem_miss(); // TODO Temporary for stats only
     }
+    // The hot fragments, already read from the disk, may be in the RAM cache.
+    // Their data is used directly from the cache buffer, without a copy.
+    if (!read_mem)
+    {
+        curr_frag_ = fs_ops_->memc_try_read_frag(rtrans_.fs_node_key(),
+                                                 new_rng.value(), aligned_size);
+        read_mem = !!curr_frag_;
+    }
+    if (read_mem)
+        return end_mem_read();
 
     // We may not need all the data of the last object fragment,
     // but the logic becomes too complicated when we take into account that
     // a whole transaction may lay inside a given range_element and we may
     // need to skip bytes from both ends of the range data.
-    aio_data_.size_ = aligned_size;
+    // The fragments which follow this one on the disk are read with the
+    // same disk operation, if possible.
+    const auto read_size = coalesce_read(new_rng.value());
+    prepare_frag_buff(frag_read_buff_, read_buff_size_, read_size);
+    curr_frag_ = frag_read_buff_;
+    set_coalesced_buffs(frag_read_buff_, aligned_size);
+    aio_data_.size_ = read_size;
     aio_data_.buf_  = frag_read_buff_.get();
     aio_data_.offs_ = new_rng->disk_offset().to_bytes();
 
-    X3ME_ASSERT(
-        !vol_mutex_locked_,
-        "Wrong logic around locking/unlocking of the volume access mutex");
-    vol_mutex_locked_ = fs_ops_->vmtx_lock_shared(aio_data_.offs_);
+    lock_vol_mutex();
 
     XLOG_DEBUG(disk_tag, "Begin disk read. Object_read_handle {}. Disk_offs "
-                         "{}. Size {}. Rng {}. VolMutex locked {}",
+                         "{}. Size {}. Rng {}. Coalesced frags {}. VolMutex "
+                         "locked {}",
                log_ptr(this), aio_data_.offs_, aio_data_.size_, *new_rng,
-               vol_mutex_locked_);
+               cnt_io_frags_, vol_mutex_locked_);
 
     ret.aio_data_ = &aio_data_;
     return ret;
 }
 
+object_read_handle::begin_io_op_res object_read_handle::end_mem_read() noexcept
+{
+    begin_io_op_res ret{nullptr /*skip IO*/, false /*Not in memory*/};
+    if (!check_read_data())
+    {
+        XLOG_ERROR(disk_tag, "Wrong fragment data after memory read. "
+                             "Object_read_handle {}. FS '{}'. RTrans {}",
+                   log_ptr(this), fs_ops_->vol_path(), rtrans_);
+        read_handle_done();
+        try_fire_error(cache::corrupted_object_data);
+        try_fire_closed(cache::success);
+        return ret;
+    }
+    // Set this to 0 to catch potential mistakes easily.
+    aio_data_.buf_    = nullptr;
+    aio_data_.offs_   = 0;
+    aio_data_.size_   = 0;
+    ret.try_read_mem_ = true;
+    return ret;
+}
+
+non_owner_ptr_t<const aio_data> object_read_handle::begin_read_ahead() noexcept
+{
+    static_assert(max_rdah_frags >= read_ahead_cfg::frags_limit,
+                  "The read-ahead config limit doesn't match our storage");
+    // Nothing to read ahead before the user has asked for the first fragment.
+    if (!curr_frag_ || rdah_failed_)
+        return nullptr;
+    const auto max_frags = std::min(fs_ops_->rdah_max_frags(), max_rdah_frags);
+    while (cnt_rdah_frags_ < max_frags)
+    {
+        const auto offs =
+            (cnt_rdah_frags_ > 0)
+                ? rdah_frags_[cnt_rdah_frags_ - 1].rng_.rng_end_offset()
+                : curr_rng_.rng_end_offset();
+        if (offs >= rtrans_.end_offset())
+            return nullptr;
+        // The possible errors are reported when the fragment is needed.
+        // The fragments in the aggregate writer are not read ahead.
+        const auto rng = fs_ops_->fsmd_find_range_elem(rtrans_, offs);
+        if (!rng || rng->in_memory())
+            return nullptr;
+
+        auto& rf = rdah_frags_[cnt_rdah_frags_];
+        const auto size = object_frag_size(rng->rng_size());
+        rf.rng_         = rng.value();
+        rf.data_ = fs_ops_->memc_try_read_frag(rtrans_.fs_node_key(),
+                                               rf.rng_, size);
+        if (rf.data_)
+        {
+            ++cnt_rdah_frags_; // No need of disk read for this one
+            continue;
+        }
+        if (!fs_ops_->rdah_reserve(size))
+            return nullptr;
+        rf.size_      = size;
+        cnt_io_frags_ = 1;
+
+        const auto read_size = coalesce_read(rf.rng_);
+        auto buff            = alloc_page_aligned_ref(read_size);
+        set_coalesced_buffs(buff, 0);
+        aio_data_.size_ = read_size;
+        aio_data_.buf_  = buff.get();
+        aio_data_.offs_ = rng->disk_offset().to_bytes();
+
+        lock_vol_mutex();
+
+        XLOG_DEBUG(disk_tag, "Begin read-ahead. Object_read_handle {}. "
+                             "Disk_offs {}. Size {}. Rng {}. Coalesced frags "
+                             "{}. VolMutex locked {}",
+                   log_ptr(this), aio_data_.offs_, aio_data_.size_, *rng,
+                   cnt_io_frags_, vol_mutex_locked_);
+        return &aio_data_;
+    }
+    return nullptr;
+}
+
 void object_read_handle::on_end_io_op(const err_code_t& err) noexcept
 {
     // Unlock the serializator no matter what happens here
@@ -304,6 +456,12 @@ void object_read_handle::on_end_io_op(const err_code_t& err) noexcept
         vol_mutex_locked_ = false;
     }
 
+    if (rdah_reading_.load(std::memory_order_relaxed))
+    {
+        end_read_ahead(err);
+        return;
+    }
+
     // TODO We can decrease the readers here for the currently read fragment.
     // This can prevent unneeded evacuations.
 
@@ -326,6 +484,12 @@ void object_read_handle::on_end_io_op(const err_code_t& err) noexcept
         try_fire_closed(cache::success);
         return;
     }
+    const auto frag_size = object_frag_size(curr_rng_.rng_size());
+    memc_add_curr_frag(frag_size, (read_buff_size_ > frag_size));
+    // The errors in the coalesced fragments, if any, are handled when they
+    // are read again on demand.
+    if ((cnt_io_frags_ > 0) && !end_coalesced_read(err))
+        rdah_failed_ = true;
 
     if (try_read_all_from_mem_buff() != read_res::end_of_buf)
     { // All read or aborted
@@ -342,6 +506,129 @@ void object_read_handle::on_end_io_op(const err_code_t& err) noexcept
     }
 }
 
+void object_read_handle::end_read_ahead(const err_code_t& err) noexcept
+{
+    if (!end_coalesced_read(err))
+    {
+        // The fragments are read again when needed and the error is handled
+        // then as usual. No more read-ahead for this reader.
+        XLOG_DEBUG(disk_tag, "Read-ahead failed. Object_read_handle {}. "
+                             "Disk_offs {}. Size {}. {}",
+                   log_ptr(this), aio_data_.offs_, aio_data_.size_,
+                   err.message());
+        rdah_failed_ = true;
+    }
+    // The user may have issued a read in the meantime. If not, the task
+    // continues with the next read-ahead, if any.
+    rdah_reading_.store(false, std::memory_order_relaxed);
+    if (state_.load(std::memory_order_acquire) == state::running)
+        fs_ops_->aios_enqueue_read_queue(this);
+}
+
+bytes32_t object_read_handle::coalesce_read(range_elem last) noexcept
+{
+    // The fragments written one after another by the aggregate writer are
+    // adjacent on the disk. They are read with a single disk read, up to
+    // the configured size, and then go to the read-ahead fragments.
+    const auto max_size = fs_ops_->rdah_max_read_size();
+    auto size           = object_frag_size(last.rng_size());
+    for (auto i = cnt_rdah_frags_ + cnt_io_frags_; i < max_rdah_frags; ++i)
+    {
+        const auto offs = last.rng_end_offset();
+        // No metadata lookup if there is no room for another fragment
+        if ((size >= max_size) || (offs >= rtrans_.end_offset()))
+            break;
+        const auto next      = fs_ops_->fsmd_find_range_elem(rtrans_, offs);
+        const auto next_doff = last.disk_offset().to_bytes() +
+                               object_frag_size(last.rng_size());
+        if (!next || next->in_memory() ||
+            (next->disk_offset().to_bytes() != next_doff))
+            break;
+        const auto next_size = object_frag_size(next->rng_size());
+        if (((size + next_size) > max_size) ||
+            !fs_ops_->rdah_reserve(next_size))
+            break;
+        rdah_frags_[i].rng_  = next.value();
+        rdah_frags_[i].size_ = next_size;
+        size += next_size;
+        last = next.value();
+        ++cnt_io_frags_;
+    }
+    return size;
+}
+
+void object_read_handle::set_coalesced_buffs(const aligned_data_ref_t& buff,
+                                             bytes32_t offs) noexcept
+{
+    // The fragments share the ownership of the whole read buffer.
+    // They are copied only if they go to the RAM cache.
+    const bool slice = (offs > 0) || (cnt_io_frags_ > 1);
+    const auto end   = cnt_rdah_frags_ + cnt_io_frags_;
+    for (auto i = cnt_rdah_frags_; i < end; ++i)
+    {
+        auto& rf  = rdah_frags_[i];
+        rf.data_  = aligned_data_ref_t(buff, buff.get() + offs);
+        rf.slice_ = slice;
+        offs += rf.size_;
+    }
+}
+
+bool object_read_handle::end_coalesced_read(const err_code_t& err) noexcept
+{
+    // The fragments after a bad one are dropped too, because the read-ahead
+    // fragments must follow one after another.
+    bool ok        = !err;
+    const auto end = cnt_rdah_frags_ + cnt_io_frags_;
+    for (auto i = cnt_rdah_frags_; i < end; ++i)
+    {
+        auto& rf = rdah_frags_[i];
+        ok       = ok &&
+             (frag_hdr(rf.data_.get()) ==
+              object_frag_hdr::create(rtrans_.fs_node_key(), rf.rng_));
+        if (ok)
+            ++cnt_rdah_frags_;
+        else
+        {
+            fs_ops_->rdah_release(rf.size_, false);
+            rf = rdah_frag{};
+        }
+    }
+    cnt_io_frags_ = 0;
+    return ok;
+}
+
+void object_read_handle::memc_add_curr_frag(bytes32_t size, bool copy) noexcept
+{
+    // The RAM cache takes a reference to the buffer instead of a copy.
+    // However, it accounts only the fragment size. Thus the fragment is
+    // copied if its buffer is bigger, e.g. if it's the buffer of a read of
+    // several fragments adjacent on the disk.
+    if (!copy)
+    {
+        fs_ops_->memc_add_frag(rtrans_.fs_node_key(), curr_rng_, curr_frag_,
+                               size);
+        return;
+    }
+    auto buff = alloc_page_aligned_ref(size);
+    ::memcpy(buff.get(), curr_frag_.get(), size);
+    fs_ops_->memc_add_frag(rtrans_.fs_node_key(), curr_rng_, buff, size);
+}
+
+void object_read_handle::lock_vol_mutex() noexcept
+{
+    X3ME_ASSERT(
+        !vol_mutex_locked_,
+        "Wrong logic around locking/unlocking of the volume access mutex");
+    vol_mutex_locked_ = fs_ops_->vmtx_lock_shared(aio_data_.offs_);
+    // The coalesced read may begin before the currently written disk area
+    // and end inside it.
+    if (!vol_mutex_locked_ && (cnt_io_frags_ > 0))
+    {
+        vol_mutex_locked_ = fs_ops_->vmtx_lock_shared(aio_data_.offs_ +
+                                                      aio_data_.size_ - 1);
+    }
+}
+
 void object_read_handle::service_stopped() noexcept
 {
     // This function can be executed concurrently from two threads, if the
@@ -383,7 +670,7 @@ object_read_handle::calc_copy_rng(const read_transaction& rtrans,
 object_read_handle::read_res
 object_read_handle::try_read_all_from_mem_buff() noexcept
 {
-    if (!frag_read_buff_) // The buffer is lazily allocated i.e. currently empty
+    if (!curr_frag_) // There is no current fragment yet
         return read_res::end_of_buf;
     if (rtrans_.curr_offset() >= curr_rng_.rng_end_offset())
         return read_res::end_of_buf; // Needs to get a new range.
@@ -399,8 +686,10 @@ object_read_handle::try_read_all_from_mem_buff() noexcept
     }
 
     const auto rng    = calc_copy_rng(rtrans_, curr_rng_);
-    const auto copied = ud.buffers_.write(x3me::mem_utils::make_array_view(
-        frag_data(frag_read_buff_) + rng.first, rng.second));
+    const auto copied = ud.buffers_.write(
+        x3me::mem_utils::make_array_view(
+            frag_data(curr_frag_.get()) + rng.first, rng.second),
+        curr_frag_);
     rtrans_.inc_read_bytes(copied);
 
     const auto full = ud.buffers_.all_written();
@@ -427,22 +716,70 @@ object_read_handle::try_read_all_from_mem_buff() noexcept
     ud.handler_(err, ud.buffers_.bytes_written());
     if (fin)
         try_fire_closed(cache::success);
+    else if (cnt_rdah_frags_ < fs_ops_->rdah_max_frags())
+    {
+        // Read the next fragment(s) from the disk while the user sends
+        // the current data.
+        fs_ops_->aios_enqueue_read_queue(this);
+    }
 
     return read_res::all_read;
 }
 
 bool object_read_handle::check_read_data() const noexcept
 {
-    const auto cur_hdr = frag_hdr(frag_read_buff_);
+    const auto cur_hdr = frag_hdr(curr_frag_.get());
     const auto exp_hdr =
         object_frag_hdr::create(rtrans_.fs_node_key(), curr_rng_);
     return cur_hdr == exp_hdr;
 }
 
+bool object_read_handle::try_use_read_ahead() noexcept
+{
+    if (cnt_rdah_frags_ == 0)
+        return false;
+    auto& rf = rdah_frags_[0];
+    if (rf.rng_.rng_offset() != rtrans_.curr_offset())
+    {
+        // Shouldn't happen, because the fragments are read one after another
+        drop_read_ahead();
+        return false;
+    }
+    curr_rng_  = rf.rng_;
+    curr_frag_ = std::move(rf.data_);
+    if (rf.size_ > 0)
+    {
+        fs_ops_->rdah_release(rf.size_, true);
+        // The read-ahead fragments go to the RAM cache when used, the same
+        // way as the fragments read on demand.
+        memc_add_curr_frag(rf.size_, rf.slice_);
+    }
+    std::move(rdah_frags_.begin() + 1, rdah_frags_.begin() + cnt_rdah_frags_,
+              rdah_frags_.begin());
+    rdah_frags_[--cnt_rdah_frags_] = rdah_frag{};
+    return true;
+}
+
+void object_read_handle::drop_read_ahead() noexcept
+{
+    // Drops also the fragments of the last coalesced read, if it failed
+    const auto end = cnt_rdah_frags_ + cnt_io_frags_;
+    for (uint32_t i = 0; i < end; ++i)
+    {
+        auto& rf = rdah_frags_[i];
+        if (rf.size_ > 0)
+            fs_ops_->rdah_release(rf.size_, false);
+        rf = rdah_frag{};
+    }
+    cnt_rdah_frags_ = 0;
+    cnt_io_frags_   = 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void object_read_handle::read_handle_done() noexcept
 {
+    drop_read_ahead();
     fs_ops_->fsmd_end_read(std::move(rtrans_));
     // This ensures that no other operations can be done with this read handle
     state_.store(state::closed, std::memory_order_release);
@@ -38,7 +38,11 @@ class object_read_handle final : public aio_task
 
     public:
         void set_uh_buffers(read_handler_t&& h, buffers&& wb) noexcept;
+        void set_uh_shared(read_handler_t&& h,
+                           shared_data_t& data,
+                           bytes32_t max_len) noexcept;
         void swap_uh_buffers(uh_buffers_t& rhs) noexcept;
+        bool has_uh_buffers() const noexcept;
 
         void set_close_handler(close_handler_ptr_t&& h) noexcept;
         close_handler_ptr_t release_close_handler() noexcept;
@@ -62,8 +66,38 @@ class object_read_handle final : public aio_task
 
     range_elem curr_rng_ = make_zero_range_elem();
 
-    aligned_data_ptr_t frag_read_buff_;
+    // The buffer for the disk reads. It's shared with the RAM cache after
+    // the read and thus it gets reused only if the cache doesn't hold it.
+    aligned_data_ref_t frag_read_buff_;
     bytes32_t read_buff_size_ = 0;
+    // The data of the current fragment. Points either to the above buffer
+    // or to a fragment buffer shared from the RAM cache.
+    aligned_data_ref_t curr_frag_;
+
+    // The fragments following the current one, read from the disk while
+    // the user sends the data of the current one, or read along with the
+    // current one when they are adjacent on the disk. The size is zero for
+    // the fragments shared from the RAM cache, because they don't count
+    // toward the read-ahead memory budget.
+    struct rdah_frag
+    {
+        range_elem rng_ = make_zero_range_elem();
+        aligned_data_ref_t data_;
+        bytes32_t size_ = 0;
+        // The data is part of a buffer read together with other fragments
+        bool slice_ = false;
+    };
+    static constexpr uint32_t max_rdah_frags = 8;
+    std::array<rdah_frag, max_rdah_frags> rdah_frags_;
+    uint32_t cnt_rdah_frags_ = 0;
+    // The fragments read by the current disk read, except the current one.
+    // They follow the read-ahead fragments in the above array.
+    uint32_t cnt_io_frags_ = 0;
+    // Set while a read-ahead disk read is in progress. The user reads don't
+    // enqueue the task during this time, because it's enqueued anyway when
+    // the read-ahead finishes.
+    std::atomic_bool rdah_reading_{false};
+    bool rdah_failed_ = false;
 
     enum struct state : uint16_t // Could be smaller.
     {
@@ -81,9 +115,9 @@ class object_read_handle final : public aio_task
     // otherwise we repost the second task on the queue again.
     // Maybe in the future we'll add something similar to the ASIO strands
     // to the cache::aio_service functionality and this way we'll be able
-    // to serialize single read_handle. I can't add it now because it needs
-    // some scheduling logic because simple round robin for the read_handles
-    // won't work well.
+    // to serialize single read_handle. The aio_task_queue already schedules
+    // the read handles round robin inside the interactive class, but it
+    // doesn't prevent two threads from working on the same handle.
     x3me::thread::spin_lock serializator_;
 
     bool vol_mutex_locked_ = false;
@@ -95,6 +129,11 @@ public:
 
     // The async_read and async_close must be used from single thread only
     void async_read(buffers&& bufs, read_handler_t&& h) noexcept;
+    // Gives a reference to the data of the current object fragment instead
+    // of copying it. The reference is to at most the max_len bytes.
+    void async_read(shared_data_t& data,
+                    bytes32_t max_len,
+                    read_handler_t&& h) noexcept;
 
     void async_close(close_handler_t&& h) noexcept;
 
@@ -105,6 +144,8 @@ public:
 private:
     aio_op operation() const noexcept final { return aio_op::read; }
 
+    void enqueue_user_read() noexcept;
+
     void exec() noexcept final;
 
     non_owner_ptr_t<const aio_data> on_begin_io_op() noexcept final;
@@ -115,8 +156,17 @@ private:
         bool try_read_mem_;
     };
     begin_io_op_res begin_io_op() noexcept;
+    begin_io_op_res end_mem_read() noexcept;
+    non_owner_ptr_t<const aio_data> begin_read_ahead() noexcept;
 
     void on_end_io_op(const err_code_t& err) noexcept final;
+    void end_read_ahead(const err_code_t& err) noexcept;
+    bytes32_t coalesce_read(range_elem last) noexcept;
+    void set_coalesced_buffs(const aligned_data_ref_t& buff,
+                             bytes32_t offs) noexcept;
+    bool end_coalesced_read(const err_code_t& err) noexcept;
+    void memc_add_curr_frag(bytes32_t size, bool copy) noexcept;
+    void lock_vol_mutex() noexcept;
 
     void service_stopped() noexcept final;
 
@@ -138,6 +188,8 @@ private:
     };
     read_res try_read_all_from_mem_buff() noexcept;
     bool check_read_data() const noexcept;
+    bool try_use_read_ahead() noexcept;
+    void drop_read_ahead() noexcept;
     void read_handle_done() noexcept;
     template <typename Err> // Avoid inclusion of cache_error.h
     void try_fire_error(Err err) noexcept;
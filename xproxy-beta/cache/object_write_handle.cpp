@@ -63,6 +63,36 @@ void object_write_handle::async_write(buffers&& bufs,
     fs_ops_->aios_push_write_queue(this);
 }
 
+void object_write_handle::async_close(close_handler_t&& h) noexcept
+{
+    XLOG_DEBUG(disk_tag,
+               "Object_write_handle {}. Close with handler. Object key {}",
+               log_ptr(this), wtrans_.obj_key());
+
+    // The handler must be set before the state change, because the task
+    // may be executed in the AIO thread right after it.
+    auto cl_handler = std::make_unique<close_handler_t>(std::move(h));
+    close_handler_->swap(cl_handler);
+
+    state curr = state::running;
+    if (state_.compare_exchange_strong(curr, state::close))
+    {
+        // Enqueue the task again for the final write/flush.
+        // Using enqueue instead of push because the task could be already
+        // in the aio_service queue.
+        fs_ops_->aios_enqueue_write_queue(this);
+        try_fire_error(cache::operation_aborted);
+    }
+    else // The handle has already been closed or the service stopped
+    {
+        try_fire_error(cache::operation_aborted);
+        if (curr == state::service_stopped)
+            try_fire_closed(cache::service_stopped);
+        else
+            try_fire_closed(cache::operation_aborted);
+    }
+}
+
 void object_write_handle::async_close() noexcept
 {
     XLOG_DEBUG(disk_tag, "Object_write_handle {}. Close. Object key {}",
@@ -107,7 +137,16 @@ void object_write_handle::exec() noexcept
         // Try fire operation aborted if we couldn't do it on close.
         // There may not be user handler at all.
         try_fire_error(cache::operation_aborted);
-        do_final_write();
+        {
+            // The object is complete only if all of its data has been
+            // provided before the close.
+            const bool complete = (processed_bytes_ == actual_rng_.len());
+            do_final_write();
+            if (complete)
+                try_fire_closed(cache::success);
+            else
+                try_fire_closed(cache::operation_aborted);
+        }
         // We need the done state because we can enter here again after the
         // task has done the final write. It's a situation when we detect
         // from the exec function body that we are closed and do the final
@@ -148,6 +187,7 @@ void object_write_handle::service_stopped() noexcept
                log_ptr(this), wtrans_.obj_key());
     state_.store(state::service_stopped, std::memory_order_release);
     try_fire_error(cache::service_stopped);
+    try_fire_closed(cache::service_stopped);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -275,5 +315,19 @@ void object_write_handle::try_fire_error(Err err) noexcept
         ud.handler_(err_code_t{err, get_cache_error_category()}, 0U);
 }
 
+template <typename Err>
+void object_write_handle::try_fire_closed(Err err) noexcept
+{
+    close_handler_ptr_t cl_handler;
+    close_handler_->swap(cl_handler);
+    if (cl_handler)
+    {
+        if (err == cache::success)
+            (*cl_handler)(err_code_t{});
+        else
+            (*cl_handler)(err_code_t{err, get_cache_error_category()});
+    }
+}
+
 } // namespace detail
 } // namespace cache
@@ -14,6 +14,7 @@ namespace detail
 {
 
 using write_handler_t = std::function<void(const err_code_t&, bytes32_t)>;
+using close_handler_t = std::function<void(const err_code_t&)>;
 
 class object_write_handle final : public aio_task
 {
@@ -26,6 +27,14 @@ class object_write_handle final : public aio_task
 
     user_data_sync_t user_data_;
 
+    using close_handler_ptr_t = std::unique_ptr<close_handler_t>;
+    using close_handler_sync_t =
+        x3me::thread::synchronized<close_handler_ptr_t,
+                                   x3me::thread::spin_lock>;
+    // The close handler is expected to be used in very few cases and thus
+    // it's allocated only when needed.
+    close_handler_sync_t close_handler_;
+
     // These data members are used only from the AIO write thread currently.
     // They don't need any locking.
     write_transaction wtrans_;
@@ -64,6 +73,10 @@ public:
     // The async_write and async_close must be used from single thread only
     void async_write(buffers&& bufs, write_handler_t&& h) noexcept;
 
+    // The handler is called with success only if all of the object data
+    // has been provided and handed to the aggregate writer. Note that the
+    // final fragment may still wait in the aggregate writer at this point.
+    void async_close(close_handler_t&& h) noexcept;
     // The user of this class must ensure that the object is not used
     // after a call to async_close
     void async_close() noexcept;
@@ -87,6 +100,8 @@ private:
     frag_write_buff allocate_wbuff(bytes64_t full_exp_len) const noexcept;
     template <typename Err> // Avoid inclusion of cache_error.h
     void try_fire_error(Err err) noexcept;
+    template <typename Err> // Avoid inclusion of cache_error.h
+    void try_fire_closed(Err err) noexcept;
 };
 
 using object_whandle_ptr_t = aio_task_ptr_t<object_write_handle>;
@@ -110,7 +110,8 @@ std::ostream& operator<<(std::ostream& os, const range_elem& rhs) noexcept
     return os << '{' << rhs.rng_offset() 
               << ',' << rhs.rng_size()
               << ',' << rhs.disk_offset()
-              << ',' << static_cast<uint16_t>(rhs.cnt_readers()) << '}';
+              << ',' << static_cast<uint16_t>(rhs.cnt_readers())
+              << ',' << static_cast<uint16_t>(rhs.hits()) << '}';
     // clang-format on
 }
 } // namespace detail
@@ -17,6 +17,13 @@ public:
         elem_mark = 0x00,
     };
 
+private:
+    enum : uint8_t
+    {
+        in_memory_flag = 0x01,
+        hits_shift     = 1,
+    };
+
 private:
     // Note: It's important that the mark is the first field because the
     // range_vector functionality uses SBO and constructs one range_elem
@@ -35,7 +42,11 @@ private:
     bytes8_t rng_size_hi_;
     bytes8_t rng_offset_hi_;
     volume_blocks8_t disk_offset_hi_;
-    uint8_t in_memory_; // Used as bool. 7 bytes can be used for more readers
+    // The lowest bit is the in-memory flag. The rest of the bits count
+    // the reads of the fragment, saturating at max_hits. The count is used to
+    // decide if the fragment is hot enough to be evacuated when the write
+    // position reaches it. Accessed through the atomic built-ins, as above.
+    uint8_t flags_;
 
 public:
     static constexpr auto members_size() noexcept
@@ -51,7 +62,7 @@ public:
                sizeof(rng_size_hi_) +
                sizeof(rng_offset_hi_) + 
                sizeof(disk_offset_hi_) +
-               sizeof(in_memory_);
+               sizeof(flags_);
         // clang-format on
     }
 
@@ -84,6 +95,10 @@ public:
     {
         return std::numeric_limits<decltype(cnt_readers_)>::max();
     }
+    static constexpr uint8_t max_hits() noexcept
+    {
+        return std::numeric_limits<decltype(flags_)>::max() >> hits_shift;
+    }
 
 public:
     bytes64_t rng_offset() const noexcept;
@@ -103,7 +118,7 @@ public:
     {
         mark_        = elem_mark;
         cnt_readers_ = 0;
-        in_memory_   = 0;
+        flags_       = 0;
     }
 
     void set_mark() noexcept { mark_ = elem_mark; }
@@ -138,8 +153,47 @@ public:
     }
     bool has_readers() const noexcept { return cnt_readers() > 0; }
 
-    void set_in_memory(bool v) noexcept { in_memory_ = v; }
-    bool in_memory() const noexcept { return in_memory_; }
+    void set_in_memory(bool v) noexcept
+    {
+        if (v)
+            __atomic_fetch_or(&flags_, in_memory_flag, __ATOMIC_SEQ_CST);
+        else
+            __atomic_fetch_and(&flags_, ~in_memory_flag, __ATOMIC_SEQ_CST);
+    }
+    bool in_memory() const noexcept
+    {
+        return __atomic_load_n(&flags_, __ATOMIC_ACQUIRE) & in_memory_flag;
+    }
+
+    void atomic_inc_hits() noexcept
+    {
+        auto v = __atomic_load_n(&flags_, __ATOMIC_RELAXED);
+        do
+        {
+            if ((v >> hits_shift) == max_hits())
+                return;
+        } while (!__atomic_compare_exchange_n(
+            &flags_, &v, uint8_t(v + (1 << hits_shift)), true /*weak*/,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    }
+    // Halves the hits count, so that the fragments which were hot long
+    // ago gradually lose their advantage.
+    void atomic_decay_hits() noexcept
+    {
+        auto v = __atomic_load_n(&flags_, __ATOMIC_RELAXED);
+        uint8_t n;
+        do
+        {
+            const uint8_t hits = (v >> hits_shift) / 2;
+            n = (v & in_memory_flag) | uint8_t(hits << hits_shift);
+        } while (!__atomic_compare_exchange_n(&flags_, &v, n, true /*weak*/,
+                                              __ATOMIC_RELAXED,
+                                              __ATOMIC_RELAXED));
+    }
+    uint8_t hits() const noexcept
+    {
+        return __atomic_load_n(&flags_, __ATOMIC_RELAXED) >> hits_shift;
+    }
 
     static bool is_range_elem(const void* mem) noexcept
     {
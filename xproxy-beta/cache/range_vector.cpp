@@ -1,5 +1,6 @@
 #include "precompiled.h"
 #include "range_vector.h"
+#include "slab_alloc.h"
 
 namespace cache
 {
@@ -97,7 +98,7 @@ range_vector::add_range(const range_elem& rng) noexcept
             ::memcpy(&tmp, data_, sizeof(range_elem));
             set_empty_data();
             auto* d  = get_data();
-            d->ptr_  = ::malloc(sizeof(range_elem) * 2);
+            d->ptr_  = alloc_elems(2);
             d->size_ = 1;
             ::memcpy(d->ptr_, &tmp, sizeof(range_elem));
             ret = add_range_impl(rng, 2);
@@ -116,7 +117,7 @@ range_vector::add_range(const range_elem& rng) noexcept
         // We shouldn't add more ranges than the logical limit.
         break;
     default: // Find the position to insert the new element on the heap
-        ret = add_range_impl(rng, s);
+        ret = add_range_impl(rng, capacity(s));
         X3ME_ASSERT(ret.first, "The call must return some iterator, no matter "
                                "if it succeeds or fails");
         break;
@@ -404,13 +405,23 @@ range_vector::const_iterator range_vector::rem_range(iter_range rng) noexcept
         default:
         {
             const auto pos = beg - c_beg;
-            auto p         = static_cast<range_elem*>(d->ptr_) + pos;
-            // It's OK to pass 0 size for memmove according to the C standard.
-            ::memmove(p, end, (c_end - end) * sizeof(range_elem));
-            // Go to the exact size, because of our very conservative memory
-            // strategy.
-            d->ptr_ = ::realloc(d->ptr_, new_size * sizeof(range_elem));
-            X3ME_ENFORCE(d->ptr_);
+            if (capacity(new_size) < capacity(size))
+            {
+                // Go to the smaller storage to keep the memory consumption
+                // proportional to the size.
+                auto* p = static_cast<range_elem*>(alloc_elems(new_size));
+                ::memcpy(p, c_beg, pos * sizeof(range_elem));
+                ::memcpy(p + pos, end, (c_end - end) * sizeof(range_elem));
+                free_elems(d->ptr_, size);
+                d->ptr_ = p;
+            }
+            else
+            {
+                auto p = static_cast<range_elem*>(d->ptr_) + pos;
+                // It's OK to pass 0 size for memmove according to the C
+                // standard.
+                ::memmove(p, end, (c_end - end) * sizeof(range_elem));
+            }
             d->size_ = new_size;
             ret      = static_cast<range_elem*>(d->ptr_) + pos;
             break;
@@ -556,12 +567,11 @@ void range_vector::add_at_pos(const range_elem& rng,
     X3ME_ASSERT(d->size_ <= cur_capacity, "Wrong argument 'cur_capacity'");
     if (d->size_ == cur_capacity)
     {
-        // We use the most conservative growing strategy because the lowest
-        // possible memory consumption is more important to us than the
-        // insert speed, because the last happens relatively rarely.
-        // This can change in the future.
-        d->ptr_ = ::realloc(d->ptr_, (cur_capacity + 1) * sizeof(range_elem));
-        X3ME_ENFORCE(d->ptr_);
+        // Go to the next storage size class.
+        auto* p = alloc_elems(cur_capacity + 1);
+        ::memcpy(p, d->ptr_, d->size_ * sizeof(range_elem));
+        free_elems(d->ptr_, d->size_);
+        d->ptr_ = p;
     }
     auto p = static_cast<range_elem*>(d->ptr_) + pos;
     if (pos < d->size_)
@@ -588,7 +598,7 @@ void range_vector::copy_data(const range_vector& rhs) noexcept
     if (rhsd->size_ > 0)
     {
         auto* d = get_data();
-        d->ptr_ = ::malloc(rhsd->size_ * sizeof(range_elem));
+        d->ptr_ = alloc_elems(rhsd->size_);
         ::memcpy(d->ptr_, rhsd->ptr_, rhsd->size_ * sizeof(range_elem));
         d->size_ = rhsd->size_;
     }
@@ -615,10 +625,47 @@ void range_vector::move_range_elem(range_vector& rhs) noexcept
 void range_vector::destroy_data() noexcept
 {
     // No destruction of the elements is needed, because they are POD.
-    ::free(get_data()->ptr_);
+    // The empty vector is also kept as data, but with no storage.
+    const auto* d = get_data();
+    if (d->size_ > 0)
+        free_elems(d->ptr_, d->size_);
     // No destruction of the data itself is needed because it's POD.
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// The heap storage of all range vectors comes from common slabs.
+// The range vectors are too many and too small to be allocated one by one
+// with malloc. We can't keep a pointer to an allocator in every range vector
+// because of its size. Thus the slab allocator is global. It's never
+// destroyed because some range vectors may outlive the static objects.
+
+static slab_alloc& storage() noexcept
+{
+    static auto* inst = new slab_alloc;
+    return *inst;
+}
+
+bytes64_t range_vector::storage_size() noexcept
+{
+    return storage().slabs_size();
+}
+
+range_vector::size_type range_vector::capacity(size_type size) noexcept
+{
+    X3ME_ASSERT(size > 1, "The heap storage is used for 2 or more elements");
+    return size_type(1) << (32 - __builtin_clz(size - 1));
+}
+
+void* range_vector::alloc_elems(size_type size) noexcept
+{
+    return storage().alloc(capacity(size) * sizeof(range_elem));
+}
+
+void range_vector::free_elems(void* p, size_type size) noexcept
+{
+    storage().free(p, capacity(size) * sizeof(range_elem));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool range_vector::has_data() const noexcept
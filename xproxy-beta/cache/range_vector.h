@@ -129,6 +129,10 @@ public:
     template <typename Writer>
     void save(Writer& writer) const noexcept;
 
+    // The memory taken from the system for the heap storage of all
+    // range vectors.
+    static bytes64_t storage_size() noexcept;
+
 private:
     std::pair<const_iterator, bool>
     add_range_impl(const range_elem& rng, size_type cur_capacity) noexcept;
@@ -142,6 +146,12 @@ private:
     void move_range_elem(range_vector& rhs) noexcept;
     void destroy_data() noexcept;
 
+    // The heap storage capacity is always the smallest power of 2 which is
+    // not less than the size. Thus it needn't be kept in the container data.
+    static size_type capacity(size_type size) noexcept;
+    static void* alloc_elems(size_type size) noexcept;
+    static void free_elems(void* p, size_type size) noexcept;
+
     bool has_data() const noexcept;
     container_data* get_data() noexcept;
     const container_data* get_data() const noexcept;
@@ -176,6 +186,16 @@ inline void rv_elem_atomic_dec_readers(range_vector::const_iterator e) noexcept
     const_cast<range_elem*>(e)->atomic_dec_readers();
 }
 
+inline void rv_elem_atomic_inc_hits(range_vector::const_iterator e) noexcept
+{
+    const_cast<range_elem*>(e)->atomic_inc_hits();
+}
+
+inline void rv_elem_atomic_decay_hits(range_vector::const_iterator e) noexcept
+{
+    const_cast<range_elem*>(e)->atomic_decay_hits();
+}
+
 inline void rv_elem_reset_meta(range_vector::const_iterator e) noexcept
 {
     const_cast<range_elem*>(e)->reset_meta();
@@ -201,8 +221,7 @@ bool range_vector::load(Reader& reader)
         if ((d->size_ > 1) && (d->size_ <= max_ranges))
         {
             const auto sz = d->size_ * sizeof(range_elem);
-            d->ptr_ = ::malloc(sz);
-            X3ME_ENFORCE(d->ptr_);
+            d->ptr_       = alloc_elems(d->size_);
             // Although we may throw in this call, nothing so bad can happen,
             // because the range_elem is POD data and don't need to be
             // destroyed. So just freeing the memory upon destruction is OK.
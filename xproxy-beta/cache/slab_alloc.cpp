@@ -0,0 +1,135 @@
+#include "precompiled.h"
+#include "slab_alloc.h"
+
+namespace cache
+{
+namespace detail
+{
+
+constexpr bytes32_t slab_alloc::min_chunk_size;
+constexpr bytes32_t slab_alloc::max_chunk_size;
+constexpr bytes32_t slab_alloc::slab_size;
+constexpr uint32_t slab_alloc::cnt_classes;
+constexpr uint32_t slab_alloc::cnt_arenas;
+
+using lock_guard_t = std::lock_guard<x3me::thread::spin_lock>;
+
+slab_alloc::slab_alloc() noexcept
+{
+}
+
+slab_alloc::~slab_alloc() noexcept
+{
+    for (auto& a : arenas_)
+    {
+        for (auto& sc : a)
+        {
+            for (auto* s : sc.slabs_)
+                ::free(s);
+        }
+    }
+}
+
+void* slab_alloc::alloc(bytes32_t size) noexcept
+{
+    X3ME_ASSERT(x3me::math::is_pow_of_2(size) && (size >= min_chunk_size),
+                "Unsupported chunk size");
+    if (size > max_chunk_size)
+    {
+        auto* ret = ::malloc(size);
+        X3ME_ENFORCE(ret);
+        return ret;
+    }
+
+    auto& sc = get_class(size);
+    lock_guard_t _(sc.lock_);
+    sc.used_size_ += size;
+    if (sc.free_list_)
+    {
+        auto* ret     = sc.free_list_;
+        sc.free_list_ = *static_cast<void**>(ret);
+        return ret;
+    }
+    if (sc.slab_pos_ == sc.slab_end_)
+    {
+        auto* s = static_cast<uint8_t*>(::malloc(slab_size));
+        X3ME_ENFORCE(s);
+        sc.slabs_.push_back(s);
+        sc.slab_pos_ = s;
+        sc.slab_end_ = s + slab_size;
+    }
+    auto* ret = sc.slab_pos_;
+    sc.slab_pos_ += size;
+    return ret;
+}
+
+void slab_alloc::free(void* p, bytes32_t size) noexcept
+{
+    X3ME_ASSERT(x3me::math::is_pow_of_2(size) && (size >= min_chunk_size),
+                "Unsupported chunk size");
+    if (size > max_chunk_size)
+    {
+        ::free(p);
+        return;
+    }
+
+    auto& sc = get_class(size);
+    lock_guard_t _(sc.lock_);
+    sc.used_size_ -= size;
+    *static_cast<void**>(p) = sc.free_list_;
+    sc.free_list_ = p;
+}
+
+bytes64_t slab_alloc::slabs_size() const noexcept
+{
+    bytes64_t ret = 0;
+    for (auto& a : arenas_)
+    {
+        for (auto& sc : a)
+        {
+            lock_guard_t _(sc.lock_);
+            ret += sc.slabs_.size() * slab_size;
+        }
+    }
+    return ret;
+}
+
+bytes64_t slab_alloc::used_size() const noexcept
+{
+    int64_t ret = 0;
+    for (auto& a : arenas_)
+    {
+        for (auto& sc : a)
+        {
+            lock_guard_t _(sc.lock_);
+            ret += sc.used_size_;
+        }
+    }
+    X3ME_ASSERT(ret >= 0, "Freed more chunks than allocated");
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+slab_alloc::size_class& slab_alloc::get_class(bytes32_t size) noexcept
+{
+    return arenas_[arena_idx()][class_idx(size)];
+}
+
+uint32_t slab_alloc::class_idx(bytes32_t size) noexcept
+{
+    // The size is power of 2 in [min_chunk_size, max_chunk_size]
+    return __builtin_ctz(size) - __builtin_ctz(min_chunk_size);
+}
+
+uint32_t slab_alloc::arena_idx() noexcept
+{
+    // The same thread uses the same arena index in all allocator instances
+    static std::atomic<uint32_t> next_idx{0};
+    thread_local const uint32_t idx =
+        next_idx.fetch_add(1, std::memory_order_relaxed) % cnt_arenas;
+    return idx;
+}
+
+} // namespace detail
+} // namespace cache
@@ -0,0 +1,80 @@
+#pragma once
+
+namespace cache
+{
+namespace detail
+{
+
+// Allocates small memory chunks, with sizes power of 2, from big slabs.
+// Every chunk size has its own slabs and free list. The freed chunks are
+// reused by the next allocations with the same size, but the slabs are
+// never given back to the system. This trades some unused memory for
+// no fragmentation of the system allocator, when hundreds of millions of
+// tiny and differently sized chunks get allocated and freed all the time.
+// The chunks bigger than max_chunk_size are allocated directly with malloc.
+// The functionality is thread safe. The allocator is split into arenas and
+// every thread works with its own arena, so that the threads don't contend
+// for the same locks. Every chunk size in an arena has its own lock.
+// A chunk may be freed from another thread than the one which allocated it.
+// It goes to the free list of the freeing thread arena in this case.
+class slab_alloc
+{
+public:
+    static constexpr bytes32_t min_chunk_size = 32;
+    static constexpr bytes32_t max_chunk_size = 1_KB;
+    static constexpr bytes32_t slab_size      = 64_KB;
+
+private:
+    static constexpr uint32_t cnt_classes = 6;
+    static_assert((min_chunk_size << (cnt_classes - 1)) == max_chunk_size,
+                  "Wrong count of size classes");
+    // The threads get assigned to the arenas in round robin order.
+    // The count is bigger than the count of the threads which work with
+    // the cache, at least for the current configurations.
+    static constexpr uint32_t cnt_arenas = 16;
+
+    // Aligned to a cache line to avoid false sharing between the locks
+    // of the neighbour size classes.
+    struct alignas(64) size_class
+    {
+        mutable x3me::thread::spin_lock lock_;
+        // The freed chunks are linked through their first bytes.
+        void* free_list_   = nullptr;
+        uint8_t* slab_pos_ = nullptr;
+        uint8_t* slab_end_ = nullptr;
+        std::vector<void*> slabs_;
+        // Signed because a chunk may be allocated from one arena and freed
+        // to another. Only the sum for all arenas is meaningful.
+        int64_t used_size_ = 0;
+    };
+    using arena_t = std::array<size_class, cnt_classes>;
+    std::array<arena_t, cnt_arenas> arenas_;
+
+public:
+    slab_alloc() noexcept;
+    ~slab_alloc() noexcept;
+
+    slab_alloc(const slab_alloc&) = delete;
+    slab_alloc& operator=(const slab_alloc&) = delete;
+    slab_alloc(slab_alloc&&) = delete;
+    slab_alloc& operator=(slab_alloc&&) = delete;
+
+    // The size must be power of 2 and at least min_chunk_size.
+    // The same size must be passed when the chunk is freed.
+    void* alloc(bytes32_t size) noexcept;
+    void free(void* p, bytes32_t size) noexcept;
+
+    // The memory allocated in slabs from the system.
+    bytes64_t slabs_size() const noexcept;
+    // The memory in the slabs given to the users.
+    bytes64_t used_size() const noexcept;
+
+private:
+    size_class& get_class(bytes32_t size) noexcept;
+
+    static uint32_t class_idx(bytes32_t size) noexcept;
+    static uint32_t arena_idx() noexcept;
+};
+
+} // namespace detail
+} // namespace cache
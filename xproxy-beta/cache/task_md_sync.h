@@ -30,6 +30,7 @@ public:
 
 private:
     aio_op operation() const noexcept final { return aio_op::write; }
+    aio_class io_class() const noexcept final { return aio_class::metadata; }
 
     void exec() noexcept final;
 
@@ -10,7 +10,9 @@ write_buffers::write_buffers(write_buffers&& rhs) noexcept
     : bufs_(std::move(rhs.bufs_)),
       curr_idx_(std::exchange(rhs.curr_idx_, 0)),
       curr_offs_(std::exchange(rhs.curr_offs_, 0)),
-      bytes_written_(std::exchange(rhs.bytes_written_, 0))
+      bytes_written_(std::exchange(rhs.bytes_written_, 0)),
+      shared_(std::exchange(rhs.shared_, nullptr)),
+      shared_max_(std::exchange(rhs.shared_max_, 0))
 {
 }
 
@@ -22,6 +24,8 @@ write_buffers& write_buffers::operator=(write_buffers&& rhs) noexcept
         curr_idx_      = std::exchange(rhs.curr_idx_, 0);
         curr_offs_     = std::exchange(rhs.curr_offs_, 0);
         bytes_written_ = std::exchange(rhs.bytes_written_, 0);
+        shared_        = std::exchange(rhs.shared_, nullptr);
+        shared_max_    = std::exchange(rhs.shared_max_, 0);
     }
     return *this;
 }
@@ -32,9 +36,21 @@ write_buffers& write_buffers::operator=(buffers&& rhs) noexcept
     curr_idx_      = 0;
     curr_offs_     = 0;
     bytes_written_ = 0;
+    shared_        = nullptr;
+    shared_max_    = 0;
     return *this;
 }
 
+void write_buffers::set_shared(shared_data_t& data, bytes32_t max_len) noexcept
+{
+    bufs_.clear();
+    curr_idx_      = 0;
+    curr_offs_     = 0;
+    bytes_written_ = 0;
+    shared_        = &data;
+    shared_max_    = max_len;
+}
+
 bytes32_t write_buffers::write(data_t data) noexcept
 {
     bytes32_t written = 0;
@@ -74,6 +90,21 @@ bytes32_t write_buffers::write(data_t data) noexcept
     return written;
 }
 
+bytes32_t write_buffers::write(data_t data,
+                               const aligned_data_ref_t& owner) noexcept
+{
+    if (!shared_)
+        return write(data);
+    // The reference is given out only once, thus everything gets written.
+    const auto len = std::min<bytes32_t>(data.size(), shared_max_);
+    *shared_       = shared_data_t(owner, data.data());
+    shared_        = nullptr;
+    shared_max_    = 0;
+
+    bytes_written_ += len;
+    return len;
+}
+
 void write_buffers::swap(write_buffers& rhs) noexcept
 {
     using std::swap;
@@ -81,6 +112,8 @@ void write_buffers::swap(write_buffers& rhs) noexcept
     swap(curr_idx_, rhs.curr_idx_);
     swap(curr_offs_, rhs.curr_offs_);
     swap(bytes_written_, rhs.bytes_written_);
+    swap(shared_, rhs.shared_);
+    swap(shared_max_, rhs.shared_max_);
 }
 
 bool write_buffers::all_written() const noexcept
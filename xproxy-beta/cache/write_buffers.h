@@ -1,5 +1,6 @@
 #pragma once
 
+#include "aligned_data_ptr.h"
 #include "buffer.h"
 
 namespace cache
@@ -16,6 +17,10 @@ class write_buffers
     bytes32_t curr_offs_ = 0;
     // All bytes written to the buffers so far.
     bytes32_t bytes_written_ = 0;
+    // Set when the user wants a reference to the data instead of a copy.
+    // Refers to at most the given max bytes of the data.
+    shared_data_t* shared_ = nullptr;
+    bytes32_t shared_max_  = 0;
 
 public:
     write_buffers() noexcept = default;
@@ -29,9 +34,14 @@ public:
 
     write_buffers& operator=(buffers&& rhs) noexcept;
 
+    void set_shared(shared_data_t& data, bytes32_t max_len) noexcept;
+
     using data_t = x3me::mem_utils::array_view<const uint8_t>;
     // Returns the written bytes.
     bytes32_t write(data_t data) noexcept;
+    // The same as above, but only refers to the data, if a reference is
+    // wanted. The owner must own the memory of the data.
+    bytes32_t write(data_t data, const aligned_data_ref_t& owner) noexcept;
 
     void swap(write_buffers& rhs) noexcept;
 
@@ -39,7 +49,7 @@ public:
 
     bytes32_t bytes_written() const noexcept { return bytes_written_; }
 
-    bool empty() const noexcept { return bufs_.empty(); }
+    bool empty() const noexcept { return bufs_.empty() && !shared_; }
 };
 
 } // namespace detail
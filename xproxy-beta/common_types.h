@@ -55,6 +55,8 @@ namespace x3me_sockopt
 {
 using transparent_mode =
     boost::asio::detail::socket_option::boolean<IPPROTO_IP, IP_TRANSPARENT>;
+using reuse_port =
+    boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
 using type_of_service =
     boost::asio::detail::socket_option::integer<IPPROTO_IP, IP_TOS>;
 using tcp_keep_idle =
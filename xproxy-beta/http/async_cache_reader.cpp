@@ -1,6 +1,7 @@
 #include "precompiled.h"
 #include "async_cache_reader.h"
 #include "cache/cache_error.h"
+#include "xutils/moveable_handler.h"
 
 namespace http
 {
@@ -35,6 +36,25 @@ void async_cache_reader::async_read_some(const net::vec_wr_buffer_t& buff,
         });
 }
 
+bool async_cache_reader::can_read_shared() const noexcept
+{
+    return true;
+}
+
+void async_cache_reader::async_read_shared(net::shared_data_t& data,
+                                           bytes32_t max_len,
+                                           net::handler_t&& h) noexcept
+{
+    cache_handle_.async_read_shared(
+        data, max_len, [h = std::move(h)](const err_code_t& err, bytes32_t read)
+        {
+            if (err == cache::eof)
+                h(asio_error::eof, read);
+            else
+                h(err, read);
+        });
+}
+
 void async_cache_reader::shutdown(asio_shutdown_t, err_code_t&) noexcept
 {
     // Nothing to do here
@@ -50,5 +70,107 @@ bool async_cache_reader::is_open() const noexcept
     return cache_handle_.is_open();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+async_fresh_reader::state::state(cache::async_stream&& h,
+                                 boost_string_t&& hdrs,
+                                 io_service_t& ios) noexcept
+    : cache_handle_(std::move(h)),
+      hdrs_(std::move(hdrs)),
+      ios_(ios)
+{
+}
+
+async_fresh_reader::async_fresh_reader(cache::async_stream&& h,
+                                       boost_string_t&& hdrs,
+                                       io_service_t& ios) noexcept
+    : st_(std::make_unique<state>(std::move(h), std::move(hdrs), ios))
+{
+}
+
+async_fresh_reader::~async_fresh_reader() noexcept
+{
+}
+
+void async_fresh_reader::async_read_some(const net::vec_wr_buffer_t& buff,
+                                         net::handler_t&& h) noexcept
+{
+    using namespace boost::asio;
+    auto& st = *st_;
+    if (st.hdrs_offs_ < st.hdrs_.size())
+    {
+        // Give only the headers this time. The caller will ask for more.
+        bytes32_t copied = 0;
+        for (const auto& b : buff)
+        {
+            const bytes32_t len = std::min<bytes32_t>(
+                buffer_size(b), st.hdrs_.size() - st.hdrs_offs_);
+            ::memcpy(buffer_cast<uint8_t*>(b), &st.hdrs_[st.hdrs_offs_], len);
+            st.hdrs_offs_ += len;
+            copied += len;
+            if (st.hdrs_offs_ == st.hdrs_.size())
+                break;
+        }
+        if (st.hdrs_offs_ == st.hdrs_.size())
+            boost_string_t{}.swap(st.hdrs_); // Free the memory
+        st.ios_.post(xutils::make_moveable_handler(
+            [ h = std::move(h), copied ]() mutable
+            {
+                h(err_code_t{}, copied);
+            }));
+        return;
+    }
+
+    cache::mutable_buffers cbuff;
+    for (const auto& b : buff)
+        cbuff.emplace_back(buffer_cast<uint8_t*>(b), buffer_size(b));
+
+    st.cache_handle_.async_read(
+        std::move(cbuff),
+        [h = std::move(h)](const err_code_t& err, bytes32_t read)
+        {
+            if (err == cache::eof)
+                h(asio_error::eof, read);
+            else
+                h(err, read);
+        });
+}
+
+bool async_fresh_reader::can_read_shared() const noexcept
+{
+    // The headers are copied
+    return st_->hdrs_offs_ >= st_->hdrs_.size();
+}
+
+void async_fresh_reader::async_read_shared(net::shared_data_t& data,
+                                           bytes32_t max_len,
+                                           net::handler_t&& h) noexcept
+{
+    X3ME_ASSERT(can_read_shared(), "The headers must be read first");
+    st_->cache_handle_.async_read_shared(
+        data, max_len, [h = std::move(h)](const err_code_t& err, bytes32_t read)
+        {
+            if (err == cache::eof)
+                h(asio_error::eof, read);
+            else
+                h(err, read);
+        });
+}
+
+void async_fresh_reader::shutdown(asio_shutdown_t, err_code_t&) noexcept
+{
+    // Nothing to do here
+}
+
+void async_fresh_reader::close(err_code_t&) noexcept
+{
+    st_->cache_handle_.async_close();
+}
+
+bool async_fresh_reader::is_open() const noexcept
+{
+    return st_->cache_handle_.is_open();
+}
+
 } // namespace detail
 } // namespace http
@@ -18,6 +18,46 @@ public:
 
     void async_read_some(const net::vec_wr_buffer_t& buff,
                          net::handler_t&& h) noexcept final;
+    bool can_read_shared() const noexcept final;
+    void async_read_shared(net::shared_data_t& data,
+                           bytes32_t max_len,
+                           net::handler_t&& h) noexcept final;
+    void shutdown(asio_shutdown_t, err_code_t&) noexcept final;
+    void close(err_code_t&) noexcept final;
+    bool is_open() const noexcept final;
+};
+
+// Gives the stored response headers first and then the object data from
+// the cache. Used when a fresh object is served without asking the origin.
+class async_fresh_reader final : public net::async_read_stream::implementation
+{
+    // Keep the state on the heap, because it doesn't fit in the
+    // async_read_stream inline storage.
+    struct state
+    {
+        cache::async_stream cache_handle_;
+        boost_string_t hdrs_;
+        bytes32_t hdrs_offs_ = 0;
+        io_service_t& ios_;
+
+        state(cache::async_stream&& h,
+              boost_string_t&& hdrs,
+              io_service_t& ios) noexcept;
+    };
+    std::unique_ptr<state> st_;
+
+public:
+    async_fresh_reader(cache::async_stream&& h,
+                       boost_string_t&& hdrs,
+                       io_service_t& ios) noexcept;
+    ~async_fresh_reader() noexcept final;
+
+    void async_read_some(const net::vec_wr_buffer_t& buff,
+                         net::handler_t&& h) noexcept final;
+    bool can_read_shared() const noexcept final;
+    void async_read_shared(net::shared_data_t& data,
+                           bytes32_t max_len,
+                           net::handler_t&& h) noexcept final;
     void shutdown(asio_shutdown_t, err_code_t&) noexcept final;
     void close(err_code_t&) noexcept final;
     bool is_open() const noexcept final;
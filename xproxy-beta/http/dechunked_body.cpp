@@ -0,0 +1,40 @@
+#include "precompiled.h"
+#include "dechunked_body.h"
+#include "http_constants.h"
+
+namespace http
+{
+
+std::atomic<bytes64_t> dechunked_body::total_size_{0};
+
+dechunked_body::dechunked_body() noexcept
+{
+}
+
+dechunked_body::~dechunked_body() noexcept
+{
+    total_size_.fetch_sub(data_.size(), std::memory_order_relaxed);
+}
+
+bool dechunked_body::append(const char* d, bytes32_t s) noexcept
+{
+    if ((bytes64_t(data_.size()) + s) > constants::max_dechunked_size)
+        return false;
+    // Reserve the space first, so that the concurrent appends from the
+    // other net threads can't exceed the budget together.
+    const auto prev = total_size_.fetch_add(s, std::memory_order_relaxed);
+    if ((prev + s) > constants::max_dechunked_total)
+    {
+        total_size_.fetch_sub(s, std::memory_order_relaxed);
+        return false;
+    }
+    data_.append(d, s);
+    return true;
+}
+
+bytes64_t dechunked_body::total_size() noexcept
+{
+    return total_size_.load(std::memory_order_relaxed);
+}
+
+} // namespace http
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace http
+{
+
+// The de-chunked body of a chunked response, collected in RAM until the
+// response end. All bodies, from all net threads, share a global memory
+// budget. A body which doesn't fit in the budget must be dropped.
+class dechunked_body
+{
+    static std::atomic<bytes64_t> total_size_;
+
+    boost_string_t data_;
+
+public:
+    dechunked_body() noexcept;
+    ~dechunked_body() noexcept;
+
+    dechunked_body(const dechunked_body&) = delete;
+    dechunked_body& operator=(const dechunked_body&) = delete;
+    dechunked_body(dechunked_body&&) = delete;
+    dechunked_body& operator=(dechunked_body&&) = delete;
+
+    // Returns false, without appending, if the body would become bigger
+    // than the max allowed or all bodies would exceed the global budget.
+    bool append(const char* d, bytes32_t s) noexcept;
+
+    const char* data() const noexcept { return data_.data(); }
+    bytes32_t size() const noexcept { return data_.size(); }
+
+    static bytes64_t total_size() noexcept;
+};
+
+} // namespace http
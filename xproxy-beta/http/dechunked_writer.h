@@ -0,0 +1,120 @@
+#pragma once
+
+#include "dechunked_body.h"
+#include "fresh_index.h"
+#include "http_stats.h"
+#include "cache/buffer.h"
+#include "cache/cache_error.h"
+#include "cache/cache_key.h"
+
+namespace http
+{
+
+// Stores a de-chunked response, which length has become known at its end,
+// in the cache and adds it to the fresh index when done. It lives on its own,
+// because the connection continues with the next transaction, or goes away,
+// in the meantime.
+// The Stream is the cache::async_stream. It's a template parameter only
+// for the sake of the tests.
+template <typename Stream>
+class dechunked_writer final
+    : public std::enable_shared_from_this<dechunked_writer<Stream>>
+{
+    Stream stream_;
+    fresh_index& fresh_idx_;
+    all_stats& all_stats_;
+    // The entry owns the cache key values used for the cache write
+    std::unique_ptr<fresh_index::entry> entry_;
+    std::unique_ptr<dechunked_body> body_;
+    bytes32_t written_ = 0;
+    id_tag tag_;
+
+public:
+    dechunked_writer(Stream&& stream,
+                     fresh_index& fresh_idx,
+                     all_stats& sts,
+                     std::unique_ptr<fresh_index::entry>&& e,
+                     std::unique_ptr<dechunked_body>&& body,
+                     const id_tag& tag) noexcept : stream_(std::move(stream)),
+                                                   fresh_idx_(fresh_idx),
+                                                   all_stats_(sts),
+                                                   entry_(std::move(e)),
+                                                   body_(std::move(body)),
+                                                   tag_(tag)
+    {
+    }
+
+    void start() noexcept
+    {
+        // Not truncating the object also makes the open go through the
+        // cache admission filter, as the regular object writes do.
+        const bool truncate_obj = false;
+        stream_.async_open_write(
+            entry_->get_cache_key(), truncate_obj,
+            [self = this->shared_from_this()](const err_code_t& err)
+            {
+                if (!err)
+                    self->write();
+                // The key contains the length and the validators of the
+                // object. The same object has been stored already.
+                else if (err == cache::object_present)
+                    self->stored();
+                else
+                    XLOG_DEBUG(self->tag_, "De-chunked cache open failed. {}",
+                               err.message());
+            });
+    }
+
+private:
+    void write() noexcept
+    {
+        const auto rem = body_->size() - written_;
+        stream_.async_write(
+            cache::const_buffer(body_->data() + written_, rem),
+            [self = this->shared_from_this()](const err_code_t& err,
+                                              bytes32_t written)
+            {
+                if (err)
+                {
+                    XLOG_ERROR(self->tag_, "De-chunked cache write failed. {}",
+                               err.message());
+                    self->stream_.async_close();
+                    return;
+                }
+                self->written_ += written;
+                if (self->written_ < self->body_->size())
+                {
+                    self->write();
+                }
+                else
+                {
+                    self->close();
+                }
+            });
+    }
+
+    void close() noexcept
+    {
+        // The object must not get into the fresh index before the write
+        // handle has handed all of its data to the cache.
+        stream_.async_close(
+            [self = this->shared_from_this()](const err_code_t& err)
+            {
+                if (!err)
+                    self->stored();
+                else
+                    XLOG_DEBUG(self->tag_, "De-chunked cache close failed. {}",
+                               err.message());
+            });
+    }
+
+    void stored() noexcept
+    {
+        ++all_stats_.var_stats_.cnt_dechunk_stored_;
+        XLOG_DEBUG(tag_, "De-chunked object stored. Fresh index add. CKey {}",
+                   entry_->get_cache_key());
+        fresh_idx_.insert(std::move(entry_));
+    }
+};
+
+} // namespace http
@@ -0,0 +1,370 @@
+#include "precompiled.h"
+#include "fresh_index.h"
+#include "cache/cache_key.h"
+
+namespace http
+{
+
+constexpr bytes32_t fresh_index::max_hdrs_size;
+
+static void assign(boost_string_t& to, const string_view_t& from) noexcept
+{
+    to.assign(from.data(), from.size());
+}
+
+static void trim_string_view(string_view_t& sv) noexcept
+{
+    sv.remove_prefix(std::min(sv.find_first_not_of(" \t"), sv.size()));
+    auto pos = sv.find_last_not_of(" \t");
+    if (pos != string_view_t::npos)
+        pos += 1;
+    sv.remove_suffix(sv.size() - std::min(pos, sv.size()));
+}
+
+// The header lines here end with CRLF.
+static string_view_t hdr_value(string_view_t line, size_t colon) noexcept
+{
+    line.remove_prefix(colon + 1);
+    line.remove_suffix(2);
+    trim_string_view(line);
+    return line;
+}
+
+// The header names listed in the 'Connection' headers
+using conn_hdrs_t = boost::container::small_vector<string_view_t, 4>;
+
+// The hop-by-hop headers are meaningful only for the connection to the
+// origin. They are not stored, the same as the headers listed in the
+// 'Connection' header.
+static bool is_hop_by_hop_hdr(string_view_t name,
+                              const conn_hdrs_t& conn) noexcept
+{
+    static const string_view_t hdrs[] = {
+        "Connection", "Keep-Alive", "Proxy-Connection", "Upgrade", "TE",
+        "Trailer"};
+    const auto eq = [&](string_view_t h)
+    {
+        return boost::iequals(name, h);
+    };
+    return std::any_of(std::begin(hdrs), std::end(hdrs), eq) ||
+           std::any_of(conn.begin(), conn.end(), eq);
+}
+
+// Copies the headers without the 'Age', 'Transfer-Encoding' and the
+// hop-by-hop headers and without the final empty line.
+// The 'Content-Length' header is added if missing, because the object is
+// served with its full length.
+// Returns false if the headers block is not well formed.
+static bool copy_resp_hdrs(string_view_t hdrs,
+                           bytes64_t obj_len,
+                           boost_string_t& out) noexcept
+{
+    constexpr string_view_t eol{"\r\n", 2};
+    if (!boost::ends_with(hdrs, "\r\n\r\n"))
+        return false;
+    hdrs.remove_suffix(eol.size());
+
+    // The status line is copied as is
+    auto len = hdrs.find(eol) + eol.size();
+    out.assign(hdrs.data(), len);
+    hdrs.remove_prefix(len);
+
+    // The 'Connection' headers may come after the headers they list
+    conn_hdrs_t conn;
+    for (auto h = hdrs; !h.empty(); h.remove_prefix(len))
+    {
+        len             = h.find(eol) + eol.size();
+        const auto line = h.substr(0, len);
+        const auto pos  = line.find(':');
+        if ((pos == string_view_t::npos) ||
+            !boost::iequals(line.substr(0, pos), "Connection"))
+            continue;
+        auto val = hdr_value(line, pos);
+        while (!val.empty())
+        {
+            const auto comma = std::min(val.find(','), val.size());
+            auto tok         = val.substr(0, comma);
+            trim_string_view(tok);
+            if (!tok.empty())
+                conn.push_back(tok);
+            val.remove_prefix(std::min(comma + 1, val.size()));
+        }
+    }
+
+    out.reserve(out.size() + hdrs.size());
+    bool has_clen = false;
+    bool skip     = false;
+    for (; !hdrs.empty(); hdrs.remove_prefix(len))
+    {
+        len             = hdrs.find(eol) + eol.size();
+        const auto line = hdrs.substr(0, len);
+        // A folded line continues the previous header
+        if ((line[0] != ' ') && (line[0] != '\t'))
+        {
+            const auto pos  = line.find(':');
+            const auto name = line.substr(0, pos);
+            skip = boost::iequals(name, "Age") ||
+                   boost::iequals(name, "Transfer-Encoding") ||
+                   is_hop_by_hop_hdr(name, conn);
+            has_clen = has_clen ||
+                       (!skip && boost::iequals(name, "Content-Length"));
+        }
+        if (!skip)
+            out.append(line.data(), line.size());
+    }
+    if (!has_clen)
+    {
+        x3me::utilities::string_builder_64 clen_hdr;
+        clen_hdr << "Content-Length: " << obj_len << "\r\n";
+        out.append(clen_hdr.data(), clen_hdr.size());
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+cache::cache_key fresh_index::entry::get_cache_key() const noexcept
+{
+    cache::cache_key ret;
+    ret.url_              = to_string_view(url_);
+    ret.cache_url_        = to_string_view(cache_url_);
+    ret.content_encoding_ = to_string_view(content_encoding_);
+    ret.content_md5_      = to_string_view(content_md5_);
+    ret.digest_sha1_      = to_string_view(digest_sha1_);
+    ret.digest_md5_       = to_string_view(digest_md5_);
+    ret.etag_             = to_string_view(etag_);
+    ret.obj_full_len_     = obj_full_len_;
+    ret.last_modified_    = last_modified_;
+    return ret;
+}
+
+void fresh_index::entry::get_resp_hdrs(time_t now,
+                                       boost_string_t& out) const noexcept
+{
+    out.append(hdrs_.data(), hdrs_.size());
+    append_age_hdr(now, out);
+}
+
+void fresh_index::entry::get_range_resp_hdrs(time_t now,
+                                             bytes64_t beg,
+                                             bytes64_t end,
+                                             boost_string_t& out) const
+    noexcept
+{
+    X3ME_ASSERT((beg <= end) && (end < obj_full_len_), "Invalid range");
+    constexpr string_view_t eol{"\r\n", 2};
+    constexpr string_view_t clen{"Content-Length:", 15};
+    auto hdrs = to_string_view(hdrs_);
+    // The status line is replaced keeping the HTTP version. The headers
+    // are well formed, because they have been checked when stored.
+    const auto ver = hdrs.substr(0, hdrs.find(' '));
+    hdrs.remove_prefix(hdrs.find(eol) + eol.size());
+    x3me::utilities::string_builder_256 rng_hdrs;
+    rng_hdrs << ver << " 206 Partial Content\r\n"
+             << "Content-Length: " << ((end - beg) + 1) << "\r\n"
+             << "Content-Range: bytes " << beg << '-' << end << '/'
+             << obj_full_len_ << "\r\n";
+    out.reserve(out.size() + hdrs_.size() + rng_hdrs.size());
+    out.append(rng_hdrs.data(), rng_hdrs.size());
+    while (!hdrs.empty())
+    {
+        const auto len  = hdrs.find(eol) + eol.size();
+        const auto line = hdrs.substr(0, len);
+        if (!boost::istarts_with(line, clen))
+            out.append(line.data(), line.size());
+        hdrs.remove_prefix(len);
+    }
+    append_age_hdr(now, out);
+}
+
+void fresh_index::entry::get_cond_hdrs(boost_string_t& out) const noexcept
+{
+    if (!etag_.empty())
+    {
+        constexpr string_view_t hdr{"If-None-Match: ", 15};
+        out.append(hdr.data(), hdr.size());
+        out.append(etag_.data(), etag_.size());
+        out.append("\r\n", 2);
+    }
+    if (last_modified_ != 0)
+    {
+        struct tm tmt = {};
+        char date[64];
+        ::gmtime_r(&last_modified_, &tmt);
+        const auto len = ::strftime(date, sizeof(date),
+                                    "If-Modified-Since: %a, %d %b %Y "
+                                    "%H:%M:%S GMT\r\n",
+                                    &tmt);
+        out.append(date, len);
+    }
+}
+
+void fresh_index::entry::append_age_hdr(time_t now,
+                                        boost_string_t& out) const noexcept
+{
+    const auto age = age_ + ((now > stored_at_) ? (now - stored_at_) : 0);
+    x3me::utilities::string_builder_64 age_hdr;
+    age_hdr << "Age: " << age << "\r\n\r\n";
+    out.append(age_hdr.data(), age_hdr.size());
+}
+
+string_view_t fresh_index::entry::index_url() const noexcept
+{
+    return to_string_view(cache_url_.empty() ? url_ : cache_url_);
+}
+
+bytes32_t fresh_index::entry::mem_size() const noexcept
+{
+    return sizeof(entry) + hdrs_.capacity() + url_.capacity() +
+           cache_url_.capacity() + content_encoding_.capacity() +
+           content_md5_.capacity() + digest_sha1_.capacity() +
+           digest_md5_.capacity() + etag_.capacity();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+fresh_index::fresh_index() noexcept
+{
+}
+
+fresh_index::~fresh_index() noexcept
+{
+    // The entries must be unlinked before their destruction
+    lru_.clear();
+}
+
+void fresh_index::set_max_size(bytes64_t max_size, uint32_t max_ttl) noexcept
+{
+    max_size_ = max_size;
+    max_ttl_  = max_ttl;
+}
+
+const fresh_index::entry* fresh_index::find(const string_view_t& url,
+                                            const tcp_endpoint_v4& origin,
+                                            time_t now) noexcept
+{
+    auto it = entries_.find(url);
+    if (it == entries_.end())
+        return nullptr;
+    auto& e = *it->second;
+    // The same URL requested from another origin may be a different object
+    if (!(e.origin_ == origin))
+        return nullptr;
+    if (!e.fresh(now) && !e.revalidatable())
+    {
+        rem_entry(it);
+        return nullptr;
+    }
+    lru_.erase(lru_.iterator_to(e));
+    lru_.push_back(e);
+    return &e;
+}
+
+bool fresh_index::insert(const cache::cache_key& key,
+                         const tcp_endpoint_v4& origin,
+                         const string_view_t& resp_hdrs,
+                         time_t now,
+                         time_t expires_at,
+                         uint32_t age) noexcept
+{
+    auto e = make_entry(key, origin, resp_hdrs, now, expires_at, age);
+    return e && add_entry(std::move(e));
+}
+
+std::unique_ptr<fresh_index::entry>
+fresh_index::make_entry(const cache::cache_key& key,
+                        const tcp_endpoint_v4& origin,
+                        const string_view_t& resp_hdrs,
+                        time_t now,
+                        time_t expires_at,
+                        uint32_t age) const noexcept
+{
+    const bool has_validators =
+        !key.etag_.empty() || (key.last_modified_ != 0);
+    if (!enabled() || (resp_hdrs.size() > max_hdrs_size) ||
+        key.rng_.valid() || ((expires_at <= now) && !has_validators))
+        return nullptr;
+
+    auto e = std::make_unique<entry>();
+    if (!copy_resp_hdrs(resp_hdrs, key.obj_full_len_, e->hdrs_))
+        return nullptr;
+    assign(e->url_, key.url_);
+    assign(e->cache_url_, key.cache_url_);
+    assign(e->content_encoding_, key.content_encoding_);
+    assign(e->content_md5_, key.content_md5_);
+    assign(e->digest_sha1_, key.digest_sha1_);
+    assign(e->digest_md5_, key.digest_md5_);
+    assign(e->etag_, key.etag_);
+    e->obj_full_len_  = key.obj_full_len_;
+    e->last_modified_ = key.last_modified_;
+    e->origin_        = origin;
+    e->stored_at_     = now;
+    e->expires_at_    = limit_ttl(now, expires_at);
+    e->age_           = age;
+
+    return e;
+}
+
+bool fresh_index::insert(std::unique_ptr<entry> e) noexcept
+{
+    return enabled() && add_entry(std::move(e));
+}
+
+void fresh_index::revalidated(entry& e,
+                              time_t now,
+                              time_t expires_at,
+                              uint32_t age) noexcept
+{
+    e.stored_at_  = now;
+    e.expires_at_ = limit_ttl(now, expires_at);
+    e.age_        = age;
+    if (enabled())
+        add_entry(std::make_unique<entry>(e));
+}
+
+void fresh_index::erase(const string_view_t& url) noexcept
+{
+    auto it = entries_.find(url);
+    if (it != entries_.end())
+        rem_entry(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool fresh_index::add_entry(std::unique_ptr<entry> e) noexcept
+{
+    const auto esize = e->mem_size();
+    if (esize > max_size_)
+        return false;
+
+    auto it = entries_.find(e->index_url());
+    if (it != entries_.end())
+        rem_entry(it);
+    while ((size_ + esize) > max_size_)
+    {
+        X3ME_ASSERT(!lru_.empty(), "Wrong size accounting");
+        rem_entry(entries_.find(lru_.front().index_url()));
+    }
+
+    lru_.push_back(*e);
+    size_ += esize;
+    const auto url = e->index_url();
+    entries_.emplace(url, std::move(e));
+    return true;
+}
+
+void fresh_index::rem_entry(entries_t::iterator it) noexcept
+{
+    auto& e = *it->second;
+    lru_.erase(lru_.iterator_to(e));
+    size_ -= e.mem_size();
+    entries_.erase(it);
+}
+
+time_t fresh_index::limit_ttl(time_t now, time_t expires_at) const noexcept
+{
+    return (max_ttl_ > 0) ? std::min<time_t>(expires_at, now + max_ttl_)
+                          : expires_at;
+}
+
+} // namespace http
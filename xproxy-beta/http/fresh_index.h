@@ -0,0 +1,166 @@
+#pragma once
+
+namespace cache
+{
+struct cache_key;
+} // namespace cache
+namespace http
+{
+
+// Maps request URLs to the response headers and the cache keys of objects
+// which are present in the cache and are still fresh according to their
+// 'Cache-Control: max-age' or 'Expires' headers. Such objects are served
+// directly from the cache, without sending the request to the origin.
+// The stale objects with 'ETag' or 'Last-Modified' headers are kept too.
+// They get revalidated with a conditional request to the origin.
+// The entries are bound to the origin endpoint from which the response has
+// come. The URL host comes from the client and in transparent mode nothing
+// guarantees that it matches the connected origin.
+// Every net thread has its own index and thus the index is not thread safe.
+// The least recently used entries are evicted when the size limit is reached.
+class fresh_index
+{
+    using list_hook_t = boost::intrusive::list_base_hook<
+        boost::intrusive::link_mode<boost::intrusive::safe_link>>;
+
+public:
+    class entry : public list_hook_t
+    {
+        friend class fresh_index;
+
+        // The response headers without the 'Age' header and without the
+        // empty line at the end.
+        boost_string_t hdrs_;
+        // The owned values of the cache key fields
+        boost_string_t url_;
+        boost_string_t cache_url_;
+        boost_string_t content_encoding_;
+        boost_string_t content_md5_;
+        boost_string_t digest_sha1_;
+        boost_string_t digest_md5_;
+        boost_string_t etag_;
+        uint64_t obj_full_len_ = 0;
+        time_t last_modified_  = 0;
+        tcp_endpoint_v4 origin_;
+
+        time_t stored_at_  = 0;
+        time_t expires_at_ = 0;
+        uint32_t age_      = 0; // The response age when stored
+
+        void append_age_hdr(time_t now, boost_string_t& out) const noexcept;
+
+    public:
+        cache::cache_key get_cache_key() const noexcept;
+        // Appends the response headers, with correct 'Age' header, for
+        // the given moment to the given string.
+        void get_resp_hdrs(time_t now, boost_string_t& out) const noexcept;
+        // Appends '206 Partial Content' response headers for the given
+        // inclusive byte range of the object, with correct 'Age' header.
+        void get_range_resp_hdrs(time_t now,
+                                 bytes64_t beg,
+                                 bytes64_t end,
+                                 boost_string_t& out) const noexcept;
+        // Appends the 'If-None-Match' and/or 'If-Modified-Since' headers,
+        // for revalidation of the entry, to the given string.
+        void get_cond_hdrs(boost_string_t& out) const noexcept;
+
+        bool fresh(time_t now) const noexcept { return expires_at_ > now; }
+        bool revalidatable() const noexcept
+        {
+            return !etag_.empty() || (last_modified_ != 0);
+        }
+        uint64_t obj_full_len() const noexcept { return obj_full_len_; }
+        const tcp_endpoint_v4& origin() const noexcept { return origin_; }
+
+        // The index key - the cache URL, if present, or the request URL
+        string_view_t index_url() const noexcept;
+        bytes32_t mem_size() const noexcept;
+    };
+
+private:
+    struct url_hash
+    {
+        size_t operator()(const string_view_t& v) const noexcept
+        {
+            return boost::hash_range(v.begin(), v.end());
+        }
+    };
+    // The keys point to the URL of the corresponding entry
+    using entries_t =
+        std::unordered_map<string_view_t, std::unique_ptr<entry>, url_hash>;
+    using lru_t = boost::intrusive::list<entry>;
+
+    entries_t entries_;
+    lru_t lru_;
+    bytes64_t size_ = 0;
+    // Zero means that the index is disabled
+    bytes64_t max_size_ = 0;
+    uint32_t max_ttl_   = 0;
+
+public:
+    // The max size of the stored response headers. The responses with
+    // bigger headers are not indexed.
+    static constexpr bytes32_t max_hdrs_size = 4_KB;
+
+    fresh_index() noexcept;
+    ~fresh_index() noexcept;
+
+    fresh_index(const fresh_index&) = delete;
+    fresh_index& operator=(const fresh_index&) = delete;
+    fresh_index(fresh_index&&) = delete;
+    fresh_index& operator=(fresh_index&&) = delete;
+
+    // Must be called before the index gets used.
+    // The max_ttl limits the time for which an entry is considered fresh,
+    // regardless of the response headers. Zero means no limit.
+    void set_max_size(bytes64_t max_size, uint32_t max_ttl) noexcept;
+
+    // Returns the entry for the given URL if it's been stored from the given
+    // origin and it's still fresh or it can be revalidated. Returns null
+    // otherwise. The expired entry without validators is removed.
+    // The returned entry is valid until the next call to a non-const method.
+    const entry* find(const string_view_t& url,
+                      const tcp_endpoint_v4& origin,
+                      time_t now) noexcept;
+    // Adds or replaces the entry for the key URL. The headers must be
+    // the whole response headers block, ending with an empty line.
+    // The origin is the endpoint from which the response has come.
+    // Returns false if the entry is not added.
+    bool insert(const cache::cache_key& key,
+                const tcp_endpoint_v4& origin,
+                const string_view_t& resp_hdrs,
+                time_t now,
+                time_t expires_at,
+                uint32_t age) noexcept;
+    // Creates the entry which the above insert would add, without adding it.
+    // It's used when the object is still to be stored in the cache.
+    // Returns null if the entry can't be added.
+    std::unique_ptr<entry> make_entry(const cache::cache_key& key,
+                                      const tcp_endpoint_v4& origin,
+                                      const string_view_t& resp_hdrs,
+                                      time_t now,
+                                      time_t expires_at,
+                                      uint32_t age) const noexcept;
+    // Adds or replaces the entry for its URL.
+    // Returns false if the entry is not added.
+    bool insert(std::unique_ptr<entry> e) noexcept;
+    // Updates the freshness of the given entry, a copy of an indexed one,
+    // after a successful revalidation. The entry is added again if it's
+    // been removed from the index in the meantime.
+    void revalidated(entry& e,
+                     time_t now,
+                     time_t expires_at,
+                     uint32_t age) noexcept;
+    void erase(const string_view_t& url) noexcept;
+
+    bool enabled() const noexcept { return max_size_ > 0; }
+    size_t size() const noexcept { return entries_.size(); }
+    bytes64_t mem_size() const noexcept { return size_; }
+
+private:
+    bool add_entry(std::unique_ptr<entry> e) noexcept;
+    void rem_entry(entries_t::iterator it) noexcept;
+    time_t limit_ttl(time_t now, time_t expires_at) const noexcept;
+};
+
+} // namespace http
@@ -8,14 +8,15 @@ namespace http
 
 net::handler_factory_t make_handler_factory(cache::object_distributor& cod,
                                             all_stats& stats,
-                                            http_bp_ctl& bp_ctl) noexcept
+                                            http_bp_ctl& bp_ctl,
+                                            fresh_index& fresh_idx) noexcept
 {
-    return [&cod, &stats,
-            &bp_ctl](const id_tag& tag, io_service_t& ios,
-                     net_thread_id_t net_tid) -> net::proto_handler_ptr_t
+    return [&cod, &stats, &bp_ctl,
+            &fresh_idx](const id_tag& tag, io_service_t& ios,
+                        net_thread_id_t net_tid) -> net::proto_handler_ptr_t
     {
-        return std::make_unique<detail::http_handler>(tag, cod, ios, net_tid,
-                                                      stats, bp_ctl);
+        return std::make_unique<detail::http_handler>(
+            tag, cod, ios, net_tid, stats, bp_ctl, fresh_idx);
     };
 }
 
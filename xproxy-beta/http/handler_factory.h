@@ -10,9 +10,11 @@ namespace http
 {
 class all_stats;
 class http_bp_ctl;
+class fresh_index;
 
 net::handler_factory_t make_handler_factory(cache::object_distributor& cod,
                                             all_stats& stats,
-                                            http_bp_ctl& bp_ctl) noexcept;
+                                            http_bp_ctl& bp_ctl,
+                                            fresh_index& fresh_idx) noexcept;
 
 } // namespace http
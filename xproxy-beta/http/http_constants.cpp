@@ -4,4 +4,6 @@
 namespace http
 {
 bytes32_t constants::bpctrl_window_size = 16_KB;
+bytes32_t constants::max_dechunked_size = 0;
+bytes64_t constants::max_dechunked_total = 64_MB;
 } // namespace http
@@ -14,6 +14,11 @@ enum : bytes32_t
 struct constants
 {
     static bytes32_t bpctrl_window_size;
+    // The max size of a chunked response body collected for caching.
+    // Zero disables the collecting.
+    static bytes32_t max_dechunked_size;
+    // The max size of all response bodies collected at the same time.
+    static bytes64_t max_dechunked_total;
 };
 
 } // namespace http
@@ -1,6 +1,8 @@
 #include "precompiled.h"
 #include "http_handler.h"
 #include "async_cache_reader.h"
+#include "dechunked_writer.h"
+#include "fresh_index.h"
 #include "http_bp_ctl.h"
 #include "http_constants.h"
 #include "http_stats.h"
@@ -27,6 +29,7 @@ enum origin_rbuf_size_idx : uint8_t
 {
     origin_rbuf_size_def = 0,
     origin_rbuf_size_max = 1,
+    origin_rbuf_size_hit = 2,
 };
 static constexpr bytes32_t min_csum_data_len = 1;
 // The origin buffer is at least one block or more.
@@ -38,7 +41,7 @@ static_assert(client_rbuf_block_size == 4_KB,
 static_assert(origin_rbuf_block_size == 8_KB,
               "Must correspond to the below array constants");
 static constexpr bytes32_t client_rbuf_size[] = {4_KB, 8_KB, 16_KB};
-static constexpr bytes32_t origin_rbuf_size[] = {8_KB, 16_KB};
+static constexpr bytes32_t origin_rbuf_size[] = {8_KB, 16_KB, 32_KB};
 
 static auto curr_block(const xutils::io_buff_reader& rdr) noexcept
 {
@@ -84,6 +87,106 @@ compare_buffers(const xutils::io_buff_reader& ior,
     return true;
 }
 
+// The fresh index uses the same key as the cache - the cache URL, if present,
+// or the request URL.
+static string_view_t fresh_index_url(const http_trans& trans) noexcept
+{
+    const auto url = trans.cache_url();
+    return url.empty() ? trans.req_url() : url;
+}
+
+// Creates the fresh index entry for the finished current transaction, if
+// its response allows it. The response headers are null if they haven't
+// been collected. The previous entry for the same URL is always removed.
+// The entry is bound to the origin endpoint from the given tag.
+static std::unique_ptr<fresh_index::entry>
+make_fresh_entry(fresh_index& fresh_idx,
+                 const http_trans& trans,
+                 const boost_string_t* resp_hdrs,
+                 const id_tag& tag) noexcept
+{
+    std::unique_ptr<fresh_index::entry> ret;
+    // The index entry has been already updated for a revalidated hit
+    if (!fresh_idx.enabled() || trans.is_cache_fresh_hit() ||
+        trans.is_cache_reval_hit())
+        return ret;
+    const auto now  = ::time(nullptr);
+    const auto ckey = trans.get_cache_key();
+    if (!ckey)
+        return ret;
+    // The newer response may not be fresh or may be different
+    fresh_idx.erase(fresh_index_url(trans));
+    const auto fr = trans.resp_freshness(now);
+    if (fr && resp_hdrs)
+    {
+        ret = fresh_idx.make_entry(*ckey, tag.server_endpoint(),
+                                   to_string_view(*resp_hdrs), now,
+                                   fr->expires_at_, fr->age_);
+        XLOG_DEBUG(tag, "Fresh index entry. Fresh for {} secs. Age {}. "
+                        "Created {}. CKey {}",
+                   fr->expires_at_ - now, fr->age_, !!ret, *ckey);
+    }
+    return ret;
+}
+
+struct reval_ctx
+{
+    // Copy of the revalidated entry. The index one may get evicted.
+    fresh_index::entry entry_;
+    // The response bytes not sent to the client until the response
+    // status is known.
+    bytes32_t held_bytes_ = 0;
+
+    explicit reval_ctx(const fresh_index::entry& e) noexcept : entry_(e) {}
+};
+
+// Closes the cache write handle of a finished transaction and adds the
+// object to the fresh index only if all of its data has been handed to the
+// cache. It lives on its own for the same reasons as the dechunked_writer.
+struct fresh_recorder final
+    : public std::enable_shared_from_this<fresh_recorder>
+{
+    cache::async_stream stream_;
+    fresh_index& fresh_idx_;
+    all_stats& all_stats_;
+    std::unique_ptr<fresh_index::entry> entry_;
+    id_tag tag_;
+
+    fresh_recorder(cache::async_stream&& stream,
+                   fresh_index& fresh_idx,
+                   all_stats& sts,
+                   std::unique_ptr<fresh_index::entry>&& e,
+                   const id_tag& tag) noexcept : stream_(std::move(stream)),
+                                                 fresh_idx_(fresh_idx),
+                                                 all_stats_(sts),
+                                                 entry_(std::move(e)),
+                                                 tag_(tag)
+    {
+    }
+
+    void close() noexcept
+    {
+        stream_.async_close([self = shared_from_this()](const err_code_t& err)
+                            {
+                                self->closed(err);
+                            });
+    }
+
+    void closed(const err_code_t& err) noexcept
+    {
+        if (err)
+        {
+            XLOG_DEBUG(tag_, "Cache write not finished. Skip fresh index "
+                             "add. {}",
+                       err.message());
+            return;
+        }
+        XLOG_DEBUG(tag_, "Fresh index add. CKey {}", entry_->get_cache_key());
+        if (fresh_idx_.insert(std::move(entry_)))
+            ++all_stats_.var_stats_.cnt_fresh_stored_;
+    }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace hhsm // HTTP Handler State Machine
 {
@@ -91,6 +194,11 @@ namespace hhsm // HTTP Handler State Machine
 // clang-format off
 // Events
 struct ev_cache_open_rd { net::proxy_conn* conn_; };
+struct ev_cache_open_fresh 
+{ 
+    net::proxy_conn* conn_; 
+    const cache::cache_key* key_; 
+};
 struct ev_compare_ok { net::proxy_conn* conn_; };
 struct ev_compare_fail { net::proxy_conn* conn_; };
 struct ev_cache_open_wr { net::proxy_conn* conn_; };
@@ -145,6 +253,23 @@ struct sm_impl
         { 
             h->cache_open_rd(*ev.conn_);
         };
+        auto cache_open_fresh = [](http_handler* h, auto ev)
+        { 
+            h->cache_open_fresh(*ev.conn_, *ev.key_);
+        };
+        auto switch_fresh_stream = [](http_handler* h, auto ev)
+        {
+            h->switch_fresh_stream(*ev.conn_);
+        };
+        auto fresh_fallback = [](http_handler* h, auto ev)
+        {
+            h->fresh_fallback(*ev.conn_);
+        };
+        auto fresh_record = [](http_handler* h) { h->fresh_record(); };
+        auto cache_close_record = [](http_handler* h)
+        {
+            h->cache_close_record();
+        };
         auto cache_read_compare = [](http_handler* h, auto ev)
         { 
             h->cache_read_compare(*ev.conn_);
@@ -190,6 +315,7 @@ struct sm_impl
         using namespace boost::sml;
         const auto wait_body_data_s = "wait_body_data"_s;
         const auto cache_open_rd_s  = "cache_open_rd"_s;
+        const auto cache_open_fresh_s = "cache_open_fresh"_s;
         const auto cache_compare_s  = "cache_compare"_s;
         const auto cache_open_wr_s  = "cache_open_wr"_s;
         const auto cache_read_s     = "cache_read"_s;
@@ -223,6 +349,18 @@ struct sm_impl
                                 (cache_close, cache_open_wr) = cache_open_wr_s,
             cache_open_rd_s + event<ev_cache_op_next> [pend_blind_tunnel] /
                             (cache_close, start_blind_tunnel) = cache_closed_s,
+            // Open fresh object phase. The request hasn't been sent to the
+            // origin and it's sent only if the object can't be opened.
+            wait_body_data_s + event<ev_cache_open_fresh> /
+                        (pause_org_recv, cache_open_fresh) = cache_open_fresh_s,
+            cache_open_fresh_s + event<ev_cache_op_done> [!pend_blind_tunnel] /
+                                        switch_fresh_stream = cache_read_s,
+            cache_open_fresh_s + event<ev_cache_op_done> [pend_blind_tunnel] /
+                            (cache_close, start_blind_tunnel) = cache_closed_s,
+            cache_open_fresh_s + event<ev_cache_op_err> [!pend_blind_tunnel] /
+                            (cache_close, fresh_fallback) = wait_body_data_s,
+            cache_open_fresh_s + event<ev_cache_op_err> [pend_blind_tunnel] /
+                            (cache_close, start_blind_tunnel) = cache_closed_s,
             // Checksum phase
             cache_compare_s + event<ev_compare_ok> [!pend_blind_tunnel] /
                         (consume_cache_data, switch_org_stream) = cache_read_s,
@@ -251,7 +389,9 @@ struct sm_impl
                             (cache_close, start_blind_tunnel) = cache_closed_s,
             // Cache read phase
             cache_read_s + event<ev_org_data> / consume_cache_data,
-            cache_read_s + event<ev_trans_completed> / set_trans_completed,
+            cache_read_s + event<ev_skip_trans> / skip_act,
+            cache_read_s + event<ev_trans_completed> / 
+                                        (fresh_record, set_trans_completed),
             cache_read_s + event<ev_cache_op_done> = cache_closed_s,
             // Write data phase
             cache_idle_wr_s + event<ev_org_data> / cache_write = cache_write_s,
@@ -270,10 +410,12 @@ struct sm_impl
                             (cache_close, start_blind_tunnel) = cache_closed_s,
             // This line is a bit of a hack. See ev_trans_completed usage.
             cache_idle_wr_s + event<ev_trans_completed> / 
-                        (cache_close, fin_trans_send_next) = wait_body_data_s,
+            (cache_close_record, fin_trans_send_next) = wait_body_data_s,
             // Handle blind tunnel in the different states 
             cache_open_rd_s + event<ev_try_blind_tunnel> / 
                                     (rem_bpctrl_entry, set_pend_blind_tunnel),
+            cache_open_fresh_s + event<ev_try_blind_tunnel> / 
+                                    (rem_bpctrl_entry, set_pend_blind_tunnel),
             cache_compare_s + event<ev_try_blind_tunnel> / 
                                     (rem_bpctrl_entry, set_pend_blind_tunnel),
             cache_open_wr_s + event<ev_try_blind_tunnel> /
@@ -337,6 +479,18 @@ public:
         return base_t::is("cache_read"_s);
     }
 
+    bool is_waiting_body_data() const noexcept
+    {
+        using namespace boost::sml;
+        return base_t::is("wait_body_data"_s);
+    }
+
+    bool is_opening_fresh() const noexcept
+    {
+        using namespace boost::sml;
+        return base_t::is("cache_open_fresh"_s);
+    }
+
 private:
     template <typename S1, typename S2>
     bool in_any_state(S1, S2) const noexcept
@@ -363,11 +517,15 @@ http_handler::http_handler(const id_tag& tag,
                            io_service_t& ios,
                            net_thread_id_t net_tid,
                            all_stats& sts,
-                           http_bp_ctl& bp_ctl) noexcept
+                           http_bp_ctl& bp_ctl,
+                           fresh_index& fresh_idx) noexcept
     : cache_handle_(cod, ios),
+      cod_(cod),
       csm_(this),
       all_stats_(sts),
       bp_ctrl_(bp_ctl),
+      fresh_idx_(fresh_idx),
+      ios_(ios),
       tag_(tag),
       client_rbuf_size_idx_(detail::client_rbuf_size_def),
       origin_rbuf_size_idx_(detail::origin_rbuf_size_def),
@@ -518,6 +676,8 @@ void http_handler::on_client_data(net::proxy_conn& conn) noexcept
     expand_client_recv_buff_if_needed(transactions_.back(), conn);
 
     const auto curr_bytes = transactions_[0].req_bytes();
+    if ((prev_bytes == 0) && (curr_bytes > 0) && try_fresh_hit(conn))
+        return;
     if (curr_bytes > prev_bytes)
     {
         // If we hasn't started sending the request we need to coordinated the
@@ -605,9 +765,23 @@ void http_handler::on_client_send_err(net::proxy_conn& conn) noexcept
 
 void http_handler::on_origin_data(net::proxy_conn& conn) noexcept
 {
-    X3ME_ASSERT(
-        !(flags_ & flags::origin_recv_paused),
-        "We must not receive data while the origin connection is paused");
+    if (X3ME_UNLIKELY(flags_ & flags::origin_recv_paused))
+    {
+        // The receiving could have completed just before the pause, while
+        // the request is served from the cache. The request hasn't been
+        // sent and thus the server talks first.
+        X3ME_ASSERT(
+            csm_->is_opening_fresh(),
+            "We must not receive data while the origin connection is paused");
+        const auto blk = detail::curr_block(origin_rdr_);
+        XLOG_INFO(org_trans_tag(),
+                  "Http_handler::on_origin_data. Trying blind tunnel on "
+                  "origin data before the request. Resp_data:\n{}",
+                  print_lim_text(blk, 50U));
+        ++all_stats_.var_stats_.cnt_server_talks_first_;
+        csm_->process_event(hhsm::ev_try_blind_tunnel{&conn});
+        return;
+    }
 
     const auto avail_bytes = origin_rdr_.bytes_avail();
 
@@ -788,6 +962,9 @@ bool http_handler::consume_curr_resp_data(net::proxy_conn& conn) noexcept
     }
     rdr.consume(consumed);
 
+    if (reval_ && !on_reval_resp_data(conn, trans, consumed))
+        return false;
+
     adjust_trans_state(conn, trans, (!had_hdrs && trans.resp_completed()));
 
     return true;
@@ -813,8 +990,13 @@ void http_handler::adjust_trans_state(net::proxy_conn& conn,
     // from the headers or all of them (in case of HTTP tunnel).
     // If all transaction data is received at once it doesn't make much sense
     // to try store it in the cache. It's too small, so skip it.
+    // The transaction which collects its de-chunked body is not skipped,
+    // so that its headers get collected for the fresh index.
     if (trans.in_http_tunnel())
-        csm_->process_event(hhsm::ev_skip_trans{});
+    {
+        if (!trans.collects_resp_body())
+            csm_->process_event(hhsm::ev_skip_trans{});
+    }
     else if (completed_at_once)
         csm_->process_event(hhsm::ev_skip_trans{});
     // Here we inform the state machine for the new received data. It may
@@ -830,10 +1012,10 @@ bool http_handler::set_curr_trans_backpressure_params(
     if (flags_ & flags::tr_bpctrl_params_set) // Set them only once per trans
         return true;
 
-    if (trans.is_chunked())
+    // The chunked transaction may enter HTTP tunnel as late as on
+    // its response headers end.
+    if (trans.is_chunked() && trans.in_http_tunnel())
     {
-        X3ME_ASSERT(trans.in_http_tunnel(),
-                    "Must be in http tunnel if it's chunked");
         X3ME_ASSERT((flags_ & flags::bpctrl_entry_added),
                     "The entry must have been added");
         XLOG_INFO(org_trans_tag(), "BPCTRL control set chunked");
@@ -987,6 +1169,138 @@ bool http_handler::process_curr_trans_resp(net::proxy_conn& conn) noexcept
     return true;
 }
 
+bool http_handler::try_fresh_hit(net::proxy_conn& conn) noexcept
+{
+    // Only the single, not pipelined, request for which the origin
+    // receiving can be paused is served this way.
+    auto& trans = transactions_[0];
+    if (!fresh_idx_.enabled() || (transactions_.size() > 1) ||
+        !trans.req_fresh_servable() || !csm_->is_waiting_body_data() ||
+        !conn.can_pause_origin_recv())
+        return false;
+    ++all_stats_.var_stats_.cnt_fresh_lookup_;
+    // The plugins may set the cache URL which is also the index key
+    plgns::plugins::instance->on_before_cache_open_read(net_thread_id_, trans);
+    const auto now = ::time(nullptr);
+    const auto* e  = fresh_idx_.find(detail::fresh_index_url(trans),
+                                     tag_.server_endpoint(), now);
+    if (!e)
+        return false;
+    if (!e->fresh(now))
+    {
+        // The '304' response is consumed without being sent to the client.
+        // Thus there must be no previous response data pending for it.
+        // The revalidated object is served only as a whole.
+        if ((conn.client_pending_bytes() > 0) || trans.has_req_range())
+            return false;
+        reval_ = std::make_unique<reval_ctx>(*e);
+        start_reval(conn);
+        return true;
+    }
+    fresh_hdrs_.clear();
+    auto ckey = e->get_cache_key();
+    if (trans.has_req_range())
+    {
+        // The unsatisfiable ranges and the ranges too small for the cache
+        // are answered by the origin.
+        const auto rng = trans.req_range(ckey.obj_full_len_);
+        if (!rng)
+            return false;
+        ckey.rng_.beg_ = rng->beg_;
+        ckey.rng_.end_ = rng->end_;
+        if (!cache::rw_op_allowed(ckey))
+            return false;
+        e->get_range_resp_hdrs(now, rng->beg_, rng->end_, fresh_hdrs_);
+    }
+    else
+    {
+        e->get_resp_hdrs(now, fresh_hdrs_);
+    }
+    XLOG_DEBUG(org_trans_tag(), "Fresh index hit. CKey {}", ckey);
+    csm_->process_event(hhsm::ev_cache_open_fresh{&conn, &ckey});
+    return true;
+}
+
+void http_handler::start_reval(net::proxy_conn& conn) noexcept
+{
+    // The conditional headers are inserted before the empty line which
+    // ends the request headers. The request has no body.
+    constexpr string_view_t eol{"\r\n", 2};
+    boost_string_t cond_hdrs;
+    reval_->entry_.get_cond_hdrs(cond_hdrs);
+    cond_hdrs.append(eol.data(), eol.size());
+    ++all_stats_.var_stats_.cnt_reval_;
+    const auto bytes = transactions_[0].req_bytes();
+    XLOG_DEBUG(org_trans_tag(), "Revalidate stale object. Send conditional "
+                                "request to origin. {} bytes. Cond_hdrs:\n{}",
+               bytes, to_string_view(cond_hdrs));
+    conn.send_to_origin(bytes - eol.size(), eol.size(), std::move(cond_hdrs));
+}
+
+bool http_handler::on_reval_resp_data(net::proxy_conn& conn,
+                                      http_trans& trans,
+                                      bytes32_t consumed) noexcept
+{
+    reval_->held_bytes_ += consumed;
+    if (!trans.resp_hdrs_completed())
+        return false;
+    if (trans.resp_not_modified())
+    {
+        serve_reval_hit(conn, trans);
+        return false;
+    }
+    // The object has changed. The response goes to the client as usual.
+    // The bytes received with this call are sent by the caller.
+    const auto held = reval_->held_bytes_ - consumed;
+    XLOG_DEBUG(org_trans_tag(), "Revalidated object changed. Held_bytes {}",
+               held);
+    reval_.reset();
+    if (held > 0)
+        conn.send_to_client(held);
+    return true;
+}
+
+void http_handler::serve_reval_hit(net::proxy_conn& conn,
+                                   http_trans& trans) noexcept
+{
+    if ((origin_rdr_.bytes_avail() > 0) || !conn.can_pause_origin_recv())
+    {
+        XLOG_WARN(org_trans_tag(), "Can't serve revalidated object. Origin "
+                                   "data after the 304 response {} bytes",
+                  origin_rdr_.bytes_avail());
+        reval_failed(conn);
+        return;
+    }
+    auto& e        = reval_->entry_;
+    const auto now = ::time(nullptr);
+    const auto fr  = trans.resp_freshness(now);
+    fresh_idx_.revalidated(e, now, fr ? fr->expires_at_ : now,
+                           fr ? fr->age_ : 0);
+    ++all_stats_.var_stats_.cnt_reval_304_;
+    all_stats_.var_stats_.bytes_reval_saved_ += e.obj_full_len();
+    XLOG_DEBUG(org_trans_tag(), "Revalidated object not modified. Skip {} "
+                                "response bytes. Fresh for {} secs",
+               reval_->held_bytes_, fr ? (fr->expires_at_ - now) : 0);
+
+    // The '304' response is replaced with the one from the cache
+    conn.skip_origin_data(reval_->held_bytes_);
+    consume_cache_data();
+    trans.reset_resp();
+    fresh_hdrs_.clear();
+    e.get_resp_hdrs(now, fresh_hdrs_);
+    const auto ckey = e.get_cache_key();
+    csm_->process_event(hhsm::ev_cache_open_fresh{&conn, &ckey});
+}
+
+void http_handler::reval_failed(net::proxy_conn& conn) noexcept
+{
+    // The request has been answered by the origin with a '304' response
+    // which the client hasn't asked for. Nothing else can be sent to the
+    // client for this request.
+    reval_.reset();
+    conn.enqueue_close_client();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool http_handler::has_cache_wr_data() const noexcept
@@ -1034,6 +1348,7 @@ void http_handler::switch_org_stream(net::proxy_conn& conn) noexcept
                                          "successfully opened for reading "
                                          "before calling this function");
     rem_bpctrl_entry();
+    expand_origin_recv_buff_for_hit(conn);
     net::async_read_stream::impl_type<async_cache_reader> impl;
     conn.switch_org_stream(
         net::async_read_stream{impl, std::move(cache_handle_)});
@@ -1069,11 +1384,13 @@ void http_handler::fin_trans_send_next(net::proxy_conn& conn) noexcept
     all_stats_.var_stats_.cnt_all_trans_hit_ += trans.is_cache_hit();
     detail::inc_trans_id(org_trans_id_);
     trans.update_resp_stats(all_stats_);
+    store_dechunked(trans);
     plgns::plugins::instance->on_transaction_end(net_thread_id_, trans);
     trans.log_before_destroy();
     transactions_.erase(transactions_.begin());
     // The 'trans' reference is no longer valid after this point
     reset_per_trans_flags();
+    fresh_hdrs_.clear();
     // This flag may or may not be set when we enter this function.
     // Sometimes we set the flag as pending, other times we don't need to
     // set the flag and call the function directly depending on the cache state.
@@ -1107,10 +1424,35 @@ void http_handler::consume_cache_hdrs_data() noexcept
     }
     if (avail > 0)
     {
+        if (fresh_idx_.enabled() && !(flags_ & flags::tr_no_fresh_hdrs))
+        {
+            // Keep the headers for the fresh index, if they are small enough
+            if ((fresh_hdrs_.size() + avail) <= fresh_index::max_hdrs_size)
+            {
+                auto rem = avail;
+                for (auto it = org_cache_rdr_.begin(); rem > 0; ++it)
+                {
+                    const auto blk = *it;
+                    const auto len = std::min<bytes32_t>(blk.size(), rem);
+                    fresh_hdrs_.append(
+                        reinterpret_cast<const char*>(blk.data()), len);
+                    rem -= len;
+                }
+            }
+            else
+            {
+                flags_ |= flags::tr_no_fresh_hdrs;
+                fresh_hdrs_.clear();
+            }
+        }
         XLOG_TRACE(org_trans_tag(),
                    "Consuming {} header bytes from origin cache reader", avail);
         org_cache_rdr_.consume(avail);
     }
+    // The body of the not skipped HTTP tunnel transaction, which collects
+    // its de-chunked body, is not needed here.
+    if (trans.resp_hdrs_completed() && trans.in_http_tunnel())
+        consume_cache_data();
 }
 
 void http_handler::consume_cache_data() noexcept
@@ -1179,6 +1521,159 @@ void http_handler::cache_open_rd(net::proxy_conn& conn) noexcept
         });
 }
 
+void http_handler::cache_open_fresh(net::proxy_conn& conn,
+                                    const cache::cache_key& key) noexcept
+{
+    XLOG_DEBUG(org_trans_tag(), "Start cache read of fresh object. CKey {}",
+               key);
+    const bytes32_t skip_len = 0;
+    cache_handle_.async_open_read(
+        key, skip_len,
+        [ alive = conn.shared_from_this(), this ](const err_code_t& err)
+        {
+            if (!err)
+            {
+                csm_->process_event(hhsm::ev_cache_op_done{alive.get()});
+                return;
+            }
+            X3ME_ASSERT(!transactions_.empty(), "There must be at least one "
+                                                "transaction with unsent "
+                                                "request");
+            ++all_stats_.var_stats_.cnt_fresh_open_err_;
+            if (err == cache::object_not_present)
+            {
+                // The object has been overwritten in the cache
+                XLOG_DEBUG(org_trans_tag(), "Fresh object not present");
+                fresh_idx_.erase(detail::fresh_index_url(transactions_[0]));
+            }
+            else
+            {
+                XLOG_WARN(org_trans_tag(), "Cache open fresh object error. {}",
+                          err.message());
+            }
+            csm_->process_event(hhsm::ev_cache_op_err{alive.get()});
+        });
+}
+
+void http_handler::switch_fresh_stream(net::proxy_conn& conn) noexcept
+{
+    X3ME_ASSERT(cache_handle_.is_open(), "The cache handle must have been "
+                                         "successfully opened for reading "
+                                         "before calling this function");
+    X3ME_ASSERT(!transactions_.empty(), "There must be at least one "
+                                        "transaction with unsent request");
+    auto& trans = transactions_[0];
+    if (reval_)
+    {
+        trans.set_cache_reval_hit();
+        reval_.reset();
+    }
+    else
+    {
+        trans.set_cache_fresh_hit();
+        ++all_stats_.var_stats_.cnt_fresh_hit_;
+        all_stats_.var_stats_.cnt_fresh_range_hit_ += trans.has_req_range();
+    }
+    // Don't look for the object again when the response headers come
+    flags_ |= flags::tr_caching_started;
+    rem_bpctrl_entry();
+    XLOG_DEBUG(org_trans_tag(), "Serving fresh object. Hdrs_bytes {}",
+               fresh_hdrs_.size());
+    expand_origin_recv_buff_for_hit(conn);
+    net::async_read_stream::impl_type<async_fresh_reader> impl;
+    conn.switch_org_stream(net::async_read_stream{
+        impl, std::move(cache_handle_), std::move(fresh_hdrs_), ios_});
+    conn.resume_origin_recv();
+    flags_ &= ~flags::origin_recv_paused;
+}
+
+void http_handler::fresh_fallback(net::proxy_conn& conn) noexcept
+{
+    X3ME_ASSERT(!transactions_.empty(), "There must be at least one "
+                                        "transaction with unsent request");
+    fresh_hdrs_.clear();
+    // The conditional request has been already sent and answered
+    if (reval_)
+    {
+        XLOG_WARN(org_trans_tag(), "Can't serve revalidated object");
+        reval_failed(conn);
+        return;
+    }
+    // The receive operation, cancelled by the pause, has been completed
+    // before the cache operation, because the former is queued first.
+    conn.resume_origin_recv();
+    flags_ &= ~flags::origin_recv_paused;
+    const auto bytes = transactions_[0].req_bytes();
+    XLOG_DEBUG(org_trans_tag(), "Send request to origin. {} bytes", bytes);
+    conn.send_to_origin(bytes);
+}
+
+void http_handler::fresh_record() noexcept
+{
+    X3ME_ASSERT(!transactions_.empty(), "There must be at least one "
+                                        "transaction when in this state");
+    const auto* hdrs =
+        (flags_ & flags::tr_no_fresh_hdrs) ? nullptr : &fresh_hdrs_;
+    // The object has been read from the cache i.e. it's already there
+    if (auto e = detail::make_fresh_entry(fresh_idx_, transactions_[0], hdrs,
+                                          org_trans_tag()))
+    {
+        XLOG_DEBUG(org_trans_tag(), "Fresh index add. CKey {}",
+                   e->get_cache_key());
+        if (fresh_idx_.insert(std::move(e)))
+            ++all_stats_.var_stats_.cnt_fresh_stored_;
+    }
+}
+
+void http_handler::cache_close_record() noexcept
+{
+    X3ME_ASSERT(!transactions_.empty(), "There must be at least one "
+                                        "transaction when in this state");
+    const auto* hdrs =
+        (flags_ & flags::tr_no_fresh_hdrs) ? nullptr : &fresh_hdrs_;
+    auto e = detail::make_fresh_entry(fresh_idx_, transactions_[0], hdrs,
+                                      org_trans_tag());
+    if (!e)
+    {
+        cache_close();
+        return;
+    }
+    // The object gets added to the fresh index after the cache write gets
+    // successfully finished. The write may still fail or may have been
+    // interrupted before all of the object data has been written.
+    XLOG_DEBUG(org_trans_tag(), "Closing cache handle. Fresh index add "
+                                "on success");
+    auto rec = std::make_shared<detail::fresh_recorder>(
+        std::move(cache_handle_), fresh_idx_, all_stats_, std::move(e),
+        org_trans_tag());
+    rec->close();
+}
+
+void http_handler::store_dechunked(http_trans& trans) noexcept
+{
+    if (!trans.has_resp_body())
+        return;
+    ++all_stats_.var_stats_.cnt_dechunk_collect_;
+    const auto now  = ::time(nullptr);
+    const auto fr   = trans.resp_freshness(now);
+    const auto ckey = trans.get_cache_key();
+    if (!fr || !ckey || (flags_ & flags::tr_no_fresh_hdrs) ||
+        !cache::rw_op_allowed(*ckey))
+        return;
+    auto e = fresh_idx_.make_entry(*ckey, tag_.server_endpoint(),
+                                   to_string_view(fresh_hdrs_), now,
+                                   fr->expires_at_, fr->age_);
+    if (!e)
+        return;
+    XLOG_DEBUG(org_trans_tag(), "Store de-chunked response. Fresh for {} secs. "
+                                "Age {}. CKey {}",
+               fr->expires_at_ - now, fr->age_, *ckey);
+    auto wr = std::make_shared<dechunked_writer<cache::async_stream>>(
+        cache::async_stream(cod_, ios_), fresh_idx_, all_stats_, std::move(e),
+        trans.release_resp_body(), org_trans_tag());
+    wr->start();
+}
+
 void http_handler::cache_read_compare(net::proxy_conn& conn) noexcept
 {
     // Don't read from the cache already received body data
@@ -1290,8 +1785,14 @@ void http_handler::cache_open_wr(net::proxy_conn& conn,
                 X3ME_ASSERT(err != cache::already_open,
                             "Wrong state machine. Must not try open when "
                             "already open");
-                XLOG_WARN(org_trans_tag(), "Error opening cache for write. {}",
-                          err.message());
+                // Not admitted objects are a normal thing, not an error
+                if (err == cache::object_not_admitted)
+                    XLOG_DEBUG(org_trans_tag(), "Cache open for write. {}",
+                               err.message());
+                else
+                    XLOG_WARN(org_trans_tag(),
+                              "Error opening cache for write. {}",
+                              err.message());
                 consume_cache_wr_data(*alive, org_cache_rdr_.bytes_avail());
                 csm_->process_event(hhsm::ev_cache_op_err{alive.get()});
             }
@@ -1389,7 +1890,7 @@ void http_handler::rem_bpctrl_entry() noexcept
 void http_handler::reset_per_trans_flags() noexcept
 {
     flags_ &= ~(flags::tr_bpctrl_params_set | flags::tr_caching_started |
-                flags::tr_after_end_data);
+                flags::tr_after_end_data | flags::tr_no_fresh_hdrs);
 }
 
 void http_handler::expand_client_recv_buff_if_needed(
@@ -1442,11 +1943,23 @@ void http_handler::expand_origin_recv_buff_if_needed(
         }
         break;
     case detail::origin_rbuf_size_max:
+    case detail::origin_rbuf_size_hit:
         // Don't need to (can't) expand the buffer
         break;
     }
 }
 
+void http_handler::expand_origin_recv_buff_for_hit(
+    net::proxy_conn& conn) noexcept
+{
+    // The cached data is referred by the origin buffer blocks instead of
+    // copied to them. More blocks allow receiving more data from the cache
+    // while the previously received blocks are being sent to the client.
+    const auto idx        = detail::origin_rbuf_size_hit;
+    origin_rbuf_size_idx_ = idx;
+    conn.expand_origin_recv_buff(detail::origin_rbuf_size[idx]);
+}
+
 const id_tag& http_handler::no_trans_tag() noexcept
 {
     tag_.set_transaction_id(0);
@@ -13,10 +13,12 @@ namespace http
 {
 struct all_stats;
 class http_bp_ctl;
+class fresh_index;
 namespace detail
 {
 enum client_rbuf_size_idx : uint8_t;
 enum origin_rbuf_size_idx : uint8_t;
+struct reval_ctx;
 namespace hhsm
 {
 struct sm;
@@ -39,8 +41,11 @@ class http_handler final : public net::proto_handler
     xutils::io_buff_reader org_cache_rdr_; // Origin to cache reader
 
     cache::async_stream cache_handle_;
+    // Used for the cache writes of the de-chunked responses, which are done
+    // independently of the connection.
+    cache::object_distributor& cod_;
 
-    x3me::utils::pimpl<hhsm::sm, 64, 8> csm_; // The cache logic state machine
+    x3me::utils::pimpl<hhsm::sm, 72, 8> csm_; // The cache logic state machine
 
     transactions_t transactions_;
 
@@ -48,6 +53,17 @@ class http_handler final : public net::proto_handler
 
     http_bp_ctl& bp_ctrl_;
 
+    fresh_index& fresh_idx_;
+    // The response headers of the current transaction. They are either
+    // collected from the origin, to be added to the fresh index, or taken
+    // from the index, to be served together with the cached object.
+    boost_string_t fresh_hdrs_;
+    // Present while a stale object from the fresh index is revalidated
+    // with a conditional request.
+    std::unique_ptr<reval_ctx> reval_;
+
+    io_service_t& ios_;
+
     id_tag tag_;
     id_tag::trans_id_t cln_trans_id_ = 1;
     id_tag::trans_id_t org_trans_id_ = 1;
@@ -69,6 +85,7 @@ class http_handler final : public net::proto_handler
         tr_bpctrl_params_set = 1 << 4,
         tr_caching_started   = 1 << 5,
         tr_after_end_data    = 1 << 6,
+        tr_no_fresh_hdrs     = 1 << 7,
     };
     flags_t flags_ = 0;
 
@@ -78,7 +95,8 @@ public:
                  io_service_t& ios,
                  net_thread_id_t net_tid,
                  all_stats& sts,
-                 http_bp_ctl& bp_ctl) noexcept;
+                 http_bp_ctl& bp_ctl,
+                 fresh_index& fresh_idx) noexcept;
     ~http_handler() noexcept final;
 
     http_handler(const http_handler&) = delete;
@@ -113,6 +131,18 @@ private:
     bool set_bpctrl_content_len(bytes64_t clen) noexcept;
     void set_bpctrl_curr_trans_clen() noexcept;
     bool process_curr_trans_resp(net::proxy_conn& conn) noexcept;
+    // Starts serving the current request from the cache, without sending
+    // it to the origin, if the requested object is in the fresh index.
+    // Sends a conditional request instead, if the indexed object is stale.
+    bool try_fresh_hit(net::proxy_conn& conn) noexcept;
+    void start_reval(net::proxy_conn& conn) noexcept;
+    // Holds the response to the conditional request until its headers
+    // are completed. Returns true if the response goes to the client.
+    bool on_reval_resp_data(net::proxy_conn& conn,
+                            http_trans& trans,
+                            bytes32_t consumed) noexcept;
+    void serve_reval_hit(net::proxy_conn& conn, http_trans& trans) noexcept;
+    void reval_failed(net::proxy_conn& conn) noexcept;
 
 private:
     friend struct hhsm::sm_impl;
@@ -130,6 +160,18 @@ private:
     void consume_cache_hdrs_data() noexcept;
     void consume_cache_data() noexcept;
     void cache_open_rd(net::proxy_conn& conn) noexcept;
+    void cache_open_fresh(net::proxy_conn& conn,
+                          const cache::cache_key& key) noexcept;
+    void switch_fresh_stream(net::proxy_conn& conn) noexcept;
+    void fresh_fallback(net::proxy_conn& conn) noexcept;
+    // Adds the object read from the cache to the fresh index
+    void fresh_record() noexcept;
+    // Closes the cache write handle and adds the written object to the
+    // fresh index, if the write gets successfully finished.
+    void cache_close_record() noexcept;
+    // Stores the de-chunked body of the finished chunked response in the
+    // cache and adds it to the fresh index, if the response allows it.
+    void store_dechunked(http_trans& trans) noexcept;
     void cache_read_compare(net::proxy_conn& conn) noexcept;
     void cache_reopen_wr_truncate(net::proxy_conn& conn) noexcept;
     void cache_open_wr(net::proxy_conn& conn, bool truncate_obj) noexcept;
@@ -145,6 +187,7 @@ private:
                                            net::proxy_conn& conn) noexcept;
     void expand_origin_recv_buff_if_needed(const http_trans& trans,
                                            net::proxy_conn& conn) noexcept;
+    void expand_origin_recv_buff_for_hit(net::proxy_conn& conn) noexcept;
 
     const id_tag& no_trans_tag() noexcept;
     const id_tag& cln_trans_tag() noexcept;
@@ -28,6 +28,30 @@ struct req_msg
     bytes64_t content_len_ = no_len;
 
     values_store_t values_;
+
+    // Single byte range from the 'Range' header. The first byte is missing
+    // for a suffix range, then the last one is the suffix length. The last
+    // byte is missing for an open ended range.
+    struct rng
+    {
+        bytes64_t first_ = no_len;
+        bytes64_t last_  = no_len;
+
+        bool valid() const noexcept
+        {
+            return (first_ != no_len) || (last_ != no_len);
+        }
+    };
+    rng rng_;
+
+    // Set if the request asks for multiple or unparsable ranges, for a
+    // conditional response or for a fresh copy from the origin. Such
+    // requests are not served from the fresh index.
+    bool no_fresh_ = false;
+    // Set on 'Authorization' header. Such requests are never served from
+    // the fresh index and their responses are indexed only if explicitly
+    // allowed as described in the RFC 7234, section 3.2.
+    bool authorization_ = false;
 };
 
 struct resp_msg
@@ -71,6 +95,23 @@ struct resp_msg
 
     cache::resp_cache_control cache_control_ =
         cache::resp_cache_control::cc_not_present;
+
+    // Used for the freshness calculation. Zero means not present for the
+    // dates and minus one for the max ages.
+    time_t date_       = 0;
+    time_t expires_    = 0;
+    int64_t max_age_   = -1;
+    int64_t s_maxage_  = -1;
+    uint32_t age_      = 0;
+    // The response must not be served without asking the origin.
+    // Set on no-store, no-cache, private, Set-Cookie and unsupported Vary.
+    bool no_fresh_ = false;
+    // Set on public, s-maxage and must-revalidate. The response to a request
+    // with 'Authorization' header can be shared only if set.
+    bool auth_shared_ = false;
+    // Set on 'Vary: Accept-Encoding'. Such response is served from the fresh
+    // index only if it's not encoded.
+    bool vary_enc_ = false;
 };
 
 } // namespace http
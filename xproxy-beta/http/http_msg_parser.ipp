@@ -148,6 +148,19 @@ int on_trailing_hdrs_end_if(req_parser, Ntf*) noexcept
     return res_error;
 }
 
+template <typename Ntf>
+int on_body_data_if(resp_parser, Ntf* ntf, const char* d, size_t s) noexcept
+{
+    return ntf->on_body_data(d, s);
+}
+
+template <typename Ntf>
+int on_body_data_if(req_parser, Ntf*, const char*, size_t) noexcept
+{
+    assert(false);
+    return res_error;
+}
+
 template <typename Ntf, typename ParserType>
 int on_hdrs_end_pause(Ntf* ntf, http_parser& p, ParserType) noexcept
 {
@@ -240,6 +253,12 @@ struct ev_hval_data : ev_with_data
     constexpr static auto next_state = parser_state::hval_data;
     using ev_with_data::ev_with_data;
 };
+// The body data come after the headers and don't change the state
+struct ev_body_data : ev_with_data
+{
+    constexpr static auto next_state = parser_state::hdrs_end;
+    using ev_with_data::ev_with_data;
+};
 
 ////////////////////////////////////////////////////////////////////////////////
 // The state machine functionality.
@@ -401,6 +420,11 @@ static int process_event(http_parser* p, const Event& ev) noexcept
             {
                 return on_msg_end_pause(hp->ntf_, hp->impl_, PT{});
             },
+            // The body data, already de-chunked, if the body is chunked.
+            [](auto* hp, const ev_body_data& ev)
+            {
+                return on_body_data_if(PT{}, hp->ntf_, ev.data_, ev.size_);
+            },
             // On header key after headers complete, means that we have
             // trailing footers after chunked data.
             [](auto* hp, const ev_hkey_data& ev)
@@ -458,6 +482,8 @@ static http_parser_settings init_settings() noexcept
     // TODO Change with 'if constexpr' when present
     if (std::is_same<PT, req_parser>::value)
         sts.on_url = &parser_data_cb<Ntf, PT, psm::ev_url_data>;
+    else
+        sts.on_body = &parser_data_cb<Ntf, PT, psm::ev_body_data>;
     return sts;
 }
 
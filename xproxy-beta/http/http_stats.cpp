@@ -34,6 +34,17 @@ var_stats& var_stats::operator+=(const var_stats& rhs) noexcept
     cnt_ccompare_fail_ += rhs.cnt_ccompare_fail_;
     bytes_ccompare_ += rhs.bytes_ccompare_;
 
+    cnt_fresh_lookup_ += rhs.cnt_fresh_lookup_;
+    cnt_fresh_hit_ += rhs.cnt_fresh_hit_;
+    cnt_fresh_open_err_ += rhs.cnt_fresh_open_err_;
+    cnt_fresh_stored_ += rhs.cnt_fresh_stored_;
+    cnt_fresh_range_hit_ += rhs.cnt_fresh_range_hit_;
+    cnt_dechunk_collect_ += rhs.cnt_dechunk_collect_;
+    cnt_dechunk_stored_ += rhs.cnt_dechunk_stored_;
+    cnt_reval_ += rhs.cnt_reval_;
+    cnt_reval_304_ += rhs.cnt_reval_304_;
+    bytes_reval_saved_ += rhs.bytes_reval_saved_;
+
     cnt_bpctrl_entries_ += rhs.cnt_bpctrl_entries_;
 
     return *this;
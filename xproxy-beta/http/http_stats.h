@@ -38,6 +38,23 @@ struct var_stats
     uint64_t cnt_ccompare_fail_ = 0;
     bytes64_t bytes_ccompare_   = 0;
 
+    // Requests looked up in, and served from, the freshness index
+    uint64_t cnt_fresh_lookup_   = 0;
+    uint64_t cnt_fresh_hit_      = 0;
+    uint64_t cnt_fresh_open_err_ = 0;
+    uint64_t cnt_fresh_stored_   = 0;
+    // Range requests answered with '206' responses from the fresh index
+    uint64_t cnt_fresh_range_hit_ = 0;
+    // Chunked responses collected de-chunked, and the ones of them stored
+    // in the cache and the fresh index.
+    uint64_t cnt_dechunk_collect_ = 0;
+    uint64_t cnt_dechunk_stored_  = 0;
+    // Conditional requests for stale indexed objects, the '304' responses
+    // served from the cache and the object bytes not downloaded due to them
+    uint64_t cnt_reval_          = 0;
+    uint64_t cnt_reval_304_      = 0;
+    bytes64_t bytes_reval_saved_ = 0;
+
     uint32_t cnt_bpctrl_entries_ = 0;
 
     var_stats& operator+=(const var_stats& rhs) noexcept;
@@ -1,5 +1,6 @@
 #include "precompiled.h"
 #include "http_trans.h"
+#include "http_constants.h"
 #include "http_date.h"
 #include "http_msg.h"
 #include "http_version.h"
@@ -23,6 +24,63 @@ static void trim_string_view(string_view_t& sv) noexcept
     sv.remove_suffix(sv.size() - std::min(pos, sv.size()));
 }
 
+// Calls the given function for every comma separated, non empty directive
+template <typename Fn>
+static void for_each_directive(string_view_t val, Fn&& fn) noexcept
+{
+    while (!val.empty())
+    {
+        const auto pos = std::min(val.find(','), val.size());
+        auto dir       = val.substr(0, pos);
+        trim_string_view(dir);
+        if (!dir.empty())
+            fn(dir);
+        val.remove_prefix(std::min(pos + 1, val.size()));
+    }
+}
+
+static bool is_directive(const string_view_t& dir,
+                         const string_view_t& name) noexcept
+{
+    // The directives with arguments, like no-cache="Set-Cookie", are treated
+    // the same way as the directives without arguments.
+    return boost::starts_with(dir, name) &&
+           ((dir.size() == name.size()) || (dir[name.size()] == '='));
+}
+
+// Returns -1 if the value is not a valid delta seconds value
+static int64_t parse_delta_secs(string_view_t val) noexcept
+{
+    trim_string_view(val);
+    if ((val.size() >= 2) && (val.front() == '"') && (val.back() == '"'))
+    {
+        val.remove_prefix(1);
+        val.remove_suffix(1);
+    }
+    if (val.empty())
+        return -1;
+    // RFC 7234 says that bigger values must be treated as 2^31
+    constexpr int64_t max_secs = 1LL << 31;
+    int64_t ret = 0;
+    for (const char c : val)
+    {
+        if ((c < '0') || (c > '9'))
+            return -1;
+        ret = std::min<int64_t>(ret * 10 + (c - '0'), max_secs);
+    }
+    return ret;
+}
+
+// Returns the delta seconds of a directive like 'max-age=60' or -1 if
+// the directive has no valid value.
+static int64_t directive_secs(const string_view_t& dir,
+                              const string_view_t& name) noexcept
+{
+    return (dir.size() > name.size())
+               ? parse_delta_secs(dir.substr(name.size() + 1))
+               : -1;
+}
+
 static string_view_t url_no_protocol(const boost_string_t& url) noexcept
 {
     constexpr string_view_t http{"http://", 7};
@@ -69,7 +127,13 @@ std::ostream& operator<<(std::ostream& os, http_trans::state_flags rhs) noexcept
             os << "http_tunnel;";
         if (rhs & http_trans::flag_chunked)
             os << "chunked;";
-        if (rhs & http_trans::flag_cache_hit)
+        if (rhs & http_trans::flag_transfer_enc)
+            os << "transfer_enc;";
+        if (rhs & http_trans::flag_cache_fresh_hit)
+            os << "cache_fresh_hit;";
+        else if (rhs & http_trans::flag_cache_reval_hit)
+            os << "cache_reval_hit;";
+        else if (rhs & http_trans::flag_cache_hit)
             os << "cache_hit;";
         else if (rhs & http_trans::flag_cache_miss)
             os << "cache_miss;";
@@ -105,6 +169,7 @@ http_trans::http_trans(http_trans&& rhs) noexcept
       req_msg_(std::move(rhs.req_msg_)),
       resp_msg_(std::move(rhs.resp_msg_)),
       tag_(std::exchange(rhs.tag_, net_tag)),
+      resp_body_(std::move(rhs.resp_body_)),
       state_flags_(std::exchange(rhs.state_flags_, flag_initial)),
       collect_req_hdr_val_(std::exchange(rhs.collect_req_hdr_val_, false)),
       collect_resp_hdr_val_(std::exchange(rhs.collect_resp_hdr_val_, false))
@@ -127,6 +192,7 @@ http_trans& http_trans::operator=(http_trans&& rhs) noexcept
         req_msg_              = std::move(rhs.req_msg_);
         resp_msg_             = std::move(rhs.resp_msg_);
         tag_                  = std::exchange(rhs.tag_, net_tag);
+        resp_body_            = std::move(rhs.resp_body_);
         state_flags_          = std::exchange(rhs.state_flags_, flag_initial);
         collect_req_hdr_val_  = std::exchange(rhs.collect_req_hdr_val_, false);
         collect_resp_hdr_val_ = std::exchange(rhs.collect_resp_hdr_val_, false);
@@ -446,11 +512,31 @@ void http_trans::set_cache_csum_miss() noexcept
     state_flags_ |= flag_cache_csum_miss;
 }
 
+void http_trans::set_cache_fresh_hit() noexcept
+{
+    state_flags_ |= (flag_cache_hit | flag_cache_fresh_hit);
+}
+
+void http_trans::set_cache_reval_hit() noexcept
+{
+    state_flags_ |= (flag_cache_hit | flag_cache_reval_hit);
+}
+
 bool http_trans::is_cache_hit() const noexcept
 {
     return (state_flags_ & flag_cache_hit);
 }
 
+bool http_trans::is_cache_fresh_hit() const noexcept
+{
+    return (state_flags_ & flag_cache_fresh_hit);
+}
+
+bool http_trans::is_cache_reval_hit() const noexcept
+{
+    return (state_flags_ & flag_cache_reval_hit);
+}
+
 void http_trans::set_origin_resp_bytes(bytes32_t bytes) noexcept
 {
     origin_resp_bytes_ = bytes;
@@ -458,6 +544,10 @@ void http_trans::set_origin_resp_bytes(bytes32_t bytes) noexcept
 
 bytes32_t http_trans::origin_resp_bytes() const noexcept
 {
+    // Nothing has been received from the origin for a fresh hit.
+    // The '304' response isn't part of the message for a revalidated hit.
+    if (state_flags_ & (flag_cache_fresh_hit | flag_cache_reval_hit))
+        return 0;
     if (origin_resp_bytes_ == 0)
     {
         // No origin message bytes has been explicitly set.
@@ -472,19 +562,143 @@ string_view_t http_trans::req_url() const noexcept
     return to_string_view(req_msg_->url_);
 }
 
+string_view_t http_trans::cache_url() const noexcept
+{
+    return to_string_view(req_msg_->cache_url_);
+}
+
 void http_trans::set_cache_url(boost_string_t&& url) noexcept
 {
     req_msg_->cache_url_ = std::move(url);
 }
 
+bool http_trans::req_fresh_servable() const noexcept
+{
+    const auto clen = req_msg_->content_len_;
+    return (state_flags_ & flag_req_complete_ok) &&
+           !(state_flags_ & (flag_done_forced | flag_http_tunnel)) &&
+           !req_msg_->no_fresh_ && !req_msg_->authorization_ &&
+           ((clen == req_msg::no_len) || (clen == 0));
+}
+
+bool http_trans::has_req_range() const noexcept
+{
+    return req_msg_->rng_.valid();
+}
+
+optional_t<http_trans::byte_range>
+http_trans::req_range(bytes64_t obj_len) const noexcept
+{
+    optional_t<byte_range> ret;
+    const auto& r = req_msg_->rng_;
+    if (!r.valid() || (obj_len == 0))
+        return ret;
+    if (r.first_ == req_msg::no_len)
+    { // The suffix range may be bigger than the object
+        if (r.last_ > 0)
+            ret = byte_range{obj_len - std::min(r.last_, obj_len), obj_len - 1};
+    }
+    else if (r.first_ < obj_len)
+    {
+        ret = byte_range{r.first_, std::min(r.last_, obj_len - 1)};
+    }
+    return ret;
+}
+
+optional_t<http_trans::freshness> http_trans::resp_freshness(time_t now) const
+    noexcept
+{
+    optional_t<freshness> ret;
+    const auto& m = *resp_msg_;
+    // The '304' response has no body and thus it's in HTTP tunnel mode,
+    // because of the missing 'Content-Length'.
+    const bool not_modified =
+        (resp_parser_.get_status_code() == HTTP_STATUS_NOT_MODIFIED);
+    // The chunked response is in HTTP tunnel mode too, because of the missing
+    // 'Content-Length', but its length is known if its body is collected.
+    const bool dechunked = !!resp_body_;
+    if (!(state_flags_ & flag_resp_hdrs_complete) ||
+        (state_flags_ & flag_done_forced) || m.no_fresh_ ||
+        (req_msg_->authorization_ && !m.auth_shared_) ||
+        (m.vary_enc_ && !m.content_encoding_.empty()) ||
+        (!not_modified &&
+         ((!dechunked &&
+           ((state_flags_ & (flag_http_tunnel | flag_chunked)) ||
+            (m.content_len_ == resp_msg::no_len))) ||
+          (resp_parser_.get_status_code() != HTTP_STATUS_OK) ||
+          m.rng_.valid())))
+    {
+        return ret;
+    }
+    // The freshness lifetime and the age are calculated as described in the
+    // RFC 7234, but without the response and request delays.
+    int64_t lifetime = -1;
+    if (m.s_maxage_ >= 0)
+        lifetime = m.s_maxage_;
+    else if (m.max_age_ >= 0)
+        lifetime = m.max_age_;
+    else if (m.expires_ != 0)
+        lifetime = int64_t(m.expires_) - ((m.date_ != 0) ? m.date_ : now);
+    const int64_t apparent_age =
+        ((m.date_ != 0) && (now > m.date_)) ? (now - m.date_) : 0;
+    const int64_t age = std::max<int64_t>(apparent_age, m.age_);
+    const auto age32  = static_cast<uint32_t>(
+        std::min<int64_t>(age, std::numeric_limits<uint32_t>::max()));
+    if (lifetime > age)
+        ret = freshness{now + (lifetime - age), age32};
+    else if (not_modified || !m.etag_.empty() || (m.last_modified_ != 0))
+        ret = freshness{now, age32}; // Needs revalidation
+    return ret;
+}
+
+bool http_trans::collects_resp_body() const noexcept
+{
+    return !!resp_body_;
+}
+
+bool http_trans::has_resp_body() const noexcept
+{
+    return resp_body_ && (state_flags_ & flag_resp_complete_ok) &&
+           !(state_flags_ & flag_done_forced);
+}
+
+std::unique_ptr<dechunked_body> http_trans::release_resp_body() noexcept
+{
+    return std::move(resp_body_);
+}
+
+bool http_trans::resp_not_modified() const noexcept
+{
+    return (state_flags_ & flag_resp_complete_ok) &&
+           !(state_flags_ & flag_done_forced) &&
+           (resp_parser_.get_status_code() == HTTP_STATUS_NOT_MODIFIED);
+}
+
+void http_trans::reset_resp() noexcept
+{
+    XLOG_DEBUG(tag_, "Http_trans::reset_resp. Curr_state '{}'", state_flags_);
+    constexpr state_flags_t resp_flags =
+        flag_resp_hdrs_complete | flag_resp_complete | flag_http_tunnel |
+        flag_chunked | flag_transfer_enc;
+    state_flags_ = (state_flags)(state_flags_ & ~resp_flags);
+    resp_parser_.reset();
+    resp_msg_             = resp_msg_t{};
+    origin_resp_bytes_    = 0;
+    collect_resp_hdr_val_ = false;
+    resp_body_.reset();
+}
+
 optional_t<cache::cache_key> http_trans::get_cache_key() const noexcept
 {
     optional_t<cache::cache_key> ret;
+    const bool dechunked = has_resp_body();
     if ((state_flags_ & flag_resp_hdrs_complete) &&
-        !(state_flags_ & (flag_done_forced | flag_http_tunnel)))
+        !(state_flags_ & flag_done_forced) &&
+        (!(state_flags_ & flag_http_tunnel) || dechunked))
     {
         X3ME_ASSERT(!req_msg_->url_.empty() &&
-                        (resp_msg_->content_len_ != req_msg::no_len),
+                        ((resp_msg_->content_len_ != req_msg::no_len) ||
+                         dechunked),
                     "Invalid transaction state");
         // Some of the below could be empty, but it's cheaper just
         // to assign them, than to check and then assign them.
@@ -497,7 +711,9 @@ optional_t<cache::cache_key> http_trans::get_cache_key() const noexcept
         ret->digest_md5_  = s.value_pos_to_view(resp_msg_->digest_md5_);
         ret->etag_        = s.value_pos_to_view(resp_msg_->etag_);
 
-        if (!resp_msg_->rng_.valid())
+        if (dechunked)
+            ret->obj_full_len_ = resp_body_->size();
+        else if (!resp_msg_->rng_.valid())
             ret->obj_full_len_ = resp_msg_->content_len_;
         else
         {
@@ -531,6 +747,8 @@ void http_trans::log_before_destroy() const noexcept
         auto hit = [this]
         {
             // clang-format off
+            if (state_flags_ & flag_cache_fresh_hit) return "FRESH_HIT";
+            if (state_flags_ & flag_cache_reval_hit) return "REVAL_HIT";
             if (state_flags_ & flag_cache_hit) return "HIT";
             if (state_flags_ & flag_cache_miss) return "MISS";
             if (state_flags_ & flag_cache_csum_miss) return "CSUM_MISS";
@@ -713,7 +931,13 @@ int http_trans::on_hdr_key_data(const char* d, size_t s, req_parser) noexcept
 int http_trans::on_hdr_key_end(req_parser) noexcept
 {
     using namespace detail;
+    static constexpr const_string_t authorization{"Authorization"};
     const auto key_info = req_msg_->values_.current_key();
+    // The transaction currently goes to unsupported mode on this header.
+    // The flag is set explicitly in order to keep the fresh index safe,
+    // if this gets changed.
+    if (key_info.full_ && is_same_hdr(authorization, key_info.key_))
+        req_msg_->authorization_ = true;
     if (key_info.full_ && hdr_unsupported<intr_req_hdrs>(key_info.key_))
     {
         XLOG_INFO(tag_, "Http_trans::on_req_key_end. Start unsupported "
@@ -722,6 +946,14 @@ int http_trans::on_hdr_key_end(req_parser) noexcept
         state_flags_ |= flag_done_unsupported;
         return http::res_error; // Break the parsing
     }
+    if (key_info.full_ &&
+        (is_same_hdr(req_hdr::if_match, key_info.key_) ||
+         is_same_hdr(req_hdr::if_modified_since, key_info.key_) ||
+         is_same_hdr(req_hdr::if_none_match, key_info.key_) ||
+         is_same_hdr(req_hdr::if_range, key_info.key_)))
+    {
+        req_msg_->no_fresh_ = true;
+    }
 
     XLOG_TRACE(tag_,
                "Http_trans::on_req_key_end. Key_begin '{}'. Curr_state '{}'",
@@ -751,6 +983,9 @@ int http_trans::on_hdr_val_begin(req_parser) noexcept
         collect_req_hdr_val_ =
             key_info.full_ &&
             (is_same_hdr(req_hdr::content_length, key_info.key_) ||
+             is_same_hdr(req_hdr::cache_control, key_info.key_) ||
+             is_same_hdr(req_hdr::pragma, key_info.key_) ||
+             is_same_hdr(req_hdr::range, key_info.key_) ||
              (is_same_hdr(req_hdr::host, key_info.key_) &&
               !boost::istarts_with(req_msg_->url_, "http://")));
         // We don't check if it starts with 'www' because the internal
@@ -792,6 +1027,15 @@ int http_trans::on_hdr_val_end(req_parser) noexcept
         {
             read_req_host();
         }
+        else if (is_same_hdr(req_hdr::cache_control, key_info.key_) ||
+                 is_same_hdr(req_hdr::pragma, key_info.key_))
+        {
+            read_req_cache_directives();
+        }
+        else if (is_same_hdr(req_hdr::range, key_info.key_))
+        {
+            read_req_range();
+        }
         else
         {
             assert(false && "Must not collect values for not handled cases");
@@ -921,10 +1165,27 @@ int http_trans::on_hdr_key_end(resp_parser) noexcept
     if (!(state_flags_ & flag_http_tunnel) && key_info.full_ &&
         is_same_hdr(resp_hdr::transfer_encoding, key_info.key_))
     {
-        XLOG_INFO(tag_, "Http_trans::on_resp_key_end. Start HTTP tunnel on "
-                        "header 'Transfer-Encoding'. Curr_state '{}'",
-                  state_flags_);
-        state_flags_ |= flag_http_tunnel;
+        if (constants::max_dechunked_size > 0)
+        {
+            // The HTTP tunnel is started on headers end, because the
+            // remaining headers are needed if the de-chunked body gets
+            // collected.
+            state_flags_ |= flag_transfer_enc;
+        }
+        else
+        {
+            XLOG_INFO(tag_, "Http_trans::on_resp_key_end. Start HTTP tunnel "
+                            "on header 'Transfer-Encoding'. Curr_state '{}'",
+                      state_flags_);
+            state_flags_ |= flag_http_tunnel;
+        }
+    }
+    else if (key_info.full_ &&
+             is_same_hdr(resp_hdr::set_cookie, key_info.key_))
+    {
+        // Personalized response. Must not be served to other clients
+        // without asking the origin.
+        resp_msg_->no_fresh_ = true;
     }
     else
     {
@@ -966,7 +1227,13 @@ int http_trans::on_hdr_val_begin(resp_parser) noexcept
              is_same_hdr(resp_hdr::content_md5, key_info.key_) ||
              is_same_hdr(resp_hdr::content_range, key_info.key_) ||
              is_same_hdr(resp_hdr::digest, key_info.key_) ||
-             is_same_hdr(resp_hdr::etag, key_info.key_));
+             is_same_hdr(resp_hdr::etag, key_info.key_) ||
+             is_same_hdr(resp_hdr::cache_control, key_info.key_) ||
+             is_same_hdr(resp_hdr::pragma, key_info.key_) ||
+             is_same_hdr(resp_hdr::date, key_info.key_) ||
+             is_same_hdr(resp_hdr::expires, key_info.key_) ||
+             is_same_hdr(resp_hdr::age, key_info.key_) ||
+             is_same_hdr(resp_hdr::vary, key_info.key_));
     }
 
     return http::res_ok;
@@ -1036,17 +1303,29 @@ int http_trans::on_hdr_val_end(resp_parser) noexcept
             {
                 read_resp_last_modified();
             }
-            else if ((resp_msg_->cache_control_ ==
-                      cache::resp_cache_control::cc_not_present) &&
-                     is_same_hdr(resp_hdr::cache_control, key_info.key_))
+            else if (is_same_hdr(resp_hdr::cache_control, key_info.key_) ||
+                     is_same_hdr(resp_hdr::pragma, key_info.key_))
             {
-                read_resp_cache_control();
+                // All values are needed here, if there are repeated headers
+                read_resp_cache_directives();
             }
-            else if ((resp_msg_->cache_control_ ==
-                      cache::resp_cache_control::cc_not_present) &&
-                     is_same_hdr(resp_hdr::pragma, key_info.key_))
+            else if ((resp_msg_->date_ == 0) &&
+                     is_same_hdr(resp_hdr::date, key_info.key_))
             {
-                read_resp_pragma();
+                read_resp_date(resp_msg_->date_);
+            }
+            else if ((resp_msg_->expires_ == 0) &&
+                     is_same_hdr(resp_hdr::expires, key_info.key_))
+            {
+                read_resp_date(resp_msg_->expires_);
+            }
+            else if (is_same_hdr(resp_hdr::age, key_info.key_))
+            {
+                read_resp_age();
+            }
+            else if (is_same_hdr(resp_hdr::vary, key_info.key_))
+            {
+                read_resp_vary();
             }
             else if (resp_msg_->digest_md5_.empty() &&
                      resp_msg_->digest_sha1_.empty() &&
@@ -1100,6 +1379,23 @@ int http_trans::on_hdrs_end(resp_parser) noexcept
         resp_msg_->content_len_, state_flags_);
     state_flags_ |= flag_resp_hdrs_complete;
 
+    if ((state_flags_ & flag_transfer_enc) &&
+        !(state_flags_ & flag_http_tunnel))
+    {
+        XLOG_INFO(tag_, "Http_trans::on_resp_hdrs_end. Start HTTP tunnel "
+                        "on header 'Transfer-Encoding'. Curr_state '{}'",
+                  state_flags_);
+        state_flags_ |= flag_http_tunnel;
+        // The chunked response gets cached if it's small enough and it
+        // could be served from the fresh index.
+        if ((state_flags_ & flag_chunked) &&
+            (resp_msg_->content_len_ == resp_msg::no_len))
+        {
+            resp_body_ = std::make_unique<dechunked_body>();
+            if (!resp_freshness(::time(nullptr)))
+                resp_body_.reset();
+        }
+    }
     if ((resp_msg_->content_len_ == resp_msg::no_len) &&
         !(state_flags_ & flag_http_tunnel))
     { // We'll probably never enter here, still let's expect the unexpected
@@ -1120,12 +1416,31 @@ int http_trans::on_hdrs_end(resp_parser) noexcept
     }
     // Skip body if content length is not present and not chunked.
     // Otherwise the parser will never emit on_msg_end.
+    // The '304' response never has a body, even if it has 'Content-Length'.
     return ((state_flags_ & flag_chunked) ||
-            (resp_msg_->content_len_ != resp_msg::no_len))
+            (resp_msg_->content_len_ != resp_msg::no_len)) &&
+                   (resp_parser_.get_status_code() != HTTP_STATUS_NOT_MODIFIED)
                ? http::res_ok
                : http::res_skip_body;
 }
 
+int http_trans::on_body_data(const char* d, size_t s) noexcept
+{
+    if (resp_body_)
+    {
+        if (!resp_body_->append(d, s))
+        {
+            XLOG_DEBUG(tag_, "Http_trans::on_resp_body_data. Stop collecting "
+                             "the body after {} bytes. All bodies {} bytes. "
+                             "Curr_state '{}'",
+                       resp_body_->size(), dechunked_body::total_size(),
+                       state_flags_);
+            resp_body_.reset();
+        }
+    }
+    return http::res_ok;
+}
+
 int http_trans::on_trailing_hdrs_begin() noexcept
 {
     XLOG_INFO(tag_, "Http_trans::on_trailing_hdrs_begin. Start unsupported "
@@ -1186,6 +1501,55 @@ void http_trans::read_req_content_len() noexcept
     }
 }
 
+void http_trans::read_req_cache_directives() noexcept
+{
+    const auto val = req_msg_->values_.current_value_view();
+    XLOG_TRACE(tag_, "Http_trans::read_req_cache_directives {}", val);
+    // The client wants a response validated by the origin
+    for_each_directive(val, [this](const string_view_t& dir)
+                       {
+                           if (is_directive(dir, "no-cache") ||
+                               is_directive(dir, "no-store") ||
+                               is_directive(dir, "max-age"))
+                           {
+                               req_msg_->no_fresh_ = true;
+                           }
+                       });
+}
+
+void http_trans::read_req_range() noexcept
+{
+    namespace x3   = boost::spirit::x3;
+    const auto val = req_msg_->values_.current_value_view();
+    req_msg::rng rng;
+    // clang-format off
+    auto rdfirst = [&](const auto& ctx){ rng.first_ = x3::_attr(ctx); };
+    auto rdlast  = [&](const auto& ctx){ rng.last_ = x3::_attr(ctx); };
+    auto parser = x3::no_case[x3::lit("bytes")] >> '=' >>
+                  -x3::ulong_long[rdfirst] >> '-' >>
+                  -x3::ulong_long[rdlast];
+    // clang-format on
+    auto beg = val.begin();
+    // Only a single range is supported. Parse silently consuming the spaces.
+    if (phrase_parse(beg, val.end(), parser, x3::ascii::space) &&
+        (beg == val.end()) && rng.valid() &&
+        ((rng.first_ == req_msg::no_len) || (rng.last_ == req_msg::no_len) ||
+         (rng.first_ <= rng.last_)))
+    {
+        req_msg_->rng_ = rng;
+        XLOG_TRACE(tag_, "Http_trans::read_req_range. Parsed hdr 'Range: {}'. "
+                         "First {}. Last {}. Curr_state '{}'",
+                   val, rng.first_, rng.last_, state_flags_);
+    }
+    else
+    {
+        XLOG_DEBUG(tag_, "Http_trans::read_req_range. Not supported "
+                         "'Range: {}'. Curr_state '{}'",
+                   val, state_flags_);
+        req_msg_->no_fresh_ = true;
+    }
+}
+
 void http_trans::read_req_host() noexcept
 {
     assert(!boost::starts_with(req_msg_->url_, "http://"));
@@ -1251,7 +1615,7 @@ bool http_trans::read_resp_content_len() noexcept
 void http_trans::read_resp_transfer_enc() noexcept
 {
     const auto val = resp_msg_->values_.current_value_view();
-    assert(state_flags_ & flag_http_tunnel);
+    assert(state_flags_ & (flag_http_tunnel | flag_transfer_enc));
     // The nodejs parser searches case sensitive and exactly
     // one word. We search for chunked. We'll see if we have
     // multiple transfer
@@ -1439,6 +1803,87 @@ void http_trans::read_resp_pragma() noexcept
         resp_msg_->cache_control_ = cache::resp_cache_control::cc_no_cache;
 }
 
+void http_trans::read_resp_cache_directives() noexcept
+{
+    const auto val = resp_msg_->values_.current_value_view();
+    XLOG_TRACE(tag_, "Http_trans::read_resp_cache_directives {}", val);
+    // Case sensitive compare for the same reasons as above.
+    // The 'public' and 'must-revalidate' directives don't change anything
+    // while the response is fresh, but they allow the response to a request
+    // with 'Authorization' header to be shared.
+    auto& m = *resp_msg_;
+    for_each_directive(val, [&](const string_view_t& dir)
+                       {
+                           if (is_directive(dir, "no-store") ||
+                               is_directive(dir, "no-cache") ||
+                               is_directive(dir, "private"))
+                           {
+                               m.no_fresh_ = true;
+                           }
+                           else if (is_directive(dir, "max-age"))
+                           {
+                               m.max_age_ = directive_secs(dir, "max-age");
+                           }
+                           else if (is_directive(dir, "s-maxage"))
+                           {
+                               m.s_maxage_ = directive_secs(dir, "s-maxage");
+                               m.auth_shared_ = true;
+                           }
+                           else if (is_directive(dir, "public") ||
+                                    is_directive(dir, "must-revalidate"))
+                           {
+                               m.auth_shared_ = true;
+                           }
+                       });
+}
+
+void http_trans::read_resp_date(time_t& res) noexcept
+{
+    // Needs zero terminated string. See read_resp_last_modified.
+    if (X3ME_UNLIKELY(!resp_msg_->values_.append_value("\0", 1)))
+    {
+        XLOG_ERROR(tag_,
+                   "Http_trans::read_resp_date. Can't append terminate zero");
+        return;
+    }
+    const auto http_date = resp_msg_->values_.current_value_view();
+    if (const auto unix_time = detail::parse_http_date(http_date.data()))
+    {
+        res = unix_time.value();
+    }
+    else
+    {
+        // RFC 7234 says that invalid dates must be treated as in the past
+        XLOG_DEBUG(tag_, "Http_trans::read_resp_date. Can't parse {}",
+                   http_date.substr(0, http_date.size() - 1));
+        res = 1;
+    }
+}
+
+void http_trans::read_resp_age() noexcept
+{
+    const auto age = parse_delta_secs(resp_msg_->values_.current_value_view());
+    if (age > 0)
+    {
+        resp_msg_->age_ = static_cast<uint32_t>(std::min<int64_t>(
+            age, std::numeric_limits<uint32_t>::max()));
+    }
+}
+
+void http_trans::read_resp_vary() noexcept
+{
+    static constexpr const_string_t accept_enc{"Accept-Encoding"};
+    const auto val = resp_msg_->values_.current_value_view();
+    // Only the responses varying on the content encoding are supported.
+    for_each_directive(val, [this](const string_view_t& v)
+                       {
+                           if (detail::is_same_hdr(accept_enc, v))
+                               resp_msg_->vary_enc_ = true;
+                           else
+                               resp_msg_->no_fresh_ = true;
+                       });
+}
+
 void http_trans::read_resp_digest() noexcept
 {
     auto get_digest = [](const string_view_t& hdr_val,
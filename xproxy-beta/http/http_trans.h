@@ -1,5 +1,6 @@
 #pragma once
 
+#include "dechunked_body.h"
 #include "http_msg_parser.h"
 
 namespace cache
@@ -15,8 +16,8 @@ struct resp_msg;
 
 class http_trans
 {
-    using req_msg_t  = x3me::utils::pimpl<req_msg, 104, 8>;
-    using resp_msg_t = x3me::utils::pimpl<resp_msg, 144, 8>;
+    using req_msg_t  = x3me::utils::pimpl<req_msg, 136, 8>;
+    using resp_msg_t = x3me::utils::pimpl<resp_msg, 184, 8>;
     // Why flags and not state machine???
     // The main advantage of the state machine (IMO) is that you can
     // see the transition table in one place instead of tracing the
@@ -26,7 +27,7 @@ class http_trans
     // In addition, here we need to use the state as flags in some of the
     // getter methods of the class. The state machine also needs more
     // boilerplate. Thus I decided to use flags here.
-    using state_flags_t = uint16_t;
+    using state_flags_t = uint32_t;
     enum state_flags : state_flags_t
     {
         flag_initial            = 0,
@@ -45,6 +46,9 @@ class http_trans
         flag_cache_csum_miss    = 1 << 12,
         flag_done_error         = 1 << 13,
         flag_done_unsupported   = 1 << 14,
+        flag_cache_fresh_hit    = 1 << 15,
+        flag_cache_reval_hit    = 1 << 16,
+        flag_transfer_enc       = 1 << 17,
         flag_req_complete       = flag_req_complete_ok | flag_req_complete_eof,
         flag_resp_complete      = flag_resp_complete_ok | flag_resp_complete_eof,
         flag_done_forced        = flag_done_error | flag_done_unsupported,
@@ -69,6 +73,11 @@ private:
     // If this remains 0 all response bytes has been received from the origin.
     bytes32_t origin_resp_bytes_ = 0;
 
+    // The de-chunked body of a chunked response, collected so that the
+    // response can be cached when its length becomes known at its end.
+    // Present only while collected and not bigger than the max allowed.
+    std::unique_ptr<dechunked_body> resp_body_;
+
     state_flags state_flags_ = flag_initial;
     // These flags tell us if we need to collect the current header
     // value or not. So far we have a hole at the end of the transaction,
@@ -91,6 +100,18 @@ public:
         bytes32_t consumed_;
     };
 
+    struct freshness
+    {
+        time_t expires_at_;
+        uint32_t age_; // The age of the response, in seconds, when calculated
+    };
+
+    struct byte_range // inclusive range [beg, end]
+    {
+        bytes64_t beg_;
+        bytes64_t end_;
+    };
+
 public:
     explicit http_trans(const id_tag& tag) noexcept;
     ~http_trans() noexcept;
@@ -141,17 +162,56 @@ public:
     void set_cache_hit() noexcept;
     void set_cache_miss() noexcept;
     void set_cache_csum_miss() noexcept;
+    // The response is served from the cache without asking the origin
+    void set_cache_fresh_hit() noexcept;
+    // The response is served from the cache after a '304 Not Modified'
+    // response to a conditional request.
+    void set_cache_reval_hit() noexcept;
     bool is_cache_hit() const noexcept;
+    bool is_cache_fresh_hit() const noexcept;
+    bool is_cache_reval_hit() const noexcept;
 
     void set_origin_resp_bytes(bytes32_t bytes) noexcept;
     bytes32_t origin_resp_bytes() const noexcept;
 
     string_view_t req_url() const noexcept;
+    string_view_t cache_url() const noexcept;
     void set_cache_url(boost_string_t&& url) noexcept;
 
+    // Returns true if the completed request can be answered from the fresh
+    // index i.e. it's a plain GET without multiple ranges, conditional or
+    // no-cache headers.
+    bool req_fresh_servable() const noexcept;
+    // Returns true if the request asks for a single byte range
+    bool has_req_range() const noexcept;
+    // Returns the requested byte range for an object with the given length.
+    // Returns nothing if the range can't be satisfied.
+    optional_t<byte_range> req_range(bytes64_t obj_len) const noexcept;
+    // Returns the moment until which the response is fresh, according to its
+    // 'Cache-Control: max-age/s-maxage' or 'Expires' headers.
+    // The moment is not after now for the stale responses with validators
+    // and for the '304 Not Modified' responses without expiration time.
+    // Returns nothing if the response is not a full 200 or 304 response,
+    // it's stale without validators or it's not allowed to be served without
+    // asking the origin. Valid only after the response headers are completed.
+    optional_t<freshness> resp_freshness(time_t now) const noexcept;
+    // Returns true while the de-chunked body of the response is collected
+    bool collects_resp_body() const noexcept;
+    // Returns true if the whole de-chunked body of the response has been
+    // collected. The cache key and the freshness of such response are
+    // valid, although it's in HTTP tunnel mode.
+    bool has_resp_body() const noexcept;
+    // Gives away the collected de-chunked body, if any
+    std::unique_ptr<dechunked_body> release_resp_body() noexcept;
+    // Returns true if the response is completed '304 Not Modified'.
+    bool resp_not_modified() const noexcept;
+    // Drops the received response, so that the transaction can receive
+    // another response, e.g. from the cache, for the same request.
+    void reset_resp() noexcept;
+
     // Returns valid cache key only after the response headers are completed
     // and the transaction is in normal mode (not http_tunnel, unsupported or
-    // error).
+    // error), or after the whole de-chunked response body is collected.
     optional_t<cache::cache_key> get_cache_key() const noexcept;
 
     void log_before_destroy() const noexcept;
@@ -189,6 +249,7 @@ public:
     int on_hdr_val_data(const char* d, size_t s, resp_parser) noexcept;
     int on_hdr_val_end(resp_parser) noexcept;
     int on_hdrs_end(resp_parser) noexcept;
+    int on_body_data(const char* d, size_t s) noexcept;
     int on_trailing_hdrs_begin() noexcept;
     int on_trailing_hdrs_end() noexcept;
     int on_msg_end(resp_parser) noexcept;
@@ -196,6 +257,8 @@ public:
 private:
     void read_req_content_len() noexcept;
     void read_req_host() noexcept;
+    void read_req_cache_directives() noexcept;
+    void read_req_range() noexcept;
 
     bool read_resp_content_len() noexcept;
     void read_resp_transfer_enc() noexcept;
@@ -207,6 +270,10 @@ private:
     void read_resp_pragma() noexcept;
     void read_resp_digest() noexcept;
     void read_resp_etag() noexcept;
+    void read_resp_cache_directives() noexcept;
+    void read_resp_date(time_t& res) noexcept;
+    void read_resp_age() noexcept;
+    void read_resp_vary() noexcept;
 
     friend std::ostream& operator<<(std::ostream& os,
                                     const http_trans& rhs) noexcept;
@@ -6,8 +6,15 @@ namespace detail
 {
 
 #define REQ_HDRS(XX)                                                           \
+    XX(cache_control, "Cache-Control")                                         \
     XX(content_length, "Content-Length")                                       \
-    XX(host, "Host")
+    XX(host, "Host")                                                           \
+    XX(if_match, "If-Match")                                                   \
+    XX(if_modified_since, "If-Modified-Since")                                 \
+    XX(if_none_match, "If-None-Match")                                         \
+    XX(if_range, "If-Range")                                                   \
+    XX(pragma, "Pragma")                                                       \
+    XX(range, "Range")
 
 enum struct req_hdr
 {
@@ -50,16 +57,21 @@ inline constexpr const const_string_t& hdr_str(req_hdr h) noexcept
 ////////////////////////////////////////////////////////////////////////////////
 
 #define RESP_HDRS(XX)                                                          \
+    XX(age, "Age")                                                             \
     XX(cache_control, "Cache-Control")                                         \
     XX(content_encoding, "Content-Encoding")                                   \
     XX(content_length, "Content-Length")                                       \
     XX(content_md5, "Content-MD5")                                             \
     XX(content_range, "Content-Range")                                         \
+    XX(date, "Date")                                                           \
     XX(digest, "Digest")                                                       \
     XX(etag, "ETag")                                                           \
+    XX(expires, "Expires")                                                     \
     XX(pragma, "Pragma")                                                       \
+    XX(set_cookie, "Set-Cookie")                                               \
     XX(transfer_encoding, "Transfer-Encoding")                                 \
-    XX(last_modified, "Last-Modified")
+    XX(last_modified, "Last-Modified")                                         \
+    XX(vary, "Vary")
 
 enum struct resp_hdr
 {
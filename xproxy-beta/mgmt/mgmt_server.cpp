@@ -76,6 +76,76 @@ inline double bytes_to_gbytes(uint64_t bytes) noexcept
     return round3(bytes / (1024.0 * 1024.0 * 1024.0));
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+void accumulate(cache::stats_aio_class& to,
+                const cache::stats_aio_class& from) noexcept
+{
+    to.cnt_tasks_ += from.cnt_tasks_;
+    to.wait_time_us_ += from.wait_time_us_;
+    to.max_wait_time_us_ =
+        std::max(to.max_wait_time_us_, from.max_wait_time_us_);
+}
+
+json_rpc::value_t to_json(json_rpc::document_t& d,
+                          const cache::stats_aio_class& s) noexcept
+{
+    json_rpc::value_t v;
+    v.SetObject();
+    add_to_obj(d, v, "Tasks", s.cnt_tasks_);
+    add_to_obj(d, v, "AvgWait_us", div_non_null(s.wait_time_us_, s.cnt_tasks_));
+    add_to_obj(d, v, "MaxWait_us", s.max_wait_time_us_);
+    return v;
+}
+
+json_rpc::value_t to_json(json_rpc::document_t& d,
+                          const cache::latency_hist& h) noexcept
+{
+    json_rpc::value_t v;
+    v.SetObject();
+    add_to_obj(d, v, "Count", h.cnt_);
+    add_to_obj(d, v, "Avg_us", div_non_null(h.sum_us_, h.cnt_));
+    add_to_obj(d, v, "P50_us", h.percentile(50.0));
+    add_to_obj(d, v, "P99_us", h.percentile(99.0));
+    add_to_obj(d, v, "P999_us", h.percentile(99.9));
+    add_to_obj(d, v, "Max_us", h.max_us_);
+    return v;
+}
+
+void accumulate(cache::stats_aio_latency& to,
+                const cache::stats_aio_latency& from) noexcept
+{
+    to.read_wait_.merge(from.read_wait_);
+    to.read_service_.merge(from.read_service_);
+    to.agg_write_wait_.merge(from.agg_write_wait_);
+    to.agg_write_service_.merge(from.agg_write_service_);
+    to.md_write_wait_.merge(from.md_write_wait_);
+    to.md_write_service_.merge(from.md_write_service_);
+}
+
+void add_to_obj(json_rpc::document_t& d,
+                json_rpc::value_t& v,
+                const cache::stats_aio_latency& s) noexcept
+{
+    add_to_obj(d, v, "LatReadWait", to_json(d, s.read_wait_));
+    add_to_obj(d, v, "LatReadService", to_json(d, s.read_service_));
+    add_to_obj(d, v, "LatAggWriteWait", to_json(d, s.agg_write_wait_));
+    add_to_obj(d, v, "LatAggWriteService", to_json(d, s.agg_write_service_));
+    add_to_obj(d, v, "LatMdWriteWait", to_json(d, s.md_write_wait_));
+    add_to_obj(d, v, "LatMdWriteService", to_json(d, s.md_write_service_));
+}
+
+void add_to_obj(json_rpc::document_t& d,
+                json_rpc::value_t& v,
+                const cache::stats_aio_sched& s) noexcept
+{
+    add_to_obj(d, v, "AioInteractive", to_json(d, s.interactive_));
+    add_to_obj(d, v, "AioEvacuation", to_json(d, s.evacuation_));
+    add_to_obj(d, v, "AioFlush", to_json(d, s.flush_));
+    add_to_obj(d, v, "AioMetadata", to_json(d, s.metadata_));
+    add_to_obj(d, v, "AioBgDelay", to_json(d, s.bg_delay_));
+}
+
 } // namespace
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -208,6 +278,7 @@ void mgmt_server::respond_summary_net_stats(json_rpc_res&& res,
     add_to_obj(val, "BytesOriginSend", as.bytes_all_origin_send_);
     add_to_obj(val, "BytesClientSend", as.bytes_all_client_send_);
     add_to_obj(val, "BytesClientSendHIT", as.bytes_hit_client_send_);
+    add_to_obj(val, "BytesClientSendHITShared", as.bytes_hit_shared_);
     add_to_obj(val, "CntHalfClosed", as.cnt_half_closed_);
     add_to_obj(val, "CntHalfClosedClnRecv", as.cnt_half_closed_cln_recv_);
     add_to_obj(val, "CntHalfClosedOrgRecv", as.cnt_half_closed_org_recv_);
@@ -268,6 +339,16 @@ void mgmt_server::respond_summary_http_stats(json_rpc_res&& res,
     add_to_obj(val, "CntCCompareOK", vs.cnt_ccompare_ok_);
     add_to_obj(val, "CntCCompareFail", vs.cnt_ccompare_fail_);
     add_to_obj(val, "AvgSizeCCompare", avg_size_ccompare);
+    add_to_obj(val, "CntFreshLookup", vs.cnt_fresh_lookup_);
+    add_to_obj(val, "CntFreshHit", vs.cnt_fresh_hit_);
+    add_to_obj(val, "CntFreshOpenErr", vs.cnt_fresh_open_err_);
+    add_to_obj(val, "CntFreshStored", vs.cnt_fresh_stored_);
+    add_to_obj(val, "CntFreshRangeHit", vs.cnt_fresh_range_hit_);
+    add_to_obj(val, "CntDechunkCollect", vs.cnt_dechunk_collect_);
+    add_to_obj(val, "CntDechunkStored", vs.cnt_dechunk_stored_);
+    add_to_obj(val, "CntReval", vs.cnt_reval_);
+    add_to_obj(val, "CntReval304", vs.cnt_reval_304_);
+    add_to_obj(val, "BytesRevalSaved", vs.bytes_reval_saved_);
 
     add_to_obj(val, "BPCTRL_Entries", vs.cnt_bpctrl_entries_);
 
@@ -370,6 +451,9 @@ void mgmt_server::respond_summary_cache_stats(
         uint64_t cnt_evac_entries_todo_    = 0;
         uint64_t cnt_evac_entries_ok_      = 0;
         uint64_t cnt_evac_entries_err_     = 0;
+        uint64_t cnt_evac_reads_           = 0;
+        bytes64_t evac_read_size_          = 0;
+        uint64_t evac_read_time_us_        = 0;
 
         bytes64_t min_written_data_size_ = static_cast<bytes64_t>(-1);
         bytes64_t max_written_data_size_ = 0;
@@ -377,6 +461,9 @@ void mgmt_server::respond_summary_cache_stats(
         uint32_t cnt_pending_reads_  = 0;
         uint32_t cnt_pending_writes_ = 0;
 
+        cache::stats_aio_sched aio_sched_;
+        cache::stats_aio_latency aio_latency_;
+
         uint16_t cnt_errors_ = 0;
     } ss;
     // Accumulate the stats
@@ -399,6 +486,9 @@ void mgmt_server::respond_summary_cache_stats(
         ss.cnt_evac_entries_todo_ += s.cnt_evac_entries_todo_;
         ss.cnt_evac_entries_ok_ += s.cnt_evac_entries_ok_;
         ss.cnt_evac_entries_err_ += s.cnt_evac_entries_err_;
+        ss.cnt_evac_reads_ += s.cnt_evac_reads_;
+        ss.evac_read_size_ += s.evac_read_size_;
+        ss.evac_read_time_us_ += s.evac_read_time_us_;
 
         if (ss.min_written_data_size_ > s.written_data_size_)
             ss.min_written_data_size_ = s.written_data_size_;
@@ -408,6 +498,13 @@ void mgmt_server::respond_summary_cache_stats(
         ss.cnt_pending_reads_ += s.cnt_pending_reads_;
         ss.cnt_pending_writes_ += s.cnt_pending_writes_;
 
+        accumulate(ss.aio_sched_.interactive_, s.aio_sched_.interactive_);
+        accumulate(ss.aio_sched_.evacuation_, s.aio_sched_.evacuation_);
+        accumulate(ss.aio_sched_.flush_, s.aio_sched_.flush_);
+        accumulate(ss.aio_sched_.metadata_, s.aio_sched_.metadata_);
+        accumulate(ss.aio_sched_.bg_delay_, s.aio_sched_.bg_delay_);
+        accumulate(ss.aio_latency_, s.aio_latency_);
+
         ss.cnt_errors_ += s.cnt_errors_;
     }
     const uint16_t cnt_volumes = st.size();
@@ -428,6 +525,11 @@ void mgmt_server::respond_summary_cache_stats(
         div_non_null(double(ss.cnt_evac_entries_err_),
                      ss.cnt_evac_entries_ok_ + ss.cnt_evac_entries_err_) *
         100.0;
+    // The time is summed for all volumes, so this is the average
+    // evacuation throughput of a single volume.
+    const auto evac_read_mbps =
+        div_non_null(bytes_to_mbytes(ss.evac_read_size_) * 1000000.0,
+                     ss.evac_read_time_us_);
     const bytes64_t avg_written_data_size =
         div_non_null(ss.written_data_size_, cnt_volumes);
 
@@ -443,6 +545,8 @@ void mgmt_server::respond_summary_cache_stats(
     add_to_obj(val, "CntObjects", ss.cnt_objects_);
     add_to_obj(val, "PendingReads", ss.cnt_pending_reads_);
     add_to_obj(val, "PendingWrites", ss.cnt_pending_writes_);
+    add_to_obj(val, val, ss.aio_sched_);
+    add_to_obj(val, val, ss.aio_latency_);
     add_to_obj(val, "AllWrittenBlockMeta_MB",
                bytes_to_mbytes(ss.written_meta_size_));
     add_to_obj(val, "AllWrittenData_GB",
@@ -459,6 +563,9 @@ void mgmt_server::respond_summary_cache_stats(
     add_to_obj(val, "EvacEntries_Pr", round3(evac_entries_pr));
     add_to_obj(val, "EvacEntriesReadErr_Pr", round3(evac_entries_read_err_pr));
     add_to_obj(val, "CheckedEvacEntries", ss.cnt_evac_entries_checked_);
+    add_to_obj(val, "EvacReads", ss.cnt_evac_reads_);
+    add_to_obj(val, "EvacRead_MB", bytes_to_mbytes(ss.evac_read_size_));
+    add_to_obj(val, "EvacRead_MBps", round3(evac_read_mbps));
 
     res.write_response(std::move(val));
 }
@@ -490,6 +597,9 @@ void mgmt_server::respond_detailed_cache_stats(
             div_non_null(double(s.cnt_evac_entries_err_),
                          s.cnt_evac_entries_ok_ + s.cnt_evac_entries_err_) *
             100.0;
+        const auto evac_read_mbps =
+            div_non_null(bytes_to_mbytes(s.evac_read_size_) * 1000000.0,
+                         s.evac_read_time_us_);
         const bytes32_t avg_entry_size =
             div_non_null(s.entries_data_size_, s.cnt_entries_);
         const bytes32_t avg_object_size =
@@ -505,6 +615,8 @@ void mgmt_server::respond_detailed_cache_stats(
 
         add_to_obj(val, tmp, "PendingReads", s.cnt_pending_reads_);
         add_to_obj(val, tmp, "PendingWrites", s.cnt_pending_writes_);
+        add_to_obj(val, tmp, s.aio_sched_);
+        add_to_obj(val, tmp, s.aio_latency_);
 
         add_to_obj(val, tmp, "WrittenBlockMeta_MB",
                    bytes_to_mbytes(s.written_meta_size_));
@@ -520,6 +632,9 @@ void mgmt_server::respond_detailed_cache_stats(
         add_to_obj(val, "EvacEntriesReadErr_Pr",
                    round3(evac_entries_read_err_pr));
         add_to_obj(val, "CheckedEvacEntries", s.cnt_evac_entries_checked_);
+        add_to_obj(val, tmp, "EvacReads", s.cnt_evac_reads_);
+        add_to_obj(val, tmp, "EvacRead_MB", bytes_to_mbytes(s.evac_read_size_));
+        add_to_obj(val, tmp, "EvacRead_MBps", round3(evac_read_mbps));
 
         add_to_obj(val, tmp, "FsMetaNodes", s.cnt_nodes_);
         add_to_obj(val, tmp, "FsMetaRanges", s.cnt_ranges_);
@@ -565,6 +680,21 @@ void mgmt_server::respond_summary_internal_cache_stats(
         ss.cnt_failed_unmark_read_rng_ += s.cnt_failed_unmark_read_rng_;
         ss.cnt_invalid_rng_elem_ += s.cnt_invalid_rng_elem_;
         ss.cnt_evac_frag_no_mem_entry_ += s.cnt_evac_frag_no_mem_entry_;
+        ss.cnt_mem_cache_hit_ += s.cnt_mem_cache_hit_;
+        ss.cnt_mem_cache_miss_ += s.cnt_mem_cache_miss_;
+        ss.cnt_mem_cache_add_ += s.cnt_mem_cache_add_;
+        ss.cnt_mem_cache_evict_ += s.cnt_mem_cache_evict_;
+        ss.mem_cache_size_ += s.mem_cache_size_;
+        ss.rdah_issued_bytes_ += s.rdah_issued_bytes_;
+        ss.rdah_used_bytes_ += s.rdah_used_bytes_;
+        ss.rdah_wasted_bytes_ += s.rdah_wasted_bytes_;
+        ss.cnt_rdah_no_budget_ += s.cnt_rdah_no_budget_;
+        ss.rdah_size_ += s.rdah_size_;
+        ss.cnt_evac_hot_frags_ += s.cnt_evac_hot_frags_;
+        ss.evac_hot_bytes_ += s.evac_hot_bytes_;
+        ss.cnt_evac_hot_no_budget_ += s.cnt_evac_hot_no_budget_;
+        ss.cnt_admit_ok_ += s.cnt_admit_ok_;
+        ss.cnt_admit_rejected_ += s.cnt_admit_rejected_;
     }
 
     const auto lock_volume_mtx_pr =
@@ -584,6 +714,14 @@ void mgmt_server::respond_summary_internal_cache_stats(
         div_non_null(double(ss.cnt_read_frag_mem_hit_),
                      ss.cnt_read_frag_mem_hit_ + ss.cnt_read_frag_mem_miss_) *
         100;
+    const auto admit_rejected_pr =
+        div_non_null(double(ss.cnt_admit_rejected_),
+                     ss.cnt_admit_ok_ + ss.cnt_admit_rejected_) *
+        100;
+    const auto mem_cache_hit_pr =
+        div_non_null(double(ss.cnt_mem_cache_hit_),
+                     ss.cnt_mem_cache_hit_ + ss.cnt_mem_cache_miss_) *
+        100;
 
     json_rpc::document_t val;
     val.SetObject();
@@ -601,6 +739,23 @@ void mgmt_server::respond_summary_internal_cache_stats(
     add_to_obj(val, "CntFailUnmarkReadRng", ss.cnt_failed_unmark_read_rng_);
     add_to_obj(val, "CntInvalidRngEleme", ss.cnt_invalid_rng_elem_);
     add_to_obj(val, "CntEvacFragNoEntry", ss.cnt_evac_frag_no_mem_entry_);
+    add_to_obj(val, "MemCacheHit_Pr", round3(mem_cache_hit_pr));
+    add_to_obj(val, "CntMemCacheAdd", ss.cnt_mem_cache_add_);
+    add_to_obj(val, "CntMemCacheEvict", ss.cnt_mem_cache_evict_);
+    add_to_obj(val, "MemCacheSize_MB", bytes_to_mbytes(ss.mem_cache_size_));
+    add_to_obj(val, "ReadAheadIssued_MB",
+               bytes_to_mbytes(ss.rdah_issued_bytes_));
+    add_to_obj(val, "ReadAheadUsed_MB", bytes_to_mbytes(ss.rdah_used_bytes_));
+    add_to_obj(val, "ReadAheadWasted_MB",
+               bytes_to_mbytes(ss.rdah_wasted_bytes_));
+    add_to_obj(val, "CntReadAheadNoBudget", ss.cnt_rdah_no_budget_);
+    add_to_obj(val, "ReadAheadSize_MB", bytes_to_mbytes(ss.rdah_size_));
+    add_to_obj(val, "CntEvacHotFrags", ss.cnt_evac_hot_frags_);
+    add_to_obj(val, "EvacHot_MB", bytes_to_mbytes(ss.evac_hot_bytes_));
+    add_to_obj(val, "CntEvacHotNoBudget", ss.cnt_evac_hot_no_budget_);
+    add_to_obj(val, "AdmitRejected_Pr", round3(admit_rejected_pr));
+    add_to_obj(val, "CntAdmitOk", ss.cnt_admit_ok_);
+    add_to_obj(val, "CntAdmitRejected", ss.cnt_admit_rejected_);
 
     res.write_response(std::move(val));
 }
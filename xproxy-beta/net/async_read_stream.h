@@ -16,6 +16,12 @@ public:
         virtual void shutdown(asio_shutdown_t, err_code_t&) noexcept = 0;
         virtual void close(err_code_t&) noexcept = 0;
         virtual bool is_open() const noexcept = 0;
+        // The streams over a memory, which is not going to change, may
+        // give a reference to the data instead of copying it.
+        virtual bool can_read_shared() const noexcept = 0;
+        virtual void async_read_shared(shared_data_t&,
+                                       bytes32_t,
+                                       handler_t&&) noexcept = 0;
     };
     // We can't have explicit template arguments passed to the constructor
     // and thus we need this intermediate type.
@@ -52,6 +58,19 @@ public:
                                        handler_t{std::forward<Handler>(h)});
     }
 
+    bool can_read_shared() const noexcept { return impl()->can_read_shared(); }
+
+    // The data gets set before the handler is called, if there is no error.
+    // It refers to at most max_len bytes.
+    template <typename Handler>
+    void async_read_shared(shared_data_t& data,
+                           bytes32_t max_len,
+                           Handler&& h) noexcept
+    {
+        return impl()->async_read_shared(data, max_len,
+                                         handler_t{std::forward<Handler>(h)});
+    }
+
     void shutdown(asio_shutdown_t how, err_code_t& err) noexcept
     {
         return impl()->shutdown(how, err);
@@ -13,6 +13,8 @@ struct all_stats
     bytes64_t bytes_all_origin_send_ = 0;
     bytes64_t bytes_all_client_send_ = 0;
     bytes64_t bytes_hit_client_send_ = 0;
+    // The HIT bytes referred from the cache instead of copied
+    bytes64_t bytes_hit_shared_ = 0;
 
     uint64_t cnt_half_closed_            = 0;
     uint64_t cnt_half_closed_cln_recv_   = 0;
@@ -36,6 +38,7 @@ struct all_stats
         bytes_all_origin_send_      += rhs.bytes_all_origin_send_;
         bytes_all_client_send_      += rhs.bytes_all_client_send_;
         bytes_hit_client_send_      += rhs.bytes_hit_client_send_;
+        bytes_hit_shared_           += rhs.bytes_hit_shared_;
         cnt_half_closed_            += rhs.cnt_half_closed_;
         cnt_half_closed_cln_recv_   += rhs.cnt_half_closed_cln_recv_;
         cnt_half_closed_org_recv_   += rhs.cnt_half_closed_org_recv_;
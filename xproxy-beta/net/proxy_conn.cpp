@@ -83,6 +83,7 @@ struct ev_cln_sent_err {};
 struct ev_cln_close {};
 struct ev_org_recv_pause {};
 struct ev_org_recv_resume {};
+struct ev_org_recv_cancelled {};
 // clang-format on
 
 struct sm_impl
@@ -102,15 +103,16 @@ struct sm_impl
         {
             // Don't issue too small reads and
             // do read only if the other leg is alive.
-            return (c->origin_rbuf_.bytes_avail_wr() >= 
+            return (c->org_recv_avail() >= 
                     (c->origin_rbuf_.block_size() / 2)) &&
                     c->client_sock_.is_open();
         };
         auto start_org_recv = [](proxy_conn* c){ c->start_org_recv(); };
+        auto cancel_org_recv = [](proxy_conn* c){ c->cancel_org_recv(); };
 
         auto org_send_allowed = [](proxy_conn* c)
         {
-            return (c->origin_pending_bytes_ > 0) && 
+            return ((c->origin_pending_bytes_ > 0) || c->origin_repl_) &&
                     c->origin_stream_.is<tcp_socket_t>();
         };
         auto start_org_send = [](proxy_conn* c){ c->start_org_send(); };
@@ -161,6 +163,7 @@ struct sm_impl
         const auto org_recv_eof_s    = "org_recv_eof"_s;
         const auto org_recv_err_s    = "org_recv_err"_s;
         const auto org_recv_paused_s = "org_recv_paused"_s;
+        const auto org_recv_pausing_s = "org_recv_pausing"_s;
         const auto org_send_start_s  = "org_send_start"_s;
         const auto org_send_conn_s   = "org_send_conn"_s;
         const auto org_send_idle_s   = "org_send_idle"_s;
@@ -204,6 +207,17 @@ struct sm_impl
             org_recv_eof_s + event<ev_org_recv> / no_act,
             org_recv_err_s + event<ev_org_recv> / no_act,
             org_recv_paused_s + event<ev_org_recv> / no_act,
+            // Pause requested while a receive operation is in progress.
+            // The operation gets cancelled, but it may still complete with
+            // data, EOF or error, if it has been already queued for execution.
+            org_recv_s + event<ev_org_recv_pause> / 
+                                        cancel_org_recv = org_recv_pausing_s,
+            org_recv_pausing_s + event<ev_org_recv> / no_act,
+            org_recv_pausing_s + event<ev_org_recv_data> = org_recv_paused_s,
+            org_recv_pausing_s + event<ev_org_recv_cancelled> = 
+                                                        org_recv_paused_s,
+            org_recv_pausing_s + event<ev_org_recv_eof> = org_recv_eof_s,
+            org_recv_pausing_s + event<ev_org_recv_err> = org_recv_err_s,
             // Origin sending
             *org_send_start_s + event<ev_org_connect> = org_send_conn_s,
             org_send_conn_s + event<ev_org_connected> = org_send_idle_s,
@@ -316,6 +330,18 @@ public:
         return base_t::is("org_recv_paused"_s);
     }
 
+    bool is_org_strm_pausing() const noexcept
+    {
+        using namespace boost::sml;
+        return base_t::is("org_recv_pausing"_s);
+    }
+
+    bool can_pause_org_strm() const noexcept
+    {
+        using namespace boost::sml;
+        return in_any_state("org_recv_idle"_s, "org_recv"_s);
+    }
+
     bool has_org_err() const noexcept
     {
         using namespace boost::sml;
@@ -501,6 +527,11 @@ void proxy_conn::pause_origin_recv() noexcept
     sm_->process_event(pcsm::ev_org_recv_pause{});
 }
 
+bool proxy_conn::can_pause_origin_recv() const noexcept
+{
+    return sm_->can_pause_org_strm();
+}
+
 void proxy_conn::resume_origin_recv() noexcept
 {
     sm_->process_event(pcsm::ev_org_recv_resume{});
@@ -542,6 +573,35 @@ void proxy_conn::send_to_origin(bytes32_t bytes) noexcept
     sm_->process_event(pcsm::ev_org_send{});
 }
 
+void proxy_conn::send_to_origin(bytes32_t bytes,
+                                bytes32_t skip,
+                                boost_string_t&& repl) noexcept
+{
+    X3ME_ASSERT(!origin_repl_, "Only one replacement can be pending");
+    const auto rdr_avail = client_rbuf_rdr_.bytes_avail();
+    origin_pending_bytes_ += bytes;
+    assert((origin_pending_bytes_ + skip) <= rdr_avail);
+    XLOG_DEBUG(tag_,
+               "Proxy_conn::send_to_origin {} bytes. Replace {} bytes with "
+               "{} bytes. All_pending_bytes {}. Client_reader_bytes {}",
+               bytes, skip, repl.size(), origin_pending_bytes_, rdr_avail);
+    origin_repl_ = std::make_unique<origin_repl>();
+    origin_repl_->data_ = std::move(repl);
+    origin_repl_->offs_ = origin_pending_bytes_;
+    origin_repl_->skip_ = skip;
+    sm_->process_event(pcsm::ev_org_send{});
+}
+
+void proxy_conn::skip_origin_data(bytes32_t bytes) noexcept
+{
+    X3ME_ASSERT(client_pending_bytes_ == 0,
+                "The skipped bytes must not be pending for the client");
+    XLOG_DEBUG(tag_, "Proxy_conn::skip_origin_data {} bytes. "
+                     "Origin_reader_bytes {}",
+               bytes, origin_rbuf_rdr_.bytes_avail());
+    origin_rbuf_rdr_.consume(bytes);
+}
+
 void proxy_conn::enqueue_shutdown_client_send() noexcept
 {
     sm_->process_event(pcsm::ev_cln_send_shut{});
@@ -578,7 +638,12 @@ void proxy_conn::start_blind_tunnel() noexcept
     assert((org_bytes_avail + origin_rbuf_.bytes_avail_wr() + 1) ==
            origin_rbuf_.capacity());
 
-    origin_pending_bytes_ = cln_bytes_avail;
+    // The original client data is sent if the replacement hasn't been sent.
+    // Otherwise the replaced bytes get consumed when the sending completes.
+    if (origin_repl_ && !origin_repl_->in_flight_)
+        origin_repl_.reset();
+    origin_pending_bytes_ =
+        cln_bytes_avail - (origin_repl_ ? origin_repl_->skip_ : 0);
     client_pending_bytes_ = org_bytes_avail;
     XLOG_INFO(tag_, "Proxy_conn. Starting blind tunnel. "
                     "Origin_pending_bytes {}. Client_pending_bytes {}",
@@ -777,88 +842,141 @@ void proxy_conn::start_cln_recv() noexcept
 
 void proxy_conn::start_org_recv() noexcept
 {
-    vec_wr_buffer_t buff;
-    const auto bytes_recv = fill_wr_buffer(origin_rbuf_, buff);
-    XLOG_DEBUG(tag_, "Proxy_conn. Try receive {} bytes from origin",
-               bytes_recv);
-    origin_stream_.async_read_some(
-        buff,
-        [inst = shared_from_this()](const err_code_t& err, bytes32_t bytes)
+    auto on_recv = [inst = shared_from_this()](const err_code_t& err,
+                                               bytes32_t bytes)
+    {
+        auto* sm           = inst->sm_.get();
+        const bool s2_data = inst->origin_stream_.is<async_read_stream>();
+        // Release our reference even if nothing has been received
+        auto shared = std::move(inst->origin_shared_data_);
+        if (bytes > 0)
         {
-            auto* sm           = inst->sm_.get();
-            const bool s2_data = inst->origin_stream_.is<async_read_stream>();
-            if (bytes > 0)
+            XLOG_DEBUG(
+                inst->tag_,
+                "Proxy_conn. Received {} bytes from origin. From_strm2 {}",
+                bytes, s2_data);
+            inst->update_org_recv_bytes_stats(bytes);
+            // Needed for the send to client so that it can set
+            // correct DSCP/TOS mark.
+            if (s2_data)
+                inst->sm_flags_ |= sm_flags::org_strm2_data_this_time;
+            else
+                inst->sm_flags_ &= ~sm_flags::org_strm2_data_this_time;
+
+            if (shared)
             {
-                XLOG_DEBUG(
-                    inst->tag_,
-                    "Proxy_conn. Received {} bytes from origin. From_strm2 {}",
-                    bytes, s2_data);
-                inst->update_org_recv_bytes_stats(bytes);
-                // Needed for the send to client so that it can set
-                // correct DSCP/TOS mark.
-                if (s2_data)
-                    inst->sm_flags_ |= sm_flags::org_strm2_data_this_time;
-                else
-                    inst->sm_flags_ &= ~sm_flags::org_strm2_data_this_time;
-
+                inst->all_stats_.bytes_hit_shared_ +=
+                    inst->origin_rbuf_.write_shared(shared, bytes);
+            }
+            else
                 inst->origin_rbuf_.commit(bytes);
-                sm->process_event(pcsm::ev_org_recv_data{});
+            sm->process_event(pcsm::ev_org_recv_data{});
 
-                if (!inst->in_blind_tunnel())
-                    inst->proto_handler_->on_origin_data(*inst);
-                else
-                {
-                    inst->client_pending_bytes_ =
-                        inst->origin_rbuf_rdr_.bytes_avail();
-                    sm->process_event(pcsm::ev_cln_send{});
-                }
-            }
-            if (!err)
+            if (!inst->in_blind_tunnel())
+                inst->proto_handler_->on_origin_data(*inst);
+            else
             {
-                sm->process_event(pcsm::ev_org_recv{});
+                inst->client_pending_bytes_ =
+                    inst->origin_rbuf_rdr_.bytes_avail();
+                sm->process_event(pcsm::ev_cln_send{});
             }
-            else if (err == asio_error::eof)
+        }
+        if (!err)
+        {
+            sm->process_event(pcsm::ev_org_recv{});
+        }
+        else if (err == asio_error::eof)
+        {
+            XLOG_INFO(inst->tag_,
+                      "Proxy_conn. EOF in origin receiving. From_strm2 {}",
+                      s2_data);
+            sm->process_event(pcsm::ev_org_recv_eof{});
+            inst->mark_half_closed();
+            // This is a bit of a hack, but we need to act in different
+            // ways depending on the type of the current origin stream.
+            if (s2_data)
             {
-                XLOG_INFO(inst->tag_,
-                          "Proxy_conn. EOF in origin receiving. From_strm2 {}",
-                          s2_data);
-                sm->process_event(pcsm::ev_org_recv_eof{});
-                inst->mark_half_closed();
-                // This is a bit of a hack, but we need to act in different
-                // ways depending on the type of the current origin stream.
-                if (s2_data)
-                {
-                    inst->close_org(); // Free OS resource
-                    if (!inst->in_blind_tunnel())
-                        inst->proto_handler_->on_switched_stream_eof(*inst);
-                    else
-                        sm->process_event(pcsm::ev_cln_close{});
-                }
+                inst->close_org(); // Free OS resource
+                if (!inst->in_blind_tunnel())
+                    inst->proto_handler_->on_switched_stream_eof(*inst);
                 else
-                {
-                    if (!inst->in_blind_tunnel())
-                        inst->proto_handler_->on_origin_recv_eof(*inst);
-                    else
-                        sm->process_event(pcsm::ev_cln_send_shut{});
-                }
+                    sm->process_event(pcsm::ev_cln_close{});
             }
-            else if (err != asio_error::operation_aborted)
+            else
             {
-                XLOG_INFO(
-                    inst->tag_,
-                    "Proxy_conn. Error in origin receiving. From_strm2 {}. {}",
-                    s2_data, err.message());
-                sm->process_event(pcsm::ev_org_recv_err{});
-
-                inst->close_org(); // Free OS resource
-                inst->mark_half_closed();
-
                 if (!inst->in_blind_tunnel())
-                    inst->proto_handler_->on_origin_recv_err(*inst);
+                    inst->proto_handler_->on_origin_recv_eof(*inst);
                 else
-                    sm->process_event(pcsm::ev_cln_close{});
+                    sm->process_event(pcsm::ev_cln_send_shut{});
             }
-        });
+        }
+        else if (err == asio_error::operation_aborted)
+        {
+            // The receive operation could have been cancelled because
+            // of a pause request. Otherwise the stream has been closed.
+            if (sm->is_org_strm_pausing())
+                sm->process_event(pcsm::ev_org_recv_cancelled{});
+        }
+        else
+        {
+            XLOG_INFO(
+                inst->tag_,
+                "Proxy_conn. Error in origin receiving. From_strm2 {}. {}",
+                s2_data, err.message());
+            sm->process_event(pcsm::ev_org_recv_err{});
+
+            inst->close_org(); // Free OS resource
+            inst->mark_half_closed();
+
+            if (!inst->in_blind_tunnel())
+                inst->proto_handler_->on_origin_recv_err(*inst);
+            else
+                sm->process_event(pcsm::ev_cln_close{});
+        }
+    };
+
+    if (org_recv_shared())
+    {
+        const auto bytes_recv = origin_rbuf_.bytes_avail_shared();
+        XLOG_DEBUG(tag_, "Proxy_conn. Try receive {} shared bytes from origin",
+                   bytes_recv);
+        origin_stream_.get<async_read_stream>().async_read_shared(
+            origin_shared_data_, bytes_recv, std::move(on_recv));
+        return;
+    }
+
+    vec_wr_buffer_t buff;
+    const auto bytes_recv = fill_wr_buffer(origin_rbuf_, buff);
+    XLOG_DEBUG(tag_, "Proxy_conn. Try receive {} bytes from origin",
+               bytes_recv);
+    origin_stream_.async_read_some(buff, std::move(on_recv));
+}
+
+void proxy_conn::cancel_org_recv() noexcept
+{
+    XLOG_DEBUG(tag_, "Proxy_conn. Cancel the receiving from origin");
+    err_code_t err;
+    origin_stream_.get<tcp_socket_t>().cancel(err);
+    if (err)
+    {
+        XLOG_WARN(tag_, "Proxy_conn. Failed to cancel the receiving from "
+                        "origin. {}",
+                  err.message());
+    }
+}
+
+bool proxy_conn::org_recv_shared() const noexcept
+{
+    // The data from the cache is referred instead of copied, except the
+    // response headers which the fresh reader copies.
+    return origin_stream_.is<async_read_stream>() &&
+           origin_stream_.get<async_read_stream>().can_read_shared();
+}
+
+bytes32_t proxy_conn::org_recv_avail() const noexcept
+{
+    return org_recv_shared() ? origin_rbuf_.bytes_avail_shared()
+                             : origin_rbuf_.bytes_avail_wr();
 }
 
 void proxy_conn::start_cln_send() noexcept
@@ -908,8 +1026,17 @@ void proxy_conn::start_org_send() noexcept
 {
     using namespace boost;
     vec_ro_buffer_t buff;
-    const auto bytes_to_send =
-        fill_vec_ro_buffer(client_rbuf_rdr_, origin_pending_bytes_, buff);
+    // The client bytes after the replaced ones are sent with the next send.
+    auto bytes_to_send = fill_vec_ro_buffer(
+        client_rbuf_rdr_,
+        origin_repl_ ? origin_repl_->offs_ : origin_pending_bytes_, buff);
+    if (origin_repl_)
+    {
+        const auto& data = origin_repl_->data_;
+        buff.push_back(boost::asio::buffer(data.data(), data.size()));
+        bytes_to_send += data.size();
+        origin_repl_->in_flight_ = true;
+    }
     XLOG_DEBUG(tag_, "Proxy_conn. Sending {} bytes to origin", bytes_to_send);
     auto& sock = origin_stream_.get<tcp_socket_t>();
     asio::async_write(
@@ -921,9 +1048,24 @@ void proxy_conn::start_org_send() noexcept
             {
                 XLOG_DEBUG(inst->tag_, "Proxy_conn. Sent {} bytes to origin",
                            bytes);
-                X3ME_ASSERT(inst->origin_pending_bytes_ >= bytes);
-                inst->origin_pending_bytes_ -= bytes;
-                inst->client_rbuf_rdr_.consume(bytes);
+                auto& repl             = inst->origin_repl_;
+                bytes32_t client_bytes = bytes;
+                bytes32_t skip_bytes   = 0;
+                if (repl && repl->in_flight_)
+                {
+                    X3ME_ASSERT(bytes == (repl->offs_ + repl->data_.size()));
+                    client_bytes = repl->offs_;
+                    skip_bytes   = repl->skip_;
+                    repl.reset();
+                }
+                else if (repl) // Added while this sending was in progress
+                {
+                    X3ME_ASSERT(repl->offs_ >= bytes);
+                    repl->offs_ -= bytes;
+                }
+                X3ME_ASSERT(inst->origin_pending_bytes_ >= client_bytes);
+                inst->origin_pending_bytes_ -= client_bytes;
+                inst->client_rbuf_rdr_.consume(client_bytes + skip_bytes);
                 inst->update_org_send_bytes_stats(bytes);
 
                 sm->process_event(pcsm::ev_org_sent_data{});
@@ -58,6 +58,10 @@ class proxy_conn
     xutils::io_buff_reader client_rbuf_rdr_;
     xutils::io_buff_reader origin_rbuf_rdr_;
 
+    // The data received from the cache, when the origin buffer refers
+    // to it instead of copying it.
+    shared_data_t origin_shared_data_;
+
     proto_handler_ptr_t proto_handler_;
 
     // Bytes waiting to be send to the origin.
@@ -67,6 +71,19 @@ class proxy_conn
     // Includes the currently send bytes to the client.
     bytes32_t client_pending_bytes_ = 0;
 
+    // Data sent to the origin in place of part of the client data.
+    // Allocated on demand because it's rarely needed.
+    struct origin_repl
+    {
+        boost_string_t data_;
+        // The pending bytes before the replaced ones
+        bytes32_t offs_;
+        // The count of the replaced client bytes
+        bytes32_t skip_;
+        bool in_flight_ = false;
+    };
+    std::unique_ptr<origin_repl> origin_repl_;
+
     x3me::utils::pimpl<pcsm::sm, 32, 8> sm_; // The state machine
 
     all_stats& all_stats_;
@@ -147,7 +164,10 @@ public:
 
     // Pauses the receiving from the origin side.
     // A paused receiving can only be resumed through resume_origin_recv.
+    // A receive operation in progress gets cancelled and the origin stream
+    // becomes paused when its completion handler gets executed.
     void pause_origin_recv() noexcept;
+    bool can_pause_origin_recv() const noexcept;
     void resume_origin_recv() noexcept;
 
     // These two operations start receiving from the given side if there is
@@ -157,6 +177,19 @@ public:
 
     void send_to_client(bytes32_t bytes) noexcept;
     void send_to_origin(bytes32_t bytes) noexcept;
+    // Sends the given bytes to the origin followed by the replacement data,
+    // which is sent instead of the next skip bytes from the client.
+    // Only one replacement can be pending at a time.
+    void send_to_origin(bytes32_t bytes,
+                        bytes32_t skip,
+                        boost_string_t&& repl) noexcept;
+    // Consumes the given bytes from the origin without sending them to the
+    // client. There must be no pending bytes for the client.
+    void skip_origin_data(bytes32_t bytes) noexcept;
+    bytes32_t client_pending_bytes() const noexcept
+    {
+        return client_pending_bytes_;
+    }
 
     // Executed when all pending/unconsumed bytes are sent.
     void enqueue_shutdown_client_send() noexcept;
@@ -179,6 +212,9 @@ private:
 
     void start_cln_recv() noexcept;
     void start_org_recv() noexcept;
+    void cancel_org_recv() noexcept;
+    bool org_recv_shared() const noexcept;
+    bytes32_t org_recv_avail() const noexcept;
 
     void start_cln_send() noexcept;
     void start_org_send() noexcept;
@@ -17,4 +17,7 @@ using vec_ro_buffer_t = vec_buffer_t<boost::asio::const_buffer>;
 using handler_t = x3me::utils::inplace_fn<x3me::utils::inplace_params<8>,
                                           void(const err_code_t&, bytes32_t)>;
 
+// A reference to data owned by someone else, e.g. by the cache.
+using shared_data_t = std::shared_ptr<const uint8_t>;
+
 } // namespace net
@@ -4,20 +4,26 @@
 ////////////////////////////////////////////////////////////////////////////////
 // system headers
 #include <grp.h>
+#include <linux/filter.h>
 #include <linux/fs.h>
+#include <linux/io_uring.h>
 #include <linux/netlink.h>
 #include <pcre.h>
+#include <pthread.h>
 #include <pwd.h>
+#include <sched.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <sys/capability.h>
+#include <sys/mman.h>
 #include <sys/prctl.h>
 #include <sys/raw.h>
 #include <sys/resource.h>
 #include <sys/statvfs.h>
 #include <sys/syscall.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 #include <zlib.h>
@@ -28,12 +34,15 @@
 #include <array>
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <exception>
 #include <experimental/optional>
 #include <experimental/tuple>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <new>
@@ -43,6 +52,7 @@
 #include <thread>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 
 ////////////////////////////////////////////////////////////////////////////////
 // boost headers
@@ -141,6 +141,13 @@ bool settings::load(const std::string& file_path)
             << 50 << '\n';
         result = false;
     }
+    // The de-chunked responses can be served only through the fresh index
+    if ((cache_dechunk_max_KB_ > 0) && (cache_fresh_index_MB_ == 0))
+    {
+        std::cerr << "The settings cache.dechunk_max_KB must be 0 when "
+                     "cache.fresh_index_MB is 0\n";
+        result = false;
+    }
 
     return result;
 }
@@ -11,9 +11,27 @@
     MACRO(uint16_t, uint16_t, main, kmod_def_window)                           \
     MACRO(uint16_t, uint16_t, main, dscp_hit)                                  \
     MACRO(uint16_t, uint16_t, main, dscp_miss)                                 \
+    MACRO(bool, bool, main, reuse_port)                                        \
+    MACRO(bool, bool, main, reuse_port_cpu_steering)                           \
     MACRO(std::string, std::string, cache, storage_cfg)                        \
     MACRO(uint16_t, uint16_t, cache, volume_threads)                           \
     MACRO(uint16_t, uint16_t, cache, min_avg_object_size_KB)                   \
+    MACRO(std::string, std::string, cache, aio_engine)                         \
+    MACRO(uint16_t, uint16_t, cache, aio_batch_size)                           \
+    MACRO(uint32_t, uint32_t, cache, metadata_journal_MB)                      \
+    MACRO(uint32_t, uint32_t, cache, mem_cache_MB)                             \
+    MACRO(uint16_t, uint16_t, cache, read_ahead_frags)                         \
+    MACRO(uint32_t, uint32_t, cache, read_ahead_MB)                            \
+    MACRO(uint32_t, uint32_t, cache, read_coalesce_KB)                         \
+    MACRO(uint16_t, uint16_t, cache, evac_min_hits)                            \
+    MACRO(uint32_t, uint32_t, cache, evac_hot_KB)                              \
+    MACRO(uint16_t, uint16_t, cache, admission_min_requests)                   \
+    MACRO(uint32_t, uint32_t, cache, admission_bypass_size_KB)                 \
+    MACRO(uint32_t, uint32_t, cache, admission_sketch_entries)                 \
+    MACRO(uint32_t, uint32_t, cache, fresh_index_MB)                           \
+    MACRO(uint32_t, uint32_t, cache, fresh_max_ttl_sec)                        \
+    MACRO(uint32_t, uint32_t, cache, dechunk_max_KB)                           \
+    MACRO(uint32_t, uint32_t, cache, dechunk_total_MB)                         \
     MACRO(std::string, std::string, plugins, cache_url_cfg)                    \
     MACRO(std::string, std::string, plugins, host_stats_cfg)                   \
     MACRO(ip_addr4_t, std::string, mgmt, bind_ip)                              \
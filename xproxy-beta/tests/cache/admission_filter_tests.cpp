@@ -0,0 +1,91 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../../cache/admission_filter.h"
+#include "../../cache/cache_stats.h"
+
+using namespace cache::detail;
+
+namespace
+{
+
+auto make_key(uint32_t v) noexcept
+{
+    return fs_node_key_t{&v, sizeof(v)};
+}
+
+admission_cfg make_cfg(uint16_t min_requests, bytes64_t bypass_size = 0)
+{
+    admission_cfg cfg;
+    cfg.min_requests_   = min_requests;
+    cfg.bypass_size_    = bypass_size;
+    cfg.sketch_entries_ = 4096;
+    return cfg;
+}
+
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(admission_filter_tests)
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+    for (uint16_t min_requests : {0, 1})
+    {
+        admission_filter af;
+        af.init(make_cfg(min_requests));
+        BOOST_CHECK(!af.enabled());
+        for (uint32_t i = 0; i < 100; ++i)
+            BOOST_CHECK(af.admit(make_key(i), 1_KB));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(admit_on_nth_request)
+{
+    constexpr uint16_t min_requests = 3;
+    admission_filter af;
+    af.init(make_cfg(min_requests));
+    BOOST_CHECK(af.enabled());
+
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        const auto key = make_key(i);
+        for (uint16_t r = 1; r < min_requests; ++r)
+            BOOST_CHECK(!af.admit(key, 1_KB));
+        BOOST_CHECK(af.admit(key, 1_KB));
+        BOOST_CHECK(af.admit(key, 1_KB));
+    }
+
+    cache::stats_internal sts;
+    af.get_stats(sts);
+    BOOST_CHECK_EQUAL(sts.cnt_admit_ok_, 200);
+    BOOST_CHECK_EQUAL(sts.cnt_admit_rejected_, 200);
+}
+
+BOOST_AUTO_TEST_CASE(admit_big_objects)
+{
+    admission_filter af;
+    af.init(make_cfg(4, 1_MB));
+
+    BOOST_CHECK(!af.admit(make_key(1), 1_MB - 1));
+    BOOST_CHECK(af.admit(make_key(2), 1_MB));
+    BOOST_CHECK(af.admit(make_key(3), 10_MB));
+}
+
+BOOST_AUTO_TEST_CASE(counts_decay)
+{
+    constexpr uint16_t min_requests = 2;
+    admission_filter af;
+    af.init(make_cfg(min_requests));
+
+    const auto key = make_key(0);
+    BOOST_CHECK(!af.admit(key, 1_KB));
+    // Many other requests age the count of the key. It needs to be
+    // requested twice again to get admitted.
+    const auto other_key = make_key(1);
+    for (uint32_t i = 0; i < 50000; ++i)
+        af.admit(other_key, 1_KB);
+    BOOST_CHECK(!af.admit(key, 1_KB));
+    BOOST_CHECK(af.admit(key, 1_KB));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -195,7 +195,7 @@ BOOST_AUTO_TEST_CASE(begin_end_disk_write)
     BOOST_REQUIRE_EQUAL(awb.bytes_avail(), written);
 
     cache::stats_fs_wr unused;
-    auto ro_buff = awb.begin_disk_write(unused);
+    auto ro_buff = awb.begin_disk_write(0 /*write_lap*/, unused);
     BOOST_REQUIRE_EQUAL(ro_buff.size(), round_to_store_block_size(
                                             agg_write_meta_size + written));
     auto entries = awb.end_disk_write();
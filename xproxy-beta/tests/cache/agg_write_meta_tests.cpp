@@ -319,4 +319,80 @@ BOOST_AUTO_TEST_CASE(load_fail_wrong_magic_ftr)
     BOOST_REQUIRE_EQUAL(0, awm2.cnt_entries());
 }
 
+
+BOOST_AUTO_TEST_CASE(load_success_jrnl)
+{
+    const auto meta_buff_size = 4_KB;
+    agg_write_meta awm(meta_buff_size, true);
+    auto offs = 200_MB;
+    for (auto i = 0; i < 10; ++i, offs -= 30_KB)
+    {
+        awm.add_entry(make_key(i), make_relem(offs, 20_KB));
+    }
+    awm.rem_entries(make_key(3));
+    BOOST_REQUIRE(awm.add_rem_key(make_key(3)));
+    BOOST_REQUIRE(awm.add_rem_key(make_key('z')));
+    BOOST_REQUIRE_EQUAL(awm.cnt_entries(), 9);
+    const auto fs_uuid = boost::uuids::random_generator()();
+    awm.set_jrnl_info(fs_uuid, 42);
+
+    auto buff = std::make_unique<uint8_t[]>(meta_buff_size);
+    {
+        memory_writer wr(buff.get(), meta_buff_size);
+        awm.save(wr);
+    }
+
+    // The journal is loaded even if not going to be written
+    agg_write_meta awm2(meta_buff_size);
+    {
+        memory_reader rd(buff.get(), meta_buff_size);
+        const bool res = awm2.load(rd);
+        BOOST_REQUIRE(res);
+    }
+    BOOST_REQUIRE_EQUAL(awm.cnt_entries(), awm2.cnt_entries());
+    BOOST_CHECK(std::equal(awm.begin(), awm.end(), awm2.begin()));
+    BOOST_REQUIRE(awm2.has_jrnl());
+    BOOST_CHECK(awm2.jrnl_complete());
+    BOOST_CHECK(awm2.jrnl_fs_uuid() == fs_uuid);
+    BOOST_CHECK_EQUAL(awm2.jrnl_write_lap(), 42);
+    BOOST_REQUIRE_EQUAL(awm2.rem_keys().size(), 2);
+    BOOST_CHECK(awm2.rem_keys()[0] == make_key(3));
+    BOOST_CHECK(awm2.rem_keys()[1] == make_key('z'));
+}
+
+BOOST_AUTO_TEST_CASE(jrnl_no_space)
+{
+    const auto meta_buff_size = 4_KB;
+    agg_write_meta awm(meta_buff_size, true);
+    auto offs = 200_MB;
+    auto cnt  = 0;
+    for (; awm.add_entry(make_key(cnt), make_relem(offs, 20_KB)) ==
+           agg_write_meta::add_res::ok;
+         ++cnt, offs -= 30_KB)
+    {
+    }
+    // The journal section takes some space
+    BOOST_CHECK_LT(awm.cnt_entries(), awm.max_cnt_entries());
+    BOOST_CHECK(!awm.add_rem_key(make_key('z')));
+    const auto fs_uuid = boost::uuids::random_generator()();
+    awm.set_jrnl_info(fs_uuid, 1);
+
+    auto buff = std::make_unique<uint8_t[]>(meta_buff_size);
+    {
+        memory_writer wr(buff.get(), meta_buff_size);
+        awm.save(wr);
+    }
+
+    agg_write_meta awm2(meta_buff_size);
+    {
+        memory_reader rd(buff.get(), meta_buff_size);
+        const bool res = awm2.load(rd);
+        BOOST_REQUIRE(res);
+    }
+    BOOST_REQUIRE_EQUAL(awm2.cnt_entries(), cnt);
+    BOOST_REQUIRE(awm2.has_jrnl());
+    BOOST_CHECK(!awm2.jrnl_complete());
+    BOOST_CHECK(awm2.rem_keys().empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -65,6 +65,7 @@ public:
                        frag_data_t,
                        volume_blocks64_t,
                        agg_wblock_sync_t&)> fsmd_add_new_fragment_;
+    std::function<wr_pos(const wr_pos&)> fsmd_next_write_pos_;
     std::function<wr_pos(volume_blocks64_t,
                          const std::vector<write_transaction>&,
                          agg_wblock_sync_t&)> fsmd_commit_disk_write_;
@@ -142,6 +143,10 @@ private:
     {
         return fsmd_add_new_fragment_(key, rng, frag, offs, wblock);
     }
+    wr_pos fsmd_next_write_pos(const wr_pos& curr) noexcept override
+    {
+        return fsmd_next_write_pos_(curr);
+    }
     wr_pos fsmd_commit_disk_write(volume_blocks64_t offs,
                                   const std::vector<write_transaction>& wtranss,
                                   agg_wblock_sync_t& wblock) noexcept override
@@ -179,7 +184,8 @@ struct fixture
     volume_blocks64_t given_offs_;
     bool allow_add_new_frag_ = true;
 
-    frag_write_buff exp_evac_wbuff;
+    // The expected evacuated fragments in the order of their evacuation
+    std::deque<frag_write_buff> exp_evac_wbuffs_;
 
     bool fsmd_add_new_fragment_called_  = false;
     bool fsmd_add_evac_fragment_called_ = false;
@@ -237,14 +243,21 @@ public:
             fsmd_add_evac_fragment_called_ = true;
             given_key_                     = key;
             given_rng_ = rng;
-            BOOST_REQUIRE_EQUAL(frag.size(), exp_evac_wbuff.size());
-            BOOST_REQUIRE(0 == ::memcmp(frag.data(), exp_evac_wbuff.data(),
-                                        exp_evac_wbuff.size()));
+            BOOST_REQUIRE(!exp_evac_wbuffs_.empty());
+            const auto& exp = exp_evac_wbuffs_.front();
+            BOOST_REQUIRE_EQUAL(frag.size(), exp.size());
+            BOOST_REQUIRE(0 == ::memcmp(frag.data(), exp.data(), exp.size()));
+            exp_evac_wbuffs_.pop_front();
             given_offs_ = offs;
             // Let the real operations handle the real work
             return fs_ops_real_.fsmd_add_evac_fragment(key, rng, frag, offs,
                                                        wblock);
         };
+        fs_ops_mock_.fsmd_next_write_pos_ =
+            [&](const cache_fs_ops::wr_pos& curr)
+        {
+            return fs_ops_real_.fsmd_next_write_pos(curr);
+        };
         fs_ops_mock_.fsmd_commit_disk_write_ =
             [&](volume_blocks64_t offs,
                 const std::vector<write_transaction>& wtranss,
@@ -626,9 +639,10 @@ BOOST_AUTO_TEST_CASE(second_lap_read_something_to_evacuate)
     BOOST_REQUIRE(fsmd_rem_non_evac_frags_called);
     // Now if we call again run_one it should execute add_evac_fragment
     fsmd_add_evac_fragment_called_ = false;
-    exp_evac_wbuff = make_wbuff('d', 1024_KB, 1024_KB);
+    exp_evac_wbuffs_.push_back(make_wbuff('d', 1024_KB, 1024_KB));
     fs_ops_mock_.run_one();
     BOOST_REQUIRE(fsmd_add_evac_fragment_called_);
+    BOOST_REQUIRE(exp_evac_wbuffs_.empty());
     BOOST_REQUIRE_EQUAL(given_offs_, data_offset);
     BOOST_REQUIRE_EQUAL(given_key_, wtrans2.fs_node_key());
     BOOST_REQUIRE_EQUAL(given_rng_, wtrans2.get_range());
@@ -728,20 +742,14 @@ BOOST_AUTO_TEST_CASE(second_lap_read_all_to_evacuate)
     fs_ops_mock_.run_one();
     BOOST_REQUIRE(fsmd_rem_non_evac_frags_called);
     // Now if we call again run_one it should execute add_evac_fragment
-    // for the first transaction
-    fsmd_add_evac_fragment_called_ = false;
-    exp_evac_wbuff = make_wbuff('c', 1024_KB, 1024_KB);
-    fs_ops_mock_.run_one();
-    BOOST_REQUIRE(fsmd_add_evac_fragment_called_);
-    BOOST_REQUIRE_EQUAL(given_offs_, data_offset);
-    BOOST_REQUIRE_EQUAL(given_key_, wtrans1.fs_node_key());
-    BOOST_REQUIRE_EQUAL(given_rng_, wtrans1.get_range());
-    // Now if we call again run_one it should execute add_evac_fragment
-    // for the first transaction
+    // for both transactions. The neighbour fragments are read together
+    // with a single disk read and evacuated in the order of their offsets.
     fsmd_add_evac_fragment_called_ = false;
-    exp_evac_wbuff = make_wbuff('d', 1024_KB, 1024_KB);
+    exp_evac_wbuffs_.push_back(make_wbuff('c', 1024_KB, 1024_KB));
+    exp_evac_wbuffs_.push_back(make_wbuff('d', 1024_KB, 1024_KB));
     fs_ops_mock_.run_one();
     BOOST_REQUIRE(fsmd_add_evac_fragment_called_);
+    BOOST_REQUIRE(exp_evac_wbuffs_.empty());
     BOOST_REQUIRE_EQUAL(given_offs_, data_offset);
     BOOST_REQUIRE_EQUAL(given_key_, wtrans2.fs_node_key());
     BOOST_REQUIRE_EQUAL(given_rng_, wtrans2.get_range());
@@ -750,17 +758,14 @@ BOOST_AUTO_TEST_CASE(second_lap_read_all_to_evacuate)
     // However, we have evacuated all fragments thus we shouldn't have space
     // left. So disable adding new fragment.
     allow_add_new_frag_            = false;
-    fs_ops_mock_.curr_disk_offs_   = data_offset.to_bytes();
     wbuff                          = make_wbuff('r', 512_KB, 512_KB);
     fsmd_add_new_fragment_called_  = false;
     fsmd_commit_disk_write_called_ = false;
     agg_wr_->final_write(std::move(wbuff), std::move(wtrans3));
-    fs_ops_mock_.vmtx_wait_disk_readers_called_ = false;
-    fs_ops_mock_.write_can_be_called_ = true;
-    fs_ops_mock_.run_one();
-    BOOST_REQUIRE(fsmd_commit_disk_write_called_);
-    BOOST_REQUIRE(fs_ops_mock_.vmtx_wait_disk_readers_called_);
-    //  After that, the metadata of the next write block will be read.
+    BOOST_REQUIRE(fsmd_add_new_fragment_called_);
+    BOOST_REQUIRE(!fsmd_commit_disk_write_called_);
+    //  The full block is swapped with the next one and the metadata of the
+    //  next write block is read before the flush of the full one.
     //  It'll be the same. Just filter it out.
     auto exp_offs = data_offset + bytes2blocks(agg_write_block_size);
 
@@ -786,13 +791,81 @@ BOOST_AUTO_TEST_CASE(second_lap_read_all_to_evacuate)
     fs_ops_mock_.write_can_be_called_ = false;
     fs_ops_mock_.run_one();
     BOOST_REQUIRE(fsmd_rem_non_evac_frags_called);
-    BOOST_REQUIRE(fsmd_rem_non_evac_frags_called);
     // After the evacuation is done the pending write must be written
     // automatically
     BOOST_REQUIRE(fsmd_add_new_fragment_called_);
     BOOST_REQUIRE_EQUAL(given_offs_, exp_offs);
     BOOST_REQUIRE_EQUAL(given_key_, exp_key);
     BOOST_REQUIRE_EQUAL(given_rng_, range(8192_KB, 512_KB, frag_rng));
+    BOOST_REQUIRE(!fsmd_commit_disk_write_called_);
+
+    // The full block gets flushed after that
+    fs_ops_mock_.curr_disk_offs_                = data_offset.to_bytes();
+    fs_ops_mock_.vmtx_wait_disk_readers_called_ = false;
+    fs_ops_mock_.read_can_be_called_            = false;
+    fs_ops_mock_.write_can_be_called_           = true;
+    fs_ops_mock_.run_one();
+    BOOST_REQUIRE(fsmd_commit_disk_write_called_);
+    BOOST_REQUIRE(fs_ops_mock_.vmtx_wait_disk_readers_called_);
+    BOOST_REQUIRE_EQUAL(given_offs_, data_offset);
+    BOOST_REQUIRE_EQUAL(write_pos(), exp_offs);
+}
+
+BOOST_AUTO_TEST_CASE(write_while_flushing)
+{
+    fs_ops_mock_.fsmd_rem_non_evac_frags_ =
+        [](std::vector<agg_meta_entry>&, volume_blocks64_t, volume_blocks64_t)
+    {
+        BOOST_REQUIRE_MESSAGE(false, "Must not be called in this test");
+    };
+    fs_ops_mock_.fsmd_add_evac_fragment_ =
+        [](const fs_node_key_t&, const range&, array_view<const uint8_t>,
+           volume_blocks64_t, agg_wblock_sync_t&)
+    {
+        BOOST_REQUIRE_MESSAGE(false, "Must not be called in this test");
+        return false;
+    };
+    reset_agg_wr(data_offset, 0);
+
+    auto exp_key = gen_key("aaa");
+    write_transaction wtrans1(exp_key, range{0_KB, 8192_KB});
+    write_transaction wtrans2(exp_key, range{8192_KB, 1024_KB});
+
+    // Fill the agg write block until there is no space in it.
+    auto wbuff = make_wbuff('c', 1024_KB, 1024_KB);
+    bool r     = true;
+    for (int i = 0; r && (i < 8); ++i)
+    {
+        allow_add_new_frag_ = true;
+        r = agg_wr_->write(wbuff, wtrans1);
+        BOOST_REQUIRE_EQUAL(given_offs_, data_offset);
+    }
+    BOOST_REQUIRE(!r);
+    BOOST_REQUIRE(!fsmd_commit_disk_write_called_);
+
+    // The full block waits for its flush, but the next write must go
+    // to the second block without waiting for the flush.
+    const auto exp_offs = data_offset + bytes2blocks(agg_write_block_size);
+    wbuff                         = make_wbuff('d', 1024_KB, 1024_KB);
+    allow_add_new_frag_           = true;
+    fsmd_add_new_fragment_called_ = false;
+    r = agg_wr_->write(wbuff, wtrans2);
+    BOOST_REQUIRE(r);
+    BOOST_REQUIRE(fsmd_add_new_fragment_called_);
+    BOOST_REQUIRE(!fsmd_commit_disk_write_called_);
+    BOOST_CHECK_EQUAL(wtrans2.written(), 1024_KB);
+    BOOST_REQUIRE_EQUAL(given_offs_, exp_offs);
+    BOOST_REQUIRE_EQUAL(given_rng_, range(8192_KB, 1024_KB, frag_rng));
+    // The metadata write position moves only after the flush is done.
+    BOOST_REQUIRE_EQUAL(write_pos(), data_offset);
+
+    fs_ops_mock_.curr_disk_offs_       = data_offset.to_bytes();
+    fs_ops_mock_.write_can_be_called_  = true;
+    fs_ops_mock_.run_one();
+    BOOST_REQUIRE(fsmd_commit_disk_write_called_);
+    BOOST_REQUIRE_EQUAL(given_offs_, data_offset);
+    BOOST_REQUIRE_EQUAL(write_pos(), exp_offs);
+    BOOST_REQUIRE_EQUAL(write_lap(), 0);
 }
 
 BOOST_AUTO_TEST_CASE(flush_on_stop)
@@ -0,0 +1,316 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../../cache/aio_data.h"
+#include "../../cache/aio_service.h"
+#include "../../cache/aio_task.h"
+#include "../../cache/aligned_data_ptr.h"
+#include "../../cache/cache_common.h"
+#include "../../cache/cache_stats.h"
+#include "../../cache/volume_fd.h"
+
+using namespace cache::detail;
+
+namespace
+{
+
+constexpr auto bsize      = store_block_size;
+constexpr auto cnt_blocks = 64U;
+constexpr bytes64_t fsize = bsize * cnt_blocks;
+const std::string fname   = "/tmp/aio_service_tests";
+
+class latch
+{
+    std::mutex mutex_;
+    std::condition_variable cond_var_;
+    uint32_t cnt_;
+
+public:
+    explicit latch(uint32_t cnt) noexcept : cnt_(cnt) {}
+
+    void count_down() noexcept
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        if (--cnt_ == 0)
+            cond_var_.notify_all();
+    }
+    void wait() noexcept
+    {
+        std::unique_lock<std::mutex> lk(mutex_);
+        cond_var_.wait(lk, [this]
+                       {
+                           return cnt_ == 0;
+                       });
+    }
+};
+
+// The latch is decremented on every finished IO operation
+class io_task final : public aio_task
+{
+    aligned_data_ptr_t buf_;
+    aio_data data_;
+    aio_op op_;
+    latch& done_;
+
+public:
+    err_code_t err_;
+
+    io_task(aio_op op, bytes64_t offs, latch& done) noexcept
+        : buf_(alloc_page_aligned(bsize)),
+          op_(op),
+          done_(done)
+    {
+        data_.buf_  = buf_.get();
+        data_.offs_ = offs;
+        data_.size_ = bsize;
+    }
+
+    uint8_t* buf() noexcept { return buf_.get(); }
+
+private:
+    aio_op operation() const noexcept final { return op_; }
+    void exec() noexcept final {}
+    non_owner_ptr_t<const aio_data> on_begin_io_op() noexcept final
+    {
+        return &data_;
+    }
+    void on_end_io_op(const err_code_t& err) noexcept final
+    {
+        err_ = err;
+        done_.count_down();
+    }
+    void service_stopped() noexcept final {}
+};
+
+uint8_t block_char(uint32_t blk) noexcept
+{
+    return 'a' + (blk % 26);
+}
+
+struct fixture
+{
+    volume_fd fd_;
+
+    fixture()
+    {
+        {
+            std::ofstream f{fname}; // Touch
+        }
+
+        err_code_t err;
+        fd_.open(fname.c_str(), err);
+        BOOST_REQUIRE_MESSAGE(!err, "Unable to open '" + fname + "'. " +
+                                        err.message());
+
+        fd_.truncate(fsize, err);
+        BOOST_REQUIRE_MESSAGE(!err, "Unable to truncate '" + fname + "'. " +
+                                        err.message());
+
+        auto buf = alloc_page_aligned(bsize);
+        for (auto i = 0U; i < cnt_blocks; ++i)
+        {
+            ::memset(buf.get(), block_char(i), bsize);
+            fd_.write(buf.get(), bsize, i * bsize, err);
+            BOOST_REQUIRE_MESSAGE(!err, "Unable to write to '" + fname + "'. " +
+                                            err.message());
+        }
+    }
+
+    void read_all(aio_engine engine)
+    {
+        aio_service aios(fd_);
+        aio_service_cfg cfg;
+        cfg.num_threads_ = 3;
+        cfg.batch_size_  = 8;
+        cfg.engine_      = engine;
+        aios.start("/tmp/aio_service_tests", cfg);
+
+        latch done(cnt_blocks);
+        std::vector<aio_task_ptr_t<io_task>> tasks;
+        for (auto i = 0U; i < cnt_blocks; ++i)
+        {
+            tasks.push_back(
+                make_aio_task<io_task>(aio_op::read, i * bsize, done));
+            aios.push_read_queue(tasks.back().get());
+        }
+        done.wait();
+        aios.stop();
+
+        for (auto i = 0U; i < cnt_blocks; ++i)
+        {
+            auto& t = tasks[i];
+            BOOST_REQUIRE_MESSAGE(!t->err_, t->err_.message());
+            const auto c = block_char(i);
+            BOOST_CHECK(std::all_of(t->buf(), t->buf() + bsize,
+                                    [c](uint8_t v)
+                                    {
+                                        return v == c;
+                                    }));
+        }
+    }
+
+    void write_read(aio_engine engine)
+    {
+        aio_service aios(fd_);
+        aio_service_cfg cfg;
+        cfg.num_threads_ = 2;
+        cfg.batch_size_  = 4;
+        cfg.engine_      = engine;
+
+        constexpr bytes64_t offs = 3 * bsize;
+        latch wdone(1);
+        auto wt = make_aio_task<io_task>(aio_op::write, offs, wdone);
+        // The write goes through the fixed buffer, if it's supported.
+        aios.register_fixed_buffer(wt->buf(), bsize);
+        aios.start("/tmp/aio_service_tests", cfg);
+
+        ::memset(wt->buf(), 'z', bsize);
+        aios.push_write_queue(wt.get());
+        wdone.wait();
+        BOOST_REQUIRE_MESSAGE(!wt->err_, wt->err_.message());
+        {
+            latch done(1);
+            auto t = make_aio_task<io_task>(aio_op::read, offs, done);
+            aios.push_read_queue(t.get());
+            done.wait();
+            BOOST_REQUIRE_MESSAGE(!t->err_, t->err_.message());
+            BOOST_CHECK(std::all_of(t->buf(), t->buf() + bsize, [](uint8_t v)
+                                    {
+                                        return v == 'z';
+                                    }));
+        }
+        aios.stop();
+    }
+};
+
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE(aio_service_tests, fixture)
+
+BOOST_AUTO_TEST_CASE(read_threads)
+{
+    read_all(aio_engine::threads);
+}
+
+BOOST_AUTO_TEST_CASE(read_io_uring)
+{
+    // Falls back to the threads engine, if io_uring is not supported
+    read_all(aio_engine::io_uring);
+}
+
+BOOST_AUTO_TEST_CASE(write_read_threads)
+{
+    write_read(aio_engine::threads);
+}
+
+BOOST_AUTO_TEST_CASE(write_read_io_uring)
+{
+    write_read(aio_engine::io_uring);
+}
+
+BOOST_AUTO_TEST_CASE(read_past_eof_io_uring)
+{
+    aio_service aios(fd_);
+    aio_service_cfg cfg;
+    cfg.num_threads_ = 2;
+    cfg.batch_size_  = 2;
+    cfg.engine_      = aio_engine::io_uring;
+    aios.start("/tmp/aio_service_tests", cfg);
+
+    latch done(1);
+    auto t = make_aio_task<io_task>(aio_op::read, fsize, done);
+    aios.push_read_queue(t.get());
+    done.wait();
+    aios.stop();
+    BOOST_CHECK(t->err_);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+struct gate_fixture
+{
+    aio_task_queue read_queue_;
+    aio_read_gate gate_{read_queue_};
+
+    gate_fixture() { gate_.set_max_delay(std::chrono::milliseconds(5)); }
+
+    std::chrono::microseconds timed_wait_reads()
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        const auto beg = std_clock_t::now();
+        gate_.wait_reads();
+        return duration_cast<microseconds>(std_clock_t::now() - beg);
+    }
+
+    cache::stats_aio_class stats() const noexcept
+    {
+        cache::stats_aio_class sts;
+        gate_.get_stats(sts);
+        return sts;
+    }
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(aio_read_gate_tests, gate_fixture)
+
+BOOST_AUTO_TEST_CASE(no_reads_no_delay)
+{
+    gate_.wait_reads();
+    BOOST_CHECK_EQUAL(stats().cnt_tasks_, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(in_flight_read_delays_up_to_max)
+{
+    gate_.begin_read();
+    BOOST_CHECK(timed_wait_reads() >= std::chrono::milliseconds(5));
+    gate_.end_read();
+    const auto sts = stats();
+    BOOST_CHECK_EQUAL(sts.cnt_tasks_, 1U);
+    BOOST_CHECK_GE(sts.wait_time_us_, 5000U);
+    BOOST_CHECK_EQUAL(sts.max_wait_time_us_, sts.wait_time_us_);
+    // Not delayed once the read has ended
+    gate_.wait_reads();
+    BOOST_CHECK_EQUAL(stats().cnt_tasks_, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(queued_read_delays)
+{
+    latch done(1);
+    auto t = make_aio_task<io_task>(aio_op::read, 0, done);
+    BOOST_REQUIRE(read_queue_.push_back(t.get()));
+    gate_.wait_reads();
+    BOOST_CHECK_EQUAL(stats().cnt_tasks_, 1U);
+    BOOST_REQUIRE(read_queue_.remove_task(t.get()));
+}
+
+BOOST_AUTO_TEST_CASE(delay_ends_with_the_reads)
+{
+    gate_.set_max_delay(std::chrono::seconds(10));
+    gate_.begin_read();
+    std::thread rd([this]
+                   {
+                       std::this_thread::sleep_for(
+                           std::chrono::milliseconds(2));
+                       gate_.end_read();
+                   });
+    BOOST_CHECK(timed_wait_reads() < std::chrono::seconds(5));
+    rd.join();
+    BOOST_CHECK_EQUAL(stats().cnt_tasks_, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(zero_max_delay_disables)
+{
+    gate_.set_max_delay(std::chrono::microseconds(0));
+    gate_.begin_read();
+    gate_.wait_reads();
+    gate_.end_read();
+    BOOST_CHECK_EQUAL(stats().cnt_tasks_, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
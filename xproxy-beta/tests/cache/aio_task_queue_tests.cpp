@@ -0,0 +1,189 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../../cache/aio_task.h"
+#include "../../cache/aio_task_queue.h"
+#include "../../cache/cache_stats.h"
+
+using namespace cache::detail;
+
+namespace
+{
+
+class cls_task final : public aio_task
+{
+    aio_class cls_;
+
+public:
+    explicit cls_task(aio_class cls) noexcept : cls_(cls) {}
+
+    aio_class cls() const noexcept { return cls_; }
+
+private:
+    aio_op operation() const noexcept final { return aio_op::exec; }
+    aio_class io_class() const noexcept final { return cls_; }
+    void exec() noexcept final {}
+    non_owner_ptr_t<const aio_data> on_begin_io_op() noexcept final
+    {
+        return nullptr;
+    }
+    void on_end_io_op(const err_code_t&) noexcept final {}
+    void service_stopped() noexcept final {}
+};
+
+using tasks_t = std::vector<std::unique_ptr<cls_task>>;
+
+// No deadlines, so that only the weights matter
+aio_sched_cfg weights_only_cfg() noexcept
+{
+    aio_sched_cfg cfg;
+    for (auto& c : cfg.classes_)
+        c.deadline_ = std::chrono::hours(1);
+    return cfg;
+}
+
+void push_tasks(aio_task_queue& q, tasks_t& tasks, aio_class cls, uint32_t cnt)
+{
+    for (uint32_t i = 0; i < cnt; ++i)
+    {
+        tasks.push_back(std::make_unique<cls_task>(cls));
+        BOOST_REQUIRE(q.push_back(tasks.back().get()));
+    }
+}
+
+std::vector<aio_class> pop_classes(aio_task_queue& q, uint32_t cnt)
+{
+    std::vector<aio_class> ret;
+    std::array<non_owner_ptr_t<aio_task>, 64> tasks;
+    BOOST_REQUIRE(cnt <= tasks.size());
+    const auto n = q.pop(tasks.data(), cnt, false);
+    BOOST_REQUIRE_EQUAL(n, cnt);
+    for (uint32_t i = 0; i < n; ++i)
+        ret.push_back(static_cast<cls_task*>(tasks[i])->cls());
+    return ret;
+}
+
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(aio_task_queue_tests)
+
+BOOST_AUTO_TEST_CASE(weighted_round_robin)
+{
+    aio_task_queue q;
+    auto cfg = weights_only_cfg();
+    cfg.classes_[static_cast<uint8_t>(aio_class::interactive)].weight_ = 3;
+    cfg.classes_[static_cast<uint8_t>(aio_class::metadata)].weight_    = 1;
+    q.set_sched_cfg(cfg);
+
+    tasks_t tasks;
+    push_tasks(q, tasks, aio_class::metadata, 8);
+    push_tasks(q, tasks, aio_class::interactive, 24);
+
+    const auto res = pop_classes(q, 32);
+    // Every window of 4 pops must contain 3 interactive and 1 metadata task
+    for (size_t i = 0; i < res.size(); i += 4)
+    {
+        const auto cnt = std::count(res.begin() + i, res.begin() + i + 4,
+                                    aio_class::metadata);
+        BOOST_CHECK_EQUAL(cnt, 1);
+    }
+    BOOST_CHECK_EQUAL(q.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(fifo_inside_class)
+{
+    aio_task_queue q;
+    q.set_sched_cfg(weights_only_cfg());
+
+    tasks_t tasks;
+    push_tasks(q, tasks, aio_class::interactive, 3);
+    auto first = std::make_unique<cls_task>(aio_class::interactive);
+    BOOST_REQUIRE(q.push_front(first.get()));
+
+    BOOST_CHECK_EQUAL(q.pop(), first.get());
+    for (const auto& t : tasks)
+        BOOST_CHECK_EQUAL(q.pop(), t.get());
+}
+
+BOOST_AUTO_TEST_CASE(deadline_goes_first)
+{
+    aio_task_queue q;
+    auto cfg = weights_only_cfg();
+    cfg.classes_[static_cast<uint8_t>(aio_class::interactive)].weight_ = 100;
+    cfg.classes_[static_cast<uint8_t>(aio_class::flush)].weight_       = 1;
+    cfg.classes_[static_cast<uint8_t>(aio_class::flush)].deadline_ =
+        std::chrono::microseconds(0);
+    q.set_sched_cfg(cfg);
+
+    tasks_t tasks;
+    push_tasks(q, tasks, aio_class::interactive, 4);
+    push_tasks(q, tasks, aio_class::flush, 1);
+
+    const auto res = pop_classes(q, 5);
+    BOOST_CHECK(res.front() == aio_class::flush);
+}
+
+BOOST_AUTO_TEST_CASE(remove_and_release)
+{
+    aio_task_queue q;
+    tasks_t tasks;
+    push_tasks(q, tasks, aio_class::interactive, 2);
+    push_tasks(q, tasks, aio_class::metadata, 2);
+    BOOST_CHECK_EQUAL(q.size(), 4U);
+
+    BOOST_CHECK_EQUAL(q.remove_task(tasks[3].get()), tasks[3].get());
+    BOOST_CHECK(q.remove_task(tasks[3].get()) == nullptr);
+    BOOST_CHECK_EQUAL(q.size(), 3U);
+
+    q.stop();
+    BOOST_CHECK(!q.push_back(tasks[3].get()));
+    auto rest = q.release_all();
+    BOOST_CHECK_EQUAL(std::distance(rest.begin(), rest.end()), 3);
+    rest.clear();
+}
+
+BOOST_AUTO_TEST_CASE(wait_stats)
+{
+    aio_task_queue q;
+    tasks_t tasks;
+    push_tasks(q, tasks, aio_class::evacuation, 2);
+    push_tasks(q, tasks, aio_class::metadata, 1);
+    pop_classes(q, 3);
+
+    cache::stats_aio_sched sts;
+    q.get_stats(sts);
+    BOOST_CHECK_EQUAL(sts.interactive_.cnt_tasks_, 0U);
+    BOOST_CHECK_EQUAL(sts.evacuation_.cnt_tasks_, 2U);
+    BOOST_CHECK_EQUAL(sts.flush_.cnt_tasks_, 0U);
+    BOOST_CHECK_EQUAL(sts.metadata_.cnt_tasks_, 1U);
+    BOOST_CHECK(sts.evacuation_.max_wait_time_us_ <=
+                sts.evacuation_.wait_time_us_);
+}
+
+BOOST_AUTO_TEST_CASE(pop_returns_enqueue_time)
+{
+    aio_task_queue q;
+    tasks_t tasks;
+    const auto beg = std_clock_t::now();
+    push_tasks(q, tasks, aio_class::interactive, 1);
+    const auto mid = std_clock_t::now();
+    push_tasks(q, tasks, aio_class::interactive, 2);
+    const auto end = std_clock_t::now();
+
+    std_clock_t::time_point enq;
+    BOOST_CHECK_EQUAL(q.pop(enq), tasks[0].get());
+    BOOST_CHECK((beg <= enq) && (enq <= mid));
+    // The popped task is pushed again and gets a new enqueue time
+    BOOST_REQUIRE(q.push_back(tasks[0].get()));
+
+    std::array<non_owner_ptr_t<aio_task>, 3> popped;
+    std::array<std_clock_t::time_point, 3> enqs;
+    BOOST_REQUIRE_EQUAL(q.pop(popped.data(), 3, false, enqs.data()), 3U);
+    BOOST_CHECK_EQUAL(popped[0], tasks[1].get());
+    BOOST_CHECK_EQUAL(popped[2], tasks[0].get());
+    BOOST_CHECK((mid <= enqs[0]) && (enqs[0] <= end));
+    BOOST_CHECK((mid <= enqs[1]) && (enqs[1] <= end));
+    BOOST_CHECK(end <= enqs[2]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
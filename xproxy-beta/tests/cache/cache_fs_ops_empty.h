@@ -78,7 +78,8 @@ public:
     {
         X3ME_ASSERT(false, "Must not be called");
     }
-    write_transaction fsmd_begin_write(const object_key&) noexcept override
+    expected_t<write_transaction, err_code_t>
+    fsmd_begin_write(const object_key&, bool) noexcept override
     {
         X3ME_ASSERT(false, "Must not be called");
         return write_transaction{};
@@ -89,6 +90,12 @@ public:
         X3ME_ASSERT(false, "Must not be called");
         return boost::make_unexpected(err_code_t{});
     }
+    expected_t<range_elem, err_code_t>
+    fsmd_find_range_elem(const read_transaction&, bytes64_t) noexcept override
+    {
+        X3ME_ASSERT(false, "Must not be called");
+        return boost::make_unexpected(err_code_t{});
+    }
     void fsmd_rem_non_evac_frags(std::vector<agg_meta_entry>&,
                                  volume_blocks64_t,
                                  volume_blocks64_t) noexcept override
@@ -111,6 +118,11 @@ public:
         X3ME_ASSERT(false, "Must not be called");
         return false;
     }
+    wr_pos fsmd_next_write_pos(const wr_pos&) noexcept override
+    {
+        X3ME_ASSERT(false, "Must not be called");
+        return wr_pos{};
+    }
     wr_pos fsmd_commit_disk_write(volume_blocks64_t,
                                   const std::vector<write_transaction>&,
                                   agg_wblock_sync_t&) noexcept override
@@ -143,6 +155,39 @@ public:
     {
         X3ME_ASSERT(false, "Must not be called");
     }
+
+    aligned_data_ref_t memc_try_read_frag(const fs_node_key_t&,
+                                          const range_elem&,
+                                          bytes32_t) noexcept override
+    {
+        return nullptr;
+    }
+    void memc_add_frag(const fs_node_key_t&, const range_elem&,
+                       const aligned_data_ref_t&, bytes32_t) noexcept override
+    {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // The read-ahead is disabled by default. The tests can enable it.
+    uint32_t rdah_max_frags_      = 0;
+    bytes32_t rdah_max_read_size_ = 0;
+
+    uint32_t rdah_max_frags() const noexcept override
+    {
+        return rdah_max_frags_;
+    }
+    bytes32_t rdah_max_read_size() const noexcept override
+    {
+        return rdah_max_read_size_;
+    }
+    bool rdah_reserve(bytes32_t) noexcept override { return false; }
+    void rdah_release(bytes32_t, bool) noexcept override
+    {
+        X3ME_ASSERT(false, "Must not be called");
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    void count_mem_miss() noexcept override {}
 };
 
 } // namespace detail
@@ -0,0 +1,205 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../../cache/flat_hash_map.h"
+#include "../../cache/fs_node_key.h"
+
+using namespace cache::detail;
+
+namespace
+{
+
+// The same as the hash used by the fs_table
+struct key_hash
+{
+    uint64_t operator()(const fs_node_key_t& k) const noexcept
+    {
+        uint64_t ret;
+        ::memcpy(&ret, k.data() + sizeof(ret), sizeof(ret));
+        return ret;
+    }
+};
+
+// Puts all keys in the same group, so that it overflows
+struct same_hash
+{
+    uint64_t operator()(const fs_node_key_t&) const noexcept { return 0; }
+};
+
+using map_t = flat_hash_map<fs_node_key_t, uint64_t, key_hash>;
+using same_map_t = flat_hash_map<fs_node_key_t, uint64_t, same_hash>;
+
+fs_node_key_t make_key(uint64_t v) noexcept
+{
+    return fs_node_key_t{&v, sizeof(v)};
+}
+
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(flat_hash_map_tests)
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+    map_t m;
+    BOOST_CHECK(m.empty());
+    BOOST_CHECK_EQUAL(m.size(), 0);
+    BOOST_CHECK_EQUAL(m.capacity(), 0);
+    BOOST_CHECK(m.begin() == m.end());
+    BOOST_CHECK(m.find(make_key(1)) == m.end());
+}
+
+BOOST_AUTO_TEST_CASE(insert_find_erase)
+{
+    constexpr uint64_t cnt = 10000;
+    map_t m;
+    for (uint64_t i = 0; i < cnt; ++i)
+    {
+        auto res = m.insert(map_t::value_type(make_key(i), i));
+        BOOST_REQUIRE(res.second);
+        BOOST_REQUIRE_EQUAL(res.first->second, i);
+    }
+    BOOST_CHECK_EQUAL(m.size(), cnt);
+    // Duplicated keys are not inserted
+    auto res = m.insert(map_t::value_type(make_key(5), 42));
+    BOOST_CHECK(!res.second);
+    BOOST_CHECK_EQUAL(res.first->second, 5);
+
+    for (uint64_t i = 0; i < cnt; i += 2)
+        m.erase(m.find(make_key(i)));
+    BOOST_CHECK_EQUAL(m.size(), cnt / 2);
+    for (uint64_t i = 0; i < cnt; ++i)
+    {
+        auto it = m.find(make_key(i));
+        if (i % 2)
+        {
+            BOOST_REQUIRE(it != m.end());
+            BOOST_REQUIRE_EQUAL(it->second, i);
+        }
+        else
+            BOOST_REQUIRE(it == m.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(erase_while_iterating)
+{
+    constexpr uint64_t cnt = 1000;
+    map_t m;
+    for (uint64_t i = 0; i < cnt; ++i)
+        m.insert(map_t::value_type(make_key(i), i));
+
+    uint64_t cnt_visited = 0;
+    for (auto it = m.begin(); it != m.end(); ++it)
+    {
+        ++cnt_visited;
+        if (it->second % 3 == 0)
+            m.erase(it);
+    }
+    BOOST_CHECK_EQUAL(cnt_visited, cnt);
+    BOOST_CHECK_EQUAL(m.size(), cnt - ((cnt + 2) / 3));
+    BOOST_CHECK_EQUAL(std::distance(m.begin(), m.end()), m.size());
+}
+
+BOOST_AUTO_TEST_CASE(reserve)
+{
+    constexpr uint64_t cnt = 1000;
+    map_t m;
+    m.reserve(cnt);
+    const auto cap = m.capacity();
+    BOOST_CHECK_GE(cap, cnt);
+    for (uint64_t i = 0; i < cnt; ++i)
+        m.insert(map_t::value_type(make_key(i), i));
+    BOOST_CHECK_EQUAL(m.capacity(), cap);
+}
+
+BOOST_AUTO_TEST_CASE(deleted_slots_reused)
+{
+    constexpr uint64_t cnt = 1000;
+    map_t m;
+    for (uint64_t i = 0; i < cnt; ++i)
+        m.insert(map_t::value_type(make_key(i), i));
+    const auto cap = m.capacity();
+    // The cache log removes old and adds new entries all the time.
+    // The table must not grow if the count of the entries stays the same.
+    for (uint64_t i = cnt; i < 100 * cnt; ++i)
+    {
+        m.erase(m.find(make_key(i - cnt)));
+        m.insert(map_t::value_type(make_key(i), i));
+    }
+    BOOST_CHECK_EQUAL(m.size(), cnt);
+    BOOST_CHECK_LE(m.capacity(), cap);
+    for (uint64_t i = 99 * cnt; i < 100 * cnt; ++i)
+        BOOST_REQUIRE(m.find(make_key(i)) != m.end());
+}
+
+BOOST_AUTO_TEST_CASE(overflowed_groups)
+{
+    constexpr uint64_t cnt = 300;
+    same_map_t m;
+    for (uint64_t i = 0; i < cnt; ++i)
+        BOOST_REQUIRE(m.insert(same_map_t::value_type(make_key(i), i)).second);
+    BOOST_CHECK_EQUAL(std::distance(m.begin(), m.end()), cnt);
+    for (uint64_t i = 0; i < cnt; ++i)
+        BOOST_REQUIRE_EQUAL(m.find(make_key(i))->second, i);
+    // The emptied groups, which have overflowed, must still lead the
+    // searches to the next groups.
+    for (uint64_t i = 0; i < cnt / 2; ++i)
+        m.erase(m.find(make_key(i)));
+    for (uint64_t i = 0; i < cnt; ++i)
+    {
+        auto it = m.find(make_key(i));
+        if (i < cnt / 2)
+            BOOST_REQUIRE(it == m.end());
+        else
+            BOOST_REQUIRE_EQUAL(it->second, i);
+    }
+    // The deleted slots are reused
+    const auto mem = m.memory_usage();
+    for (uint64_t i = 0; i < cnt / 2; ++i)
+        BOOST_REQUIRE(m.insert(same_map_t::value_type(make_key(i), i)).second);
+    BOOST_CHECK_EQUAL(m.memory_usage(), mem);
+    for (uint64_t i = 0; i < cnt; ++i)
+        BOOST_REQUIRE_EQUAL(m.find(make_key(i))->second, i);
+}
+
+BOOST_AUTO_TEST_CASE(memory_per_entry)
+{
+    // The empty slots don't take memory. The groups take a pointer,
+    // a small header, an alignment padding and a tag per entry.
+    const double max_bytes = sizeof(map_t::value_type) + 2;
+    for (const uint64_t cnt : {1000, 1500, 100000, 150000})
+    {
+        map_t m;
+        for (uint64_t i = 0; i < cnt; ++i)
+            m.insert(map_t::value_type(make_key(i), i));
+        BOOST_CHECK_LE(double(m.memory_usage()) / cnt, max_bytes);
+
+        map_t r;
+        r.reserve(cnt);
+        for (uint64_t i = 0; i < cnt; ++i)
+            r.insert(map_t::value_type(make_key(i), i));
+        BOOST_CHECK_LE(double(r.memory_usage()) / cnt, max_bytes);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(copy_move)
+{
+    map_t m;
+    for (uint64_t i = 0; i < 100; ++i)
+        m.insert(map_t::value_type(make_key(i), i));
+
+    map_t m2(m);
+    BOOST_CHECK_EQUAL(m2.size(), m.size());
+    BOOST_CHECK_EQUAL(m2.find(make_key(7))->second, 7);
+
+    map_t m3(std::move(m));
+    BOOST_CHECK(m.empty());
+    BOOST_CHECK(m.find(make_key(7)) == m.end());
+    BOOST_CHECK_EQUAL(m3.size(), 100);
+
+    m = m3;
+    BOOST_CHECK_EQUAL(m.size(), 100);
+    m3.erase(m3.find(make_key(7)));
+    BOOST_CHECK_EQUAL(m.find(make_key(7))->second, 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
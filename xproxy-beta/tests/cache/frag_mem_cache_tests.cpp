@@ -0,0 +1,216 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../../cache/cache_stats.h"
+#include "../../cache/frag_mem_cache.h"
+#include "../../cache/range_elem.h"
+
+using namespace cache::detail;
+
+namespace
+{
+
+// The cache splits the size between 16 shards. All fragments with the same
+// key go to the same shard.
+constexpr bytes64_t shard_size = 10000;
+constexpr bytes64_t cache_size = 16 * shard_size;
+constexpr bytes32_t frag_size  = 100;
+
+auto make_key(char c) noexcept
+{
+    char cc[16];
+    ::memset(cc, c, sizeof(cc));
+    return fs_node_key_t{cc, sizeof(cc)};
+}
+
+range_elem make_rng(uint32_t idx, bytes32_t size = frag_size) noexcept
+{
+    const auto disk_offs = volume_blocks64_t::create_from_bytes(
+        volume_skip_bytes + idx * store_block_size);
+    return make_range_elem(idx * size, size, disk_offs);
+}
+
+aligned_data_ref_t make_data(uint32_t idx, bytes32_t size = frag_size)
+{
+    auto ret = alloc_page_aligned_ref(size);
+    ::memset(ret.get(), 'a' + (idx % 26), size);
+    return ret;
+}
+
+void add_frag(frag_mem_cache& mc, const fs_node_key_t& key, uint32_t idx)
+{
+    mc.add_frag(key, make_rng(idx), make_data(idx), frag_size);
+}
+
+bool read_frag(frag_mem_cache& mc, const fs_node_key_t& key, uint32_t idx)
+{
+    const auto data = mc.try_read_frag(key, make_rng(idx), frag_size);
+    if (!data)
+        return false;
+    const auto exp = make_data(idx);
+    BOOST_REQUIRE(::memcmp(data.get(), exp.get(), frag_size) == 0);
+    return true;
+}
+
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(frag_mem_cache_tests)
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+    frag_mem_cache mc;
+    const auto key = make_key('a');
+    BOOST_CHECK(!mc.enabled());
+    add_frag(mc, key, 1);
+    BOOST_CHECK(!read_frag(mc, key, 1));
+
+    cache::stats_internal sts;
+    mc.get_stats(sts);
+    BOOST_CHECK_EQUAL(sts.cnt_mem_cache_add_, 0);
+    BOOST_CHECK_EQUAL(sts.mem_cache_size_, 0);
+}
+
+BOOST_AUTO_TEST_CASE(read_hit_miss)
+{
+    frag_mem_cache mc;
+    mc.set_max_size(cache_size);
+    BOOST_CHECK(mc.enabled());
+
+    const auto key = make_key('a');
+    BOOST_CHECK(!read_frag(mc, key, 1));
+    add_frag(mc, key, 1);
+    BOOST_CHECK(read_frag(mc, key, 1));
+    // Different range, different key
+    BOOST_CHECK(!read_frag(mc, key, 2));
+    BOOST_CHECK(!read_frag(mc, make_key('b'), 1));
+    // The same range, but different disk position
+    {
+        const auto rng = make_rng(1);
+        const auto other = make_range_elem(
+            rng.rng_offset(), rng.rng_size(),
+            rng.disk_offset() + volume_blocks64_t::create_from_blocks(1));
+        BOOST_CHECK(!mc.try_read_frag(key, other, frag_size));
+    }
+    // Wrong fragment size
+    BOOST_CHECK(!mc.try_read_frag(key, make_rng(1), frag_size / 2));
+
+    cache::stats_internal sts;
+    mc.get_stats(sts);
+    BOOST_CHECK_EQUAL(sts.cnt_mem_cache_hit_, 1);
+    BOOST_CHECK_EQUAL(sts.cnt_mem_cache_miss_, 5);
+    BOOST_CHECK_EQUAL(sts.cnt_mem_cache_add_, 1);
+    BOOST_CHECK_EQUAL(sts.cnt_mem_cache_evict_, 0);
+    BOOST_CHECK_EQUAL(sts.mem_cache_size_, frag_size);
+}
+
+BOOST_AUTO_TEST_CASE(skip_too_big_frag)
+{
+    frag_mem_cache mc;
+    mc.set_max_size(cache_size);
+
+    // Bigger than the small queue of the shard
+    constexpr bytes32_t big_size = shard_size / 2;
+    const auto key = make_key('a');
+    mc.add_frag(key, make_rng(1, big_size), make_data(1, big_size), big_size);
+
+    cache::stats_internal sts;
+    mc.get_stats(sts);
+    BOOST_CHECK_EQUAL(sts.cnt_mem_cache_add_, 0);
+    BOOST_CHECK_EQUAL(sts.mem_cache_size_, 0);
+}
+
+BOOST_AUTO_TEST_CASE(shared_data)
+{
+    frag_mem_cache mc;
+    mc.set_max_size(cache_size);
+
+    // The cache keeps a reference to the added buffer and gives it back
+    // to the readers without copying it.
+    const auto key  = make_key('a');
+    const auto data = make_data(1);
+    mc.add_frag(key, make_rng(1), data, frag_size);
+    BOOST_CHECK_EQUAL(data.use_count(), 2);
+    {
+        const auto rd = mc.try_read_frag(key, make_rng(1), frag_size);
+        BOOST_CHECK_EQUAL(rd.get(), data.get());
+        BOOST_CHECK_EQUAL(data.use_count(), 3);
+    }
+    // The readers keep the data alive after its removal from the cache
+    const auto rd = mc.try_read_frag(key, make_rng(1), frag_size);
+    mc.rem_frags(key);
+    BOOST_CHECK_EQUAL(data.use_count(), 2);
+    BOOST_CHECK_EQUAL(rd.get()[0], 'a' + 1);
+}
+
+BOOST_AUTO_TEST_CASE(rem_frags)
+{
+    frag_mem_cache mc;
+    mc.set_max_size(cache_size);
+
+    const auto key1 = make_key('a');
+    const auto key2 = make_key('b');
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        add_frag(mc, key1, i);
+        add_frag(mc, key2, i);
+    }
+    mc.rem_frags(key1);
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        BOOST_CHECK(!read_frag(mc, key1, i));
+        BOOST_CHECK(read_frag(mc, key2, i));
+    }
+
+    cache::stats_internal sts;
+    mc.get_stats(sts);
+    BOOST_CHECK_EQUAL(sts.mem_cache_size_, 5 * frag_size);
+}
+
+BOOST_AUTO_TEST_CASE(scan_resistance)
+{
+    frag_mem_cache mc;
+    mc.set_max_size(cache_size);
+
+    constexpr uint32_t hot_idx  = 0;
+    constexpr uint32_t cnt_scan = 10 * (shard_size / frag_size);
+
+    const auto key = make_key('a');
+    add_frag(mc, key, hot_idx);
+    BOOST_CHECK(read_frag(mc, key, hot_idx));
+    // A scan through many fragments, read only once, must not evict
+    // the fragment which has been read again.
+    for (uint32_t i = 1; i <= cnt_scan; ++i)
+        add_frag(mc, key, i);
+    BOOST_CHECK(read_frag(mc, key, hot_idx));
+    BOOST_CHECK(!read_frag(mc, key, 1));
+
+    cache::stats_internal sts;
+    mc.get_stats(sts);
+    BOOST_CHECK_EQUAL(sts.cnt_mem_cache_add_, cnt_scan + 1);
+    BOOST_CHECK_GT(sts.cnt_mem_cache_evict_, 0);
+    BOOST_CHECK_LE(sts.mem_cache_size_, shard_size);
+    BOOST_CHECK_EQUAL(sts.mem_cache_size_ / frag_size,
+                      sts.cnt_mem_cache_add_ - sts.cnt_mem_cache_evict_);
+}
+
+BOOST_AUTO_TEST_CASE(ghost_promotion)
+{
+    frag_mem_cache mc;
+    mc.set_max_size(cache_size);
+
+    constexpr uint32_t cnt_scan = 2 * (shard_size / frag_size);
+
+    const auto key = make_key('a');
+    for (uint32_t i = 0; i < cnt_scan; ++i)
+        add_frag(mc, key, i);
+    BOOST_CHECK(!read_frag(mc, key, 0));
+    // Evicted recently. Now it goes directly to the main queue and
+    // survives another scan.
+    add_frag(mc, key, 0);
+    for (uint32_t i = cnt_scan; i < 2 * cnt_scan; ++i)
+        add_frag(mc, key, i);
+    BOOST_CHECK(read_frag(mc, key, 0));
+    BOOST_CHECK(!read_frag(mc, key, 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
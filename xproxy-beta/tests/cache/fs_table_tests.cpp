@@ -15,9 +15,11 @@ fs_node_key_t gen_key(const char* s) noexcept
     return fs_node_key_t{s, strlen(s)};
 }
 
+// The offsets are relative to the beginning of the usable volume space
 constexpr volume_blocks64_t operator""_vblocks(unsigned long long v) noexcept
 {
-    return volume_blocks64_t::create_from_blocks(v);
+    return volume_blocks64_t::create_from_blocks(
+        (volume_skip_bytes / volume_block_size) + v);
 }
 
 bool touch_file(const std::string& fpath) noexcept
@@ -26,6 +28,26 @@ bool touch_file(const std::string& fpath) noexcept
     return !of.fail();
 }
 
+bool rem_range_elem(fs_table& tbl,
+                    const fs_node_key_t& key,
+                    const range_elem& rng)
+{
+    bool removed = false;
+    tbl.rem_entries(key, [&](range_vector& rvec)
+                    {
+                        bytes64_t ret = 0;
+                        auto it       = rvec.find_exact_range(rng);
+                        if (it != rvec.end())
+                        {
+                            ret = it->rng_size();
+                            rvec.rem_range(it);
+                            removed = true;
+                        }
+                        return ret;
+                    });
+    return removed;
+}
+
 } // namespace
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -161,6 +183,84 @@ BOOST_AUTO_TEST_CASE(add_entry_fail_limit_reached)
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 2);
 }
 
+BOOST_AUTO_TEST_CASE(add_entry_concurrent_limit_reached)
+{
+    // The table is sharded and the entries are added concurrently to
+    // different shards. The global limit must still be respected.
+    constexpr auto cnt_nodes  = 128U;
+    constexpr auto disk_space = cnt_nodes * min_obj_size;
+    fs_table tbl(disk_space, min_obj_size);
+    const auto rng =
+        make_range_elem(0, 20_KB, volume_blocks64_t::create_from_bytes(
+                                      volume_skip_bytes));
+
+    auto overwrite_dont_call = [](const auto&, const auto&)
+    {
+        return false;
+    };
+
+    constexpr auto cnt_threads = 4U;
+    constexpr auto cnt_keys    = 100U; // Per thread
+    std::atomic<uint32_t> cnt_added{0};
+    std::atomic<uint32_t> cnt_limit{0};
+    std::vector<std::thread> threads;
+    for (auto t = 0U; t < cnt_threads; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+                                 for (auto i = 0U; i < cnt_keys; ++i)
+                                 {
+                                     const auto k = std::to_string(t) + "_" +
+                                                    std::to_string(i);
+                                     const auto res = tbl.add_entry(
+                                         gen_key(k.c_str()), rng,
+                                         overwrite_dont_call);
+                                     if (res == fs_table::add_res::added)
+                                         ++cnt_added;
+                                     else if (res ==
+                                              fs_table::add_res::limit_reached)
+                                         ++cnt_limit;
+                                 }
+                             });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    BOOST_CHECK_EQUAL(cnt_added.load(), cnt_nodes);
+    BOOST_CHECK_EQUAL(cnt_limit.load(), cnt_threads * cnt_keys - cnt_nodes);
+    BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), cnt_nodes);
+    BOOST_CHECK_EQUAL(tbl.cnt_entries(), cnt_nodes);
+    BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 0); // Because of the SBO
+    BOOST_CHECK_EQUAL(tbl.entries_data_size(), cnt_nodes * 20_KB);
+    BOOST_CHECK(tbl.limit_reached());
+
+    // Removing an entry frees space for another one in any shard
+    auto rem_all = [](range_vector& rv)
+    {
+        bytes64_t sz = 0;
+        for (const auto& r : rv)
+            sz += r.rng_size();
+        rv.rem_range(range_vector::iter_range{rv.begin(), rv.end()});
+        return sz;
+    };
+    optional_t<uint32_t> rem;
+    for (auto t = 0U; (t < cnt_threads) && !rem; ++t)
+    {
+        for (auto i = 0U; (i < cnt_keys) && !rem; ++i)
+        {
+            const auto k = std::to_string(t) + "_" + std::to_string(i);
+            rem = tbl.rem_entries(gen_key(k.c_str()), rem_all);
+        }
+    }
+    BOOST_REQUIRE(rem);
+    BOOST_CHECK(!tbl.limit_reached());
+    BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), cnt_nodes - 1);
+    const auto res =
+        tbl.add_entry(gen_key("new_key"), rng, overwrite_dont_call);
+    BOOST_CHECK(res == fs_table::add_res::added);
+    BOOST_CHECK(tbl.limit_reached());
+}
+
 BOOST_AUTO_TEST_CASE(rem_entry)
 {
     constexpr auto disk_space = 1_MB;
@@ -194,31 +294,31 @@ BOOST_AUTO_TEST_CASE(rem_entry)
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 2);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 5);
 
-    bool rres = tbl.rem_entry(key1, rng11);
+    bool rres = rem_range_elem(tbl, key1, rng11);
     BOOST_CHECK(rres);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 2);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 4);
-    rres = tbl.rem_entry(key1, rng12);
+    rres = rem_range_elem(tbl, key1, rng12);
     BOOST_CHECK(rres);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 2);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 2); // One less because of the SBO
     // Trying to remove already removed range must fail
-    rres = tbl.rem_entry(key1, rng12);
+    rres = rem_range_elem(tbl, key1, rng12);
     BOOST_CHECK(!rres);
     // The fs_node must be removed after this call
-    rres = tbl.rem_entry(key1, rng13);
+    rres = rem_range_elem(tbl, key1, rng13);
     BOOST_CHECK(rres);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 1);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 2);
     // Trying to remove already removed key must fail
-    rres = tbl.rem_entry(key1, rng13);
+    rres = rem_range_elem(tbl, key1, rng13);
     BOOST_CHECK(!rres);
 
-    rres = tbl.rem_entry(key2, rng22);
+    rres = rem_range_elem(tbl, key2, rng22);
     BOOST_CHECK(rres);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 1);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 0); // One less because of the SBO
-    rres = tbl.rem_entry(key2, rng21);
+    rres = rem_range_elem(tbl, key2, rng21);
     BOOST_CHECK(rres);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 0);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 0); // One less because of the SBO
@@ -263,8 +363,9 @@ BOOST_AUTO_TEST_CASE(rem_entries)
                             auto rngs = rvec.find_exact_range(range{0, 40_KB});
                             BOOST_REQUIRE_EQUAL(rngs.size(), 2);
                             rvec.rem_range(rngs);
+                            return bytes64_t{40_KB};
                         });
-    BOOST_CHECK_EQUAL(cnt_removed, 2);
+    BOOST_CHECK(cnt_removed == 2U);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 1);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 3);
     cnt_removed = tbl.rem_entries(
@@ -272,8 +373,9 @@ BOOST_AUTO_TEST_CASE(rem_entries)
         {
             BOOST_REQUIRE_MESSAGE(false, "Should not be called, because the "
                                          "key should be no longer present");
+            return bytes64_t{0};
         });
-    BOOST_CHECK_EQUAL(cnt_removed, 0);
+    BOOST_CHECK(!cnt_removed);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 1);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 3);
 
@@ -283,8 +385,9 @@ BOOST_AUTO_TEST_CASE(rem_entries)
                             auto rngs = rvec.find_exact_range(range{0, 40_KB});
                             BOOST_REQUIRE_EQUAL(rngs.size(), 2);
                             rvec.rem_range(rngs);
+                            return bytes64_t{40_KB};
                         });
-    BOOST_CHECK_EQUAL(cnt_removed, 2);
+    BOOST_CHECK(cnt_removed == 2U);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 1);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 0); // The SBO must be activated
     // The fs_table must become empty after this call
@@ -294,8 +397,9 @@ BOOST_AUTO_TEST_CASE(rem_entries)
             auto rngs = rvec.find_exact_range(range{40_KB, 20_KB});
             BOOST_REQUIRE_EQUAL(rngs.size(), 1);
             rvec.rem_range(rngs);
+            return bytes64_t{20_KB};
         });
-    BOOST_CHECK_EQUAL(cnt_removed, 1);
+    BOOST_CHECK(cnt_removed == 1U);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 0);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 0);
 }
@@ -358,12 +462,12 @@ BOOST_AUTO_TEST_CASE(add_rem_entries_correct_cnt_ranges)
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 1);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 2);
     // Remove the second range. The SBO must kick-in.
-    bool rres = tbl.rem_entry(key, make_range_elem(50_KB, 20_KB, 128_vblocks));
+    bool rres = rem_range_elem(tbl, key, make_range_elem(50_KB, 20_KB, 128_vblocks));
     BOOST_CHECK(rres);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 1);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 0);
     // Remove the last range
-    rres = tbl.rem_entry(key, make_range_elem(10_KB, 20_KB, 128_vblocks));
+    rres = rem_range_elem(tbl, key, make_range_elem(10_KB, 20_KB, 128_vblocks));
     BOOST_CHECK(rres);
     BOOST_CHECK_EQUAL(tbl.cnt_fs_nodes(), 0);
     BOOST_CHECK_EQUAL(tbl.cnt_ranges(), 0);
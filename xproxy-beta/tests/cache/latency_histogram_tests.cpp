@@ -0,0 +1,97 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../../cache/latency_histogram.h"
+
+using cache::latency_hist;
+using cache::detail::latency_recorder;
+
+BOOST_AUTO_TEST_SUITE(latency_histogram_tests)
+
+BOOST_AUTO_TEST_CASE(bucket_bounds)
+{
+    // Every value must fall in a bucket whose upper bound is not less than
+    // the value and is within the relative error of the histogram.
+    uint32_t prev_idx = 0;
+    for (uint64_t v = 0; v < 100000; ++v)
+    {
+        const auto idx = latency_hist::bucket_idx(v);
+        BOOST_REQUIRE(idx < latency_hist::cnt_buckets);
+        BOOST_REQUIRE(idx >= prev_idx);
+        const auto upper = latency_hist::bucket_upper(idx);
+        BOOST_REQUIRE(upper >= v);
+        BOOST_REQUIRE(upper <= (v + (v / latency_hist::cnt_sub)));
+        prev_idx = idx;
+    }
+    BOOST_CHECK_EQUAL(latency_hist::bucket_idx(latency_hist::max_us),
+                      latency_hist::cnt_buckets - 1);
+    BOOST_CHECK_EQUAL(latency_hist::bucket_idx(-1),
+                      latency_hist::cnt_buckets - 1);
+    BOOST_CHECK_EQUAL(latency_hist::bucket_upper(latency_hist::cnt_buckets - 1),
+                      latency_hist::max_us);
+}
+
+BOOST_AUTO_TEST_CASE(percentiles)
+{
+    latency_recorder rec;
+    for (uint64_t v = 1; v <= 1000; ++v)
+        rec.record(v);
+
+    latency_hist h;
+    rec.get_stats(h);
+    BOOST_CHECK_EQUAL(h.cnt_, 1000U);
+    BOOST_CHECK_EQUAL(h.sum_us_, 500500U);
+    BOOST_CHECK_EQUAL(h.max_us_, 1000U);
+
+    const auto p50 = h.percentile(50.0);
+    BOOST_CHECK((p50 >= 500) && (p50 <= 500 + 500 / latency_hist::cnt_sub));
+    const auto p99 = h.percentile(99.0);
+    BOOST_CHECK((p99 >= 990) && (p99 <= 1000));
+    BOOST_CHECK_EQUAL(h.percentile(99.9), 1000U);
+    BOOST_CHECK_EQUAL(h.percentile(100.0), 1000U);
+
+    BOOST_CHECK_EQUAL(latency_hist{}.percentile(50.0), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(merge)
+{
+    latency_recorder rec1;
+    latency_recorder rec2;
+    for (uint32_t i = 0; i < 99; ++i)
+        rec1.record(10);
+    rec2.record(5000);
+
+    latency_hist h1;
+    latency_hist h2;
+    rec1.get_stats(h1);
+    rec2.get_stats(h2);
+    h1.merge(h2);
+    BOOST_CHECK_EQUAL(h1.cnt_, 100U);
+    BOOST_CHECK_EQUAL(h1.max_us_, 5000U);
+    BOOST_CHECK_EQUAL(h1.percentile(99.0), 10U);
+    BOOST_CHECK_EQUAL(h1.percentile(99.9), 5000U);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_record)
+{
+    constexpr uint32_t cnt_threads = 4;
+    constexpr uint32_t cnt_values  = 10000;
+    latency_recorder rec;
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < cnt_threads; ++t)
+    {
+        threads.emplace_back([&rec, t]
+                             {
+                                 for (uint32_t i = 0; i < cnt_values; ++i)
+                                     rec.record(i + t);
+                             });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    latency_hist h;
+    rec.get_stats(h);
+    BOOST_CHECK_EQUAL(h.cnt_, cnt_threads * cnt_values);
+    BOOST_CHECK_EQUAL(h.max_us_, cnt_values - 1 + cnt_threads - 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -19,7 +19,7 @@ read_transaction make_rtrans(bytes64_t offs, bytes32_t size) noexcept
 range_elem make_relem(bytes64_t offs, bytes32_t size) noexcept
 {
     return make_range_elem(
-        offs, size, volume_blocks64_t::round_up_to_blocks(128_KB + offs));
+        offs, size, volume_blocks64_t::round_up_to_blocks(volume_skip_bytes + offs));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,7 +75,7 @@ public:
         curr_rng_.set_rng_offset(rng_offs);
         curr_rng_.set_rng_size(rng_size);
         curr_rng_.set_disk_offset(
-            volume_blocks64_t::round_up_to_blocks(rng_offs + 128_KB));
+            volume_blocks64_t::round_up_to_blocks(rng_offs + volume_skip_bytes));
         curr_rng_.set_in_memory(rng_in_memory);
         const auto exp_hdr = object_frag_hdr::create(key_, curr_rng_);
         buff_.resize(object_frag_size(rng_size), fill);
@@ -161,6 +161,17 @@ private:
         return boost::make_unexpected(err_code_t{
             cache::internal_logic_error, cache::get_cache_error_category()});
     }
+    expected_t<range_elem, err_code_t>
+    fsmd_find_range_elem(const read_transaction&,
+                         bytes64_t offs) noexcept final
+    {
+        // Only the current range is known to the tests
+        if (find_rng_ && x3me::math::in_range(offs, curr_rng_.rng_offset(),
+                                              curr_rng_.rng_end_offset()))
+            return curr_rng_;
+        return boost::make_unexpected(err_code_t{
+            cache::object_not_present, cache::get_cache_error_category()});
+    }
     bool aggw_try_read_frag(const fs_node_key_t&, const range_elem& rng,
                             frag_buff_t buf) noexcept final
     {
@@ -168,7 +179,7 @@ private:
         if (find_aggw_rng_)
         {
             X3ME_ASSERT(rng == curr_rng_, "Invalid current range");
-            X3ME_ASSERT(object_frag_size(buf.size()) == buff_.size(),
+            X3ME_ASSERT(buf.size() == buff_.size(),
                         "Invalid buff size");
             ::memcpy(buf.data(), buff_.data(), buff_.size());
         }
@@ -222,7 +233,7 @@ public:
         static_cast<aio_task*>(handle_.get())->service_stopped();
     }
 
-    void close_handle() noexcept { handle_->close(); }
+    void close_handle() noexcept { handle_->async_close(); }
 
     bool same_buffers(bytes32_t skipb, bytes32_t skipe,
                       bytes32_t rem_buffs = 0) const noexcept
@@ -254,6 +265,288 @@ public:
     }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+
+// Simulates an object with several fragments on the disk and an AIO queue,
+// which the tests run step by step. Used for the read-ahead tests.
+class rdah_fs_ops final : public cache_fs_ops_empty
+{
+    struct frag
+    {
+        range_elem rng_;
+        std::vector<uint8_t> data_; // Together with the fragment header
+    };
+    std::vector<frag> frags_;
+    bytes64_t disk_end_ = volume_skip_bytes;
+
+    std::deque<aio_task_ptr_t<aio_task>> queue_;
+
+public:
+    struct cached_frag
+    {
+        range_elem rng_;
+        std::vector<uint8_t> data_;
+        // The buffer isn't shared with other fragments
+        bool own_buff_;
+    };
+    std::vector<cached_frag> cached_;
+
+public:
+    struct pending_io
+    {
+        aio_task_ptr_t<aio_task> task_;
+        non_owner_ptr_t<const aio_data> data_;
+    };
+
+    read_transaction rtrans_;
+    fs_node_key_t key_{"aaa", 3};
+
+    bytes32_t rdah_budget_   = 1_MB;
+    bytes32_t rdah_reserved_ = 0;
+    bytes32_t rdah_used_     = 0;
+    bytes32_t rdah_wasted_   = 0;
+    uint32_t cnt_disk_reads_ = 0;
+
+public:
+    ~rdah_fs_ops() noexcept final { rtrans_.invalidate(); }
+
+    // The fragments follow one after another in the object. They follow
+    // one after another on the disk too, unless a gap is given.
+    void add_frag(bytes32_t size, uint8_t fill, bytes32_t disk_gap = 0)
+    {
+        const bytes64_t offs =
+            frags_.empty() ? 0 : frags_.back().rng_.rng_end_offset();
+        disk_end_ += disk_gap;
+        frag f;
+        f.rng_ = make_range_elem(offs, size,
+                                 volume_blocks64_t::create_from_bytes(disk_end_));
+        f.data_.resize(object_frag_size(size));
+        for (bytes32_t i = 0; i < f.data_.size(); ++i)
+            f.data_[i] = fill + i;
+        const auto hdr = object_frag_hdr::create(key_, f.rng_);
+        ::memcpy(f.data_.data(), &hdr, sizeof(hdr));
+        disk_end_ += f.data_.size();
+        frags_.push_back(std::move(f));
+    }
+
+    bytes32_t frag_size(uint32_t idx) const noexcept
+    {
+        return frags_[idx].data_.size();
+    }
+
+    // Checks that the fragments have been added to the RAM cache in the
+    // given order, with correct data and in their own buffers.
+    bool cached_frags(std::initializer_list<uint32_t> idxs) const noexcept
+    {
+        if (cached_.size() != idxs.size())
+            return false;
+        auto it = cached_.begin();
+        for (const auto idx : idxs)
+        {
+            const auto& f = frags_[idx];
+            if (!(it->rng_ == f.rng_) || (it->data_ != f.data_) ||
+                !it->own_buff_)
+                return false;
+            ++it;
+        }
+        return true;
+    }
+
+    std::vector<char> data(bytes64_t offs, bytes32_t len) const noexcept
+    {
+        std::vector<char> ret;
+        for (const auto& f : frags_)
+        {
+            const auto beg = f.rng_.rng_offset();
+            const auto end = f.rng_.rng_end_offset();
+            for (auto i = std::max(beg, offs); i < std::min(end, offs + len);
+                 ++i)
+                ret.push_back(f.data_[sizeof(object_frag_hdr) + (i - beg)]);
+        }
+        return ret;
+    }
+
+    size_t queue_size() const noexcept { return queue_.size(); }
+
+    // Executes the begin of the next queued task.
+    // The returned IO data is null if the task doesn't need a disk read.
+    pending_io begin_next() noexcept
+    {
+        X3ME_ASSERT(!queue_.empty(), "No queued tasks");
+        pending_io ret{std::move(queue_.front()), nullptr};
+        queue_.pop_front();
+        ret.data_ = ret.task_->on_begin_io_op();
+        return ret;
+    }
+
+    // Fills the first valid_size bytes of the read buffer from the disk and
+    // ends the IO operation with the given error.
+    void end_io(pending_io& p,
+                const err_code_t& err   = err_code_t{},
+                bytes32_t valid_size    = -1,
+                bool corrupt_hdrs_after = false) noexcept
+    {
+        const auto* d = p.data_;
+        X3ME_ASSERT(d, "Nothing to end");
+        ++cnt_disk_reads_;
+        valid_size = std::min(valid_size, d->size_);
+        ::memset(d->buf_, 0, d->size_);
+        for (const auto& f : frags_)
+        {
+            const auto doffs = f.rng_.disk_offset().to_bytes();
+            if ((doffs < d->offs_) || ((doffs + f.data_.size()) >
+                                       (d->offs_ + d->size_)))
+                continue;
+            const auto boffs = doffs - d->offs_;
+            if (boffs >= valid_size)
+                continue;
+            ::memcpy(d->buf_ + boffs, f.data_.data(),
+                     std::min<size_t>(f.data_.size(), valid_size - boffs));
+            // Corrupt the fragments after the first one
+            if (corrupt_hdrs_after && (boffs > 0))
+                ::memset(d->buf_ + boffs, 0, sizeof(object_frag_hdr));
+        }
+        p.task_->on_end_io_op(err);
+    }
+
+    void run_all() noexcept
+    {
+        while (!queue_.empty())
+        {
+            auto p = begin_next();
+            if (p.data_)
+                end_io(p);
+        }
+    }
+
+private:
+    void aios_push_read_queue(owner_ptr_t<aio_task> t) noexcept final
+    {
+        queue_.emplace_back(t);
+    }
+    void aios_enqueue_read_queue(owner_ptr_t<aio_task> t) noexcept final
+    {
+        if (std::find(queue_.begin(), queue_.end(), t) == queue_.end())
+            queue_.emplace_back(t);
+    }
+    bool vmtx_lock_shared(bytes64_t) noexcept final { return false; }
+    void fsmd_end_read(read_transaction&& rtrans) noexcept final
+    {
+        rtrans_ = std::move(rtrans);
+    }
+    expected_t<range_elem, err_code_t>
+    fsmd_find_next_range_elem(const read_transaction& rtrans) noexcept final
+    {
+        return fsmd_find_range_elem(rtrans, rtrans.curr_offset());
+    }
+    expected_t<range_elem, err_code_t>
+    fsmd_find_range_elem(const read_transaction&,
+                         bytes64_t offs) noexcept final
+    {
+        for (const auto& f : frags_)
+        {
+            if (x3me::math::in_range(offs, f.rng_.rng_offset(),
+                                     f.rng_.rng_end_offset()))
+                return f.rng_;
+        }
+        return boost::make_unexpected(err_code_t{
+            cache::object_not_present, cache::get_cache_error_category()});
+    }
+    void memc_add_frag(const fs_node_key_t&,
+                       const range_elem& rng,
+                       const aligned_data_ref_t& frag,
+                       bytes32_t size) noexcept final
+    {
+        // The handle may keep the buffer too, for its next disk read.
+        // More owners mean that the buffer is shared with other fragments.
+        const auto* p = frag.get();
+        cached_.push_back(cached_frag{rng, std::vector<uint8_t>(p, p + size),
+                                      (frag.use_count() <= 2)});
+    }
+    bool rdah_reserve(bytes32_t size) noexcept final
+    {
+        if ((rdah_reserved_ + size) > rdah_budget_)
+            return false;
+        rdah_reserved_ += size;
+        return true;
+    }
+    void rdah_release(bytes32_t size, bool used) noexcept final
+    {
+        BOOST_REQUIRE(rdah_reserved_ >= size);
+        rdah_reserved_ -= size;
+        (used ? rdah_used_ : rdah_wasted_) += size;
+    }
+};
+
+class rdah_fixture
+{
+public:
+    std::shared_ptr<rdah_fs_ops> fs_ops_ = std::make_shared<rdah_fs_ops>();
+
+    object_rhandle_ptr_t handle_;
+
+    std::vector<char> buff_;
+    cache::shared_data_t shared_;
+    bool handler_called_ = false;
+    err_code_t err_;
+    bytes32_t read_bytes_ = 0;
+
+public:
+    void init(bytes64_t offs, bytes64_t size) noexcept
+    {
+        read_transaction rtrans(object_key(fs_ops_->key_, range{offs, size}));
+        handle_ = new object_read_handle(fs_ops_, std::move(rtrans));
+    }
+
+    void async_read(bytes32_t size) noexcept
+    {
+        buff_.assign(size, 0);
+        handler_called_ = false;
+        cache::const_buffers buffs;
+        buffs.emplace_back(buff_.data(), buff_.size());
+        handle_->async_read(std::move(buffs),
+                            [this](const err_code_t& err, bytes32_t bytes)
+                            {
+                                handler_called_ = true;
+                                err_            = err;
+                                read_bytes_     = bytes;
+                            });
+    }
+
+    bool same_data(bytes64_t offs) const noexcept
+    {
+        const auto exp = fs_ops_->data(offs, read_bytes_);
+        return std::equal(exp.begin(), exp.end(), buff_.begin(),
+                          buff_.begin() + read_bytes_);
+    }
+
+    void async_read_shared(bytes32_t max_len) noexcept
+    {
+        shared_.reset();
+        handler_called_ = false;
+        handle_->async_read(shared_, max_len,
+                            [this](const err_code_t& err, bytes32_t bytes)
+                            {
+                                handler_called_ = true;
+                                err_            = err;
+                                read_bytes_     = bytes;
+                            });
+    }
+
+    bool same_shared_data(bytes64_t offs) const noexcept
+    {
+        const auto exp = fs_ops_->data(offs, read_bytes_);
+        const auto* p  = reinterpret_cast<const char*>(shared_.get());
+        return std::equal(exp.begin(), exp.end(), p, p + read_bytes_);
+    }
+
+    void close_handle() noexcept
+    {
+        handle_->async_close();
+        fs_ops_->run_all();
+    }
+};
+
 } // namespace
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -693,7 +986,7 @@ BOOST_AUTO_TEST_CASE(disk_memory_and_agg_read_skip_end)
     BOOST_CHECK(same_buffers(0_KB, min_obj_size));
 }
 
-BOOST_AUTO_TEST_CASE(error_eof_on_read_after_eof)
+BOOST_AUTO_TEST_CASE(error_invalid_handle_on_read_after_eof)
 {
     init(20_KB, 2 * min_obj_size);
 
@@ -732,13 +1025,13 @@ BOOST_AUTO_TEST_CASE(error_eof_on_read_after_eof)
     BOOST_CHECK(!fs_ops_->vmtx_unlock_shared_called_); // Skipped too
     BOOST_CHECK(fs_ops_->fmsd_end_read_called_); // Now it's finished
 
-    // Reading after EOF should get us another EOF
+    // The handle gets closed on EOF and reading after it is an error
     fs_ops_->reset_state();
     handler_called = false;
     async_read(4, [&](err_code_t err, bytes32_t read_bytes)
                {
                    handler_called = true;
-                   BOOST_CHECK_EQUAL(err.value(), cache::eof);
+                   BOOST_CHECK_EQUAL(err.value(), cache::invalid_handle);
                    BOOST_CHECK_EQUAL(read_bytes, 0);
                });
     fs_ops_->run_one();
@@ -762,7 +1055,7 @@ BOOST_AUTO_TEST_CASE(error_eof_on_read_after_eof)
     BOOST_CHECK(fs_ops_->rtrans_.finished());
 
     fs_ops_->update_all_data(); // We need it to compare buffers to all data
-    // Remove last 4 buffers allocated for the second EOF
+    // Remove last 4 buffers allocated for the read after EOF
     BOOST_CHECK(same_buffers(0_KB, 0_KB, 4));
 }
 
@@ -1012,3 +1305,375 @@ BOOST_AUTO_TEST_CASE(service_stopped_and_read_attempt)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE(object_read_handle_rdah_tests, rdah_fixture)
+
+BOOST_AUTO_TEST_CASE(user_read_during_read_ahead)
+{
+    // The fragments aren't adjacent on the disk and aren't coalesced
+    fs_ops_->rdah_max_frags_ = 1;
+    fs_ops_->add_frag(16_KB, 'a', 4_KB);
+    fs_ops_->add_frag(16_KB, 'b', 4_KB);
+    fs_ops_->add_frag(16_KB, 'c', 4_KB);
+    init(0, 48_KB);
+
+    async_read(16_KB);
+    BOOST_REQUIRE_EQUAL(fs_ops_->queue_size(), 1);
+    auto io = fs_ops_->begin_next();
+    BOOST_REQUIRE(io.data_);
+    fs_ops_->end_io(io);
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_data(0));
+
+    // The task gets enqueued again to read the next fragment
+    BOOST_REQUIRE_EQUAL(fs_ops_->queue_size(), 1);
+    io = fs_ops_->begin_next();
+    BOOST_REQUIRE(io.data_);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, fs_ops_->frag_size(1));
+
+    // The user read, issued while the read-ahead is in progress, doesn't
+    // enqueue the task. The end of the read-ahead enqueues it.
+    async_read(16_KB);
+    BOOST_CHECK_EQUAL(fs_ops_->queue_size(), 0);
+    fs_ops_->end_io(io);
+    BOOST_CHECK(!handler_called_);
+    BOOST_REQUIRE_EQUAL(fs_ops_->queue_size(), 1);
+
+    // The user read is served from the read-ahead fragment
+    io = fs_ops_->begin_next();
+    BOOST_CHECK(!io.data_);
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_data(16_KB));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 2);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_, fs_ops_->frag_size(1));
+
+    // The last fragment is read ahead while there is no user read
+    fs_ops_->run_all();
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 3);
+    async_read(16_KB);
+    BOOST_CHECK_EQUAL(fs_ops_->queue_size(), 1);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(err_.value(), cache::eof);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_data(32_KB));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 3);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_,
+                      fs_ops_->frag_size(1) + fs_ops_->frag_size(2));
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_wasted_, 0);
+    BOOST_CHECK(fs_ops_->rtrans_.finished());
+}
+
+BOOST_AUTO_TEST_CASE(read_ahead_budget_released_on_error)
+{
+    fs_ops_->rdah_max_frags_ = 1;
+    fs_ops_->add_frag(16_KB, 'a', 4_KB);
+    fs_ops_->add_frag(16_KB, 'b', 4_KB);
+    fs_ops_->add_frag(16_KB, 'c', 4_KB);
+    init(0, 48_KB);
+
+    async_read(16_KB);
+    auto io = fs_ops_->begin_next();
+    fs_ops_->end_io(io);
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+
+    // The read-ahead fails. Its budget is released as wasted.
+    io = fs_ops_->begin_next();
+    BOOST_REQUIRE(io.data_);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, fs_ops_->frag_size(1));
+    fs_ops_->end_io(io, err_code_t{EIO, bsys::get_system_category()});
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_wasted_, fs_ops_->frag_size(1));
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_, 0);
+
+    // The fragment is read again on demand and no more read-ahead is done
+    fs_ops_->run_all();
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 2);
+    async_read(16_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_data(16_KB));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 3);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+
+    close_handle();
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_, 0);
+    BOOST_CHECK(!fs_ops_->rtrans_.finished());
+}
+
+BOOST_AUTO_TEST_CASE(read_ahead_budget_released_on_close)
+{
+    fs_ops_->rdah_max_frags_ = 2;
+    fs_ops_->add_frag(16_KB, 'a', 4_KB);
+    fs_ops_->add_frag(16_KB, 'b', 4_KB);
+    fs_ops_->add_frag(16_KB, 'c', 4_KB);
+    init(0, 48_KB);
+
+    async_read(16_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 3);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_,
+                      fs_ops_->frag_size(1) + fs_ops_->frag_size(2));
+
+    // The unused read-ahead fragments are released as wasted
+    close_handle();
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_wasted_,
+                      fs_ops_->frag_size(1) + fs_ops_->frag_size(2));
+}
+
+BOOST_AUTO_TEST_CASE(read_ahead_no_budget)
+{
+    fs_ops_->rdah_max_frags_ = 1;
+    fs_ops_->rdah_budget_    = 16_KB; // Smaller than a fragment
+    fs_ops_->add_frag(16_KB, 'a', 4_KB);
+    fs_ops_->add_frag(16_KB, 'b', 4_KB);
+    init(0, 32_KB);
+
+    async_read(16_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 1);
+
+    async_read(16_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(err_.value(), cache::eof);
+    BOOST_CHECK(same_data(16_KB));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 2);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_ + fs_ops_->rdah_wasted_, 0);
+}
+
+BOOST_AUTO_TEST_CASE(user_read_straddles_read_ahead_window)
+{
+    fs_ops_->rdah_max_frags_ = 1;
+    fs_ops_->add_frag(16_KB, 'a', 4_KB);
+    fs_ops_->add_frag(16_KB, 'b', 4_KB);
+    fs_ops_->add_frag(16_KB, 'c', 4_KB);
+    fs_ops_->add_frag(16_KB, 'd', 4_KB);
+    init(0, 64_KB);
+
+    // Reads the first half of the first fragment.
+    // The second fragment is read ahead after that.
+    async_read(8_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(same_data(0));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 2);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, fs_ops_->frag_size(1));
+
+    // The rest of the first fragment, the whole read-ahead fragment and
+    // part of the fragment after the read-ahead window.
+    async_read(32_KB);
+    auto io = fs_ops_->begin_next();
+    BOOST_REQUIRE(io.data_);
+    BOOST_CHECK(!handler_called_);
+    fs_ops_->end_io(io);
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 32_KB);
+    BOOST_CHECK(same_data(8_KB));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 3);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_, fs_ops_->frag_size(1));
+
+    // The last fragment is read ahead and the read finishes from memory
+    fs_ops_->run_all();
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 4);
+    async_read(24_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(err_.value(), cache::eof);
+    BOOST_CHECK_EQUAL(read_bytes_, 24_KB);
+    BOOST_CHECK(same_data(40_KB));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 4);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_wasted_, 0);
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_read_serves_several_frags)
+{
+    fs_ops_->rdah_max_read_size_ = 256_KB;
+    fs_ops_->add_frag(16_KB, 'a');
+    fs_ops_->add_frag(16_KB, 'b');
+    fs_ops_->add_frag(16_KB, 'c');
+    init(0, 48_KB);
+    const auto size1 = fs_ops_->frag_size(1);
+    const auto size2 = fs_ops_->frag_size(2);
+
+    // The fragments are adjacent on the disk and are read at once
+    async_read(16_KB);
+    auto io = fs_ops_->begin_next();
+    BOOST_REQUIRE(io.data_);
+    BOOST_CHECK_EQUAL(io.data_->size_, fs_ops_->frag_size(0) + size1 + size2);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, size1 + size2);
+    fs_ops_->end_io(io);
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_data(0));
+
+    async_read(16_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_data(16_KB));
+
+    async_read(16_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(err_.value(), cache::eof);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_data(32_KB));
+
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 1);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_, size1 + size2);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_wasted_, 0);
+    // The RAM cache gets copies of the fragments, not parts of the big buffer
+    BOOST_CHECK(fs_ops_->cached_frags({0, 1, 2}));
+    BOOST_CHECK(fs_ops_->rtrans_.finished());
+}
+
+BOOST_AUTO_TEST_CASE(shared_read_refers_to_frag_data)
+{
+    fs_ops_->add_frag(16_KB, 'a');
+    fs_ops_->add_frag(16_KB, 'b');
+    init(0, 32_KB);
+
+    // Refers to at most the requested bytes
+    async_read_shared(10_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 10_KB);
+    BOOST_REQUIRE(shared_);
+    BOOST_CHECK(same_shared_data(0));
+
+    // Refers only to the rest of the current fragment. The fragment data
+    // doesn't move while referred.
+    const auto prev = shared_;
+    async_read_shared(32_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 6_KB);
+    BOOST_CHECK(shared_.get() == (prev.get() + 10_KB));
+    BOOST_CHECK(same_shared_data(10_KB));
+
+    async_read_shared(32_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(err_.value(), cache::eof);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_shared_data(16_KB));
+    // The data of the previous fragment is still valid
+    const auto exp = fs_ops_->data(0, 10_KB);
+    BOOST_CHECK(std::equal(exp.begin(), exp.end(),
+                           reinterpret_cast<const char*>(prev.get())));
+    BOOST_CHECK(fs_ops_->rtrans_.finished());
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_read_wrong_hdr_in_the_middle)
+{
+    fs_ops_->rdah_max_read_size_ = 256_KB;
+    fs_ops_->add_frag(16_KB, 'a');
+    fs_ops_->add_frag(16_KB, 'b');
+    fs_ops_->add_frag(16_KB, 'c');
+    fs_ops_->add_frag(16_KB, 'd');
+    init(0, 64_KB);
+    const auto size_rest =
+        fs_ops_->frag_size(1) + fs_ops_->frag_size(2) + fs_ops_->frag_size(3);
+
+    // The first fragment is fine. The headers after it are wrong.
+    async_read(16_KB);
+    auto io = fs_ops_->begin_next();
+    BOOST_REQUIRE(io.data_);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, size_rest);
+    fs_ops_->end_io(io, err_code_t{}, -1, true /*corrupt_hdrs_after*/);
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(!err_);
+    BOOST_CHECK_EQUAL(read_bytes_, 16_KB);
+    BOOST_CHECK(same_data(0));
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_wasted_, size_rest);
+    BOOST_CHECK(fs_ops_->cached_frags({0}));
+
+    // The dropped fragments are read again on demand
+    async_read(48_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(err_.value(), cache::eof);
+    BOOST_CHECK_EQUAL(read_bytes_, 48_KB);
+    BOOST_CHECK(same_data(16_KB));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 2);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_,
+                      fs_ops_->frag_size(2) + fs_ops_->frag_size(3));
+    BOOST_CHECK(fs_ops_->cached_frags({0, 1, 2, 3}));
+    BOOST_CHECK(fs_ops_->rtrans_.finished());
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_read_ahead_short_read)
+{
+    // The first fragment isn't adjacent to the others. It's read alone and
+    // the rest are read ahead together.
+    fs_ops_->rdah_max_frags_     = 3;
+    fs_ops_->rdah_max_read_size_ = 256_KB;
+    fs_ops_->add_frag(16_KB, 'a');
+    fs_ops_->add_frag(16_KB, 'b', 4_KB);
+    fs_ops_->add_frag(16_KB, 'c');
+    fs_ops_->add_frag(16_KB, 'd');
+    init(0, 64_KB);
+    const auto size_rest =
+        fs_ops_->frag_size(1) + fs_ops_->frag_size(2) + fs_ops_->frag_size(3);
+
+    async_read(16_KB);
+    auto io = fs_ops_->begin_next();
+    BOOST_REQUIRE(io.data_);
+    BOOST_CHECK_EQUAL(io.data_->size_, fs_ops_->frag_size(0));
+    fs_ops_->end_io(io);
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK(same_data(0));
+
+    // The disk read ends early, in the middle of the second fragment
+    io = fs_ops_->begin_next();
+    BOOST_REQUIRE(io.data_);
+    BOOST_CHECK_EQUAL(io.data_->size_, size_rest);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, size_rest);
+    fs_ops_->end_io(
+        io, err_code_t{cache::eof, cache::get_cache_error_category()},
+        fs_ops_->frag_size(1) + 4_KB);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_wasted_, size_rest);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_used_, 0);
+
+    // The fragments are read again on demand
+    fs_ops_->run_all();
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 2);
+    async_read(48_KB);
+    fs_ops_->run_all();
+    BOOST_REQUIRE(handler_called_);
+    BOOST_CHECK_EQUAL(err_.value(), cache::eof);
+    BOOST_CHECK_EQUAL(read_bytes_, 48_KB);
+    BOOST_CHECK(same_data(16_KB));
+    BOOST_CHECK_EQUAL(fs_ops_->cnt_disk_reads_, 3);
+    BOOST_CHECK_EQUAL(fs_ops_->rdah_reserved_, 0);
+    BOOST_CHECK(fs_ops_->cached_frags({0, 1, 2, 3}));
+    BOOST_CHECK(fs_ops_->rtrans_.finished());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
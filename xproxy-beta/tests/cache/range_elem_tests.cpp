@@ -62,6 +62,44 @@ BOOST_AUTO_TEST_CASE(range_elem_check_readers)
     BOOST_CHECK_EQUAL(re.cnt_readers(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(range_elem_check_hits)
+{
+    auto re = make_range_elem(1_MB, 32_KB, bytes2blocks(2_MB));
+    BOOST_CHECK_EQUAL(re.hits(), 0);
+    BOOST_CHECK(!re.in_memory());
+
+    // The hits and the in-memory flag share a byte and must not interfere
+    re.set_in_memory(true);
+    for (auto i = 1U; i <= range_elem::max_hits(); ++i)
+    {
+        re.atomic_inc_hits();
+        BOOST_CHECK_EQUAL(re.hits(), i);
+    }
+    BOOST_CHECK(re.in_memory());
+
+    // The count saturates at the limit
+    re.atomic_inc_hits();
+    BOOST_CHECK_EQUAL(re.hits(), range_elem::max_hits());
+
+    re.set_in_memory(false);
+    BOOST_CHECK(!re.in_memory());
+    BOOST_CHECK_EQUAL(re.hits(), range_elem::max_hits());
+
+    re.atomic_decay_hits();
+    BOOST_CHECK_EQUAL(re.hits(), range_elem::max_hits() / 2);
+    BOOST_CHECK(!re.in_memory());
+    re.set_in_memory(true);
+    while (re.hits() > 0)
+        re.atomic_decay_hits();
+    BOOST_CHECK(re.in_memory());
+
+    re.atomic_inc_hits();
+    re.reset_meta();
+    BOOST_CHECK_EQUAL(re.hits(), 0);
+    BOOST_CHECK(!re.in_memory());
+    BOOST_CHECK_EQUAL(re.rng_offset(), 1_MB);
+}
+
 BOOST_AUTO_TEST_CASE(range_elem_make_non_zero)
 {
     { // small values
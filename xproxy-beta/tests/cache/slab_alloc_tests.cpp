@@ -0,0 +1,95 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../../cache/slab_alloc.h"
+
+using namespace cache::detail;
+
+BOOST_AUTO_TEST_SUITE(slab_alloc_tests)
+
+BOOST_AUTO_TEST_CASE(alloc_free_reuse)
+{
+    slab_alloc sa;
+    BOOST_CHECK_EQUAL(sa.slabs_size(), 0);
+
+    auto* p1 = sa.alloc(32);
+    auto* p2 = sa.alloc(32);
+    BOOST_CHECK_EQUAL(static_cast<uint8_t*>(p2) - static_cast<uint8_t*>(p1),
+                      32);
+    BOOST_CHECK_EQUAL(sa.slabs_size(), slab_alloc::slab_size);
+    BOOST_CHECK_EQUAL(sa.used_size(), 64);
+    ::memset(p1, 'a', 32);
+    ::memset(p2, 'b', 32);
+
+    // The freed chunk is given to the next allocation with the same size
+    sa.free(p1, 32);
+    BOOST_CHECK_EQUAL(sa.used_size(), 32);
+    auto* p3 = sa.alloc(32);
+    BOOST_CHECK_EQUAL(p3, p1);
+    // But not to the allocations with different size
+    auto* p4 = sa.alloc(64);
+    BOOST_CHECK_NE(p4, p1);
+    BOOST_CHECK_EQUAL(sa.slabs_size(), 2 * slab_alloc::slab_size);
+    BOOST_CHECK_EQUAL(sa.used_size(), 128);
+
+    sa.free(p2, 32);
+    sa.free(p3, 32);
+    sa.free(p4, 64);
+    BOOST_CHECK_EQUAL(sa.used_size(), 0);
+    // The slabs are kept for later use
+    BOOST_CHECK_EQUAL(sa.slabs_size(), 2 * slab_alloc::slab_size);
+}
+
+BOOST_AUTO_TEST_CASE(many_slabs)
+{
+    slab_alloc sa;
+    constexpr bytes32_t size = slab_alloc::max_chunk_size;
+    constexpr uint32_t cnt   = 3 * (slab_alloc::slab_size / size);
+    std::vector<void*> ptrs;
+    for (uint32_t i = 0; i < cnt; ++i)
+    {
+        ptrs.push_back(sa.alloc(size));
+        ::memset(ptrs.back(), i, size);
+    }
+    BOOST_CHECK_EQUAL(sa.slabs_size(), 3 * slab_alloc::slab_size);
+    BOOST_CHECK_EQUAL(sa.used_size(), cnt * size);
+    for (uint32_t i = 0; i < cnt; ++i)
+        BOOST_CHECK_EQUAL(static_cast<uint8_t*>(ptrs[i])[size - 1], uint8_t(i));
+    for (auto* p : ptrs)
+        sa.free(p, size);
+    BOOST_CHECK_EQUAL(sa.used_size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(big_chunks)
+{
+    slab_alloc sa;
+    // Bigger chunks don't go to the slabs
+    auto* p = sa.alloc(2 * slab_alloc::max_chunk_size);
+    ::memset(p, 'a', 2 * slab_alloc::max_chunk_size);
+    BOOST_CHECK_EQUAL(sa.slabs_size(), 0);
+    BOOST_CHECK_EQUAL(sa.used_size(), 0);
+    sa.free(p, 2 * slab_alloc::max_chunk_size);
+}
+
+BOOST_AUTO_TEST_CASE(free_from_another_thread)
+{
+    slab_alloc sa;
+    auto* p1 = sa.alloc(32);
+    void* p2 = nullptr;
+    // The other thread works with its own arena and slabs
+    std::thread([&]
+                {
+                    p2 = sa.alloc(32);
+                    sa.free(p1, 32);
+                })
+        .join();
+    BOOST_CHECK_EQUAL(sa.slabs_size(), 2 * slab_alloc::slab_size);
+    BOOST_CHECK_EQUAL(sa.used_size(), 32);
+    // The chunk freed by the other thread is reused only from there
+    auto* p3 = sa.alloc(32);
+    BOOST_CHECK_NE(p3, p1);
+    sa.free(p2, 32);
+    sa.free(p3, 32);
+    BOOST_CHECK_EQUAL(sa.used_size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
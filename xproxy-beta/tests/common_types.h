@@ -55,9 +55,12 @@ using optional_t = std::experimental::optional<T>;
 template <typename T, typename E>
 using expected_t = boost::expected<T, E>;
 
-using io_service_t  = boost::asio::io_service;
-using err_code_t    = boost::system::error_code;
-using string_view_t = boost::string_view;
+using io_service_t   = boost::asio::io_service;
+using std_clock_t    = std::chrono::steady_clock;
+using err_code_t     = boost::system::error_code;
+using string_view_t  = boost::string_view;
+using uuid_t         = boost::uuids::uuid;
+using boost_string_t = boost::container::string;
 
 template <size_t Size>
 using stack_string_t = x3me::str_utils::stack_string<Size>;
@@ -72,3 +75,8 @@ using bytes8_t  = uint8_t;
 using bytes16_t = uint16_t;
 using bytes32_t = uint32_t;
 using bytes64_t = uint64_t;
+
+inline string_view_t to_string_view(const boost_string_t& s) noexcept
+{
+    return {s.data(), s.size()};
+}
@@ -0,0 +1,115 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../http/dechunked_body.h"
+#include "../http/http_constants.h"
+
+using http::dechunked_body;
+using http::constants;
+
+namespace
+{
+
+struct limits_guard
+{
+    const bytes32_t max_size_;
+    const bytes64_t max_total_;
+
+    limits_guard(bytes32_t max_size, bytes64_t max_total) noexcept
+        : max_size_(constants::max_dechunked_size),
+          max_total_(constants::max_dechunked_total)
+    {
+        constants::max_dechunked_size  = max_size;
+        constants::max_dechunked_total = max_total;
+    }
+    ~limits_guard() noexcept
+    {
+        constants::max_dechunked_size  = max_size_;
+        constants::max_dechunked_total = max_total_;
+    }
+};
+
+const char data[] = "0123456789abcdef";
+
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(dechunked_body_tests)
+
+BOOST_AUTO_TEST_CASE(body_max_size)
+{
+    limits_guard lg(20, 1_KB);
+    dechunked_body body;
+    BOOST_CHECK(body.append(data, 16));
+    BOOST_CHECK(body.append(data, 4));
+    // The failed append doesn't change the body, nor the total
+    BOOST_CHECK(!body.append(data, 1));
+    BOOST_CHECK_EQUAL(body.size(), 20U);
+    BOOST_CHECK_EQUAL(dechunked_body::total_size(), 20U);
+}
+
+BOOST_AUTO_TEST_CASE(total_budget)
+{
+    limits_guard lg(1_KB, 40);
+    BOOST_REQUIRE_EQUAL(dechunked_body::total_size(), 0U);
+    {
+        dechunked_body body1;
+        dechunked_body body2;
+        dechunked_body body3;
+        BOOST_CHECK(body1.append(data, 16));
+        BOOST_CHECK(body2.append(data, 16));
+        // Only 8 bytes remain in the budget
+        BOOST_CHECK(!body3.append(data, 16));
+        BOOST_CHECK_EQUAL(body3.size(), 0U);
+        BOOST_CHECK(body3.append(data, 8));
+        BOOST_CHECK_EQUAL(dechunked_body::total_size(), 40U);
+        BOOST_CHECK(!body1.append(data, 1));
+        BOOST_CHECK_EQUAL(dechunked_body::total_size(), 40U);
+        {
+            // The destroyed body gives its memory back to the budget
+            dechunked_body body4;
+            BOOST_CHECK(!body4.append(data, 1));
+        }
+        BOOST_CHECK_EQUAL(dechunked_body::total_size(), 40U);
+    }
+    BOOST_CHECK_EQUAL(dechunked_body::total_size(), 0U);
+    dechunked_body body5;
+    BOOST_CHECK(body5.append(data, 16));
+    BOOST_CHECK_EQUAL(dechunked_body::total_size(), 16U);
+}
+
+BOOST_AUTO_TEST_CASE(total_budget_concurrent_appends)
+{
+    constexpr bytes64_t max_total = 64_KB;
+    constexpr uint32_t num_threads = 4;
+    limits_guard lg(max_total, max_total);
+    BOOST_REQUIRE_EQUAL(dechunked_body::total_size(), 0U);
+
+    // Every body alone could take the whole budget
+    std::vector<std::unique_ptr<dechunked_body>> bodies;
+    for (uint32_t i = 0; i < num_threads; ++i)
+        bodies.push_back(std::make_unique<dechunked_body>());
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < num_threads; ++i)
+    {
+        threads.emplace_back([&body = *bodies[i]]
+                             {
+                                 while (body.append(data, 16))
+                                     ;
+                             });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    bytes64_t sum = 0;
+    for (const auto& b : bodies)
+        sum += b->size();
+    BOOST_CHECK_LE(sum, max_total);
+    // An append may fail only because of the concurrent reservations
+    BOOST_CHECK_GE(sum, max_total - (num_threads - 1) * 16);
+    // The failed appends must not leave reserved, but unused, budget
+    BOOST_CHECK_EQUAL(dechunked_body::total_size(), sum);
+    bodies.clear();
+    BOOST_CHECK_EQUAL(dechunked_body::total_size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
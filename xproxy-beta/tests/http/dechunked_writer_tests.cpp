@@ -0,0 +1,202 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../http/dechunked_writer.h"
+#include "../http/http_constants.h"
+#include "../cache/cache_error.h"
+#include "../cache/cache_key.h"
+
+using http::fresh_index;
+
+namespace
+{
+
+// The handlers are kept outside the writer and thus every test must
+// complete or drop them.
+struct stream_state
+{
+    using handler_t       = std::function<void(const err_code_t&)>;
+    using write_handler_t = std::function<void(const err_code_t&, bytes32_t)>;
+
+    handler_t on_open_;
+    write_handler_t on_write_;
+    handler_t on_close_;
+    std::vector<bytes32_t> write_sizes_;
+    uint32_t cnt_close_ = 0;
+    bool truncate_      = true;
+
+    void open_done(const err_code_t& err = err_code_t{})
+    {
+        BOOST_REQUIRE(on_open_);
+        auto h = std::move(on_open_);
+        on_open_ = nullptr;
+        h(err);
+    }
+    void write_done(bytes32_t written, const err_code_t& err = err_code_t{})
+    {
+        BOOST_REQUIRE(on_write_);
+        auto h = std::move(on_write_);
+        on_write_ = nullptr;
+        h(err, written);
+    }
+    void close_done(const err_code_t& err = err_code_t{})
+    {
+        BOOST_REQUIRE(on_close_);
+        auto h = std::move(on_close_);
+        on_close_ = nullptr;
+        h(err);
+    }
+    bool pending() const noexcept { return on_open_ || on_write_ || on_close_; }
+};
+
+struct test_stream
+{
+    stream_state* st_;
+
+    explicit test_stream(stream_state& st) noexcept : st_(&st) {}
+
+    template <typename Handler>
+    void async_open_write(const cache::cache_key&, bool truncate, Handler&& h)
+    {
+        st_->truncate_ = truncate;
+        st_->on_open_  = std::forward<Handler>(h);
+    }
+    template <typename ConstBuffers, typename Handler>
+    void async_write(ConstBuffers&& bufs, Handler&& h)
+    {
+        BOOST_REQUIRE_EQUAL(bufs.size(), 1U);
+        st_->write_sizes_.push_back(bufs.data()[0].iov_len);
+        st_->on_write_ = std::forward<Handler>(h);
+    }
+    template <typename Handler>
+    void async_close(Handler&& h)
+    {
+        ++st_->cnt_close_;
+        st_->on_close_ = std::forward<Handler>(h);
+    }
+    void async_close() { ++st_->cnt_close_; }
+};
+
+using test_writer = http::dechunked_writer<test_stream>;
+
+const string_view_t resp_hdrs{"HTTP/1.1 200 OK\r\n"
+                              "Transfer-Encoding: chunked\r\n"
+                              "Cache-Control: max-age=60\r\n"
+                              "\r\n"};
+const string_view_t body_data{"abcdefghijklmnopqrstuvwxyz"};
+
+const tcp_endpoint_v4 origin{0x0A000001, 80};
+
+err_code_t cache_err(cache::error e)
+{
+    return err_code_t{e, cache::get_cache_error_category()};
+}
+
+struct fixture
+{
+    stream_state st_;
+    fresh_index idx_;
+    http::all_stats stats_;
+    id_tag tag_;
+    time_t now_ = ::time(nullptr);
+    const bytes32_t max_dechunked_ = http::constants::max_dechunked_size;
+
+    fixture()
+    {
+        idx_.set_max_size(1_MB, 0);
+        http::constants::max_dechunked_size = 1_KB;
+    }
+    ~fixture() { http::constants::max_dechunked_size = max_dechunked_; }
+
+    std::shared_ptr<test_writer> make_writer()
+    {
+        cache::cache_key key;
+        key.url_          = "url";
+        key.etag_         = "\"abc\"";
+        key.obj_full_len_ = body_data.size();
+        auto e = idx_.make_entry(key, origin, resp_hdrs, now_, now_ + 60, 0);
+        BOOST_REQUIRE(e);
+        auto body = std::make_unique<http::dechunked_body>();
+        BOOST_REQUIRE(body->append(body_data.data(), body_data.size()));
+        return std::make_shared<test_writer>(test_stream(st_), idx_, stats_,
+                                             std::move(e), std::move(body),
+                                             tag_);
+    }
+
+    bool indexed() noexcept { return idx_.find("url", origin, now_); }
+};
+
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE(dechunked_writer_tests, fixture)
+
+BOOST_AUTO_TEST_CASE(stored_and_indexed)
+{
+    make_writer()->start();
+    BOOST_CHECK(!st_.truncate_);
+    st_.open_done();
+    // Short writes continue with the remaining data
+    st_.write_done(10);
+    st_.write_done(body_data.size() - 10);
+    BOOST_CHECK((st_.write_sizes_ ==
+                 std::vector<bytes32_t>{body_data.size(),
+                                        body_data.size() - 10}));
+    // Not indexed before the write handle is closed
+    BOOST_CHECK(!indexed());
+    BOOST_CHECK_EQUAL(st_.cnt_close_, 1U);
+    st_.close_done();
+    BOOST_CHECK(indexed());
+    BOOST_CHECK_EQUAL(stats_.var_stats_.cnt_dechunk_stored_, 1U);
+    BOOST_CHECK(!st_.pending());
+    // The body memory is released with the writer
+    BOOST_CHECK_EQUAL(http::dechunked_body::total_size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(object_present_indexed)
+{
+    make_writer()->start();
+    // The same object, with the same length and validators, is in the cache
+    st_.open_done(cache_err(cache::object_present));
+    BOOST_CHECK(st_.write_sizes_.empty());
+    BOOST_CHECK(indexed());
+    BOOST_CHECK_EQUAL(stats_.var_stats_.cnt_dechunk_stored_, 1U);
+    BOOST_CHECK(!st_.pending());
+}
+
+BOOST_AUTO_TEST_CASE(open_fails_not_indexed)
+{
+    make_writer()->start();
+    st_.open_done(cache_err(cache::object_not_admitted));
+    BOOST_CHECK(st_.write_sizes_.empty());
+    BOOST_CHECK(!indexed());
+    BOOST_CHECK_EQUAL(stats_.var_stats_.cnt_dechunk_stored_, 0U);
+    BOOST_CHECK(!st_.pending());
+}
+
+BOOST_AUTO_TEST_CASE(write_fails_not_indexed)
+{
+    make_writer()->start();
+    st_.open_done();
+    st_.write_done(10);
+    st_.write_done(0, cache_err(cache::disk_error));
+    // The handle is closed without waiting and nothing gets indexed
+    BOOST_CHECK_EQUAL(st_.cnt_close_, 1U);
+    BOOST_CHECK(!indexed());
+    BOOST_CHECK_EQUAL(stats_.var_stats_.cnt_dechunk_stored_, 0U);
+    BOOST_CHECK(!st_.pending());
+    BOOST_CHECK_EQUAL(http::dechunked_body::total_size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(close_fails_not_indexed)
+{
+    make_writer()->start();
+    st_.open_done();
+    st_.write_done(body_data.size());
+    // The data hasn't been handed to the cache
+    st_.close_done(cache_err(cache::operation_aborted));
+    BOOST_CHECK(!indexed());
+    BOOST_CHECK_EQUAL(stats_.var_stats_.cnt_dechunk_stored_, 0U);
+    BOOST_CHECK(!st_.pending());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,316 @@
+#include "precompiled.h"
+#include <boost/test/unit_test.hpp>
+#include "../http/fresh_index.h"
+#include "../cache/cache_key.h"
+
+using http::fresh_index;
+
+namespace
+{
+
+const string_view_t resp_hdrs{"HTTP/1.1 200 OK\r\n"
+                              "Content-Length: 100\r\n"
+                              "age: 10\r\n"
+                              "Cache-Control: max-age=60\r\n"
+                              "\r\n"};
+const string_view_t stored_hdrs{"HTTP/1.1 200 OK\r\n"
+                                "Content-Length: 100\r\n"
+                                "Cache-Control: max-age=60\r\n"};
+
+const tcp_endpoint_v4 origin{0x0A000001, 80};
+
+cache::cache_key make_key(const string_view_t& url,
+                          const string_view_t& cache_url = string_view_t{})
+{
+    cache::cache_key ret;
+    ret.url_          = url;
+    ret.cache_url_    = cache_url;
+    ret.etag_         = "\"abc\"";
+    ret.obj_full_len_ = 100;
+    return ret;
+}
+
+std::string get_resp_hdrs(const fresh_index::entry& e, time_t now)
+{
+    boost_string_t out;
+    e.get_resp_hdrs(now, out);
+    return std::string(out.data(), out.size());
+}
+
+std::string get_cond_hdrs(const fresh_index::entry& e)
+{
+    boost_string_t out;
+    e.get_cond_hdrs(out);
+    return std::string(out.data(), out.size());
+}
+
+} // namespace
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(fresh_index_tests)
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+    fresh_index idx;
+    BOOST_CHECK(!idx.enabled());
+    BOOST_CHECK(!idx.insert(make_key("url"), origin, resp_hdrs, 1000, 1050,
+                            10));
+    BOOST_CHECK(idx.find("url", origin, 1000) == nullptr);
+    BOOST_CHECK_EQUAL(idx.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(insert_find)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_REQUIRE(idx.insert(make_key("url"), origin, resp_hdrs, 1000, 1050,
+                             10));
+    BOOST_CHECK_EQUAL(idx.size(), 1U);
+    BOOST_CHECK(idx.mem_size() > 0);
+
+    const auto* e = idx.find("url", origin, 1020);
+    BOOST_REQUIRE(e);
+    BOOST_CHECK_EQUAL(e->index_url(), "url");
+    const auto key = e->get_cache_key();
+    BOOST_CHECK_EQUAL(key.url_, "url");
+    BOOST_CHECK(key.cache_url_.empty());
+    BOOST_CHECK_EQUAL(key.etag_, "\"abc\"");
+    BOOST_CHECK_EQUAL(key.obj_full_len_, 100U);
+    // The old 'Age' header is replaced with the current age
+    BOOST_CHECK_EQUAL(get_resp_hdrs(*e, 1020),
+                      std::string(stored_hdrs) + "Age: 30\r\n\r\n");
+    BOOST_CHECK(idx.find("other", origin, 1020) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(other_origin)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_REQUIRE(idx.insert(make_key("url"), origin, resp_hdrs, 1000, 1050,
+                             10));
+    // The same URL requested from another origin is not served
+    BOOST_CHECK(idx.find("url", tcp_endpoint_v4{0x0A000002, 80}, 1020) ==
+                nullptr);
+    BOOST_CHECK(idx.find("url", tcp_endpoint_v4{0x0A000001, 8080}, 1020) ==
+                nullptr);
+    BOOST_CHECK_EQUAL(idx.size(), 1U);
+    const auto* e = idx.find("url", origin, 1020);
+    BOOST_REQUIRE(e);
+    BOOST_CHECK(e->origin() == origin);
+}
+
+BOOST_AUTO_TEST_CASE(range_resp_hdrs)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_REQUIRE(idx.insert(make_key("url"), origin, resp_hdrs, 1000, 1050,
+                             10));
+    const auto* e = idx.find("url", origin, 1020);
+    BOOST_REQUIRE(e);
+    boost_string_t out;
+    e->get_range_resp_hdrs(1020, 10, 19, out);
+    BOOST_CHECK_EQUAL(std::string(out.data(), out.size()),
+                      "HTTP/1.1 206 Partial Content\r\n"
+                      "Content-Length: 10\r\n"
+                      "Content-Range: bytes 10-19/100\r\n"
+                      "Cache-Control: max-age=60\r\n"
+                      "Age: 30\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(dechunked_resp_hdrs)
+{
+    const string_view_t chunked_hdrs{"HTTP/1.1 200 OK\r\n"
+                                     "Transfer-Encoding: chunked\r\n"
+                                     "Cache-Control: max-age=60\r\n"
+                                     "\r\n"};
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    // The entry is created without being added to the index
+    auto e = idx.make_entry(make_key("url"), origin, chunked_hdrs, 1000, 1050,
+                            0);
+    BOOST_REQUIRE(e);
+    BOOST_CHECK_EQUAL(idx.size(), 0U);
+    BOOST_REQUIRE(idx.insert(std::move(e)));
+    BOOST_CHECK_EQUAL(idx.size(), 1U);
+    const auto* found = idx.find("url", origin, 1020);
+    BOOST_REQUIRE(found);
+    // Served with the length of the de-chunked object
+    BOOST_CHECK_EQUAL(get_resp_hdrs(*found, 1020),
+                      "HTTP/1.1 200 OK\r\n"
+                      "Cache-Control: max-age=60\r\n"
+                      "Content-Length: 100\r\n"
+                      "Age: 20\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(hop_by_hop_hdrs_not_stored)
+{
+    const string_view_t hdrs{"HTTP/1.1 200 OK\r\n"
+                             "Connection: keep-alive, X-Conn-Hdr\r\n"
+                             "Keep-Alive: timeout=5\r\n"
+                             "Cache-Control: max-age=60\r\n"
+                             "Proxy-Connection: close\r\n"
+                             "Upgrade: h2c\r\n"
+                             "x-conn-hdr: a,\r\n"
+                             " b\r\n"
+                             "TE: trailers\r\n"
+                             "Trailer: Expires\r\n"
+                             "Connection: x-other\r\n"
+                             "X-Other: 1\r\n"
+                             "Content-Length: 100\r\n"
+                             "Trailer-Like: 2\r\n"
+                             "\r\n"};
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_REQUIRE(idx.insert(make_key("url"), origin, hdrs, 1000, 1050, 0));
+    const auto* e = idx.find("url", origin, 1020);
+    BOOST_REQUIRE(e);
+    BOOST_CHECK_EQUAL(get_resp_hdrs(*e, 1020),
+                      "HTTP/1.1 200 OK\r\n"
+                      "Cache-Control: max-age=60\r\n"
+                      "Content-Length: 100\r\n"
+                      "Trailer-Like: 2\r\n"
+                      "Age: 20\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(cache_url_is_key)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_REQUIRE(
+        idx.insert(make_key("url", "cache_url"), origin, resp_hdrs, 1000, 1050,
+                   0));
+    BOOST_CHECK(idx.find("url", origin, 1000) == nullptr);
+    const auto* e = idx.find("cache_url", origin, 1000);
+    BOOST_REQUIRE(e);
+    BOOST_CHECK_EQUAL(e->get_cache_key().url_, "url");
+    idx.erase("cache_url");
+    BOOST_CHECK_EQUAL(idx.size(), 0U);
+    BOOST_CHECK_EQUAL(idx.mem_size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(expiration)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 20);
+    // Without validators the stale entries can't be revalidated
+    auto key  = make_key("url");
+    key.etag_ = string_view_t{};
+    BOOST_CHECK(!idx.insert(key, origin, resp_hdrs, 1000, 1000, 0));
+    // The max TTL limits the freshness
+    BOOST_REQUIRE(idx.insert(key, origin, resp_hdrs, 1000, 1050, 0));
+    BOOST_CHECK(idx.find("url", origin, 1019) != nullptr);
+    BOOST_CHECK(idx.find("url", origin, 1020) == nullptr);
+    BOOST_CHECK_EQUAL(idx.size(), 0U);
+    BOOST_CHECK_EQUAL(idx.mem_size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(stale_revalidatable)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_REQUIRE(idx.insert(make_key("url"), origin, resp_hdrs, 1000, 1000,
+                             0));
+    auto key           = make_key("url2");
+    key.etag_          = string_view_t{};
+    key.last_modified_ = 784111777; // Sun, 06 Nov 1994 08:49:37 GMT
+    BOOST_REQUIRE(idx.insert(key, origin, resp_hdrs, 1000, 1050, 0));
+
+    const auto* e = idx.find("url", origin, 1000);
+    BOOST_REQUIRE(e);
+    BOOST_CHECK(!e->fresh(1000));
+    BOOST_CHECK(e->revalidatable());
+    BOOST_CHECK_EQUAL(get_cond_hdrs(*e), "If-None-Match: \"abc\"\r\n");
+
+    e = idx.find("url2", origin, 1100);
+    BOOST_REQUIRE(e);
+    BOOST_CHECK(!e->fresh(1100));
+    BOOST_CHECK_EQUAL(get_cond_hdrs(*e),
+                      "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+    BOOST_CHECK_EQUAL(idx.size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(revalidated)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 100);
+    BOOST_REQUIRE(idx.insert(make_key("url"), origin, resp_hdrs, 1000, 1010,
+                             5));
+    auto e =
+        std::make_unique<fresh_index::entry>(*idx.find("url", origin, 1020));
+    BOOST_CHECK(!e->fresh(1020));
+
+    // The max TTL is applied to the revalidated entry too
+    idx.revalidated(*e, 1020, 2000, 0);
+    BOOST_CHECK(e->fresh(1119));
+    BOOST_CHECK(!e->fresh(1120));
+    BOOST_CHECK_EQUAL(get_resp_hdrs(*e, 1030),
+                      std::string(stored_hdrs) + "Age: 10\r\n\r\n");
+    const auto* found = idx.find("url", origin, 1030);
+    BOOST_REQUIRE(found);
+    BOOST_CHECK(found->fresh(1119));
+    BOOST_CHECK_EQUAL(idx.size(), 1U);
+
+    // The removed entry is added again
+    idx.erase("url");
+    idx.revalidated(*e, 1040, 1060, 0);
+    found = idx.find("url", origin, 1050);
+    BOOST_REQUIRE(found);
+    BOOST_CHECK(found->fresh(1059));
+    BOOST_CHECK_EQUAL(idx.mem_size(), found->mem_size());
+}
+
+BOOST_AUTO_TEST_CASE(invalid_hdrs)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_CHECK(!idx.insert(make_key("url"), origin, "HTTP/1.1 200 OK\r\n",
+                            1000,
+                            1050, 0));
+    const std::string big(fresh_index::max_hdrs_size, 'a');
+    BOOST_CHECK(!idx.insert(make_key("url"), origin, big + "\r\n\r\n", 1000,
+                            1050, 0));
+    auto rng_key      = make_key("url");
+    rng_key.rng_.beg_ = 0;
+    rng_key.rng_.end_ = 9;
+    BOOST_CHECK(!idx.insert(rng_key, origin, resp_hdrs, 1000, 1050, 0));
+    BOOST_CHECK_EQUAL(idx.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(replace)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_REQUIRE(idx.insert(make_key("url"), origin, resp_hdrs, 1000, 1050,
+                             0));
+    auto key  = make_key("url");
+    key.etag_ = "\"def\"";
+    BOOST_REQUIRE(idx.insert(key, origin, resp_hdrs, 1010, 1100, 0));
+    BOOST_CHECK_EQUAL(idx.size(), 1U);
+    const auto* e = idx.find("url", origin, 1060);
+    BOOST_REQUIRE(e);
+    BOOST_CHECK_EQUAL(e->get_cache_key().etag_, "\"def\"");
+}
+
+BOOST_AUTO_TEST_CASE(lru_eviction)
+{
+    fresh_index idx;
+    idx.set_max_size(1_MB, 0);
+    BOOST_REQUIRE(idx.insert(make_key("url1"), origin, resp_hdrs, 1000, 1050,
+                             0));
+    const auto esize = idx.mem_size();
+    // Allow a bit less than 3 entries
+    idx.set_max_size(3 * esize - 1, 0);
+    BOOST_REQUIRE(idx.insert(make_key("url2"), origin, resp_hdrs, 1000, 1050,
+                             0));
+    // The first one becomes the most recently used
+    BOOST_REQUIRE(idx.find("url1", origin, 1000));
+    BOOST_REQUIRE(idx.insert(make_key("url3"), origin, resp_hdrs, 1000, 1050,
+                             0));
+    BOOST_CHECK_EQUAL(idx.size(), 2U);
+    BOOST_CHECK(idx.find("url1", origin, 1000) != nullptr);
+    BOOST_CHECK(idx.find("url2", origin, 1000) == nullptr);
+    BOOST_CHECK(idx.find("url3", origin, 1000) != nullptr);
+    BOOST_CHECK(idx.mem_size() <= 3 * esize - 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
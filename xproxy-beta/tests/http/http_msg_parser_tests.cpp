@@ -1053,6 +1053,10 @@ BOOST_AUTO_TEST_CASE(resp_hdr_and_msg_bytes_when_chunked_data_and_no_footers)
     BOOST_CHECK_EQUAL(pn.cnt_on_hdrs_end_, 1);
     BOOST_CHECK_EQUAL(pn.cnt_on_msg_end_, 1);
 
+    // The body data are reported de-chunked
+    BOOST_CHECK_EQUAL(pn.cnt_on_body_data_, 2);
+    BOOST_CHECK_EQUAL(pn.body_, "abcdefghijklmnopqrstuvwxyz1234567890abcdef");
+
     // Check the counted header and message bytes
     BOOST_CHECK_EQUAL(bytes, resp.size());
     BOOST_CHECK_EQUAL(p.msg_bytes(), resp.size());
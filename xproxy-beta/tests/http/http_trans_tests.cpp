@@ -1,6 +1,7 @@
 #include "precompiled.h"
 #include <boost/test/unit_test.hpp>
 #include "../http/http_trans.h"
+#include "../http/http_constants.h"
 #include "../cache/cache_key.h"
 
 namespace cache
@@ -258,6 +259,7 @@ BOOST_AUTO_TEST_CASE(unsupported_on_authorization_req)
     BOOST_CHECK(!trans.is_chunked());
     BOOST_CHECK(!trans.is_keep_alive());
     BOOST_CHECK(!trans.in_http_tunnel());
+    BOOST_CHECK(!trans.req_fresh_servable());
 }
 
 BOOST_AUTO_TEST_CASE(
@@ -1581,6 +1583,182 @@ BOOST_AUTO_TEST_CASE(go_to_error_on_rng_vs_cont_len_2)
     BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::error);
 }
 
+BOOST_AUTO_TEST_CASE(req_single_range_fresh_servable)
+{
+    const const_string_t req{"GET /BigBuckBunny_320x180.mp4 HTTP/1.1\r\n"
+                             "Host: localhost:8080\r\n"
+                             "Range: bytes=10-19\r\n\r\n"};
+
+    id_tag tag;
+    http_trans trans(tag);
+
+    auto ret = trans.on_req_data((const uint8_t*)req.data(), req.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    BOOST_REQUIRE_EQUAL(ret.consumed_, req.size());
+
+    BOOST_CHECK(trans.req_fresh_servable());
+    BOOST_REQUIRE(trans.has_req_range());
+    auto rng = trans.req_range(100);
+    BOOST_REQUIRE(rng);
+    BOOST_CHECK_EQUAL(rng->beg_, 10U);
+    BOOST_CHECK_EQUAL(rng->end_, 19U);
+    // The last byte is limited to the object length
+    rng = trans.req_range(15);
+    BOOST_REQUIRE(rng);
+    BOOST_CHECK_EQUAL(rng->beg_, 10U);
+    BOOST_CHECK_EQUAL(rng->end_, 14U);
+    // Unsatisfiable range
+    BOOST_CHECK(!trans.req_range(10));
+}
+
+BOOST_AUTO_TEST_CASE(req_suffix_and_open_range)
+{
+    const const_string_t req1{"GET /BigBuckBunny_320x180.mp4 HTTP/1.1\r\n"
+                              "Host: localhost:8080\r\n"
+                              "Range: bytes=-30\r\n\r\n"};
+    const const_string_t req2{"GET /BigBuckBunny_320x180.mp4 HTTP/1.1\r\n"
+                              "Host: localhost:8080\r\n"
+                              "Range: bytes=90-\r\n\r\n"};
+
+    id_tag tag;
+    http_trans trans1(tag);
+    auto ret = trans1.on_req_data((const uint8_t*)req1.data(), req1.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    BOOST_CHECK(trans1.req_fresh_servable());
+    auto rng = trans1.req_range(100);
+    BOOST_REQUIRE(rng);
+    BOOST_CHECK_EQUAL(rng->beg_, 70U);
+    BOOST_CHECK_EQUAL(rng->end_, 99U);
+    // The suffix bigger than the object means the whole object
+    rng = trans1.req_range(20);
+    BOOST_REQUIRE(rng);
+    BOOST_CHECK_EQUAL(rng->beg_, 0U);
+    BOOST_CHECK_EQUAL(rng->end_, 19U);
+
+    http_trans trans2(tag);
+    ret = trans2.on_req_data((const uint8_t*)req2.data(), req2.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    BOOST_CHECK(trans2.req_fresh_servable());
+    rng = trans2.req_range(100);
+    BOOST_REQUIRE(rng);
+    BOOST_CHECK_EQUAL(rng->beg_, 90U);
+    BOOST_CHECK_EQUAL(rng->end_, 99U);
+}
+
+BOOST_AUTO_TEST_CASE(req_multi_range_not_fresh_servable)
+{
+    const const_string_t req{"GET /BigBuckBunny_320x180.mp4 HTTP/1.1\r\n"
+                             "Host: localhost:8080\r\n"
+                             "Range: bytes=0-9,20-29\r\n\r\n"};
+
+    id_tag tag;
+    http_trans trans(tag);
+
+    auto ret = trans.on_req_data((const uint8_t*)req.data(), req.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    BOOST_REQUIRE_EQUAL(ret.consumed_, req.size());
+
+    BOOST_CHECK(!trans.req_fresh_servable());
+    BOOST_CHECK(!trans.has_req_range());
+}
+
+BOOST_AUTO_TEST_CASE(collect_dechunked_fresh_resp)
+{
+    const const_string_t req{"GET /path/file.html HTTP/1.1\r\n"
+                             "Host: www.host1.com:80\r\n\r\n"};
+    const const_string_t resp{"HTTP/1.1 200 OK\r\n"
+                              "Cache-Control: max-age=60\r\n"
+                              "ETag: \"abc\"\r\n"
+                              "Transfer-Encoding: chunked\r\n\r\n"
+                              "1a\r\n"
+                              "abcdefghijklmnopqrstuvwxyz\r\n"
+                              "10\r\n"
+                              "1234567890abcdef\r\n"
+                              "0\r\n\r\n"};
+    const string_view_t body{"abcdefghijklmnopqrstuvwxyz1234567890abcdef"};
+
+    const auto max_dechunked = http::constants::max_dechunked_size;
+    X3ME_SCOPE_EXIT { http::constants::max_dechunked_size = max_dechunked; };
+    http::constants::max_dechunked_size = 1_KB;
+
+    id_tag tag;
+    http_trans trans(tag);
+
+    auto ret = trans.on_req_data((const uint8_t*)req.data(), req.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    ret = trans.on_resp_data((const uint8_t*)resp.data(), resp.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    BOOST_REQUIRE_EQUAL(ret.consumed_, resp.size());
+    BOOST_CHECK(trans.in_http_tunnel());
+    BOOST_CHECK(trans.is_chunked());
+    // The length of the de-chunked body makes the response cacheable
+    BOOST_REQUIRE(trans.has_resp_body());
+    BOOST_CHECK(trans.resp_freshness(::time(nullptr)));
+    const auto ckey = trans.get_cache_key();
+    BOOST_REQUIRE(ckey);
+    BOOST_CHECK_EQUAL(ckey->obj_full_len_, body.size());
+    BOOST_CHECK_EQUAL(ckey->etag_, "\"abc\"");
+    const auto rbody = trans.release_resp_body();
+    BOOST_REQUIRE(rbody);
+    BOOST_CHECK_EQUAL(string_view_t(rbody->data(), rbody->size()), body);
+    BOOST_CHECK(!trans.has_resp_body());
+
+    // The body bigger than the limit is not collected
+    http::constants::max_dechunked_size = body.size() - 1;
+    http_trans trans2(tag);
+    ret = trans2.on_req_data((const uint8_t*)req.data(), req.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    ret = trans2.on_resp_data((const uint8_t*)resp.data(), resp.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    BOOST_CHECK(!trans2.collects_resp_body());
+    BOOST_CHECK(!trans2.has_resp_body());
+    BOOST_CHECK(!trans2.resp_freshness(::time(nullptr)));
+    BOOST_CHECK(!trans2.get_cache_key());
+
+    // The body which doesn't fit in the global budget is not collected,
+    // because the first body is still kept
+    const auto max_total = http::constants::max_dechunked_total;
+    X3ME_SCOPE_EXIT { http::constants::max_dechunked_total = max_total; };
+    http::constants::max_dechunked_size  = 1_KB;
+    http::constants::max_dechunked_total = 2 * body.size() - 1;
+    BOOST_CHECK_EQUAL(http::dechunked_body::total_size(), body.size());
+    http_trans trans3(tag);
+    ret = trans3.on_req_data((const uint8_t*)req.data(), req.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    ret = trans3.on_resp_data((const uint8_t*)resp.data(), resp.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    BOOST_CHECK(!trans3.has_resp_body());
+    BOOST_CHECK(!trans3.get_cache_key());
+    BOOST_CHECK_EQUAL(http::dechunked_body::total_size(), body.size());
+}
+
+BOOST_AUTO_TEST_CASE(no_collect_dechunked_not_fresh_resp)
+{
+    const const_string_t req{"GET /path/file.html HTTP/1.1\r\n"
+                             "Host: www.host1.com:80\r\n\r\n"};
+    // Neither fresh nor with validators
+    const const_string_t resp{"HTTP/1.1 200 OK\r\n"
+                              "Transfer-Encoding: chunked\r\n\r\n"
+                              "1a\r\n"
+                              "abcdefghijklmnopqrstuvwxyz\r\n"
+                              "0\r\n\r\n"};
+
+    const auto max_dechunked = http::constants::max_dechunked_size;
+    X3ME_SCOPE_EXIT { http::constants::max_dechunked_size = max_dechunked; };
+    http::constants::max_dechunked_size = 1_KB;
+
+    id_tag tag;
+    http_trans trans(tag);
+
+    auto ret = trans.on_req_data((const uint8_t*)req.data(), req.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    ret = trans.on_resp_data((const uint8_t*)resp.data(), resp.size());
+    BOOST_REQUIRE_EQUAL((int)ret.res_, (int)http_trans::res::complete);
+    BOOST_CHECK(trans.in_http_tunnel());
+    BOOST_CHECK(!trans.has_resp_body());
+    BOOST_CHECK(!trans.get_cache_key());
+}
+
 BOOST_AUTO_TEST_CASE(test_move_construction)
 {
     constexpr const_string_t req{"GET /test/demo_form.asp HTTP/1.1\r\n"
@@ -160,6 +160,13 @@ int resp_parser_notified::on_status_code(http_status m)
     return return_res_ >= 0 ? 0 : -1; // Don't return skip body here
 }
 
+int resp_parser_notified::on_body_data(const char* d, size_t s)
+{
+    ++cnt_on_body_data_;
+    body_.append(d, s);
+    return return_res_ >= 0 ? 0 : -1; // Don't return skip body here
+}
+
 int resp_parser_notified::on_trailing_hdrs_begin()
 {
     ++cnt_on_trailing_hdrs_begin_;
@@ -175,5 +182,7 @@ int resp_parser_notified::on_trailing_hdrs_end()
 void resp_parser_notified::reset()
 {
     reset_impl();
-    cnt_on_status_ = 0;
+    body_.clear();
+    cnt_on_status_    = 0;
+    cnt_on_body_data_ = 0;
 }
@@ -93,15 +93,18 @@ struct req_parser_notified : public parser_notified<http::req_parser>
 // A helper class for testing the correctness of the http response parser
 struct resp_parser_notified : public parser_notified<http::resp_parser>
 {
+    std::string body_;
     http_status status_ = (http_status)-1;
 
     uint16_t cnt_on_status_              = 0;
+    uint16_t cnt_on_body_data_           = 0;
     uint16_t cnt_on_trailing_hdrs_begin_ = 0;
     uint16_t cnt_on_trailing_hdrs_end_   = 0;
 
     resp_parser_notified();
 
     int on_status_code(http_status m);
+    int on_body_data(const char* d, size_t s);
     int on_trailing_hdrs_begin();
     int on_trailing_hdrs_end();
 
@@ -470,4 +470,128 @@ BOOST_AUTO_TEST_CASE(io_buff_read_iterator)
     BOOST_REQUIRE(rdr.end() == it);
 }
 
+BOOST_AUTO_TEST_CASE(io_buff_write_shared_refers_whole_blocks)
+{
+    constexpr uint32_t block_size = 512;
+    io_buff_reader rdr;
+    io_buff buf(block_size);
+    buf.register_reader(rdr);
+    buf.expand_with(4 * block_size);
+
+    std::vector<char> data(2 * block_size + 100);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(i);
+    // The vector memory is kept by the aliasing shared pointer
+    auto owner = std::make_shared<std::vector<char>>(std::move(data));
+    io_buff::shared_mem_t mem(owner, owner->data());
+
+    // Only whole free blocks can refer to the memory
+    BOOST_REQUIRE_EQUAL(buf.bytes_avail_shared(), 3 * block_size);
+    const auto refs = mem.use_count();
+    const auto len  = 2 * block_size + 100;
+    BOOST_REQUIRE_EQUAL(buf.write_shared(mem, len), 2 * block_size);
+    BOOST_REQUIRE_EQUAL(rdr.bytes_avail(), len);
+    BOOST_REQUIRE_EQUAL(mem.use_count(), refs + 2);
+
+    auto it = rdr.begin();
+    BOOST_REQUIRE((*it).data() == owner->data());
+    BOOST_REQUIRE_EQUAL((*it).size(), block_size);
+    ++it;
+    BOOST_REQUIRE((*it).data() == owner->data() + block_size);
+    ++it;
+    // The tail is copied to the buffer memory
+    BOOST_REQUIRE((*it).data() != owner->data() + 2 * block_size);
+    BOOST_REQUIRE_EQUAL((*it).size(), 100);
+    BOOST_REQUIRE(std::equal((*it).data(), (*it).data() + 100,
+                             owner->data() + 2 * block_size));
+    ++it;
+    BOOST_REQUIRE(rdr.end() == it);
+
+    // The writer is in the middle of a block. It fills it first and then
+    // refers to the following whole free block.
+    rdr.consume(len);
+    BOOST_REQUIRE_EQUAL(buf.bytes_avail_shared(),
+                        (block_size - 100) + 3 * block_size);
+
+    buf.unregister_reader(rdr);
+}
+
+BOOST_AUTO_TEST_CASE(io_buff_write_shared_no_whole_free_block)
+{
+    constexpr uint32_t block_size = 512;
+    io_buff_reader rdr;
+    io_buff buf(block_size);
+    buf.register_reader(rdr);
+
+    // A single block buffer never has a whole free block
+    buf.expand_with(block_size);
+    BOOST_REQUIRE_EQUAL(buf.bytes_avail_shared(), buf.bytes_avail_wr());
+    buf.expand_with(block_size);
+
+    // The writer is at a block begin, but the reader hasn't freed the
+    // block yet.
+    buf.commit(block_size);
+    rdr.consume(100);
+    buf.commit(block_size);
+    BOOST_REQUIRE_EQUAL(buf.bytes_avail_wr(), 99);
+    BOOST_REQUIRE_EQUAL(buf.bytes_avail_shared(), 0);
+
+    // The whole data is copied when there is no whole free block
+    std::vector<char> data(99, 'a');
+    auto owner = std::make_shared<std::vector<char>>(std::move(data));
+    io_buff::shared_mem_t mem(owner, owner->data());
+    const auto refs = mem.use_count();
+    BOOST_REQUIRE_EQUAL(buf.write_shared(mem, 99), 0);
+    BOOST_REQUIRE_EQUAL(mem.use_count(), refs);
+    BOOST_REQUIRE_EQUAL(rdr.bytes_avail(), 2 * block_size - 1);
+
+    buf.unregister_reader(rdr);
+}
+
+BOOST_AUTO_TEST_CASE(io_buff_write_shared_unshare_on_write)
+{
+    constexpr uint32_t block_size = 512;
+    io_buff_reader rdr;
+    io_buff buf(block_size);
+    buf.register_reader(rdr);
+    buf.expand_with(4 * block_size);
+
+    std::vector<char> data(3 * block_size);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(i);
+    auto owner = std::make_shared<std::vector<char>>(std::move(data));
+    io_buff::shared_mem_t mem(owner, owner->data());
+
+    const auto orig = *owner;
+    const auto refs = mem.use_count();
+    BOOST_REQUIRE_EQUAL(buf.write_shared(mem, 3 * block_size), 3 * block_size);
+    BOOST_REQUIRE_EQUAL(mem.use_count(), refs + 3);
+    buf.commit(block_size - 1);
+    // The reader is in the middle of the second block
+    rdr.consume(block_size + 188);
+
+    // The writer may write to the first block and to the beginning of
+    // the second one. The first block simply gets its memory back.
+    // The unread data of the second one gets copied.
+    auto wit = buf.begin();
+    BOOST_REQUIRE(buf.end() != wit);
+    BOOST_REQUIRE_EQUAL(mem.use_count(), refs + 1);
+
+    auto rit = rdr.begin();
+    BOOST_REQUIRE((*rit).data() != owner->data() + block_size + 188);
+    BOOST_REQUIRE_EQUAL((*rit).size(), block_size - 188);
+    BOOST_REQUIRE(std::equal((*rit).data(), (*rit).data() + (*rit).size(),
+                             owner->data() + block_size + 188));
+    ++rit;
+    // The third block still refers to the memory
+    BOOST_REQUIRE((*rit).data() == owner->data() + 2 * block_size);
+
+    // The writes go to the own memory of the blocks
+    for (; wit != buf.end(); ++wit)
+        std::fill((*wit).data(), (*wit).data() + (*wit).size(), 'x');
+    BOOST_REQUIRE(*owner == orig);
+
+    buf.unregister_reader(rdr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,13 +5,18 @@
 // system headers
 #include <assert.h>
 #include <linux/fs.h>
+#include <linux/io_uring.h>
 #include <pcre.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/raw.h>
 #include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #include <zlib.h>
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -23,14 +28,18 @@
 #include <experimental/optional>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <new>
 #include <numeric>
+#include <random>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_set>
 
 ////////////////////////////////////////////////////////////////////////////////
 // boost headers
@@ -58,6 +67,10 @@
 #include <boost/spirit/home/x3.hpp>
 #include <boost/spirit/home/x3/support/ast/variant.hpp>
 #include <boost/utility/string_view.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <boost/uuid/nil_generator.hpp>
+#include <boost/uuid/random_generator.hpp>
 
 ////////////////////////////////////////////////////////////////////////////////
 // Other 3rd party library headers
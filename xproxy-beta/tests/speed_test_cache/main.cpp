@@ -0,0 +1,433 @@
+#include "precompiled.h"
+#include "cache/aligned_data_ptr.h"
+#include "cache/cache_common.h"
+#include "cache/disk_reader.h"
+#include "cache/flat_hash_map.h"
+#include "cache/fs_node_key.h"
+#include "cache/fs_table.h"
+#include "cache/memory_writer.h"
+#include "cache/range_vector.h"
+#include "cache/volume_fd.h"
+
+using namespace cache::detail;
+
+namespace
+{
+
+// The same as the hash used by the fs_table
+struct key_hash
+{
+    uint64_t operator()(const fs_node_key_t& k) const noexcept
+    {
+        uint64_t ret;
+        ::memcpy(&ret, k.data() + sizeof(ret), sizeof(ret));
+        return ret;
+    }
+};
+
+struct key_eq
+{
+    bool operator()(const fs_node_key_t& l, const fs_node_key_t& r) const
+        noexcept
+    {
+        return l == r;
+    }
+};
+
+fs_node_key_t make_key(uint64_t v) noexcept
+{
+    return fs_node_key_t{&v, sizeof(v)};
+}
+
+range_elem make_rng(uint64_t v) noexcept
+{
+    const auto disk_offs =
+        volume_blocks64_t::create_from_bytes(volume_skip_bytes);
+    return make_range_elem(v * 1_KB, 1_KB, disk_offs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Counts the bytes requested by the sparse_hash_map. The overhead of the
+// memory allocator itself is not included.
+
+bytes64_t g_allocated = 0;
+
+template <typename T>
+struct counting_alloc
+{
+    using value_type      = T;
+    using pointer         = T*;
+    using const_pointer   = const T*;
+    using reference       = T&;
+    using const_reference = const T&;
+    using size_type       = size_t;
+    using difference_type = ptrdiff_t;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = counting_alloc<U>;
+    };
+
+    counting_alloc() noexcept {}
+    template <typename U>
+    counting_alloc(const counting_alloc<U>&) noexcept
+    {
+    }
+
+    pointer allocate(size_type n, const void* = nullptr)
+    {
+        g_allocated += n * sizeof(T);
+        return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(pointer p, size_type n) noexcept
+    {
+        g_allocated -= n * sizeof(T);
+        ::operator delete(p);
+    }
+    size_type max_size() const noexcept { return size_type(-1) / sizeof(T); }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        new (p) U(std::forward<Args>(args)...);
+    }
+    template <typename U>
+    void destroy(U* p) noexcept
+    {
+        p->~U();
+    }
+
+    pointer address(reference r) const noexcept { return &r; }
+    const_pointer address(const_reference r) const noexcept { return &r; }
+
+    friend bool operator==(const counting_alloc&, const counting_alloc&)
+    {
+        return true;
+    }
+    friend bool operator!=(const counting_alloc&, const counting_alloc&)
+    {
+        return false;
+    }
+};
+
+using bench_flat_t   = flat_hash_map<fs_node_key_t, range_vector, key_hash>;
+using bench_sparse_t = google::sparse_hash_map<
+    fs_node_key_t, range_vector, key_hash, key_eq,
+    counting_alloc<std::pair<const fs_node_key_t, range_vector>>>;
+
+template <typename Fn>
+double ops_per_sec(uint64_t cnt_ops, Fn&& fn)
+{
+    using namespace std::chrono;
+    const auto beg = steady_clock::now();
+    fn();
+    const auto secs = duration<double>(steady_clock::now() - beg).count();
+    return cnt_ops / secs;
+}
+
+template <typename Map>
+using init_fn_t = std::function<void(Map&, uint64_t cnt)>;
+template <typename Map>
+using mem_fn_t = std::function<bytes64_t(const Map&)>;
+
+template <typename Map>
+void bench_ops(const char* name,
+               const std::vector<fs_node_key_t>& keys,
+               const init_fn_t<Map>& init,
+               const mem_fn_t<Map>& mem_usage)
+{
+    const auto cnt  = keys.size();
+    const auto half = cnt / 2;
+    using value_t   = typename Map::value_type;
+
+    Map m;
+    init(m, cnt);
+    const auto ins = ops_per_sec(cnt, [&]
+                                 {
+                                     for (uint64_t i = 0; i < cnt; ++i)
+                                     {
+                                         range_vector rv(make_rng(i));
+                                         m.insert(value_t(keys[i], rv));
+                                     }
+                                 });
+    X3ME_ENFORCE(m.size() == cnt);
+    const auto bytes_per_entry = double(mem_usage(m)) / cnt;
+
+    uint64_t found = 0;
+    const auto lkp = ops_per_sec(cnt, [&]
+                                 {
+                                     for (uint64_t i = 0; i < cnt; ++i)
+                                         found += (m.find(keys[i]) != m.end());
+                                 });
+    X3ME_ENFORCE(found == cnt);
+
+    const auto ers = ops_per_sec(half, [&]
+                                 {
+                                     for (uint64_t i = 0; i < half; ++i)
+                                         m.erase(m.find(keys[i]));
+                                 });
+    X3ME_ENFORCE(m.size() == (cnt - half));
+
+    std::cout << name << ". Entries: " << cnt
+              << ". Insert ops/sec: " << uint64_t(ins)
+              << ". Lookup ops/sec: " << uint64_t(lkp)
+              << ". Erase ops/sec: " << uint64_t(ers)
+              << ". Bytes/entry: " << bytes_per_entry << std::endl;
+}
+
+// The memory per entry of the flat map depends on where the count of
+// entries falls between two growth steps. Thus it's measured for several
+// counts of entries up to the given one.
+template <typename Map>
+void bench_mem(const char* name,
+               const std::vector<fs_node_key_t>& keys,
+               const init_fn_t<Map>& init,
+               const mem_fn_t<Map>& mem_usage)
+{
+    using value_t = typename Map::value_type;
+    std::cout << name << ". Bytes/entry for";
+    for (const auto pct : {55, 65, 75, 85, 95})
+    {
+        const uint64_t cnt = (keys.size() * pct) / 100;
+        if (cnt == 0)
+            continue;
+        Map m;
+        init(m, cnt);
+        for (uint64_t i = 0; i < cnt; ++i)
+            m.insert(value_t(keys[i], range_vector(make_rng(i))));
+        std::cout << ' ' << cnt << " entries: " << (double(mem_usage(m)) / cnt)
+                  << ';';
+    }
+    std::cout << std::endl;
+}
+
+template <typename Map>
+void bench(const char* name,
+           const std::vector<fs_node_key_t>& keys,
+           const init_fn_t<Map>& init,
+           const mem_fn_t<Map>& mem_usage)
+{
+    // Only one map exists at a time, because of the sparse_hash_map stats
+    bench_ops(name, keys, init, mem_usage);
+    bench_mem(name, keys, init, mem_usage);
+}
+
+void speed_test_hash_map(uint64_t cnt)
+{
+    std::vector<fs_node_key_t> keys;
+    keys.reserve(cnt);
+    for (uint64_t i = 0; i < cnt; ++i)
+        keys.push_back(make_key(i));
+
+    const mem_fn_t<bench_flat_t> flat_mem = [](const bench_flat_t& m)
+    {
+        return m.memory_usage();
+    };
+    bench<bench_flat_t>("flat_hash_map", keys,
+                        [](bench_flat_t&, uint64_t)
+                        {
+                        },
+                        flat_mem);
+    // This is the case when the fs_table gets loaded from the disk
+    bench<bench_flat_t>("flat_hash_map reserved", keys,
+                        [](bench_flat_t& m, uint64_t cnt)
+                        {
+                            m.reserve(cnt);
+                        },
+                        flat_mem);
+    bench<bench_sparse_t>("sparse_hash_map", keys,
+                          [](bench_sparse_t& m, uint64_t)
+                          {
+                              m.set_deleted_key(fs_node_key_t::zero());
+                          },
+                          [](const bench_sparse_t&)
+                          {
+                              return g_allocated;
+                          });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void speed_test_fs_table_load(uint64_t cnt_nodes)
+{
+    const auto disk_space = 4 * cnt_nodes * min_obj_size;
+    const auto disk_offs =
+        volume_blocks64_t::create_from_bytes(volume_skip_bytes);
+
+    auto overwrite_dont_call = [](const auto&, const auto&)
+    {
+        X3ME_ENFORCE(false, "Must not be called");
+        return true;
+    };
+
+    // Every third node has several ranges, the others have single range.
+    std::mt19937_64 gen(42);
+    std::vector<fs_node_key_t> keys;
+    keys.reserve(cnt_nodes);
+    fs_table tbl(disk_space, min_obj_size);
+    for (uint64_t i = 0; i < cnt_nodes; ++i)
+    {
+        const uint64_t k[2] = {gen(), gen()};
+        keys.push_back(fs_node_key_t{k, sizeof(k)});
+        const uint32_t cnt_rngs = ((i % 3) == 0) ? 3 : 1;
+        for (uint32_t r = 0; r < cnt_rngs; ++r)
+        {
+            const auto rng = make_range_elem(r * 20_KB, 20_KB, disk_offs);
+            const auto res =
+                tbl.add_entry(keys.back(), rng, overwrite_dont_call);
+            X3ME_ENFORCE(res == fs_table::add_res::added);
+        }
+    }
+
+    // Write the metadata image ////////////////////////////////////////
+    const bytes64_t img_size = round_to_store_block_size(tbl.size_on_disk());
+    auto buf = alloc_page_aligned(img_size);
+    memory_writer wr(buf.get(), img_size);
+    tbl.save(wr);
+    X3ME_ENFORCE(wr.written() == tbl.size_on_disk());
+
+    // Unique directory, so that several runs don't step on each other
+    char dir[] = "/tmp/speed_test_cache_XXXXXX";
+    X3ME_ENFORCE(::mkdtemp(dir), "Unable to create temporary directory");
+    const std::string fname = std::string(dir) + "/fs_table";
+    {
+        std::ofstream of(fname); // Touch
+    }
+    err_code_t err;
+    volume_fd fd;
+    fd.open(fname.c_str(), err);
+    X3ME_ENFORCE(!err, "Unable to open the metadata image file");
+    fd.write(buf.get(), img_size, 0 /*offset*/, err);
+    X3ME_ENFORCE(!err, "Unable to write the metadata image file");
+    fd.close(err);
+    buf.reset();
+
+    // Load the table ////////////////////////////////////////
+    using namespace std::chrono;
+    fs_table tbl2(disk_space, min_obj_size);
+    const auto beg = steady_clock::now();
+    {
+        disk_reader rdr(boost::container::string{fname.c_str()}, 0, img_size);
+        fs_table::err_info_t err;
+        if (!tbl2.load(rdr, err))
+        {
+            std::cerr << "Unable to load the fs_table. " << err.to_string()
+                      << std::endl;
+            std::exit(1);
+        }
+    }
+    const auto secs = duration<double>(steady_clock::now() - beg).count();
+    ::unlink(fname.c_str());
+    ::rmdir(dir);
+
+    X3ME_ENFORCE(tbl.cnt_fs_nodes() == tbl2.cnt_fs_nodes());
+    X3ME_ENFORCE(tbl.cnt_ranges() == tbl2.cnt_ranges());
+    X3ME_ENFORCE(tbl.cnt_entries() == tbl2.cnt_entries());
+    X3ME_ENFORCE(tbl.entries_data_size() == tbl2.entries_data_size());
+
+    std::cout << "fs_table load. FS nodes: " << cnt_nodes
+              << ". Metadata MB: " << (img_size / 1_MB)
+              << ". Secs: " << secs
+              << ". FS nodes/sec: " << uint64_t(cnt_nodes / secs) << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The cache_mgr reads the cache_fs through an rcu_resource on every cache
+// open, from all net threads. Both loops do the same work besides the read
+// operation. Every thread sums the sizes locally and adds them to the
+// shared counter once at the end.
+template <typename Fn>
+double rcu_ops_per_sec(uint32_t cnt_threads,
+                       uint64_t cnt_iters,
+                       std::atomic<uint64_t>& sink,
+                       Fn&& fn)
+{
+    std::atomic<bool> start{false};
+    std::vector<std::thread> thrs;
+    thrs.reserve(cnt_threads);
+    for (uint32_t t = 0; t < cnt_threads; ++t)
+    {
+        thrs.emplace_back([&]
+                          {
+                              while (!start.load(std::memory_order_acquire))
+                                  std::this_thread::yield();
+                              uint64_t sum = 0;
+                              for (uint64_t i = 0; i < cnt_iters; ++i)
+                                  sum += fn();
+                              sink.fetch_add(sum, std::memory_order_relaxed);
+                          });
+    }
+    return ops_per_sec(cnt_threads * cnt_iters, [&]
+                       {
+                           start.store(true, std::memory_order_release);
+                           for (auto& t : thrs)
+                               t.join();
+                       });
+}
+
+void speed_test_rcu_read(uint64_t cnt_iters)
+{
+    using rcu_vec_t = x3me::thread::rcu_resource<std::vector<int>>;
+    const uint32_t cnt_threads =
+        std::min(std::max(std::thread::hardware_concurrency(), 2U), 8U);
+    const auto v = {1, 2, 3};
+    rcu_vec_t res(x3me::thread::in_place, v);
+
+    std::atomic<uint64_t> sink{0};
+    const auto copy_ops = rcu_ops_per_sec(cnt_threads, cnt_iters, sink, [&]
+                                          {
+                                              auto r = res.read_copy();
+                                              return r->size();
+                                          });
+    X3ME_ENFORCE(sink.load() == cnt_threads * cnt_iters * v.size());
+    sink = 0;
+    const auto read_ops = rcu_ops_per_sec(cnt_threads, cnt_iters, sink, [&]
+                                          {
+                                              auto r = res.read();
+                                              return r->size();
+                                          });
+    X3ME_ENFORCE(sink.load() == cnt_threads * cnt_iters * v.size());
+
+    std::cout << "rcu_resource. Threads: " << cnt_threads
+              << ". Reads per thread: " << cnt_iters
+              << ". Read_copy ops/sec: " << uint64_t(copy_ops)
+              << ". Read ops/sec: " << uint64_t(read_ops) << std::endl;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    const bool hash_map = (argc > 1) && (strcmp(argv[1], "hash_map") == 0);
+    const bool load = (argc > 1) && (strcmp(argv[1], "fs_table_load") == 0);
+    const bool rcu  = (argc > 1) && (strcmp(argv[1], "rcu_read") == 0);
+    if (!hash_map && !load && !rcu)
+    {
+        std::cerr << "Provide the test to run as first argument: 'hash_map', "
+                     "'fs_table_load' or 'rcu_read'. Optionally add the count "
+                     "of entries, or reads per thread for the rcu_read, as "
+                     "second argument. The full scale run of the "
+                     "hash_map needs 100M entries and about 10 GB of memory. "
+                     "The full scale run of the fs_table_load needs 50M "
+                     "entries, about 2 GB of disk space in /tmp and 6 GB of "
+                     "memory.\n";
+        return 1;
+    }
+    const uint64_t cnt = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 1000000;
+    if (cnt < 1)
+    {
+        std::cerr << "Passed count of entries must be >= 1\n";
+        return 1;
+    }
+    if (hash_map)
+        speed_test_hash_map(cnt);
+    else if (load)
+        speed_test_fs_table_load(cnt);
+    else
+        speed_test_rcu_read(cnt);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "xlog/log_msg_tag.h"
+#include "xutils/tagged_buffer_queue.h"
+
+// The previous implementation of the xlog::detail::shared_queue, guarded by
+// a mutex. Kept here only as a baseline for the speed comparison.
+// It has only the functionality needed for the speed test.
+class locked_shared_queue
+{
+    using log_msg_tag  = xlog::detail::log_msg_tag;
+    using queue_t      = xutils::tagged_buffer_queue<log_msg_tag>;
+    using lock_guard_t = std::lock_guard<std::mutex>;
+
+    queue_t queue_;
+    std::mutex mutex_;
+    std::condition_variable cond_var_;
+    uint32_t cnt_blocked_push_ = 0;
+    const uint32_t max_allowed_size_;
+    bool block_push_ = false;
+
+public:
+    using msg_type = xutils::tagged_buffer_ptr_t<log_msg_tag>;
+
+    explicit locked_shared_queue(uint32_t max_size) noexcept
+        : max_allowed_size_(max_size)
+    {
+    }
+
+    void emplace(time_t timestamp, const char* data, uint32_t size,
+                 xlog::target_id tid, xlog::level lvl, bool force) noexcept
+    {
+        using xutils::tagged_buffer;
+        auto m = tagged_buffer<log_msg_tag>::create(size, timestamp, data,
+                                                    size, tid, lvl);
+        lock_guard_t _(mutex_);
+        if ((!block_push_ && (queue_.size() <= max_allowed_size_)) || force)
+        {
+            queue_.push(std::move(m));
+            cond_var_.notify_one();
+        }
+        else
+        {
+            ++cnt_blocked_push_;
+            block_push_ = true;
+        }
+    }
+
+    bool wait_pop(msg_type& v) noexcept
+    {
+        std::unique_lock<std::mutex> lk(mutex_);
+        cond_var_.wait(lk, [this]
+                       {
+                           return !queue_.empty();
+                       });
+        v = queue_.pop();
+        return !!v;
+    }
+};
@@ -1,4 +1,6 @@
 #include "precompiled.h"
+#include "locked_shared_queue.h"
+#include "xlog/shared_queue.h"
 
 class id_tag
 {
@@ -29,12 +31,71 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static void print_result(const char* name, uint32_t cnt_lines,
+                         std::chrono::nanoseconds dur)
+{
+    using namespace std::chrono;
+    std::cout << name << ". Written lines: " << cnt_lines
+              << ". All time: " << duration_cast<milliseconds>(dur).count()
+              << " milliseconds. Single line avg. time: "
+              << dur.count() / cnt_lines << " nanoseconds" << std::endl;
+}
+
+// Measures only the queue between the logging threads and the log channel
+// thread. Every thread pushes its messages and a single thread pops them,
+// the same way as the async channel does.
+template <typename Queue>
+static void speed_test_queue(const char* name, uint32_t num_threads)
+{
+    static constexpr char log_str[]         = "this is test log message";
+    static constexpr uint32_t cnt_all_lines = 4 * 1024 * 1024;
+    const uint32_t cnt_lines                = cnt_all_lines / num_threads;
+
+    Queue queue(cnt_all_lines);
+
+    using namespace std::chrono;
+    const auto beg = high_resolution_clock::now();
+
+    std::thread consumer([&queue, cnt = cnt_lines * num_threads]
+                         {
+                             typename Queue::msg_type msg;
+                             for (uint32_t i = 0; i < cnt; ++i)
+                             {
+                                 if (!queue.wait_pop(msg))
+                                     std::abort();
+                             }
+                         });
+    std::vector<std::thread> producers;
+    producers.reserve(num_threads);
+    for (uint32_t i = 0; i < num_threads; ++i)
+    {
+        producers.push_back(std::thread(
+            [&queue, cnt_lines]
+            {
+                for (uint32_t i = 0; i < cnt_lines; ++i)
+                {
+                    queue.emplace(0, log_str, sizeof(log_str) - 1,
+                                  xlog::invalid_target_id, xlog::level::info,
+                                  false);
+                }
+            }));
+    }
+    for (auto& t : producers)
+        t.join();
+    consumer.join();
+
+    const auto end = high_resolution_clock::now();
+    print_result(name, cnt_lines * num_threads, end - beg);
+}
+
 int main(int argc, char** argv)
 {
     // Expects number of threads to run
     if (argc < 2)
     {
-        std::cerr << "Provide number of threads as a numeric argument\n";
+        std::cerr << "Provide number of threads as a numeric argument. "
+                     "Optionally add 'queue' as second argument to compare "
+                     "only the lock free and the locked log queues\n";
         return 1;
     }
     const uint32_t num_threads = atoi(argv[1]);
@@ -43,6 +104,13 @@ int main(int argc, char** argv)
         std::cerr << "Passed number of threads must be >= 1 and <= 32\n";
         return 1;
     }
+    if ((argc > 2) && (strcmp(argv[2], "queue") == 0))
+    {
+        speed_test_queue<locked_shared_queue>("Locked queue", num_threads);
+        speed_test_queue<xlog::detail::shared_queue>("Lock free queue",
+                                                     num_threads);
+        return 0;
+    }
 
     auto xlg = xlog::create_logger<id_tag>();
 
@@ -94,12 +162,7 @@ int main(int argc, char** argv)
     }
     const auto end = high_resolution_clock::now();
 
-    std::cout << "Written lines: " << cnt_lines * num_threads << ". All time: "
-              << duration_cast<milliseconds>(end - beg).count()
-              << " milliseconds. Single line avg. time: "
-              << duration_cast<nanoseconds>(end - beg).count() /
-                     (cnt_lines * num_threads)
-              << " nanoseconds" << std::endl;
+    print_result("Logger", cnt_lines * num_threads, end - beg);
 
     return 0;
 }
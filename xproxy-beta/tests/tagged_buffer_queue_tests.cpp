@@ -29,7 +29,7 @@ BOOST_AUTO_TEST_CASE(tagged_buffer_create_destroy)
 
 BOOST_AUTO_TEST_CASE(tagged_buffer_buffer)
 {
-    constexpr size_t bufsize = 16;
+    static constexpr size_t bufsize = 16;
 
     struct test_tag
     {
@@ -53,7 +53,7 @@ BOOST_AUTO_TEST_CASE(tagged_buffer_buffer)
 
 BOOST_AUTO_TEST_CASE(tagged_buffer_queue_push_pop)
 {
-    constexpr size_t bufsize = 8;
+    static constexpr size_t bufsize = 8;
 
     struct test_tag
     {
@@ -89,7 +89,7 @@ BOOST_AUTO_TEST_CASE(tagged_buffer_queue_push_pop)
 
 BOOST_AUTO_TEST_CASE(tagged_buffer_queue_emplace_pop)
 {
-    constexpr size_t bufsize = 10;
+    static constexpr size_t bufsize = 10;
 
     struct test_tag
     {
@@ -125,7 +125,7 @@ BOOST_AUTO_TEST_CASE(tagged_buffer_queue_emplace_pop)
 
 BOOST_AUTO_TEST_CASE(tagged_buffer_queue_move)
 {
-    constexpr size_t bufsize = 8;
+    static constexpr size_t bufsize = 8;
 
     struct test_tag
     {
@@ -179,7 +179,7 @@ BOOST_AUTO_TEST_CASE(tagged_buffer_queue_move)
 
 BOOST_AUTO_TEST_CASE(tagged_buffer_queue_swap)
 {
-    constexpr size_t bufsize = 8;
+    static constexpr size_t bufsize = 8;
 
     struct test_tag
     {
@@ -225,4 +225,86 @@ BOOST_AUTO_TEST_CASE(tagged_buffer_queue_swap)
     }
 }
 
+BOOST_AUTO_TEST_CASE(mpsc_tagged_buffer_queue_push_pop)
+{
+    struct test_tag
+    {
+        int i_ = 0;
+
+        test_tag(void*, size_t, int i) : i_(i) {}
+    };
+
+    using namespace xutils;
+    mpsc_tagged_buffer_queue<test_tag> queue;
+    BOOST_CHECK(!queue.pop());
+
+    // Pop everything a few times, so that the stub node gets reinserted
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int i = 0; i < 5; ++i)
+            queue.push(tagged_buffer<test_tag>::create(0, i));
+        for (int i = 0; i < 5; ++i)
+        {
+            auto p = queue.pop();
+            BOOST_REQUIRE(p);
+            BOOST_CHECK_EQUAL(i, p->i_);
+        }
+        BOOST_CHECK(!queue.pop());
+    }
+    // The destructor frees the buffers left in the queue
+    for (int i = 0; i < 5; ++i)
+        queue.push(tagged_buffer<test_tag>::create(0, i));
+}
+
+BOOST_AUTO_TEST_CASE(mpsc_tagged_buffer_queue_multi_producers)
+{
+    struct test_tag
+    {
+        uint32_t producer_ = 0;
+        uint32_t i_        = 0;
+
+        test_tag(void*, size_t, uint32_t p, uint32_t i) : producer_(p), i_(i)
+        {
+        }
+    };
+
+    constexpr uint32_t cnt_producers = 4;
+    constexpr uint32_t cnt_items     = 20000;
+
+    using namespace xutils;
+    mpsc_tagged_buffer_queue<test_tag> queue;
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < cnt_producers; ++p)
+    {
+        producers.emplace_back([&queue, p]
+                               {
+                                   for (uint32_t i = 0; i < cnt_items; ++i)
+                                       queue.push(
+                                           tagged_buffer<test_tag>::create(
+                                               0, p, i));
+                               });
+    }
+
+    // The items of every producer must come in the order of their push
+    std::array<uint32_t, cnt_producers> next_items{};
+    uint32_t cnt_popped = 0;
+    while (cnt_popped < (cnt_producers * cnt_items))
+    {
+        auto p = queue.pop();
+        if (!p)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        BOOST_REQUIRE_LT(p->producer_, cnt_producers);
+        BOOST_REQUIRE_EQUAL(p->i_, next_items[p->producer_]);
+        ++next_items[p->producer_];
+        ++cnt_popped;
+    }
+    for (auto& t : producers)
+        t.join();
+    BOOST_CHECK(!queue.pop());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,20 +7,11 @@ namespace xlog
 namespace detail
 {
 
-// N.B. The notify of the condition_variable is moved intentionally into
-// the lock scope. The reasons are the following:
-// 1. There are two possible pthreads implementations. In the first one
-// the thread waiting on a condition variable will not be wakeup immediately
-// when the condition variable is notified, but instead it'll be put in
-// the mutex queue for wakeup when the mutex gets unlocked. In the second
-// implementation it's more effective to notify the condition variable outside
-// the mutex lock because the waiting thread may get waked-up just to be
-// put again on sleep in order to wait for the mutex to get unlocked. However,
-// a lot of people claim that you can't rely on particular pthread
-// implementation and this whole thing is a micro-optimization without
-// visible effect.
-// 2. Moving the condition_variable notify inside the mutex scope supresses
-// valgrind (helgrind) warnings about this (although they are false positive).
+// N.B. The notify of the condition_variable is done intentionally into
+// the lock scope. The consumer checks the queue size after it has marked
+// itself as waiting, under the lock. If the notify is done without the lock,
+// it could happen between the size check and the actual wait and the
+// consumer would miss it.
 
 shared_queue::shared_queue(uint32_t max_size) noexcept
     : max_allowed_size_(max_size)
@@ -35,62 +26,69 @@ void shared_queue::emplace(time_t timestamp, const char* data, uint32_t size,
                            target_id tid, level lvl, bool force) noexcept
 {
     using xutils::tagged_buffer;
-    // Create the message outside the lock
-    auto m = tagged_buffer<log_msg_tag>::create(size, timestamp, data, size,
-                                                tid, lvl);
+    // The limit check is not precise when many threads push concurrently.
+    // The queue may get a few more messages than the max allowed size, but
+    // this doesn't matter.
+    if ((!block_push_.load(std::memory_order_acquire) &&
+         (size_.load(std::memory_order_relaxed) <= max_allowed_size_)) ||
+        force)
     {
-        lock_guard_t _(mutex_);
-        if ((!block_push_ && (queue_.size() <= max_allowed_size_)) || force)
+        auto m = tagged_buffer<log_msg_tag>::create(size, timestamp, data,
+                                                    size, tid, lvl);
+        // The size is incremented before the push, so that the consumer
+        // knows that there is a message coming, even if it can't pop it yet.
+        size_.fetch_add(1, std::memory_order_seq_cst);
+        queue_.push(std::move(m));
+        if (pop_waiting_.load(std::memory_order_seq_cst))
         {
-            queue_.push(std::move(m));
+            lock_guard_t _(mutex_);
             cond_var_.notify_one();
         }
-        else
-        {
-            ++cnt_blocked_push_;
-            block_push_ = true;
-        }
+    }
+    else
+    {
+        cnt_blocked_push_.fetch_add(1, std::memory_order_relaxed);
+        block_push_.store(true, std::memory_order_release);
     }
 }
 
 shared_queue::pop_result shared_queue::wait_pop(msg_type& v) noexcept
 {
-    pop_result res;
-
-    std::unique_lock<std::mutex> lk(mutex_);
-    cond_var_.wait(lk, [this]
-                   {
-                       return !queue_.empty() || unblock_pop_;
-                   });
-    unblock_pop_ = false;
-    const auto s = queue_.size();
-    if (s > 0)
+    for (;;)
     {
-        v = queue_.pop();
-
-        // We intentionally return the size before pop in order to
-        // indicate that the pop succeeds.
-        res.queue_size_   = s;
-        res.push_blocked_ = block_push_;
+        if (unblock_pop_.exchange(false, std::memory_order_acq_rel))
+            return try_pop(v);
+        if (auto res = try_pop(v))
+            return res;
+        if (size_.load(std::memory_order_seq_cst) > 0)
+        {
+            // A producer is in the middle of the push. It'll finish soon.
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(mutex_);
+        pop_waiting_.store(true, std::memory_order_seq_cst);
+        cond_var_.wait(lk, [this]
+                       {
+                           return (size_.load(std::memory_order_seq_cst) >
+                                   0) ||
+                                  unblock_pop_.load(std::memory_order_acquire);
+                       });
+        pop_waiting_.store(false, std::memory_order_relaxed);
     }
-
-    return res;
 }
 
 shared_queue::pop_result shared_queue::try_pop(msg_type& v) noexcept
 {
     pop_result res;
 
-    lock_guard_t _(mutex_);
-    const auto s = queue_.size();
-    if (s > 0)
+    if (auto m = queue_.pop())
     {
-        v = queue_.pop();
-
+        v = std::move(m);
         // We intentionally return the size before pop in order to
         // indicate that the pop succeeds.
-        res.queue_size_   = s;
-        res.push_blocked_ = block_push_;
+        res.queue_size_   = size_.fetch_sub(1, std::memory_order_acq_rel);
+        res.push_blocked_ = block_push_.load(std::memory_order_acquire);
     }
 
     return res;
@@ -98,38 +96,35 @@ shared_queue::pop_result shared_queue::try_pop(msg_type& v) noexcept
 
 void shared_queue::block_push() noexcept
 {
-    lock_guard_t _(mutex_);
-    block_push_ = true;
+    block_push_.store(true, std::memory_order_release);
 }
 
 void shared_queue::unblock_push() noexcept
 {
-    lock_guard_t _(mutex_);
-    cnt_blocked_push_ = 0;
-    block_push_       = false;
+    cnt_blocked_push_.store(0, std::memory_order_relaxed);
+    block_push_.store(false, std::memory_order_release);
 }
 
 void shared_queue::unblock_pop() noexcept
 {
     lock_guard_t _(mutex_);
-    unblock_pop_ = true;
+    unblock_pop_.store(true, std::memory_order_release);
     cond_var_.notify_one();
 }
 
 void shared_queue::unblock_pop_if_empty() noexcept
 {
     lock_guard_t _(mutex_);
-    if (queue_.empty())
+    if (size_.load(std::memory_order_seq_cst) == 0)
     {
-        unblock_pop_ = true;
+        unblock_pop_.store(true, std::memory_order_release);
         cond_var_.notify_one();
     }
 }
 
 uint32_t shared_queue::count_blocked_push() const noexcept
 {
-    lock_guard_t _(mutex_);
-    return cnt_blocked_push_;
+    return cnt_blocked_push_.load(std::memory_order_relaxed);
 }
 
 } // namespace detail
@@ -8,18 +8,25 @@ namespace xlog
 namespace detail
 {
 
+// The log messages are pushed from many threads and popped from the single
+// logging thread. The push is lock free. The mutex and the condition variable
+// are used only to wake up the logging thread when it sleeps waiting for
+// messages.
 class shared_queue
 {
-    using queue_t      = xutils::tagged_buffer_queue<log_msg_tag>;
+    using queue_t      = xutils::mpsc_tagged_buffer_queue<log_msg_tag>;
     using lock_guard_t = std::lock_guard<std::mutex>;
 
     queue_t queue_;
-    mutable std::mutex mutex_;
-    std::condition_variable cond_var_;
-    uint32_t cnt_blocked_push_ = 0;
+    // Counts also the messages which are currently being pushed
+    alignas(64) std::atomic<uint32_t> size_{0};
+    std::atomic<uint32_t> cnt_blocked_push_{0};
+    std::atomic_bool block_push_{false};
+    std::atomic_bool unblock_pop_{false};
+    std::atomic_bool pop_waiting_{false};
     const uint32_t max_allowed_size_;
-    bool block_push_  = false;
-    bool unblock_pop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cond_var_;
 
 public:
     using msg_type = xutils::tagged_buffer_ptr_t<log_msg_tag>;
@@ -85,7 +85,16 @@ bool xproxy::init() noexcept
 
     handle_sys_signal();
 
-    accept_connection();
+    if (settings_.main_reuse_port())
+    {
+        // Every net worker starts accepting when its thread gets started
+        for (size_t i = 0; i < net_workers_.size(); ++i)
+            accept_worker_connection(i);
+    }
+    else
+    {
+        accept_connection();
+    }
 
     return true;
 }
@@ -99,12 +108,23 @@ void xproxy::run_impl(bool fast_exit) noexcept
     std::atomic_uint cnt_failed(0);
     boost::latch latch(net_workers_.size());
 
-    for (auto& s : net_workers_)
+    const bool pin_threads = settings_.main_reuse_port_cpu_steering();
+    for (size_t i = 0; i < net_workers_.size(); ++i)
     {
+        auto& s = net_workers_[i];
         net_threads.emplace_back(
-            [&s, &latch, &cnt_failed]
+            [&s, &latch, &cnt_failed, i, pin_threads]
             {
                 set_this_thread_name("xproxy_net");
+                err_code_t cpu_err;
+                if (pin_threads && !xutils::set_this_thread_cpu(i, cpu_err))
+                {
+                    // Not fatal. The connections still get served, but
+                    // by a thread on another CPU.
+                    XLOG_ERROR(main_tag, "Unable to pin net thread {} to its "
+                                         "CPU. {}",
+                               i, cpu_err.message());
+                }
                 if (auto err = s.bp_ctrl_.init())
                 {
                     XLOG_FATAL(main_tag, "Unable to init back pressure control "
@@ -322,6 +342,15 @@ bool xproxy::relinquish_privileges() noexcept
 
 bool xproxy::setup_acceptor() noexcept
 {
+    if (settings_.main_reuse_port())
+        return setup_worker_acceptors();
+    if (settings_.main_reuse_port_cpu_steering())
+    {
+        XLOG_FATAL(main_tag, "The CPU steering of the connections works only "
+                             "together with the reuse_port setting");
+        return false;
+    }
+
     const tcp_endpoint_t bind_ep(settings_.main_bind_ip(),
                                  settings_.main_bind_port());
     try
@@ -343,6 +372,102 @@ bool xproxy::setup_acceptor() noexcept
     return true;
 }
 
+bool xproxy::setup_worker_acceptors() noexcept
+{
+    const bool cpu_steering = settings_.main_reuse_port_cpu_steering();
+    // The BPF program maps the CPU number to the socket index. The threads
+    // get pinned to the CPU with the same number as their worker index.
+    if (cpu_steering &&
+        (net_workers_.size() != std::thread::hardware_concurrency()))
+    {
+        XLOG_FATAL(main_tag, "The CPU steering of the connections needs "
+                             "exactly one net worker per CPU. Net workers {}. "
+                             "CPUs {}",
+                   net_workers_.size(), std::thread::hardware_concurrency());
+        return false;
+    }
+
+    const tcp_endpoint_t bind_ep(settings_.main_bind_ip(),
+                                 settings_.main_bind_port());
+    // The sockets must be added to the reuse port group in the order of
+    // the net workers. The kernel adds them in the order of the listen calls.
+    for (size_t i = 0; i < net_workers_.size(); ++i)
+    {
+        auto& acceptor = net_workers_[i].acceptor_;
+        try
+        {
+            using boost::asio::socket_base;
+            acceptor.open(bind_ep.protocol());
+            acceptor.set_option(socket_base::reuse_address(true));
+            acceptor.set_option(x3me_sockopt::reuse_port(true));
+            acceptor.set_option(x3me_sockopt::transparent_mode(true));
+            acceptor.bind(bind_ep);
+            // The min value of SOMAXCONN and /proc/sys/net/core/somaxconn
+            acceptor.listen(socket_base::max_connections);
+        }
+        catch (const std::exception& ex)
+        {
+            XLOG_FATAL(main_tag, "Unable to setup the TCP acceptor of net "
+                                 "worker {} on {}. {}",
+                       i, bind_ep, ex.what());
+            return false;
+        }
+    }
+    if (cpu_steering)
+    {
+        // The program is attached to the whole group via any of its sockets
+        err_code_t err;
+        if (!xutils::attach_reuseport_cpu_bpf(
+                net_workers_[0].acceptor_.native_handle(),
+                net_workers_.size(), err))
+        {
+            XLOG_FATAL(main_tag, "Unable to attach the CPU steering program "
+                                 "to the TCP acceptors on {}. {}",
+                       bind_ep, err.message());
+            return false;
+        }
+    }
+    XLOG_INFO(main_tag, "Every net worker accepts connections on {}. "
+                        "CPU steering {}",
+              bind_ep, cpu_steering);
+    return true;
+}
+
+namespace
+{
+// Returns false if the acceptor has been stopped
+bool handle_accept_error(const err_code_t& err) noexcept
+{
+    // Every thread accepting connections has its own counter
+    static thread_local uint64_t print_cnt = 0;
+    if (!err)
+    {
+        print_cnt = 0;
+    }
+    else if (err == boost::system::errc::too_many_files_open)
+    {
+        // Don't log this message all the time if we constantly
+        // hit the limit.
+        if ((print_cnt % 25) == 0)
+        {
+            XLOG_ERROR(main_tag,
+                       "'open files' limit is reached. May eat up the CPUs");
+        }
+        // This is going to eat 100% CPU if the limit is constantly
+        // reached
+    }
+    else if (err != asio_error::operation_aborted)
+    {
+        XLOG_WARN(main_tag, "Accept connection error. {}", err.message());
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+} // namespace
+
 void xproxy::accept_connection() noexcept
 {
     // We don't want atomic reference counting for the sockets here, because
@@ -352,40 +477,45 @@ void xproxy::accept_connection() noexcept
     acceptor_.async_accept(
         sock->data_, [sock, this](const err_code_t& err)
         {
-            static uint64_t print_cnt = 0;
             if (!err)
-            {
-                print_cnt = 0;
                 distribute_connection(std::move(sock->data_));
+            if (handle_accept_error(err))
                 accept_connection(); // Accept new one
-            }
-            else if (err == boost::system::errc::too_many_files_open)
+        });
+}
+
+void xproxy::accept_worker_connection(net_thread_id_t net_tid) noexcept
+{
+    auto& wrk = net_workers_[net_tid];
+    // The socket is accepted directly in the io_service of the worker and
+    // doesn't need to be passed between threads.
+    auto sock = xutils::make_ref_counted<tcp_socket_t>(wrk.ios_);
+
+    wrk.acceptor_.async_accept(
+        sock->data_, [sock, net_tid, this](const err_code_t& err)
+        {
+            if (!err)
             {
-                // Don't log this message all the time if we constantly
-                // hit the limit.
-                if ((print_cnt % 25) == 0)
+                try
                 {
-                    XLOG_ERROR(
-                        main_tag,
-                        "'open files' limit is reached. May eat up the CPUs");
+                    start_connection(std::move(sock->data_),
+                                     next_session_id(), net_workers_[net_tid],
+                                     net_tid, cache_mgr_);
+                }
+                catch (const boost::system::system_error& ex)
+                {
+                    // This fails because of already disconnected transport
+                    // endpoint in 99% of the cases.
+                    XLOG_INFO(main_tag,
+                              "Error when initializing proxy connection. {}",
+                              ex.what());
                 }
-                // This is going to eat 100% CPU if the limit is constantly
-                // reached
-                accept_connection();
-            }
-            else if (err != asio_error::operation_aborted)
-            {
-                XLOG_WARN(main_tag, "Accept connection error. {}",
-                          err.message());
-                accept_connection();
             }
+            if (handle_accept_error(err))
+                accept_worker_connection(net_tid); // Accept new one
         });
 }
 
-#ifdef X3ME_APP_TEST
-extern tcp_endpoint_t g_server_ep;
-#endif
-
 void xproxy::distribute_connection(tcp_socket_t&& sock) noexcept
 {
     const int sock_fd = ::dup(sock.native_handle());
@@ -399,7 +529,7 @@ void xproxy::distribute_connection(tcp_socket_t&& sock) noexcept
         return;
     }
 
-    const auto sess_id            = curr_session_id_++;
+    const auto sess_id            = next_session_id();
     auto& wrk                     = net_workers_[curr_net_worker_];
     const net_thread_id_t net_idx = curr_net_worker_;
     auto cache_mgr                = &cache_mgr_;
@@ -413,27 +543,8 @@ void xproxy::distribute_connection(tcp_socket_t&& sock) noexcept
             {
                 using namespace boost::asio;
                 tcp_socket_t client_sock(wrk.ios_, ip::tcp::v4(), sock_fd);
-
-                auto tag = net_tag;
-                tag.set_session_id(sess_id);
-#ifndef X3ME_APP_TEST
-                // Some of these may throw
-                tag.set_user_endpoint(client_sock.remote_endpoint());
-                tag.set_server_endpoint(client_sock.local_endpoint());
-#else
-                // We need to bind to the server IP if we want the test
-                // scheme to work. At least we use the client port :).
-                auto ep = client_sock.local_endpoint();
-                ep.port(client_sock.remote_endpoint().port());
-                tag.set_user_endpoint(ep);
-                tag.set_server_endpoint(g_server_ep);
-#endif // X3ME_APP_TEST
-                auto conn = net::make_proxy_conn(
-                    tag, std::move(client_sock), http::client_rbuf_block_size,
-                    http::origin_rbuf_block_size, wrk.stats_.net_stats_,
-                    net_idx);
-                conn->start(http::make_handler_factory(
-                    *cache_mgr, wrk.stats_.http_stats_, wrk.bp_ctrl_));
+                start_connection(std::move(client_sock), sess_id, wrk, net_idx,
+                                 *cache_mgr);
             }
             catch (const boost::system::system_error& err)
             {
@@ -445,8 +556,44 @@ void xproxy::distribute_connection(tcp_socket_t&& sock) noexcept
             }
         });
     curr_net_worker_ = (curr_net_worker_ + 1) % net_workers_.size();
-    if (curr_session_id_ == 0) // Overflow
-        curr_session_id_ = 1; // Better for non-programmers to start from 1, IMO
+}
+
+#ifdef X3ME_APP_TEST
+extern tcp_endpoint_t g_server_ep;
+#endif
+
+void xproxy::start_connection(tcp_socket_t&& client_sock,
+                              id_tag::sess_id_t sess_id, net_worker& wrk,
+                              net_thread_id_t net_idx, cache::cache_mgr& cmgr)
+{
+    auto tag = net_tag;
+    tag.set_session_id(sess_id);
+#ifndef X3ME_APP_TEST
+    // Some of these may throw
+    tag.set_user_endpoint(client_sock.remote_endpoint());
+    tag.set_server_endpoint(client_sock.local_endpoint());
+#else
+    // We need to bind to the server IP if we want the test
+    // scheme to work. At least we use the client port :).
+    auto ep = client_sock.local_endpoint();
+    ep.port(client_sock.remote_endpoint().port());
+    tag.set_user_endpoint(ep);
+    tag.set_server_endpoint(g_server_ep);
+#endif // X3ME_APP_TEST
+    auto conn = net::make_proxy_conn(
+        tag, std::move(client_sock), http::client_rbuf_block_size,
+        http::origin_rbuf_block_size, wrk.stats_.net_stats_, net_idx);
+    conn->start(http::make_handler_factory(cmgr, wrk.stats_.http_stats_,
+                                           wrk.bp_ctrl_, wrk.fresh_idx_));
+}
+
+id_tag::sess_id_t xproxy::next_session_id() noexcept
+{
+    auto ret = curr_session_id_.fetch_add(1, std::memory_order_relaxed);
+    // Better for non-programmers to start from 1, IMO
+    if (ret == 0) // Overflow
+        ret = curr_session_id_.fetch_add(1, std::memory_order_relaxed);
+    return ret;
 }
 
 void xproxy::schedule_check_half_closed(net_thread_id_t net_tid) noexcept
@@ -544,6 +691,21 @@ void xproxy::set_subsystems_settings() noexcept
     net::proxy_conn::tos_mark_miss = (settings_.main_dscp_miss() << 2);
 
     http::constants::bpctrl_window_size = settings_.main_kmod_def_window();
+    // The settings ensure that it's zero when the fresh index is disabled
+    http::constants::max_dechunked_size =
+        settings_.cache_dechunk_max_KB() * 1024U;
+    http::constants::max_dechunked_total =
+        bytes64_t(settings_.cache_dechunk_total_MB()) * 1024U * 1024U;
+
+    // Every net thread has its own index and thus part of the memory
+    const bytes64_t fresh_idx_size =
+        (bytes64_t(settings_.cache_fresh_index_MB()) * 1024U * 1024U) /
+        net_workers_.size();
+    for (auto& w : net_workers_)
+    {
+        w.fresh_idx_.set_max_size(fresh_idx_size,
+                                  settings_.cache_fresh_max_ttl_sec());
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -4,6 +4,7 @@
 #include "cache/cache_mgr.h"
 #include "http/http_stats.h"
 #include "http/http_bp_ctl.h"
+#include "http/fresh_index.h"
 #include "net/net_stats.h"
 #include "plgns/plugins_mgr.h"
 
@@ -23,14 +24,17 @@ class xproxy
     {
         worker_stats stats_;
         http::http_bp_ctl bp_ctrl_;
+        http::fresh_index fresh_idx_;
 
         // The async objects living inside the io_service_t needs to be
         // destroyed before above members because they may be referencing
         // some of them in their destructors.
         io_service_t ios_;
         std_timer_t half_closed_tmr_; // Used to close inactive half closed
+        // Used only if every net worker accepts its own connections
+        tcp_acceptor_t acceptor_;
 
-        net_worker() : half_closed_tmr_(ios_) {}
+        net_worker() : half_closed_tmr_(ios_), acceptor_(ios_) {}
     };
 
     const settings& settings_;
@@ -51,7 +55,8 @@ class xproxy
     std::vector<net_worker> net_workers_;
     net_thread_id_t curr_net_worker_ = 0; // To post the next connection
 
-    id_tag::sess_id_t curr_session_id_ = 1;
+    // Atomic because the net workers may accept connections themselves
+    std::atomic<id_tag::sess_id_t> curr_session_id_{1};
 
     mgmt::mgmt_server mgmt_server_;
 
@@ -76,8 +81,15 @@ private:
     bool init_mgmt_server() noexcept;
     bool relinquish_privileges() noexcept;
     bool setup_acceptor() noexcept;
+    bool setup_worker_acceptors() noexcept;
     void accept_connection() noexcept;
+    void accept_worker_connection(net_thread_id_t net_tid) noexcept;
     void distribute_connection(tcp_socket_t&& s) noexcept;
+    // Throws boost::system::system_error if the socket is already unusable
+    static void start_connection(tcp_socket_t&& s, id_tag::sess_id_t sess_id,
+                                 net_worker& wrk, net_thread_id_t net_idx,
+                                 cache::cache_mgr& cmgr);
+    id_tag::sess_id_t next_session_id() noexcept;
     void schedule_check_half_closed(net_thread_id_t net_tid) noexcept;
     void check_half_closed(net_thread_id_t net_tid) noexcept;
     void handle_sys_signal() noexcept;
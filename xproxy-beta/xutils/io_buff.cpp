@@ -142,6 +142,60 @@ void io_buff::commit(uint32_t bytes) noexcept
     wr_offset_            = new_offset % capacity();
 }
 
+uint32_t io_buff::bytes_avail_shared() const noexcept
+{
+    const auto avail = bytes_avail_wr();
+    // A whole block can't be free in a buffer with less than two blocks
+    if (blocks_.size() < 2)
+        return avail;
+    // Fill the partially written block, if any, and refer to the memory
+    // from the following whole free blocks.
+    const auto rel_off = wr_offset_ % block_size_;
+    const auto head    = rel_off ? std::min(avail, block_size_ - rel_off) : 0;
+    const auto whole   = ((avail - head) / block_size_) * block_size_;
+    // There is always a whole free block when all data has been read
+    return (whole > 0) ? (head + whole) : 0;
+}
+
+uint32_t io_buff::write_shared(const shared_mem_t& mem, uint32_t len) noexcept
+{
+    assert((len <= bytes_avail_wr()) && "Write too much");
+
+    auto data       = static_cast<const char*>(mem.get());
+    uint32_t shared = 0;
+    while (len > 0)
+    {
+        const auto blk_idx = wr_offset_ / block_size_;
+        const auto rel_off = wr_offset_ % block_size_;
+        auto& blk          = *std::next(blocks_.begin(), blk_idx);
+        uint32_t bytes     = 0;
+        if ((rel_off == 0) && (len >= block_size_))
+        {
+            // The whole block is free. None of the readers needs its data.
+            cnt_shared_blocks_ += !blk.shared_;
+            blk.shared_ = mem;
+            // The readers get read-only access to the block memory and the
+            // writer unshares the block before writing to it.
+            blk.ptr_ = const_cast<char*>(data);
+            bytes    = block_size_;
+            shared += bytes;
+        }
+        else
+        {
+            assert(((rel_off == 0) || !blk.shared_) &&
+                   "The writer must not be in the middle of a shared block");
+            if (blk.shared_)
+                unshare(blk, blk_idx * block_size_);
+            bytes = std::min(len, block_size_ - rel_off);
+            ::memcpy(blk.ptr_ + rel_off, data, bytes);
+        }
+        data += bytes;
+        len -= bytes;
+        commit(bytes);
+    }
+    return shared;
+}
+
 io_buff_it io_buff::begin() noexcept
 {
     io_buff_it it{};
@@ -154,6 +208,8 @@ io_buff_it io_buff::begin() noexcept
         it.block_           = &(*std::next(blocks_.begin(), wr_off_blocks));
         it.curr_off_        = wr_offset_;
         it.remaining_bytes_ = bytes;
+
+        unshare_wr_blocks(bytes);
     }
     return it;
 }
@@ -204,6 +260,47 @@ io_buff::block_t io_buff::get_block(const io_buff_it& it) noexcept
     return block_t{it.block_->ptr_ + rel_off, len};
 }
 
+void io_buff::unshare_wr_blocks(uint32_t bytes) noexcept
+{
+    if (cnt_shared_blocks_ == 0)
+        return;
+    const auto blk_idx = wr_offset_ / block_size_;
+    auto blk_off       = blk_idx * block_size_;
+    auto it            = std::next(blocks_.begin(), blk_idx);
+    uint64_t rem       = (wr_offset_ - blk_off) + uint64_t(bytes);
+    while (rem > 0)
+    {
+        if (it->shared_)
+            unshare(*it, blk_off);
+        rem -= std::min<uint64_t>(rem, block_size_);
+        blk_off += block_size_;
+        if (++it == blocks_.end())
+        {
+            it      = blocks_.begin();
+            blk_off = 0;
+        }
+    }
+}
+
+void io_buff::unshare(mem_block& blk, buf_off_t blk_off) noexcept
+{
+    assert(blk.shared_ && "The block doesn't refer to external memory");
+    // The writer gets to a shared block only at its begin. A reader in the
+    // middle of the block hasn't read the rest of the block data yet.
+    const auto blk_end = blk_off + block_size_;
+    const bool unread  = std::any_of(rdr_offsets_.begin(), rdr_offsets_.end(),
+                                    [&](buf_off_t off)
+                                    {
+                                        return (blk_off < off) &&
+                                               (off < blk_end);
+                                    });
+    if (unread)
+        ::memcpy(blk.own_mem(), blk.ptr_, block_size_);
+    blk.ptr_ = blk.own_mem();
+    blk.shared_.reset();
+    --cnt_shared_blocks_;
+}
+
 io_buff::buf_off_t io_buff::rdr_min_offset() const noexcept
 {
     return !rdr_offsets_.empty()
@@ -9,6 +9,11 @@ class io_buff_it;
 /// Provides an interface to a circular queue of fixed size io_buff_block's.
 class io_buff
 {
+public:
+    /// The owner of an external memory, which the buffer blocks may refer to
+    /// instead of copying it.
+    using shared_mem_t = std::shared_ptr<const void>;
+
 private:
     friend io_buff_reader;
     friend io_buff_it;
@@ -19,9 +24,13 @@ private:
     struct mem_block : public list_hook_t
     {
         char* ptr_;
+        // Set while the block refers to external memory instead of its own.
+        shared_mem_t shared_;
 
         explicit mem_block(char* ptr) noexcept : ptr_(ptr) {}
         static mem_block* alloc(uint32_t size) noexcept;
+
+        char* own_mem() noexcept { return reinterpret_cast<char*>(this + 1); }
     };
 
     using buf_off_t = uint32_t;
@@ -34,6 +43,7 @@ private:
     block_list_t blocks_;
     const uint32_t block_size_;
     buf_off_t wr_offset_;
+    uint32_t cnt_shared_blocks_ = 0;
     std::vector<buf_off_t> rdr_offsets_;
 
 public:
@@ -63,6 +73,16 @@ public:
     /// Add (count) bytes to the use/read section, increases the use section of
     /// the buffer.
     void commit(uint32_t bytes) noexcept;
+    /// Returns how many bytes to write with write_shared, so that most of
+    /// them are referred instead of copied. Returns zero when it's better
+    /// to wait until the readers free a whole block.
+    uint32_t bytes_avail_shared() const noexcept;
+    /// Writes and commits (len) bytes of the given external memory.
+    /// The whole free blocks refer to the memory instead of copying it.
+    /// The memory must not be modified while referred. It's released when
+    /// the block gets written again or when the buffer gets destroyed.
+    /// Returns the count of the referred bytes.
+    uint32_t write_shared(const shared_mem_t& mem, uint32_t len) noexcept;
     /// Returns an iterator to the first block of the buffer.
     io_buff_it begin() noexcept;
     /// Returns an iterator to the block following the last block of the buffer.
@@ -75,6 +95,11 @@ private:
     void next_it(io_buff_it& it) noexcept;
     block_t get_block(const io_buff_it& it) noexcept;
 
+    // The writer can't write to external memory. Thus the blocks which it
+    // may write to go back to their own memory.
+    void unshare_wr_blocks(uint32_t bytes) noexcept;
+    void unshare(mem_block& blk, buf_off_t blk_off) noexcept;
+
     buf_off_t rdr_min_offset() const noexcept;
     buf_off_t next_rdr_offset_or(buf_off_t off, buf_off_t def) const noexcept;
 };
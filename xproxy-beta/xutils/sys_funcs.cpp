@@ -29,4 +29,40 @@ bool set_max_count_fds(uint32_t cnt, err_code_t& err)
     return true;
 }
 
+bool set_this_thread_cpu(uint32_t cpu, err_code_t& err)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    const int res = ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus),
+                                             &cpus);
+    if (res != 0)
+    {
+        err.assign(res, boost::system::system_category());
+        return false;
+    }
+    return true;
+}
+
+bool attach_reuseport_cpu_bpf(int sock_fd, uint32_t cnt_socks,
+                              err_code_t& err)
+{
+    // A = cpu_id; A = A % cnt_socks; return A;
+    sock_filter code[] = {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, uint32_t(SKF_AD_OFF + SKF_AD_CPU)},
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, cnt_socks},
+        {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    sock_fprog prog;
+    prog.len    = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (::setsockopt(sock_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                     sizeof(prog)) != 0)
+    {
+        err.assign(errno, boost::system::system_category());
+        return false;
+    }
+    return true;
+}
+
 } // namespace xutils
@@ -8,4 +8,18 @@ namespace xutils
 /// In case of error the 'err' is filled with info about it.
 bool set_max_count_fds(uint32_t cnt, err_code_t& err);
 
+/// Pins the calling thread to the given CPU.
+/// Returns true in case of success and false otherwise.
+/// In case of error the 'err' is filled with info about it.
+bool set_this_thread_cpu(uint32_t cpu, err_code_t& err);
+
+/// Attaches BPF program to the SO_REUSEPORT group of the given listening
+/// socket. The program selects the socket with index equal to the
+/// number of the CPU processing the connection, modulo the 'cnt_socks'.
+/// The socket index is the order in which the sockets are added to the group.
+/// Returns true in case of success and false otherwise.
+/// In case of error the 'err' is filled with info about it.
+bool attach_reuseport_cpu_bpf(int sock_fd, uint32_t cnt_socks,
+                              err_code_t& err);
+
 } // namespace xutils
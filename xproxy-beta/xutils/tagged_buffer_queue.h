@@ -12,11 +12,19 @@ namespace detail
 {
 using list_hook_t = boost::intrusive::list_base_hook<
     boost::intrusive::link_mode<boost::intrusive::safe_link>>;
+
+// Used by the lock free mpsc_tagged_buffer_queue
+struct mpsc_hook
+{
+    std::atomic<mpsc_hook*> mpsc_next_{nullptr};
+};
 } // namespace detail
 ////////////////////////////////////////////////////////////////////////////////
 
 template <typename Tag>
-class tagged_buffer : public detail::list_hook_t, public Tag
+class tagged_buffer : public detail::list_hook_t,
+                      public detail::mpsc_hook,
+                      public Tag
 {
     template <typename... Args>
     tagged_buffer(void* buff, size_t size, Args&&... args)
@@ -118,4 +126,92 @@ public:
     size_type size() const noexcept { return impl_.size(); }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+
+/// Lock free, multiple producers single consumer, queue of tagged buffers.
+/// It's the intrusive queue of Dmitry Vyukov. The push is wait free, a single
+/// atomic exchange. The pop is lock free, but it may not see the last pushed
+/// buffer for a short time, while a producer is in the middle of its push.
+/// The users of the queue need to take care for such cases, if they are
+/// important for them.
+template <typename Tag>
+class mpsc_tagged_buffer_queue
+{
+    using node_t = detail::mpsc_hook;
+
+    // The producers and the consumer work on different cache lines
+    alignas(64) std::atomic<node_t*> head_;
+    alignas(64) node_t* tail_;
+    node_t stub_;
+
+public:
+    using value_type = tagged_buffer_ptr_t<Tag>;
+
+public:
+    mpsc_tagged_buffer_queue() noexcept : head_(&stub_), tail_(&stub_) {}
+    ~mpsc_tagged_buffer_queue() noexcept
+    {
+        while (pop())
+        {
+        }
+    }
+
+    mpsc_tagged_buffer_queue(const mpsc_tagged_buffer_queue&) = delete;
+    mpsc_tagged_buffer_queue&
+    operator=(const mpsc_tagged_buffer_queue&) = delete;
+    mpsc_tagged_buffer_queue(mpsc_tagged_buffer_queue&&) = delete;
+    mpsc_tagged_buffer_queue& operator=(mpsc_tagged_buffer_queue&&) = delete;
+
+    /// Thread safe. Can be called from multiple threads.
+    void push(value_type&& v) noexcept { push_node(v.release()); }
+
+    /// Must be called only from the single consumer thread.
+    /// Returns an empty pointer if the queue is empty, or if the next buffer
+    /// is currently being pushed.
+    value_type pop() noexcept
+    {
+        node_t* tail = tail_;
+        node_t* next = tail->mpsc_next_.load(std::memory_order_acquire);
+        if (tail == &stub_)
+        {
+            if (!next)
+                return value_type{};
+            // Skip the stub node
+            tail_ = next;
+            tail  = next;
+            next  = next->mpsc_next_.load(std::memory_order_acquire);
+        }
+        if (next)
+        {
+            tail_ = next;
+            return to_value(tail);
+        }
+        if (tail != head_.load(std::memory_order_acquire))
+            return value_type{}; // A producer is in the middle of the push
+        // The tail is the last node. We need to put the stub after it,
+        // so that we can unlink the tail from the queue.
+        push_node(&stub_);
+        next = tail->mpsc_next_.load(std::memory_order_acquire);
+        if (next)
+        {
+            tail_ = next;
+            return to_value(tail);
+        }
+        return value_type{}; // A producer got in front of the stub
+    }
+
+private:
+    void push_node(node_t* n) noexcept
+    {
+        n->mpsc_next_.store(nullptr, std::memory_order_relaxed);
+        node_t* prev = head_.exchange(n, std::memory_order_acq_rel);
+        prev->mpsc_next_.store(n, std::memory_order_release);
+    }
+
+    static value_type to_value(node_t* n) noexcept
+    {
+        return value_type(static_cast<tagged_buffer<Tag>*>(n));
+    }
+};
+
 } // namespace xutils